@@ -0,0 +1,628 @@
+/***************************************************************************************
+ * DRAW
+ * 		Tile art and layout, see draw.h. Moved out of main.c as it was so the host
+ * 		tools draw with the same code.
+ **************************************************************************************/
+#include "draw.h"
+#include "engine.h"
+#include "profile.h"
+
+/***************************************************************************************
+ * DRAW SQUARE
+ * 		Based on the piece, this draws the outer then inner square starting at the top
+ * 		left x, y position. Different pieces have different colors.
+ **************************************************************************************/
+void drawSquare(int x0, int y, int pieceNumber) {
+	int i;
+	// because we have to split up the location bytes for y
+	int y0 = y / 256;
+	int y1 = y % 256;
+	int y2 = (y+19) / 256;
+	int y3 = (y+19) % 256;
+	int y4 = (y+2) / 256;
+	int y5 = (y+2) % 256;
+	int y6 = (y+17) / 256;
+	int y7 = (y+17) % 256;
+	PROF_START();
+
+	// outer square
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(x0);					// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(x0+19);			// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(y0);					// Setup beginning row address
+	writeLCDData(y1);					// Setup beginning row address
+	writeLCDData(y2);					// Setup ending row address
+	writeLCDData(y3);					// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	switch (pieceNumber) {
+	case 0:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x110F >> 8);		// Write data to LCD memory
+			writeLCDData(0x110F & 0xff);	// Write data to LCD memory
+			writeLCDData(0x110F >> 8);		// Write data to LCD memory
+			writeLCDData(0x110F & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 1:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x69D6 >> 8);		// Write data to LCD memory
+			writeLCDData(0x69D6 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x69D6 >> 8);		// Write data to LCD memory
+			writeLCDData(0x69D6 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 2:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x24BD >> 8);		// Write data to LCD memory
+			writeLCDData(0x24BD & 0xff);	// Write data to LCD memory
+			writeLCDData(0x24BD >> 8);		// Write data to LCD memory
+			writeLCDData(0x24BD & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 3:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x053D >> 8);		// Write data to LCD memory
+			writeLCDData(0x053D & 0xff);	// Write data to LCD memory
+			writeLCDData(0x053D >> 8);		// Write data to LCD memory
+			writeLCDData(0x053D & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 4:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x05D9 >> 8);		// Write data to LCD memory
+			writeLCDData(0x05D9 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x05D9 >> 8);		// Write data to LCD memory
+			writeLCDData(0x05D9 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 5:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x3A96 >> 8);		// Write data to LCD memory
+			writeLCDData(0x3A96 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x3A96 >> 8);		// Write data to LCD memory
+			writeLCDData(0x3A96 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 6:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x9135 >> 8);		// Write data to LCD memory
+			writeLCDData(0x9135 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x9135 >> 8);		// Write data to LCD memory
+			writeLCDData(0x9135 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 7:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x03D2 >> 8);		// Write data to LCD memory
+			writeLCDData(0x03D2 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x03D2 >> 8);		// Write data to LCD memory
+			writeLCDData(0x03D2 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case GARBAGE:
+		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
+			writeLCDData(0x4208 >> 8);		// Write data to LCD memory
+			writeLCDData(0x4208 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x4208 >> 8);		// Write data to LCD memory
+			writeLCDData(0x4208 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	}
+
+	// inner square
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(x0+2);				// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(x0+17);			// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(y4);					// Setup beginning row address
+	writeLCDData(y5);					// Setup beginning row address
+	writeLCDData(y6);					// Setup ending row address
+	writeLCDData(y7);					// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	switch (pieceNumber) {
+	case 1:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0xAC3F >> 8);		// Write data to LCD memory
+			writeLCDData(0xAC3F & 0xff);	// Write data to LCD memory
+			writeLCDData(0xAC3F >> 8);		// Write data to LCD memory
+			writeLCDData(0xAC3F & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 2:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0x7D7F >> 8);		// Write data to LCD memory
+			writeLCDData(0x7D7F & 0xff);	// Write data to LCD memory
+			writeLCDData(0x7D7F >> 8);		// Write data to LCD memory
+			writeLCDData(0x7D7F & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 3:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0x7EBF >> 8);		// Write data to LCD memory
+			writeLCDData(0x7EBF & 0xff);	// Write data to LCD memory
+			writeLCDData(0x7EBF >> 8);		// Write data to LCD memory
+			writeLCDData(0x7EBF & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 4:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0xAF5D >> 8);		// Write data to LCD memory
+			writeLCDData(0xAF5D & 0xff);	// Write data to LCD memory
+			writeLCDData(0xAF5D >> 8);		// Write data to LCD memory
+			writeLCDData(0xAF5D & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 5:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0x8CFF >> 8);		// Write data to LCD memory
+			writeLCDData(0x8CFF & 0xff);	// Write data to LCD memory
+			writeLCDData(0x8CFF >> 8);		// Write data to LCD memory
+			writeLCDData(0x8CFF & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 6:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0xD37C >> 8);		// Write data to LCD memory
+			writeLCDData(0xD37C & 0xff);	// Write data to LCD memory
+			writeLCDData(0xD37C >> 8);		// Write data to LCD memory
+			writeLCDData(0xD37C & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case 7:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0xAEBB >> 8);		// Write data to LCD memory
+			writeLCDData(0xAEBB & 0xff);	// Write data to LCD memory
+			writeLCDData(0xAEBB >> 8);		// Write data to LCD memory
+			writeLCDData(0xAEBB & 0xff);	// Write data to LCD memory
+		}
+		break;
+	case GARBAGE:
+		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
+			writeLCDData(0x8410 >> 8);		// Write data to LCD memory
+			writeLCDData(0x8410 & 0xff);	// Write data to LCD memory
+			writeLCDData(0x8410 >> 8);		// Write data to LCD memory
+			writeLCDData(0x8410 & 0xff);	// Write data to LCD memory
+		}
+		break;
+	}
+	PROF_STOP(PROF_SQUARE);
+}
+
+/***************************************************************************************
+ * PAINT PIECE
+ * 		Draws a square of the given color for every block of piece p at rotation r,
+ * 		starting with the top left location. Color 0 erases it.
+ **************************************************************************************/
+void paintPiece(int x, int y, unsigned int p, unsigned int r, int color) {
+	const unsigned char *s = shapes[p - 1][r];
+	int i;
+	int j;
+	PROF_START();
+
+	for (i = 0; i < 4 && s[i]; i++)
+		for (j = 0; j < 4; j++)
+			if (s[i] & (1 << j))
+				drawSquare(x+(20*j), y+(20*i), color);
+	PROF_STOP(PROF_PIECE);
+}
+
+/***************************************************************************************
+ * FILL LEVEL COLOR
+ * 		Fills the level square at the top left with any color, the background color
+ * 		hides it
+ **************************************************************************************/
+void fillLevelColor(unsigned int color) {
+	int i;
+	PROF_START();
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(20);					// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(40);					// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(5);					// Setup beginning row address
+	writeLCDData(0);					// Setup ending row address
+	writeLCDData(25);					// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 231; i > 0; i--) {			// Loop through all memory locations 16 bit color
+		writeLCDData(color >> 8);			// Write data to LCD memory
+		writeLCDData(color & 0xff);		// Write data to LCD memory
+		writeLCDData(color >> 8);			// Write data to LCD memory
+		writeLCDData(color & 0xff);		// Write data to LCD memory
+	}
+	PROF_STOP(PROF_LEVEL);
+}
+
+/***************************************************************************************
+ * LEVEL COLOR FOR
+ * 		The level color for a level, shown at the top left and used for the score
+ * 		points cleared on it. Past 12 it stays at 12's.
+ **************************************************************************************/
+unsigned int levelColorFor(unsigned char level) {
+	switch (level) {
+	case 1:
+	case 8:
+		return 0xAEBB;
+	case 2:
+	case 9:
+		return 0xAF5D;
+	case 3:
+	case 10:
+		return 0x7EBF;
+	case 4:
+	case 11:
+		return 0x7D7F;
+	case 6:
+		return 0xAC3F;
+	case 7:
+		return 0xD37C;
+	case 5:
+	case 12:
+	default:
+		return 0x8CFF;
+	}
+}
+
+/***************************************************************************************
+ * FOLLOW GRID
+ * 		Keeps grid, the colors of g's rows, up with what gameTick just did (ge). old is
+ * 		where the piece was before. Draws nothing, main.c's show and the host tools
+ * 		all keep their grid with it so what they draw can't come out different.
+ **************************************************************************************/
+void followGrid(unsigned char grid[14][10], const Game *g, unsigned char ge,
+		unsigned char oldPiece, unsigned char oldRotation, unsigned char oldX,
+		unsigned char oldY) {
+	const unsigned char *s;
+	int i;
+	int j;
+	int k;
+
+	if (ge & GE_LOCK) {
+		// the piece's colors go into the grid where it set
+		s = shapes[oldPiece - 1][oldRotation];
+		for (i = 0; i < 4 && s[i]; i++)
+			for (j = 0; j < 4; j++)
+				if (s[i] & (1 << j))
+					grid[oldY + i][oldX + j] = oldPiece;
+	}
+
+	if (ge & GE_CLEAR) {
+		// same top down collapse as the bitboard got
+		for (i = 0; i < 14; i++)
+			if (g->cleared & (1 << i))
+				for (k = i; k >= 0; k--)
+					for (j = 0; j < 10; j++)
+						grid[k][j] = k == 0 ? 0 : grid[k - 1][j];
+	}
+
+	if (ge & GE_GARBAGE) {
+		// everything moves up, gray rows in from the bottom
+		for (i = 0; i < 14; i++)
+			for (j = 0; j < 10; j++)
+				if (i < 14 - g->raised)
+					grid[i][j] = grid[i + g->raised][j];
+				else
+					grid[i][j] = (g->hole == j) ? 0 : GARBAGE;
+	}
+}
+
+/***************************************************************************************
+ * DRAW SCORE
+ * 		Prints a 2x2 pixel point in the level color for line n, a column of ten for
+ * 		every decade of lines cleared
+ **************************************************************************************/
+void drawScore(unsigned int n, unsigned int color) {
+	int scoreColumn = (n / 10) * 2;
+	int scoreRow = (n % 10) * 2;
+	PROF_START();
+
+	drawPixel(218-scoreColumn, 23-scoreRow, color);
+	drawPixel(218-scoreColumn, 24-scoreRow, color);
+	drawPixel(219-scoreColumn, 23-scoreRow, color);
+	drawPixel(219-scoreColumn, 24-scoreRow, color);
+	PROF_STOP(PROF_SCORE);
+}
+
+/***************************************************************************************
+ * INITIALIZE BACKGROUND
+ * 		Draws the main UI. This consists of a light blue background and darker blue
+ * 		foreground, with a small amount of shade underneath it
+ **************************************************************************************/
+void initBackground(void) {
+	int i;
+	PROF_START();
+	fillScreen(0x5B57);
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0x11);				// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(0xDE);				// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0x21);				// Setup beginning row address
+	writeLCDData(0x01);				// Setup ending row address
+	writeLCDData(0x38);				// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 207 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
+		writeLCDData(0x5316 >> 8);				// Write data to LCD memory
+		writeLCDData(0x5316 & 0xff);			// Write data to LCD memory
+		writeLCDData(0x5316 >> 8);				// Write data to LCD memory
+		writeLCDData(0x5316 & 0xff);			// Write data to LCD memory
+	}
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0x12);				// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(0xDD);				// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0x20);				// Setup beginning row address
+	writeLCDData(0x01);				// Setup ending row address
+	writeLCDData(0x37);				// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 205 * 141; i > 0; i--)	{		// Loop through all memory locations 16 bit color
+		writeLCDData(0x4AF4 >> 8);				// Write data to LCD memory
+		writeLCDData(0x4AF4 & 0xff);			// Write data to LCD memory
+		writeLCDData(0x4AF4 >> 8);				// Write data to LCD memory
+		writeLCDData(0x4AF4 & 0xff);			// Write data to LCD memory
+	}
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0x13);				// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(0xDC);				// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0x1F);				// Setup beginning row address
+	writeLCDData(0x01);				// Setup ending row address
+	writeLCDData(0x36);				// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 203 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
+		writeLCDData(0x42B2 >> 8);				// Write data to LCD memory
+		writeLCDData(0x42B2 & 0xff);			// Write data to LCD memory
+		writeLCDData(0x42B2 >> 8);				// Write data to LCD memory
+		writeLCDData(0x42B2 & 0xff);			// Write data to LCD memory
+	}
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0x14);				// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(0xDB);				// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0x1E);				// Setup beginning row address
+	writeLCDData(0x01);				// Setup ending row address
+	writeLCDData(0x35);				// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 201 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
+		writeLCDData(0x110F >> 8);				// Write data to LCD memory
+		writeLCDData(0x110F & 0xff);			// Write data to LCD memory
+		writeLCDData(0x110F >> 8);				// Write data to LCD memory
+		writeLCDData(0x110F & 0xff);			// Write data to LCD memory
+	}
+	PROF_STOP(PROF_BACKGROUND);
+}
+
+/***************************************************************************************
+ * FILL SCREEN
+ * 		Fills the entire screen with the given color.
+ **************************************************************************************/
+void fillScreen(int color) {
+	unsigned int i;
+	PROF_START();
+
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0);					// Setup beginning column address
+	writeLCDData(0);					// Setup ending column address
+	writeLCDData(239);				// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0);					// Setup beginning row address
+	writeLCDData(0x01);				// Setup ending row address
+	writeLCDData(0x3F);				// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = 240 * 161; i > 0; i--) {		// Loop through all memory locations 16 bit color
+		writeLCDData(color >> 8);					// Write data to LCD memory
+		writeLCDData(color & 0xff);				// Write data to LCD memory
+		writeLCDData(color >> 8);					// Write data to LCD memory
+		writeLCDData(color & 0xff);				// Write data to LCD memory
+	}
+	PROF_STOP(PROF_SCREEN);
+}
+
+/***************************************************************************************
+ * FILL RECT
+ * 		Fills x0..x1, y0..y1 (inclusive) with one color
+ **************************************************************************************/
+void fillRect(int x0, int y0, int x1, int y1, unsigned int color) {
+	unsigned int i;
+
+	if (x1 < x0 || y1 < y0)
+		return;										// before the clock starts, it'd never stop
+	PROF_START();
+	writeLCDControl(0x2A);		// Select Column Address
+	writeLCDData(x0 >> 8);		// Setup beginning column address
+	writeLCDData(x0 & 0xff);	// Setup beginning column address
+	writeLCDData(x1 >> 8);		// Setup ending column address
+	writeLCDData(x1 & 0xff);	// Setup ending column address
+	writeLCDControl(0x2B);		// Select Row Address
+	writeLCDData(y0 >> 8);		// Setup beginning row address
+	writeLCDData(y0 & 0xff);	// Setup beginning row address
+	writeLCDData(y1 >> 8);		// Setup ending row address
+	writeLCDData(y1 & 0xff);	// Setup ending row address
+	writeLCDControl(0x2C);		// Select Memory Write
+	for (i = (x1 - x0 + 1) * (y1 - y0 + 1); i > 0; i--) {	// Loop through all memory locations 16 bit color
+		writeLCDData(color >> 8);					// Write data to LCD memory
+		writeLCDData(color & 0xff);				// Write data to LCD memory
+	}
+	PROF_STOP(PROF_RECT);
+}
+
+/***************************************************************************************
+ * DRAW PIXEL
+ * 		Draws one pixel given and x, y, and color value
+ **************************************************************************************/
+void drawPixel(int x, int y, int color) {
+	PROF_START();
+
+	writeLCDControl(0x2A);				// Select Column Address
+	writeLCDData(x >> 8);					// Starting x Address (Most Sig 8 bits of address)
+	writeLCDData(x & 0xff);				// Starting x Address (Least Sig 8 bits of address)
+	writeLCDData(x >> 8);					// Ending x Address (Most Sig 8 bits of address)
+	writeLCDData(x & 0xff);				// Ending x Address (Least Sig 8 bits of address)
+	writeLCDControl(0x2B);				// Select Row Address
+	writeLCDData(y >> 8);					// Starting y Address (Most Sig 8 bits of address)
+	writeLCDData(y & 0xff);				// Starting y Address (Least Sig 8 bits of address)
+	writeLCDData(y >> 8);					// Ending y Address (Most Sig 8 bits of address)
+	writeLCDData(y & 0xff);				// Ending y Address (Least Sig 8 bits of address)
+	writeLCDControl(0x2C);				// Select Color to write to the pixel
+	writeLCDData(color >> 8);			// Send Most Significant 8 bits of 16 bit color
+	writeLCDData(color & 0xff);		// Send Least Significant 8 bits of 16 bit color
+	PROF_STOP(PROF_PIXEL);
+}
+
+/***************************************************************************************
+ * DRAW INSTRUCTION
+ * 		Draws the instructions to start the game "tap to start"
+ **************************************************************************************/
+void drawInstruction(char x0, char y0, int color) {
+	PROF_START();
+
+	drawLetter(0x74, x0, y0, color);			// t
+	drawLetter(0x61, x0+4, y0, color);		// a
+	drawLetter(0x70, x0+12, y0, color);		// p
+
+	drawLetter(0x74, x0+26, y0, color);		// t
+	drawLetter(0x6F, x0+30, y0, color);		// o
+
+	drawLetter(0x73, x0+44, y0, color);		// s
+	drawLetter(0x74, x0+51, y0, color);		// t
+	drawLetter(0x61, x0+55, y0, color);		// a
+	drawLetter(0x72, x0+63, y0, color);		// r
+	drawLetter(0x74, x0+69, y0, color);		// t
+	PROF_STOP(PROF_TEXT);
+}
+
+/***************************************************************************************
+ * DRAW LETTER
+ * 		Draws a letter based off what value is based, the x and y value of the top left
+ * 		coordinate and the color of the text
+ **************************************************************************************/
+void drawLetter(char data, char x0, char y0, int color) {
+	PROF_START();
+
+	switch (data) {
+		case 0x61: // a
+			drawPixel(x0+1, y0+4, color);
+			drawPixel(x0+1, y0+7, color);
+			drawPixel(x0+1, y0+8, color);
+			drawPixel(x0+2, y0+3, color);
+			drawPixel(x0+2, y0+6, color);
+			drawPixel(x0+2, y0+9, color);
+			drawPixel(x0+3, y0+3, color);
+			drawPixel(x0+3, y0+6, color);
+			drawPixel(x0+3, y0+9, color);
+			drawPixel(x0+4, y0+3, color);
+			drawPixel(x0+4, y0+6, color);
+			drawPixel(x0+4, y0+9, color);
+			drawPixel(x0+5, y0+4, color);
+			drawPixel(x0+5, y0+5, color);
+			drawPixel(x0+5, y0+6, color);
+			drawPixel(x0+5, y0+7, color);
+			drawPixel(x0+5, y0+8, color);
+			drawPixel(x0+6, y0+9, color);
+			break;
+		case 0x6F: // o
+			drawPixel(x0+1, y0+5, color);
+			drawPixel(x0+1, y0+6, color);
+			drawPixel(x0+1, y0+7, color);
+			drawPixel(x0+2, y0+4, color);
+			drawPixel(x0+2, y0+8, color);
+			drawPixel(x0+3, y0+3, color);
+			drawPixel(x0+3, y0+9, color);
+			drawPixel(x0+4, y0+3, color);
+			drawPixel(x0+4, y0+9, color);
+			drawPixel(x0+5, y0+4, color);
+			drawPixel(x0+5, y0+8, color);
+			drawPixel(x0+6, y0+5, color);
+			drawPixel(x0+6, y0+6, color);
+			drawPixel(x0+6, y0+7, color);
+			break;
+		case 0x70: // p
+			drawPixel(x0+1, y0+3, color);
+			drawPixel(x0+1, y0+4, color);
+			drawPixel(x0+1, y0+5, color);
+			drawPixel(x0+1, y0+6, color);
+			drawPixel(x0+1, y0+7, color);
+			drawPixel(x0+1, y0+8, color);
+			drawPixel(x0+1, y0+9, color);
+			drawPixel(x0+1, y0+10, color);
+			drawPixel(x0+1, y0+11, color);
+			drawPixel(x0+2, y0+4, color);
+			drawPixel(x0+2, y0+8, color);
+			drawPixel(x0+3, y0+3, color);
+			drawPixel(x0+3, y0+9, color);
+			drawPixel(x0+4, y0+3, color);
+			drawPixel(x0+4, y0+9, color);
+			drawPixel(x0+5, y0+4, color);
+			drawPixel(x0+5, y0+8, color);
+			drawPixel(x0+6, y0+5, color);
+			drawPixel(x0+6, y0+6, color);
+			drawPixel(x0+6, y0+7, color);
+			break;
+		case 0x72: // r
+			drawPixel(x0+1, y0+3, color);
+			drawPixel(x0+1, y0+4, color);
+			drawPixel(x0+1, y0+5, color);
+			drawPixel(x0+1, y0+6, color);
+			drawPixel(x0+1, y0+7, color);
+			drawPixel(x0+1, y0+8, color);
+			drawPixel(x0+1, y0+9, color);
+			drawPixel(x0+2, y0+4, color);
+			drawPixel(x0+3, y0+3, color);
+			break;
+		case 0x73: // s
+			drawPixel(x0+1, y0+4, color);
+			drawPixel(x0+1, y0+5, color);
+			drawPixel(x0+1, y0+8, color);
+			drawPixel(x0+2, y0+3, color);
+			drawPixel(x0+2, y0+6, color);
+			drawPixel(x0+2, y0+9, color);
+			drawPixel(x0+3, y0+3, color);
+			drawPixel(x0+3, y0+6, color);
+			drawPixel(x0+3, y0+9, color);
+			drawPixel(x0+4, y0+4, color);
+			drawPixel(x0+4, y0+6, color);
+			drawPixel(x0+4, y0+9, color);
+			drawPixel(x0+5, y0+7, color);
+			drawPixel(x0+5, y0+8, color);
+			break;
+		case 0x74: // t
+			drawPixel(x0, y0+2, color);
+			drawPixel(x0+1, y0, color);
+			drawPixel(x0+1, y0+1, color);
+			drawPixel(x0+1, y0+2, color);
+			drawPixel(x0+1, y0+3, color);
+			drawPixel(x0+1, y0+4, color);
+			drawPixel(x0+1, y0+5, color);
+			drawPixel(x0+1, y0+6, color);
+			drawPixel(x0+1, y0+7, color);
+			drawPixel(x0+1, y0+8, color);
+			drawPixel(x0+2, y0+2, color);
+			drawPixel(x0+2, y0+9, color);
+			break;
+	}
+	PROF_STOP(PROF_LETTER);
+}
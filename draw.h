@@ -0,0 +1,42 @@
+/***************************************************************************************
+ * DRAW
+ * 		The tile art and screen layout, everything that puts pixels on the ILI9341.
+ * 		Nothing here touches a pin, it all goes out through writeLCDControl and
+ * 		writeLCDData, which the platform supplies. main.c sends them over SPI, the
+ * 		host tools hand them to an emulated controller, so a host picture is the
+ * 		picture on the glass.
+ *
+ * 		Screen is 240x320 portrait (MADCTL 0x48). The board is 10x14 squares of 20
+ * 		pixels with its top left at 20, 30, the level color sits at the top left and
+ * 		the score dots along the top right.
+ **************************************************************************************/
+#ifndef DRAW_H
+#define DRAW_H
+
+#include "engine.h"
+
+#define GARBAGE			8				// grid color of a garbage block
+
+// the board square at row, column
+#define SQUARE_X(column)	(20 + 20 * (column))
+#define SQUARE_Y(row)			(30 + 20 * (row))
+
+// from the platform
+void writeLCDControl(char);
+void writeLCDData(char);
+
+void drawSquare(int, int, int);
+void paintPiece(int, int, unsigned int, unsigned int, int);
+void fillLevelColor(unsigned int);
+unsigned int levelColorFor(unsigned char);
+void followGrid(unsigned char [14][10], const Game *, unsigned char, unsigned char,
+		unsigned char, unsigned char, unsigned char);
+void drawScore(unsigned int, unsigned int);
+void initBackground(void);
+void fillScreen(int);
+void fillRect(int, int, int, int, unsigned int);
+void drawPixel(int, int, int);
+void drawInstruction(char, char, int);
+void drawLetter(char, char, char, int);
+
+#endif
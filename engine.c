@@ -0,0 +1,655 @@
+/***************************************************************************************
+ * ENGINE
+ * 		Game rules, see engine.h. Plain C, no hardware, builds with msp430-gcc and any
+ * 		host compiler.
+ **************************************************************************************/
+#include "engine.h"
+#include "profile.h"
+#ifdef ENGINE_FEATURES_CHECK
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+const unsigned char shapes[7][4][4] = {
+	{ {3, 3, 0, 0}, {3, 3, 0, 0}, {3, 3, 0, 0}, {3, 3, 0, 0} },	// O
+	{ {1, 1, 1, 1}, {15, 0, 0, 0}, {1, 1, 1, 1}, {15, 0, 0, 0} },	// I
+	{ {3, 6, 0, 0}, {2, 3, 1, 0}, {3, 6, 0, 0}, {2, 3, 1, 0} },	// Z
+	{ {6, 3, 0, 0}, {1, 3, 2, 0}, {6, 3, 0, 0}, {1, 3, 2, 0} },	// S
+	{ {2, 2, 3, 0}, {1, 7, 0, 0}, {3, 1, 1, 0}, {7, 4, 0, 0} },	// J
+	{ {1, 1, 3, 0}, {7, 1, 0, 0}, {3, 2, 2, 0}, {4, 7, 0, 0} },	// L
+	{ {2, 7, 0, 0}, {1, 3, 1, 0}, {7, 2, 0, 0}, {2, 3, 2, 0} }		// T
+};
+
+const unsigned char distinctRotations[7] = {1, 2, 2, 2, 4, 4, 4};
+
+// What each joystick zone adds to dropCounter a tick, different amounts of pull
+static const unsigned char stickPull[4] = {0, 4, 19, 99};
+
+// Garbage rows sent for 1, 2, 3, 4 lines
+static const unsigned char garbageFor[5] = {0, 0, 1, 2, 4};
+
+static unsigned char clearLines(Game *);
+static void raiseGarbage(Game *);
+static void lockPiece(Game *);
+static bool fitsBoard(const uint16_t *, unsigned int, unsigned int, int, int);
+
+// Keeps g->features up with the board, nothing in other builds
+#ifdef ENGINE_FEATURES
+static void featuresLock(Game *);
+static void featuresClear(Game *);
+static void featuresRaise(Game *);
+static void featuresSums(BoardFeatures *);
+#ifdef ENGINE_FEATURES_CHECK
+static void featuresCheck(const Game *);
+#define FEATURES_CHECK(g)	featuresCheck(g)
+#else
+#define FEATURES_CHECK(g)
+#endif
+#define FEATURES(update)	do { update; FEATURES_CHECK(g); } while (0)
+#else
+#define FEATURES(update)
+#endif
+
+// Counts and times engine operations for the host simulator, nothing in other builds
+#ifdef ENGINE_STATS
+EngineStat engineStats[STAT_OPS];
+unsigned long long (*engineClock)(void);
+
+static unsigned long long statStart(void) {
+	return engineClock ? engineClock() : 0;
+}
+
+static void statStop(int op, unsigned long long start) {
+	engineStats[op].calls++;
+	if (engineClock)
+		engineStats[op].time += engineClock() - start;
+}
+
+#define STAT_START()	unsigned long long statTime = statStart()
+#define STAT_STOP(op)	statStop(op, statTime)
+#elif defined(PROFILE)
+// The same ops on the unit, into its Timer_A histograms, see profile.h
+#define STAT_FITS		PROF_FITS
+#define STAT_LOCK		PROF_LOCK
+#define STAT_CLEAR	PROF_CLEAR
+#define STAT_START()	PROF_START()
+#define STAT_STOP(op)	PROF_STOP(op)
+#else
+#define STAT_START()
+#define STAT_STOP(op)
+#endif
+
+/***************************************************************************************
+ * GAME RESET
+ * 		Puts every variable of a game back to how a new game starts. seed is where the
+ * 		'random' piece generator starts.
+ **************************************************************************************/
+void gameReset(Game *g, unsigned int s) {
+	int i;
+
+	for (i = 0; i < 14; i++)
+		g->rows[i] = 0;
+	g->tick = 0;
+	g->keyPress = s;
+	g->dropCounter = 0;
+	g->totalLines = 0;
+	g->cleared = 0;
+	g->level = 1;
+	g->linesCleared = 0;
+	g->lines = 0;
+	g->piece = 1;
+	g->rotation = 0;
+	g->xPos = 4;
+	g->yPos = 0;
+	g->graceTime = 0;
+	g->keys = 0;
+	g->garbage = 0;
+	g->raised = 0;
+	g->hole = 0;
+	g->pieceAlive = false;
+	g->gameAlive = true;
+	FEATURES(gameFeatures(g->rows, &g->features));
+}
+
+/***************************************************************************************
+ * GAME TICK
+ * 		All game movement handling for one tick. in has the presses since the last tick
+ * 		and how far the joystick is pulled. Returns GE_ flags for what happened. Only
+ * 		ever touches g, so the same rules run our game and the other unit's.
+ **************************************************************************************/
+unsigned char gameTick(Game *g, unsigned char in) {
+	unsigned char ge = 0;
+
+	if (!g->gameAlive)
+		return GE_OVER;
+	g->tick++;
+
+	// presses wait until the piece has room, each one stirs the 'random' algorithm
+	if (in & IN_ROTATE) {
+		g->keys |= IN_ROTATE;
+		g->keyPress += PRESS_ROT;
+	}
+	if (in & IN_RIGHT) {
+		g->keys |= IN_RIGHT;
+		g->keyPress += PRESS_RGHT;
+	}
+	if (in & IN_LEFT) {
+		g->keys |= IN_LEFT;
+		g->keyPress += PRESS_LFT;
+	}
+
+	// garbage gets a tick to itself, the screen redraws after it
+	if (g->garbage) {
+		raiseGarbage(g);
+		if (!g->gameAlive)
+			return GE_GARBAGE | GE_OVER;
+		return GE_GARBAGE;
+	}
+
+	if (g->pieceAlive && !fits(g->rows, g->piece, g->rotation, g->xPos, g->yPos + 1)) {
+		g->graceTime++;						// increment so piece stays alive
+
+		if (g->graceTime > GRACE_TICKS) {
+			g->pieceAlive = false;		// okay, piece is set
+			g->graceTime = 0;
+			lockPiece(g);
+			ge |= GE_LOCK | clearLines(g);
+
+			// screen redraws after a clear, new piece comes the tick after
+			if (ge & GE_CLEAR)
+				return ge;
+		}
+	}
+
+	// piece move logic
+	if (!g->pieceAlive) {
+		// new piece, start loc, random piece gen, check gameover
+		g->xPos = 4;
+		g->yPos = 0;
+		g->piece = (g->keyPress % 7) + 1;
+		g->rotation = 0;
+		g->pieceAlive = true;
+		ge |= GE_SPAWN;
+		if (!fits(g->rows, g->piece, g->rotation, g->xPos, g->yPos)) {
+			g->gameAlive = false;
+			return ge | GE_OVER;
+		}
+	} else if ((g->keys & IN_LEFT) && fits(g->rows, g->piece, g->rotation, (int)g->xPos - 1, g->yPos)) {
+		g->xPos--;								// simple left shift
+		g->keys &= ~IN_LEFT;
+		ge |= GE_MOVED;
+	} else if ((g->keys & IN_RIGHT) && fits(g->rows, g->piece, g->rotation, g->xPos + 1, g->yPos)) {
+		g->xPos++;								// simple right shift
+		g->keys &= ~IN_RIGHT;
+		ge |= GE_MOVED;
+	} else if ((g->keys & IN_ROTATE) && fits(g->rows, g->piece, (g->rotation + 1) & 3, g->xPos, g->yPos)) {
+		g->rotation = (g->rotation + 1) & 3;
+		g->keys &= ~IN_ROTATE;
+		ge |= GE_MOVED;
+	}
+
+	// piece drops every so many ticks, fewer as the level goes up
+	if (g->dropCounter > (g->level < 20 ? 100 - (g->level-1)*5 : 5) &&
+			fits(g->rows, g->piece, g->rotation, g->xPos, g->yPos + 1)) {
+		g->yPos++;
+		g->keys = 0;
+		g->keyPress++;
+		g->dropCounter = 0;
+		ge |= GE_MOVED;
+	}
+
+	// each tick increments to give drop rate, pulling down adds more
+	g->dropCounter += stickPull[(in & IN_STICK) >> IN_STICK_SHIFT] + 1;
+	return ge;
+}
+
+/***************************************************************************************
+ * CLEAR LINES
+ * 		Takes full rows out of the bitboard, top down, dropping everything above them.
+ * 		Marks which rows went in cleared for the screen and counts lines and levels.
+ **************************************************************************************/
+static unsigned char clearLines(Game *g) {
+	unsigned char ge = 0;
+	int i;
+	int k;
+	STAT_START();
+
+	g->cleared = 0;
+	g->lines = 0;
+
+	// loop through rows to see if one is full
+	for (i = 0; i < 14; i++) {
+		if (g->rows[i] != FULL_ROW)
+			continue;
+
+		// if so, delete line
+		for (k = i; k > 0; k--)
+			g->rows[k] = g->rows[k - 1];
+		g->rows[0] = 0;
+
+		g->cleared |= 1 << i;
+		g->lines++;
+		g->totalLines++;
+
+		// level up logic
+		if (++g->linesCleared == g->level * 10) {
+			g->level++;
+			g->linesCleared = 0;
+			ge |= GE_LEVEL;
+		}
+		ge |= GE_CLEAR;
+	}
+	FEATURES(featuresClear(g));
+	STAT_STOP(STAT_CLEAR);
+	return ge;
+}
+
+/***************************************************************************************
+ * RAISE GARBAGE
+ * 		Pushes the board up g->garbage rows and fills them in from the bottom, all but
+ * 		the hole column. Anything pushed off the top, or a piece with nowhere to go,
+ * 		is game over.
+ **************************************************************************************/
+static void raiseGarbage(Game *g) {
+	int i;
+	int n;
+
+	for (n = 0; n < g->garbage; n++) {
+		if (g->rows[0])
+			g->gameAlive = false;
+		for (i = 0; i < 13; i++)
+			g->rows[i] = g->rows[i + 1];
+		g->rows[13] = FULL_ROW & ~(1 << g->hole);
+		FEATURES(featuresRaise(g));
+	}
+	g->raised = g->garbage;
+	g->garbage = 0;
+
+	// piece in play gets shoved up out of the way
+	while (g->pieceAlive && g->yPos > 0 &&
+			!fits(g->rows, g->piece, g->rotation, g->xPos, g->yPos))
+		g->yPos--;
+	if (g->pieceAlive && !fits(g->rows, g->piece, g->rotation, g->xPos, g->yPos))
+		g->gameAlive = false;
+}
+
+/***************************************************************************************
+ * FITS
+ * 		Says if piece p at rotation r with its top left at x, y stays on the board and
+ * 		misses every block in the bitboard. One AND per row of the piece.
+ **************************************************************************************/
+bool fits(const uint16_t *board, unsigned int p, unsigned int r, int x, int y) {
+#if defined(ENGINE_STATS) || defined(PROFILE)
+	bool ok;
+	STAT_START();
+
+	ok = fitsBoard(board, p, r, x, y);
+	STAT_STOP(STAT_FITS);
+	return ok;
+#else
+	return fitsBoard(board, p, r, x, y);
+#endif
+}
+
+// the test itself, fits only adds the stats around it
+static bool fitsBoard(const uint16_t *board, unsigned int p, unsigned int r, int x, int y) {
+	const unsigned char *s = shapes[p - 1][r];
+	unsigned int m;
+	int i;
+
+	if (x < 0 || x > 9)							// every shape uses its left column
+		return false;
+
+	for (i = 0; i < 4 && s[i]; i++) {
+		if (y + i > 13)
+			return false;							// off the bottom
+		m = (unsigned int)s[i] << x;
+		if (m & ~FULL_ROW)
+			return false;							// off the right side
+		if (board[y + i] & m)
+			return false;
+	}
+	return true;
+}
+
+/***************************************************************************************
+ * LOCK PIECE
+ * 		Piece is set, its blocks go into the bitboard
+ **************************************************************************************/
+static void lockPiece(Game *g) {
+	const unsigned char *s = shapes[g->piece - 1][g->rotation];
+	int i;
+	STAT_START();
+
+	for (i = 0; i < 4 && s[i]; i++)
+		g->rows[g->yPos + i] |= s[i] << g->xPos;
+	FEATURES(featuresLock(g));
+	STAT_STOP(STAT_LOCK);
+}
+
+/***************************************************************************************
+ * STACK HEIGHT
+ * 		Rows from the bottom up to the highest locked block
+ **************************************************************************************/
+unsigned char stackHeight(const Game *g) {
+	unsigned char i;
+
+	for (i = 0; i < 14 && g->rows[i] == 0; i++);
+	return 14 - i;
+}
+
+/***************************************************************************************
+ * GAME CELL
+ * 		What is at row, col: CELL_EMPTY, CELL_LOCKED or CELL_PIECE for the piece in
+ * 		play. Anything off the board is empty.
+ **************************************************************************************/
+unsigned char gameCell(const Game *g, int row, int col) {
+	int i = row - g->yPos;
+	int j = col - g->xPos;
+
+	if (row < 0 || row > 13 || col < 0 || col > 9)
+		return CELL_EMPTY;
+	if (g->rows[row] & (1 << col))
+		return CELL_LOCKED;
+	if (g->pieceAlive && i >= 0 && i < 4 && j >= 0 && j < 4 &&
+			(shapes[g->piece - 1][g->rotation][i] & (1 << j)))
+		return CELL_PIECE;
+	return CELL_EMPTY;
+}
+
+/***************************************************************************************
+ * GAME HASH
+ * 		FNV-1a over everything that decides how the rest of a game goes, two games
+ * 		with the same hash are in the same place
+ **************************************************************************************/
+uint32_t gameHash(const Game *g) {
+	uint32_t h = 2166136261UL;
+	unsigned char b[18];
+	int i;
+	int j;
+
+	for (i = 0; i < 14; i++) {
+		h = (h ^ (g->rows[i] & 0xFF)) * 16777619UL;
+		h = (h ^ (g->rows[i] >> 8)) * 16777619UL;
+	}
+	b[0] = g->tick;
+	b[1] = g->tick >> 8;
+	b[2] = g->tick >> 16;
+	b[3] = g->tick >> 24;
+	b[4] = g->keyPress;
+	b[5] = g->keyPress >> 8;
+	b[6] = g->totalLines;
+	b[7] = g->totalLines >> 8;
+	b[8] = g->piece | (g->rotation << 4);
+	b[9] = g->xPos | (g->yPos << 4);
+	b[10] = g->level;
+	b[11] = g->gameAlive | (g->pieceAlive << 1);
+	b[12] = g->dropCounter;
+	b[13] = g->dropCounter >> 8;
+	b[14] = g->graceTime;
+	b[15] = g->keys;
+	b[16] = g->linesCleared;
+	b[17] = g->lines;
+	for (j = 0; j < 18; j++)
+		h = (h ^ b[j]) * 16777619UL;
+	return h;
+}
+
+/***************************************************************************************
+ * GAME PACK
+ * 		Writes everything in g into GAME_PACKED bytes at out, the board 10 bits a row.
+ * 		gameUnpack puts it back exactly, so a game can carry on from a snapshot.
+ **************************************************************************************/
+void gamePack(const Game *g, unsigned char *out) {
+	uint32_t bits = 0;
+	int have = 0;
+	int i;
+	int n = 0;
+
+	for (i = 0; i < 14; i++) {
+		bits |= (uint32_t)(g->rows[i] & FULL_ROW) << have;
+		for (have += 10; have >= 8; have -= 8, bits >>= 8)
+			out[n++] = bits;
+	}
+	out[n++] = bits;								// last 4 bits, n is 18
+	out[n++] = g->tick;
+	out[n++] = g->tick >> 8;
+	out[n++] = g->tick >> 16;
+	out[n++] = g->tick >> 24;
+	out[n++] = g->keyPress;
+	out[n++] = g->keyPress >> 8;
+	out[n++] = g->dropCounter;
+	out[n++] = g->dropCounter >> 8;
+	out[n++] = g->totalLines;
+	out[n++] = g->totalLines >> 8;
+	out[n++] = g->cleared;
+	out[n++] = g->cleared >> 8;
+	out[n++] = g->level;
+	out[n++] = g->linesCleared;
+	out[n++] = g->lines;
+	out[n++] = g->piece | (g->rotation << 3) | (g->pieceAlive << 5) | (g->gameAlive << 6);
+	out[n++] = g->xPos | (g->yPos << 4);
+	out[n++] = g->graceTime;
+	out[n++] = g->keys;
+	out[n++] = g->garbage;
+	out[n++] = g->raised;
+	out[n++] = g->hole;
+}
+
+void gameUnpack(Game *g, const unsigned char *in) {
+	uint32_t bits = 0;
+	int have = 0;
+	int i;
+	int n = 0;
+
+	for (i = 0; i < 14; i++) {
+		while (have < 10) {
+			bits |= (uint32_t)in[n++] << have;
+			have += 8;
+		}
+		g->rows[i] = bits & FULL_ROW;
+		bits >>= 10;
+		have -= 10;
+	}
+	n = 18;
+	g->tick = in[n] | ((uint32_t)in[n + 1] << 8) | ((uint32_t)in[n + 2] << 16) | ((uint32_t)in[n + 3] << 24);
+	n += 4;
+	g->keyPress = in[n] | (in[n + 1] << 8);
+	g->dropCounter = in[n + 2] | (in[n + 3] << 8);
+	g->totalLines = in[n + 4] | (in[n + 5] << 8);
+	g->cleared = in[n + 6] | (in[n + 7] << 8);
+	n += 8;
+	g->level = in[n++];
+	g->linesCleared = in[n++];
+	g->lines = in[n++];
+	g->piece = in[n] & 0x07;
+	g->rotation = (in[n] >> 3) & 0x03;
+	g->pieceAlive = (in[n] >> 5) & 1;
+	g->gameAlive = (in[n++] >> 6) & 1;
+	g->xPos = in[n] & 0x0F;
+	g->yPos = in[n++] >> 4;
+	g->graceTime = in[n++];
+	g->keys = in[n++];
+	g->garbage = in[n++];
+	g->raised = in[n++];
+	g->hole = in[n];
+	FEATURES(gameFeatures(g->rows, &g->features));
+}
+
+/***************************************************************************************
+ * QUEUE GARBAGE
+ * 		g just cleared lines, queue the garbage they send to come up on tick. The hole
+ * 		comes from g so both units pick the same one.
+ **************************************************************************************/
+void queueGarbage(Garbage *q, uint32_t tick, const Game *g) {
+	int i;
+	unsigned char n = garbageFor[g->lines > 4 ? 4 : g->lines];
+
+	if (n == 0)
+		return;
+	for (i = 0; i < GARBAGE_QUEUE; i++) {
+		if (q[i].rows == 0) {
+			q[i].tick = tick;
+			q[i].rows = n;
+			q[i].hole = (g->keyPress + g->tick) % 10;
+			return;
+		}
+	}
+}
+
+/***************************************************************************************
+ * DUE GARBAGE
+ * 		Hands g any garbage due on its next tick. take drops it from the queue, the
+ * 		guess only peeks.
+ **************************************************************************************/
+void dueGarbage(Garbage *q, Game *g, bool take) {
+	int i;
+
+	for (i = 0; i < GARBAGE_QUEUE; i++) {
+		if (q[i].rows && q[i].tick == g->tick + 1) {
+			g->garbage += q[i].rows;
+			g->hole = q[i].hole;
+			if (take)
+				q[i].rows = 0;
+		}
+	}
+}
+
+#ifdef ENGINE_FEATURES
+/***************************************************************************************
+ * FEATURES SUMS
+ * 		height and bumps out of the heights, ten columns rather than the board.
+ * 		gameFeatures, the from scratch version, is host/features.c's.
+ **************************************************************************************/
+static void featuresSums(BoardFeatures *f) {
+	int c;
+
+	f->height = f->heights[0];
+	f->bumps = 0;
+	for (c = 1; c < 10; c++) {
+		f->height += f->heights[c];
+		f->bumps += f->heights[c] > f->heights[c - 1] ? f->heights[c] - f->heights[c - 1] :
+				f->heights[c - 1] - f->heights[c];
+	}
+}
+
+/***************************************************************************************
+ * FEATURES LOCK
+ * 		The piece just went into the board, only its columns change. A block below a
+ * 		column's old top fills a hole, one above it raises the column and every gap
+ * 		it leaves down to the old top is a new hole.
+ **************************************************************************************/
+static void featuresLock(Game *g) {
+	BoardFeatures *f = &g->features;
+	const unsigned char *s = shapes[g->piece - 1][g->rotation];
+	int first = g->xPos > 0 ? g->xPos - 1 : 0;
+	int last = g->xPos + 5 < 10 ? g->xPos + 5 : 10;
+	int top;
+	int above;
+	int below;
+	int high;
+	int row;
+	int i;
+	int c;
+
+	// bumps between the columns that can move, out now and back in after
+	for (c = first + 1; c < last; c++)
+		f->bumps -= f->heights[c] > f->heights[c - 1] ? f->heights[c] - f->heights[c - 1] :
+				f->heights[c - 1] - f->heights[c];
+
+	for (c = g->xPos; c < g->xPos + 4 && c < 10; c++) {
+		top = 14 - f->heights[c];
+		high = 14;
+		above = below = 0;
+		for (i = 0; i < 4 && s[i]; i++) {
+			if (!(s[i] & (1 << (c - g->xPos))))
+				continue;
+			row = g->yPos + i;
+			if (row < high)
+				high = row;
+			if (row < top)
+				above++;
+			else
+				below++;
+		}
+		f->filled[c] += above + below;
+		f->holes -= below;
+		if (high < top) {
+			f->holes += top - high - above;
+			f->height += top - high;
+			f->heights[c] = 14 - high;
+		}
+	}
+
+	for (c = first + 1; c < last; c++)
+		f->bumps += f->heights[c] > f->heights[c - 1] ? f->heights[c] - f->heights[c - 1] :
+				f->heights[c - 1] - f->heights[c];
+}
+
+/***************************************************************************************
+ * FEATURES CLEAR
+ * 		g->lines full rows just went. Every column had a block in each of them, so a
+ * 		column just loses that many blocks and rows of height, unless its top block
+ * 		went too: then the gaps under it aren't holes any more, and it's looked down
+ * 		for its new top.
+ **************************************************************************************/
+static void featuresClear(Game *g) {
+	BoardFeatures *f = &g->features;
+	int top;
+	int row;
+	int c;
+
+	if (g->lines == 0)
+		return;
+	for (c = 0; c < 10; c++) {
+		top = 14 - f->heights[c];
+		f->filled[c] -= g->lines;
+		if (!(g->cleared & (1 << top))) {
+			f->heights[c] -= g->lines;
+			continue;
+		}
+		// nothing moves up, the new top is at or below the old one
+		for (row = top; row < 14 && !(g->rows[row] & (1 << c)); row++);
+		f->holes -= f->heights[c] - g->lines - (14 - row);
+		f->heights[c] = 14 - row;
+	}
+	featuresSums(f);
+}
+
+/***************************************************************************************
+ * FEATURES RAISE
+ * 		One garbage row just came up: every column gets a block and a row higher but
+ * 		the hole column, which only gets taller (and a hole) if it had blocks. A
+ * 		board pushed off the top is game over, worked out from scratch.
+ **************************************************************************************/
+static void featuresRaise(Game *g) {
+	BoardFeatures *f = &g->features;
+	int c;
+
+	if (!g->gameAlive) {
+		gameFeatures(g->rows, f);
+		return;
+	}
+	for (c = 0; c < 10; c++) {
+		if (c != g->hole) {
+			f->heights[c]++;
+			f->filled[c]++;
+		} else if (f->heights[c]) {
+			f->heights[c]++;
+			f->holes++;
+		}
+	}
+	featuresSums(f);
+}
+
+#ifdef ENGINE_FEATURES_CHECK
+// debug builds: every update has to come out as a recompute would
+static void featuresCheck(const Game *g) {
+	BoardFeatures f;
+
+	gameFeatures(g->rows, &f);
+	if (memcmp(&f, &g->features, sizeof f))
+		abort();
+}
+#endif
+#endif
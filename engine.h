@@ -0,0 +1,141 @@
+/***************************************************************************************
+ * ENGINE
+ * 		The rules of the game with nothing about the hardware in them. The MSP430 build
+ * 		and the host tools compile the same engine.c, so a game run from the same seed
+ * 		and inputs comes out the same everywhere.
+ *
+ * 		gameReset starts a game, gameTick runs it one 10 ms tick on one byte of input
+ * 		and says what happened, gameCell and the Game fields answer what is where.
+ * 		Everything a game needs is in its Game, there are no globals.
+ *
+ * 		Sizes are fixed width so a 16 bit int on the MSP430 and a 32 bit one on a host
+ * 		wrap the 'random' piece generator the same way.
+ **************************************************************************************/
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ENGINE_BUILD	1			// bump when a rule change plays games out differently,
+															// replays from another build won't match
+
+// Board
+#define FULL_ROW		0x03FF	// all 10 columns of a bitboard row
+#define GRACE_TICKS	38			// block touches but it's still 'alive' this long
+#define PRESS_ROT		18			// what each button adds to keyPress
+#define PRESS_RGHT	33
+#define PRESS_LFT		29
+#define GARBAGE_QUEUE	4			// garbage batches in flight to one game
+
+// Input										// one byte per tick into gameTick
+#define IN_LEFT			0x01		// pressed since the last tick
+#define IN_RIGHT		0x02
+#define IN_ROTATE		0x04
+#define IN_STICK		0x18		// joystick pull, 0 none to 3 all the way
+#define IN_STICK_SHIFT	3
+
+// Game Events							// what gameTick did, so the screen can follow
+#define GE_MOVED		0x01		// piece moved, rotated or dropped
+#define GE_SPAWN		0x02		// new piece
+#define GE_LOCK			0x04		// piece set into the board
+#define GE_CLEAR		0x08		// lines went, cleared has which rows
+#define GE_LEVEL		0x10		// level went up
+#define GE_GARBAGE	0x20		// garbage rows came up from the bottom
+#define GE_OVER			0x40		// game over
+
+#define GAME_PACKED	40			// bytes gamePack writes
+
+// gameCell
+#define CELL_EMPTY	0
+#define CELL_LOCKED	1
+#define CELL_PIECE	2
+
+// Board Features						// only with -DENGINE_FEATURES, for host searches
+#ifdef ENGINE_FEATURES
+// What an evaluator wants of the board, kept up as pieces lock, rows clear and
+// garbage comes up, touching only the columns that changed. gameFeatures works it
+// all out from scratch, ENGINE_FEATURES_CHECK checks every update against it. It
+// comes from the host, host/features.c, with the rest of the board features.
+typedef struct {
+	uint8_t heights[10];				// rows from the bottom to the top block of each column
+	uint8_t filled[10];					// blocks in each column
+	uint8_t height;							// heights added up
+	uint8_t holes;							// empty cells with a block somewhere above
+	uint8_t bumps;							// height steps between neighbours
+} BoardFeatures;
+#endif
+
+// One game's rules state. Nothing about the screen, so two fit in RAM for versus.
+typedef struct {
+	uint16_t rows[14];					// locked blocks, bit n is column n
+	uint32_t tick;							// ticks run
+	uint16_t keyPress;					// needed for 'random' algorithm
+	uint16_t dropCounter;				// ticks to slow/speed up block fall
+	uint16_t totalLines;
+	uint16_t cleared;						// rows that went on the last clear, bit n is row n
+	uint8_t level;
+	uint8_t linesCleared;				// this level
+	uint8_t lines;							// lines on the last clear
+	uint8_t piece;							// what piece is in play
+	uint8_t rotation;						// rotation of piece
+	uint8_t xPos;								// top left corner of piece
+	uint8_t yPos;
+	uint8_t graceTime;					// block touches but it's still 'alive'
+	uint8_t keys;								// presses waiting for room to move
+	uint8_t garbage;						// rows to bring up at the start of the next tick
+	uint8_t raised;							// rows that came up on the last garbage tick
+	uint8_t hole;								// column left open in them
+	bool pieceAlive;
+	bool gameAlive;
+#ifdef ENGINE_FEATURES
+	BoardFeatures features;			// of rows
+#endif
+} Game;
+
+// Garbage on its way to a game, comes up on tick
+typedef struct {
+	uint32_t tick;
+	uint8_t rows;
+	uint8_t hole;
+} Garbage;
+
+// Piece shapes, one 4 bit row mask per row down from the top left corner (bit 0 is
+// the left column). Indexed by [piece - 1][rotation].
+extern const unsigned char shapes[7][4][4];
+
+// Rotations that actually look different, an AI can skip the rest
+extern const unsigned char distinctRotations[7];
+
+// Engine Stats							// only with -DENGINE_STATS, for the host simulator
+#ifdef ENGINE_STATS
+#define STAT_FITS		0				// collision tests
+#define STAT_LOCK		1				// pieces set into the bitboard
+#define STAT_CLEAR	2				// full row scans after a lock
+#define STAT_OPS		3
+
+typedef struct {
+	unsigned long long calls;
+	unsigned long long time;		// engineClock units, 0 with no clock
+} EngineStat;
+
+extern EngineStat engineStats[STAT_OPS];
+extern unsigned long long (*engineClock)(void);	// NULL just counts
+#endif
+
+void gameReset(Game *, unsigned int);
+unsigned char gameTick(Game *, unsigned char);
+unsigned char gameCell(const Game *, int, int);
+uint32_t gameHash(const Game *);
+void gamePack(const Game *, unsigned char *);
+void gameUnpack(Game *, const unsigned char *);
+bool fits(const uint16_t *, unsigned int, unsigned int, int, int);
+unsigned char stackHeight(const Game *);
+void queueGarbage(Garbage *, uint32_t, const Game *);
+void dueGarbage(Garbage *, Game *, bool);
+#ifdef ENGINE_FEATURES
+// from the host
+void gameFeatures(const uint16_t *, BoardFeatures *);
+#endif
+
+#endif
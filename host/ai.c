@@ -0,0 +1,272 @@
+/***************************************************************************************
+ * AI
+ * 		See ai.h
+ **************************************************************************************/
+#include <stddef.h>
+#include "ai.h"
+
+#define NO_PLACE		(-1000000000)	// score for nowhere to go
+#define BATCH				64						// placements scored at a time
+
+// Piece outlines for dropping, from shapes. bottom[j] is the lowest row of column j
+// of the piece, counted down from its top.
+typedef struct {
+	unsigned char width;
+	unsigned char bottom[4];
+} Outline;
+
+// main.c's weights with wells, then holes and height pushed up until games stopped
+// ending in the first few levels
+const AiWeights aiDefaults = {-100, 50, -200, -20, -20};
+
+// Placements waiting to be scored, in the order they were found so ties go the same
+// way a batch at a time as one at a time
+typedef struct {
+	uint16_t boards[BATCH][14];		// full rows out
+	Features features[BATCH];
+	uint8_t lines[BATCH];					// full rows taken out of each
+	uint16_t moves[BATCH];				// rotation << 8 | column, or the reach state
+	unsigned int count;
+} Batch;
+
+static Outline outlines[7][4];
+static bool outlined = false;
+
+/***************************************************************************************
+ * OUTLINE
+ * 		Fills outlines the first time an AI starts
+ **************************************************************************************/
+static void outline(void) {
+	const unsigned char *s;
+	Outline *o;
+	int p;
+	int r;
+	int i;
+	int j;
+
+	for (p = 0; p < 7; p++)
+		for (r = 0; r < 4; r++) {
+			s = shapes[p][r];
+			o = &outlines[p][r];
+			o->width = 0;
+			for (j = 0; j < 4; j++)
+				for (i = 0; i < 4; i++)
+					if (s[i] & (1 << j)) {
+						o->bottom[j] = i;
+						o->width = j + 1;
+					}
+		}
+	outlined = true;
+}
+
+/***************************************************************************************
+ * AI START
+ * 		weights NULL for aiDefaults
+ **************************************************************************************/
+void aiStart(Ai *a, const AiWeights *weights) {
+	if (!outlined)
+		outline();
+	a->weights = weights ? *weights : aiDefaults;
+	a->rotation = 0;
+	a->column = 4;
+	a->score = NO_PLACE;
+	a->placements = 0;
+	a->plans = 0;
+	a->reach = false;
+	a->pathLength = 0;
+	a->planner = NULL;
+	a->plannerContext = NULL;
+}
+
+/***************************************************************************************
+ * SQUEEZE
+ * 		Takes board's full rows out from the bottom up, returns how many
+ **************************************************************************************/
+static int squeeze(uint16_t *board) {
+	int lines = 0;
+	int i;
+	int j;
+
+	for (i = 13, j = 13; i >= 0; i--) {
+		if (board[i] == FULL_ROW)
+			lines++;
+		else
+			board[j--] = board[i];
+	}
+	while (j >= 0)
+		board[j--] = 0;
+	return lines;
+}
+
+/***************************************************************************************
+ * AI WEIGH
+ * 		What a board with features f is worth, lines the rows cleared getting there
+ **************************************************************************************/
+int aiWeigh(const AiWeights *w, const Features *f, int lines) {
+	return w->height * f->height + w->lines * lines + w->holes * f->holes + w->bumps * f->bumps +
+			w->wells * f->wells;
+}
+
+/***************************************************************************************
+ * BATCH SCORE / BATCH ADD
+ * 		Scores what's waiting and keeps the best in a. Adds the piece in play at
+ * 		rotation r, x, y to g's board, scoring the batch once it's full.
+ **************************************************************************************/
+static void batchScore(Ai *a, Batch *b) {
+	unsigned int n;
+	int score;
+
+	featuresBatch((const uint16_t (*)[14])b->boards, b->count, b->features);
+	for (n = 0; n < b->count; n++) {
+		score = aiWeigh(&a->weights, &b->features[n], b->lines[n]);
+		if (score > a->score) {
+			a->score = score;
+			if (a->reach) {
+				a->target = b->moves[n];
+				a->rotation = REACH_ROT(b->moves[n]);
+				a->column = REACH_X(b->moves[n]);
+			} else {
+				a->rotation = b->moves[n] >> 8;
+				a->column = b->moves[n] & 0xFF;
+			}
+		}
+	}
+	a->placements += b->count;
+	b->count = 0;
+}
+
+static void batchAdd(Ai *a, Batch *b, const Game *g, int r, int x, int y, uint16_t move) {
+	const unsigned char *s = shapes[g->piece - 1][r];
+	uint16_t *board = b->boards[b->count];
+	int i;
+
+	for (i = 0; i < 14; i++)
+		board[i] = g->rows[i];
+	for (i = 0; i < 4 && s[i]; i++)
+		board[y + i] |= (unsigned int)s[i] << x;
+	b->lines[b->count] = squeeze(board);
+	b->moves[b->count] = move;
+	if (++b->count == BATCH)
+		batchScore(a, b);
+}
+
+/***************************************************************************************
+ * PLAN REACH
+ * 		aiPlan for reach, every rest of the piece from where it is now
+ **************************************************************************************/
+static int planReach(Ai *a, const Game *g) {
+	unsigned int rests = reachFind(&a->moves, g->rows, g->piece, g->rotation, g->xPos, g->yPos);
+	unsigned int n;
+	uint16_t rest;
+	Batch b;
+
+	a->pathLength = 0;
+	b.count = 0;
+	for (n = 0; n < rests; n++) {
+		rest = a->moves.rests[n];
+		batchAdd(a, &b, g, REACH_ROT(rest), REACH_X(rest), REACH_Y(rest), rest);
+	}
+	batchScore(a, &b);
+	if (a->score != NO_PLACE)
+		a->pathLength = reachPath(&a->moves, a->target, a->path);
+	return a->score;
+}
+
+/***************************************************************************************
+ * AI PLAN
+ * 		Scores every placement of the piece in play, keeps the best in a and returns
+ * 		its score, NO_PLACE if it has nowhere to go. A drop lands where the first
+ * 		column of the piece meets the top of the stack, so it's one pass over the
+ * 		piece's columns, no collision tests.
+ **************************************************************************************/
+int aiPlan(Ai *a, const Game *g) {
+	const Outline *o;
+	int top[10];										// first row with a block, 14 if none
+	unsigned int seen = 0;
+	unsigned int m;
+	Batch b;
+	int r;
+	int x;
+	int y;
+	int i;
+	int j;
+
+	a->rotation = g->rotation;
+	a->column = g->xPos;
+	a->score = NO_PLACE;
+	a->plans++;
+	if (a->reach)
+		return planReach(a, g);
+
+	for (j = 0; j < 10; j++)
+		top[j] = 14;
+	for (i = 0; i < 14; i++) {
+		for (m = g->rows[i] & ~seen; m; m &= m - 1)
+			top[__builtin_ctz(m)] = i;
+		seen |= g->rows[i];
+	}
+
+	b.count = 0;
+	for (r = 0; r < distinctRotations[g->piece - 1]; r++) {
+		o = &outlines[g->piece - 1][r];
+		for (x = 0; x + o->width <= 10; x++) {
+			y = 14;
+			for (j = 0; j < o->width; j++)
+				if (top[x + j] - 1 - o->bottom[j] < y)
+					y = top[x + j] - 1 - o->bottom[j];
+			if (y < g->yPos)
+				continue;								// stack is in the way
+			batchAdd(a, &b, g, r, x, y, r << 8 | x);
+		}
+	}
+	batchScore(a, &b);
+	return a->score;
+}
+
+/***************************************************************************************
+ * AI INPUT
+ * 		Input for the next tick of g, ge is what the last gameTick returned. Plans
+ * 		again whenever the board under the piece changes. With reach, a piece that
+ * 		fell off its path gets a new path to the same rest, or a new plan if it
+ * 		can't get there anymore.
+ **************************************************************************************/
+unsigned char aiInput(Ai *a, const Game *g, unsigned char ge) {
+	unsigned char in;
+
+	if (ge & (GE_SPAWN | GE_GARBAGE)) {
+		if (a->planner)
+			a->planner(a->plannerContext, a, g);
+		else
+			aiPlan(a, g);
+	}
+	if (a->reach) {
+		if (!g->pieceAlive || !a->pathLength)
+			return 0;
+		if ((in = reachInput(g, a->path, a->pathLength)) != 0xFF)
+			return in;
+		reachFind(&a->moves, g->rows, g->piece, g->rotation, g->xPos, g->yPos);
+		if (reachSeen(&a->moves, a->target))
+			a->pathLength = reachPath(&a->moves, a->target, a->path);
+		else
+			aiPlan(a, g);
+		return a->pathLength ? reachInput(g, a->path, a->pathLength) : 0;
+	}
+	return aiWalk(g, a->rotation, a->column);
+}
+
+/***************************************************************************************
+ * AI WALK
+ * 		Input for the next tick of g to take its piece to rotation and column and
+ * 		drop it there. Only depends on g, so a search can play it ahead on a copy.
+ **************************************************************************************/
+unsigned char aiWalk(const Game *g, unsigned char rotation, unsigned char column) {
+	if (g->keys)
+		return 0;										// last press hasn't been used yet
+	if (g->rotation != rotation)
+		return IN_ROTATE;
+	if (g->xPos > column)
+		return IN_LEFT;
+	if (g->xPos < column)
+		return IN_RIGHT;
+	return 3 << IN_STICK_SHIFT;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************************
+ * AI
+ * 		Strong player for the host tools, for benchmark games and for testing units
+ * 		against. Same idea as the attract mode AI in main.c, with no RAM to save: for
+ * 		every piece it drops each rotation in each column straight down the column
+ * 		heights, scores the board that leaves and goes for the best. Then it walks
+ * 		the piece there a press a tick, rotations, then shifts, then the joystick.
+ * 		Boards are scored a batch at a time off features.c's kernel.
+ *
+ * 		With reach set it scores every rest reach.c can find instead, tucks and spins
+ * 		too, and walks the piece along the shortest path there. A planner can stand
+ * 		in for aiPlan, search.c's lookahead does.
+ **************************************************************************************/
+#ifndef AI_H
+#define AI_H
+
+#include "../engine.h"
+#include "reach.h"
+#include "features.h"
+
+// what a board is worth, x100 a unit of each
+typedef struct {
+	int height;						// column heights added up
+	int lines;						// cleared by the drop
+	int holes;						// empty cells with a block somewhere above
+	int bumps;						// height steps between neighbours
+	int wells;						// depth of columns below both neighbours
+} AiWeights;
+
+typedef struct Ai Ai;
+
+struct Ai {
+	AiWeights weights;
+	unsigned char rotation;				// where the piece in play is going
+	unsigned char column;
+	int score;										// of that placement
+	unsigned long long placements;	// scored so far
+	unsigned long long plans;
+	bool reach;										// plan over every rest, not just drops
+	Reach moves;
+	uint16_t target;							// state the piece is going to, with reach
+	uint16_t path[REACH_STATES];		// states on the way there
+	unsigned int pathLength;
+	int (*planner)(void *, Ai *, const Game *);	// plans instead of aiPlan if set
+	void *plannerContext;						// handed back to planner
+};
+
+extern const AiWeights aiDefaults;
+
+void aiStart(Ai *, const AiWeights *);
+int aiPlan(Ai *, const Game *);
+unsigned char aiInput(Ai *, const Game *, unsigned char);
+unsigned char aiWalk(const Game *, unsigned char, unsigned char);
+int aiWeigh(const AiWeights *, const Features *, int);
+
+#endif
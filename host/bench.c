@@ -0,0 +1,504 @@
+/***************************************************************************************
+ * BENCH
+ * 		The engine's and draw.c's hot operations one at a time, ns each, checked
+ * 		against a baseline so a change that slows one down shows up in review and not
+ * 		on a unit. make bench runs it. The draws' SPI bytes are lcdcheck's to check.
+ *
+ * 		build/bench [-u] [-p percent] [-s seed] [baseline]
+ * 				baseline is host/bench.baseline if not given, -u writes it from this build
+ * 				-p how much slower than the baseline fails, SLOWER_PERCENT
+ * 				-s seeds the boards and pieces, the baseline's were made with 1
+ *
+ * 		Engine operations run over BOARDS boards made up from the seed, a random stack
+ * 		with the odd hole and full row like a game leaves, each op on the next board:
+ * 			collision		fits() on a random piece, rotation and place
+ * 			rotate			a tick with rotate pressed, no kicks in these rules so it's
+ * 									the one fits() and the turn if there's room
+ * 			lock-N			a tick that locks an I and clears N lines, with 0 the next
+ * 									piece spawns in the same tick like in a game
+ * 			spawn				a tick with no piece, draws the next one off keyPress
+ * 			game-over		the same with no room for it
+ * 			garbage			queueGarbage's hole draw for a 4 line clear
+ * 		Tick ops copy their Game first, a few ns and the same every build. Then each
+ * 		of drawcalls.c's draws, the ones lcdcheck checks, into writeLCD stubs.
+ *
+ * 		Each op runs in batches of ~BATCH_MS, the best of ROUNDS is its ns. The
+ * 		baseline is one value a line and each can be SLOWER_PERCENT and SLOWER_NS
+ * 		slower, faster is fine and -u takes the new numbers. ns are this machine's, so
+ * 		the baseline says which machine (CPU, architecture and host name) and compiler
+ * 		wrote it and anywhere else nothing is checked. -u on the one you compare on.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/utsname.h>
+#include "../engine.h"
+#include "../draw.h"
+#include "drawcalls.h"
+
+#define BOARDS					4096				// power of 2
+#define BATCH_MS				10
+#define ROUNDS					7
+#define SLOWER_PERCENT	25
+#define SLOWER_NS				10					// and this on top, a 10 ns op moves by a few
+#define MAX_VALUES			64
+#define I_PIECE					2						// vertical in rotation 0
+
+typedef struct {
+	char name[48];
+	double value;
+} Value;
+
+typedef struct {
+	uint8_t piece;
+	uint8_t rotation;
+	int8_t x;
+	int8_t y;
+} Place;
+
+// an op runs n times and gives back something made of what it did
+typedef unsigned long long (*Op)(unsigned long long);
+
+unsigned long long rng;
+uint16_t boards[BOARDS][14];
+Place places[BOARDS];
+Game rotates[BOARDS];
+Game locks[5][BOARDS];
+Game spawns[BOARDS];
+Game overs[BOARDS];
+Game garbages[BOARDS];
+Value values[MAX_VALUES];
+unsigned int valueCount;
+unsigned long long lcdBytes;
+const DrawCall *drawing;						// drawOp's
+char machine[160];
+char compiler[160];
+volatile unsigned long long sink;		// so no op is thrown away
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * MACHINE
+ * 		What the ns are from: the CPU's model name, the architecture and the host, as
+ * 		a model name alone is the same on every cloud box, and the compiler
+ **************************************************************************************/
+void identify(void) {
+	FILE *f = fopen("/proc/cpuinfo", "r");
+	struct utsname u;
+	char line[256];
+	char *model = NULL;
+	char *end;
+
+	while (f && !model && fgets(line, sizeof line, f))
+		if (!strncmp(line, "model name", 10) && (model = strchr(line, ':')))
+			for (model++; *model == ' ' || *model == '\t'; model++);
+	if (f)
+		fclose(f);
+	if (model && (end = strchr(model, '\n')))
+		*end = 0;
+	uname(&u);
+	snprintf(machine, sizeof machine, "%s, %s, %s", model ? model : "unknown", u.machine,
+			u.nodename);
+#if defined(__clang__)
+	snprintf(compiler, sizeof compiler, "%s", __VERSION__);
+#elif defined(__GNUC__)
+	snprintf(compiler, sizeof compiler, "gcc %s", __VERSION__);
+#else
+	snprintf(compiler, sizeof compiler, "unknown");
+#endif
+}
+
+unsigned int random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng >> 32;
+}
+
+// draw.c's way out, counted
+void writeLCDControl(char c) {
+	(void)c;
+	lcdBytes++;
+}
+
+void writeLCDData(char c) {
+	(void)c;
+	lcdBytes++;
+}
+
+void add(const char *name, const char *what, double value) {
+	if (valueCount == MAX_VALUES)
+		return;
+	snprintf(values[valueCount].name, sizeof values[valueCount].name, "%s.%s", name, what);
+	values[valueCount].value = value;
+	valueCount++;
+}
+
+/***************************************************************************************
+ * MAKE BOARDS
+ * 		A random stack height a column, mostly filled below it with the odd hole, and
+ * 		now and then a full row, so every path in fits and clearLines gets used.
+ * 		Then the Games each tick op starts from.
+ **************************************************************************************/
+// a piece somewhere it fits on b, or the top left if nowhere random does
+Place placeOn(const uint16_t *b) {
+	Place p;
+	int tries;
+
+	for (tries = 0; tries < 100; tries++) {
+		p.piece = 1 + random32() % 7;
+		p.rotation = random32() % 4;
+		p.x = random32() % 10;
+		p.y = random32() % 14;
+		if (fits(b, p.piece, p.rotation, p.x, p.y))
+			return p;
+	}
+	p.piece = 1;
+	p.rotation = 0;
+	p.x = 0;
+	p.y = 0;
+	return p;
+}
+
+void makeBoards(void) {
+	uint16_t *rows;
+	Game *g;
+	Place p;
+	int top[10];
+	unsigned int n;
+	int lines;
+	int hole;
+	int i;
+	int c;
+
+	for (n = 0; n < BOARDS; n++) {
+		rows = boards[n];
+		for (c = 0; c < 10; c++)
+			top[c] = 14 - random32() % 15;
+		for (i = 0; i < 14; i++) {
+			rows[i] = 0;
+			for (c = 0; c < 10; c++)
+				if (i == top[c] || (i > top[c] && random32() % 6))
+					rows[i] |= 1 << c;
+			if (i > 6 && random32() % 8 == 0)
+				rows[i] = FULL_ROW;
+		}
+
+		// collision anywhere at all, on or off the board
+		places[n].piece = 1 + random32() % 7;
+		places[n].rotation = random32() % 4;
+		places[n].x = (int)(random32() % 12) - 1;
+		places[n].y = random32() % 14;
+
+		// a piece in play where it fits, rotate pressed
+		g = &rotates[n];
+		gameReset(g, random32());
+		memcpy(g->rows, rows, sizeof g->rows);
+		p = placeOn(rows);
+		g->piece = p.piece;
+		g->rotation = p.rotation;
+		g->xPos = p.x;
+		g->yPos = p.y;
+		g->pieceAlive = true;
+
+		// an I down a well at the bottom, lines of its 4 rows full but for it
+		hole = random32() % 10;
+		for (lines = 0; lines <= 4; lines++) {
+			g = &locks[lines][n];
+			gameReset(g, random32());
+			for (i = 0; i < 10; i++)
+				g->rows[i] = rows[i] == FULL_ROW ? rows[i] & ~(1 << hole) : rows[i];
+			for (i = 10; i < 14; i++)
+				g->rows[i] = FULL_ROW & ~(1 << hole) & ~(i - 10 < 4 - lines ? 1 << (hole + 1) % 10 : 0);
+			g->piece = I_PIECE;
+			g->xPos = hole;
+			g->yPos = 10;
+			g->pieceAlive = true;
+			g->graceTime = GRACE_TICKS;
+		}
+
+		// no piece, room at the top for the next or not
+		g = &spawns[n];
+		gameReset(g, random32());
+		for (i = 4; i < 14; i++)
+			g->rows[i] = rows[i];
+		g = &overs[n];
+		*g = spawns[n];
+		g->rows[0] = g->rows[1] = 0x0030;
+
+		// just cleared 4, the most garbage
+		g = &garbages[n];
+		gameReset(g, random32());
+		g->lines = 4;
+		g->tick = random32();
+	}
+}
+
+/***************************************************************************************
+ * OPS
+ **************************************************************************************/
+unsigned long long collision(unsigned long long n) {
+	unsigned long long s = 0;
+	const Place *p;
+
+	while (n--) {
+		p = &places[n & (BOARDS - 1)];
+		s += fits(boards[n & (BOARDS - 1)], p->piece, p->rotation, p->x, p->y);
+	}
+	return s;
+}
+
+// a tick on a copy of the next of games
+unsigned long long ticks(const Game *games, unsigned char in, unsigned long long n) {
+	unsigned long long s = 0;
+	Game g;
+
+	while (n--) {
+		g = games[n & (BOARDS - 1)];
+		s += gameTick(&g, in) + g.rotation + g.piece;
+	}
+	return s;
+}
+
+unsigned long long rotate(unsigned long long n) {
+	return ticks(rotates, IN_ROTATE, n);
+}
+
+unsigned long long lock0(unsigned long long n) {
+	return ticks(locks[0], 0, n);
+}
+
+unsigned long long lock1(unsigned long long n) {
+	return ticks(locks[1], 0, n);
+}
+
+unsigned long long lock2(unsigned long long n) {
+	return ticks(locks[2], 0, n);
+}
+
+unsigned long long lock3(unsigned long long n) {
+	return ticks(locks[3], 0, n);
+}
+
+unsigned long long lock4(unsigned long long n) {
+	return ticks(locks[4], 0, n);
+}
+
+unsigned long long spawn(unsigned long long n) {
+	return ticks(spawns, 0, n);
+}
+
+unsigned long long gameOver(unsigned long long n) {
+	return ticks(overs, 0, n);
+}
+
+unsigned long long garbage(unsigned long long n) {
+	unsigned long long s = 0;
+	Garbage q[GARBAGE_QUEUE];
+
+	while (n--) {
+		memset(q, 0, sizeof q);
+		queueGarbage(q, n, &garbages[n & (BOARDS - 1)]);
+		s += q[0].hole;
+	}
+	return s;
+}
+
+// the draw call drawing points at, the same draws lcdcheck checks
+unsigned long long drawOp(unsigned long long n) {
+	void (*draw)(void) = drawing->draw;
+
+	while (n--)
+		draw();
+	return lcdBytes;
+}
+
+/***************************************************************************************
+ * RUN
+ * 		op's ns each, the best of ROUNDS batches of about BATCH_MS
+ **************************************************************************************/
+void run(const char *name, Op op) {
+	unsigned long long n = 1;
+	unsigned long long t;
+	double best = 0;
+	double ns;
+	int i;
+
+	// as many as make a batch
+	while ((t = now(), sink += op(n), now() - t) < BATCH_MS * 1000000ULL)
+		n *= 2;
+	for (i = 0; i < ROUNDS; i++) {
+		t = now();
+		sink += op(n);
+		ns = (double)(now() - t) / n;
+		if (!i || ns < best)
+			best = ns;
+	}
+	add(name, "ns", best);
+	printf("  %-20s %10.1f\n", name, best);
+}
+
+/***************************************************************************************
+ * CHECK
+ * 		This build's values against baseline at path. The number that failed. Only if
+ * 		it's from this machine and compiler, anywhere else they're noise.
+ **************************************************************************************/
+int check(const char *path, unsigned int slower) {
+	FILE *f = fopen(path, "r");
+	char line[256];
+	char name[64];
+	double want;
+	double most;
+	bool sameMachine = false;
+	bool sameCompiler = false;
+	unsigned int failed = 0;
+	unsigned int seen = 0;
+	unsigned int i;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof line, f)) {
+		line[strcspn(line, "\n")] = 0;
+		if (!strncmp(line, "machine ", 8)) {
+			sameMachine = !strcmp(line + 8, machine);
+			if (!sameMachine)
+				printf("  baseline's machine is %s, this is %s\n", line + 8, machine);
+			continue;
+		}
+		if (!strncmp(line, "compiler ", 9)) {
+			sameCompiler = !strcmp(line + 9, compiler);
+			if (!sameCompiler)
+				printf("  baseline's compiler is %s, this is %s\n", line + 9, compiler);
+			continue;
+		}
+		if (line[0] == '#' || sscanf(line, "%63s %lf", name, &want) != 2)
+			continue;
+		for (i = 0; i < valueCount && strcmp(values[i].name, name); i++);
+		if (i == valueCount) {
+			printf("  %-24s gone\n", name);
+			failed++;
+			continue;
+		}
+		seen++;
+		if (!(sameMachine && sameCompiler))
+			continue;
+		most = want * (100 + slower) / 100 + SLOWER_NS;
+		if (values[i].value > most) {
+			printf("  %-24s %.1f ns, was %.1f\n", name, values[i].value, want);
+			failed++;
+		}
+	}
+	fclose(f);
+	if (!(sameMachine && sameCompiler))
+		printf("  not checked, the baseline's from another machine or compiler\n");
+	if (seen < valueCount)
+		printf("  %u values not in the baseline, -u to add them\n", valueCount - seen);
+	return failed;
+}
+
+/***************************************************************************************
+ * WRITE BASELINE
+ **************************************************************************************/
+int writeBaseline(const char *path) {
+	FILE *f = fopen(path, "w");
+	unsigned int i;
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	fprintf(f, "# build/bench baseline, build/bench -u writes it. .ns is ns an op on this\n");
+	fprintf(f, "# machine built by this compiler.\n");
+	fprintf(f, "machine %s\n", machine);
+	fprintf(f, "compiler %s\n", compiler);
+	for (i = 0; i < valueCount; i++)
+		fprintf(f, "%s %.1f\n", values[i].name, values[i].value);
+	if (fclose(f)) {
+		perror(path);
+		return 1;
+	}
+	printf("%s: %u values\n", path, valueCount);
+	return 0;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *path = "host/bench.baseline";
+	unsigned int slower = SLOWER_PERCENT;
+	unsigned int seed = 1;
+	bool update = false;
+	Game g;
+	int failed;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-u"))
+			update = true;
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			slower = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoul(argv[++i], NULL, 0);
+		else if (argv[i][0] != '-' && i + 1 == argc)
+			path = argv[i];
+		else
+			break;
+	}
+	if (i < argc) {
+		fprintf(stderr, "usage: %s [-u] [-p percent] [-s seed] [baseline]\n", argv[0]);
+		return 2;
+	}
+
+	identify();
+	rng = seed * 2654435761ULL + 1;
+	makeBoards();
+	// the ops have to do what they say or their numbers mean nothing
+	for (i = 0; i <= 4; i++) {
+		g = locks[i][0];
+		if (!(gameTick(&g, 0) & GE_LOCK) || g.lines != i) {
+			fprintf(stderr, "bench: lock-%d cleared %d lines\n", i, g.lines);
+			return 1;
+		}
+	}
+	g = overs[0];
+	if (!(gameTick(&g, 0) & GE_OVER)) {
+		fprintf(stderr, "bench: game-over didn't end the game\n");
+		return 1;
+	}
+
+	printf("%-22s %10s\n", "op", "ns");
+	run("collision", collision);
+	run("rotate", rotate);
+	run("lock-0", lock0);
+	run("lock-1", lock1);
+	run("lock-2", lock2);
+	run("lock-3", lock3);
+	run("lock-4", lock4);
+	run("spawn", spawn);
+	run("game-over", gameOver);
+	run("garbage", garbage);
+	for (drawing = drawCalls; drawing < drawCalls + drawCallCount; drawing++)
+		run(drawing->name, drawOp);
+	if (update)
+		return writeBaseline(path);
+
+	failed = check(path, slower);
+	if (failed < 0)
+		return 1;
+	printf("%s: %s\n", path, failed ? "FAILED" : "ok");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+/***************************************************************************************
+ * BOT
+ * 		See bot.h
+ **************************************************************************************/
+#include "bot.h"
+
+/***************************************************************************************
+ * BOT SEED
+ **************************************************************************************/
+void botSeed(Bot *b, unsigned long long seed) {
+	b->rng = seed * 2654435761ULL + 1;
+	b->rotation = 0;
+	b->column = 0;
+}
+
+/***************************************************************************************
+ * BOT RANDOM
+ **************************************************************************************/
+unsigned int botRandom(Bot *b) {
+	b->rng ^= b->rng << 13;
+	b->rng ^= b->rng >> 7;
+	b->rng ^= b->rng << 17;
+	return (unsigned int)(b->rng >> 32);
+}
+
+/***************************************************************************************
+ * BOT INPUT
+ * 		Input for the next tick of g. ge is what the last gameTick returned.
+ **************************************************************************************/
+unsigned char botInput(Bot *b, const Game *g, unsigned char ge) {
+	if (ge & GE_SPAWN) {
+		b->rotation = botRandom(b) % distinctRotations[g->piece - 1];
+		b->column = botRandom(b) % 10;
+	}
+	if (g->keys)
+		return 0;										// last press hasn't been used yet
+	if (g->rotation != b->rotation)
+		return IN_ROTATE;
+	if (g->xPos > b->column)
+		return IN_LEFT;
+	if (g->xPos < b->column)
+		return IN_RIGHT;
+	return 3 << IN_STICK_SHIFT;
+}
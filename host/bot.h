@@ -0,0 +1,23 @@
+/***************************************************************************************
+ * BOT
+ * 		Random player for the host tools. Picks a rotation and column for every piece
+ * 		and walks it there a press a tick, then pulls the joystick all the way, so
+ * 		games look like a (bad) person's rather than noise. Same seed, same games,
+ * 		on any host.
+ **************************************************************************************/
+#ifndef BOT_H
+#define BOT_H
+
+#include "../engine.h"
+
+typedef struct {
+	unsigned long long rng;			// xorshift64
+	unsigned char rotation;			// where the piece in play is going
+	unsigned char column;
+} Bot;
+
+void botSeed(Bot *, unsigned long long);
+unsigned int botRandom(Bot *);
+unsigned char botInput(Bot *, const Game *, unsigned char);
+
+#endif
@@ -0,0 +1,369 @@
+/***************************************************************************************
+ * CORPUS
+ * 		Replays from every unit in one archive file, and a pass that plays them all
+ * 		back across every core and says what happened in them.
+ *
+ * 		build/corpus pack out file...
+ * 		build/corpus stats [-j threads] archive
+ *
+ * 		Archive, numbers little endian:
+ * 			'T' 'R' 'C' 'A'  version  0  0  0  count(4)  0(4)
+ * 			count index entries, offset(8) length(8) of each replay from the file start
+ * 			the replays, as replay record writes them
+ *
+ * 		stats maps the archive and plays every replay where it lies in the map, nothing
+ * 		is read or copied into the heap. Threads take replays a batch at a time off one
+ * 		counter, so a few long games don't leave the rest idle, and tally into their
+ * 		own counts, added up at the end. No locks while playing, so it goes as wide as
+ * 		there are cores.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../engine.h"
+#include "../replay.h"
+
+#define ARCHIVE_VERSION	1
+#define ARCHIVE_HEADER	16			// bytes
+#define ARCHIVE_ENTRY		16
+#define BATCH						16			// replays a thread takes at a time
+#define MAX_THREADS			256
+
+// how a game ended
+#define END_SPAWN				0				// next piece had no room
+#define END_GARBAGE			1				// garbage pushed the stack out the top
+#define END_ALIVE				2				// recording stopped with the game still going
+#define END_BAD					3				// replay broken or played out different
+#define ENDS						4
+
+// One thread's counts. Aligned so two threads never write the same cache line.
+typedef struct {
+	unsigned long long games;
+	unsigned long long ticks;
+	unsigned long long lines;
+	unsigned long long pieces[8];						// by piece, 1-7
+	unsigned long long clears[5];						// by lines at once, 1-4
+	unsigned long long levelTicks[256];			// ticks played at each level
+	unsigned long long ends[ENDS];
+	unsigned long long endPiece[8];					// piece that didn't fit, END_SPAWN games
+} __attribute__((aligned(64))) Tally;
+
+typedef struct {
+	pthread_t thread;
+	Tally tally;
+} Worker;
+
+const unsigned char *archive;					// the map
+size_t archiveLength;
+unsigned long replays;
+unsigned long nextReplay;							// first replay no thread has taken yet
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * GET / PUT
+ * 		Little endian numbers in and out of the archive
+ **************************************************************************************/
+unsigned long long get(const unsigned char *b, int bytes) {
+	unsigned long long n = 0;
+
+	while (bytes--)
+		n = n << 8 | b[bytes];
+	return n;
+}
+
+void put(FILE *f, unsigned long long n, int bytes) {
+	while (bytes--) {
+		putc(n & 0xFF, f);
+		n >>= 8;
+	}
+}
+
+/***************************************************************************************
+ * PACK
+ * 		Writes files into a new archive at out
+ **************************************************************************************/
+int pack(const char *out, char **files, int count) {
+	FILE *f = fopen(out, "wb");
+	FILE *in;
+	unsigned long long offset = ARCHIVE_HEADER + (unsigned long long)count * ARCHIVE_ENTRY;
+	unsigned long long total = 0;
+	char buffer[65536];
+	struct stat st;
+	size_t n;
+	int i;
+
+	if (!f) {
+		perror(out);
+		return 1;
+	}
+	fwrite("TRCA", 1, 4, f);
+	put(f, ARCHIVE_VERSION, 4);
+	put(f, count, 4);
+	put(f, 0, 4);
+
+	// the index first, from the sizes, then the files behind it
+	for (i = 0; i < count; i++) {
+		if (stat(files[i], &st)) {
+			perror(files[i]);
+			fclose(f);
+			return 1;
+		}
+		put(f, offset, 8);
+		put(f, st.st_size, 8);
+		offset += st.st_size;
+	}
+	for (i = 0; i < count; i++) {
+		if (!(in = fopen(files[i], "rb"))) {
+			perror(files[i]);
+			fclose(f);
+			return 1;
+		}
+		while ((n = fread(buffer, 1, sizeof buffer, in)) > 0) {
+			fwrite(buffer, 1, n, f);
+			total += n;
+		}
+		fclose(in);
+	}
+	if (fclose(f) || ARCHIVE_HEADER + (unsigned long long)count * ARCHIVE_ENTRY + total != offset) {
+		fprintf(stderr, "%s: write failed, or a file changed while packing\n", out);
+		return 1;
+	}
+	printf("%s: %d replays, %llu bytes\n", out, count, offset);
+	return 0;
+}
+
+/***************************************************************************************
+ * MERGE
+ **************************************************************************************/
+void merge(Tally *into, const Tally *t) {
+	int i;
+
+	into->games += t->games;
+	into->ticks += t->ticks;
+	into->lines += t->lines;
+	for (i = 0; i < 8; i++) {
+		into->pieces[i] += t->pieces[i];
+		into->endPiece[i] += t->endPiece[i];
+	}
+	for (i = 0; i < 5; i++)
+		into->clears[i] += t->clears[i];
+	for (i = 0; i < 256; i++)
+		into->levelTicks[i] += t->levelTicks[i];
+	for (i = 0; i < ENDS; i++)
+		into->ends[i] += t->ends[i];
+}
+
+/***************************************************************************************
+ * PLAY ONE
+ * 		Plays replay n of the archive into t. The game's own counts go in only if it
+ * 		played out, a bad one is just a bad one and nothing it did counts.
+ **************************************************************************************/
+void playOne(Tally *t, unsigned long n) {
+	const unsigned char *entry = archive + ARCHIVE_HEADER + n * ARCHIVE_ENTRY;
+	unsigned long long offset = get(entry, 8);
+	unsigned long long length = get(entry + 8, 8);
+	int ge = 0;
+	int last = 0;										// events of the last tick that played
+	Tally one;
+	Player p;
+	Game g;
+
+	t->games++;
+	if (offset > archiveLength || length > archiveLength - offset ||
+			replayOpen(&p, archive + offset, length, &g)) {
+		t->ends[END_BAD]++;
+		return;
+	}
+	memset(&one, 0, sizeof one);
+	for (;;) {
+		one.levelTicks[g.level]++;
+		if ((ge = replayStep(&p, &g)) < 0)
+			break;
+		last = ge;
+		if (ge & GE_SPAWN)
+			one.pieces[g.piece]++;
+		if (ge & GE_CLEAR)
+			one.clears[g.lines]++;
+	}
+	if (ge == REPLAY_BAD) {
+		t->ends[END_BAD]++;
+		return;
+	}
+	one.levelTicks[g.level]--;			// the step that found the end played nothing
+	one.ticks = g.tick;
+	one.lines = g.totalLines;
+
+	if (g.gameAlive) {
+		one.ends[END_ALIVE]++;
+	} else if (last & GE_GARBAGE) {
+		one.ends[END_GARBAGE]++;
+	} else {
+		one.ends[END_SPAWN]++;
+		one.endPiece[g.piece]++;
+	}
+	merge(t, &one);
+}
+
+/***************************************************************************************
+ * WORK
+ * 		Thread body, takes batches until there are none left
+ **************************************************************************************/
+void *work(void *arg) {
+	Worker *w = arg;
+	unsigned long first;
+	unsigned long n;
+
+	while ((first = __atomic_fetch_add(&nextReplay, BATCH, __ATOMIC_RELAXED)) < replays)
+		for (n = first; n < first + BATCH && n < replays; n++)
+			playOne(&w->tally, n);
+	return NULL;
+}
+
+/***************************************************************************************
+ * REPORT
+ **************************************************************************************/
+void report(const Tally *t, int threads, double s) {
+	static const char pieceNames[8] = " OIZSJLT";
+	static const char *clearNames[5] = {"", "single", "double", "triple", "tetris"};
+	static const char *endNames[ENDS] = {"no room to spawn", "pushed out by garbage",
+			"still going", "bad replay"};
+	unsigned long long pieces = 0;
+	int i;
+
+	for (i = 1; i < 8; i++)
+		pieces += t->pieces[i];
+
+	printf("corpus: %llu games, %d threads, %.3f s\n", t->games, threads, s);
+	printf("%-8s %14.1f/s\n", "games", t->games / s);
+	printf("%-8s %14.1f/s  %llu\n", "ticks", t->ticks / s, t->ticks);
+
+	printf("\npieces %llu\n", pieces);
+	for (i = 1; i < 8; i++)
+		printf("  %c %14llu %6.2f%%\n", pieceNames[i], t->pieces[i],
+				pieces ? 100.0 * t->pieces[i] / pieces : 0.0);
+
+	printf("\nlines %llu\n", t->lines);
+	for (i = 1; i < 5; i++)
+		printf("  %-7s %10llu\n", clearNames[i], t->clears[i]);
+
+	printf("\nticks at level\n");
+	for (i = 0; i < 256; i++)
+		if (t->levelTicks[i])
+			printf("  %3d %14llu %6.2f%%\n", i, t->levelTicks[i], 100.0 * t->levelTicks[i] / t->ticks);
+
+	printf("\nending\n");
+	for (i = 0; i < ENDS; i++)
+		printf("  %-22s %10llu\n", endNames[i], t->ends[i]);
+	printf("  no room for  ");
+	for (i = 1; i < 8; i++)
+		printf(" %c %llu", pieceNames[i], t->endPiece[i]);
+	printf("\n");
+}
+
+/***************************************************************************************
+ * STATS
+ * 		Plays every replay in the archive at path on threads threads
+ **************************************************************************************/
+int stats(const char *path, int threads) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	Worker *workers;
+	Tally total;
+	unsigned long long t0;
+	void *map;
+	int i;
+
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		return 1;
+	}
+	archiveLength = st.st_size;
+	map = archiveLength ? mmap(NULL, archiveLength, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: can't map\n", path);
+		return 1;
+	}
+	archive = map;
+	replays = archiveLength < ARCHIVE_HEADER ? 0 : get(archive + 8, 4);
+	if (archiveLength < ARCHIVE_HEADER || memcmp(archive, "TRCA", 4) ||
+			get(archive + 4, 4) != ARCHIVE_VERSION ||
+			replays > (archiveLength - ARCHIVE_HEADER) / ARCHIVE_ENTRY) {
+		fprintf(stderr, "%s: not a replay archive\n", path);
+		munmap(map, archiveLength);
+		return 1;
+	}
+	posix_madvise(map, archiveLength, POSIX_MADV_WILLNEED);
+
+	// workers is where the tallies live, aligned for them
+	if (posix_memalign((void **)&workers, 64, threads * sizeof *workers)) {
+		munmap(map, archiveLength);
+		return 1;
+	}
+	memset(workers, 0, threads * sizeof *workers);
+	nextReplay = 0;
+
+	t0 = now();
+	for (i = 1; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, work, &workers[i]))
+			break;
+	threads = i;
+	work(&workers[0]);
+	for (i = 1; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	memset(&total, 0, sizeof total);
+	for (i = 0; i < threads; i++)
+		merge(&total, &workers[i].tally);
+	report(&total, threads, (now() - t0) / 1e9);
+
+	free(workers);
+	munmap(map, archiveLength);
+	return total.ends[END_BAD] ? 1 : 0;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int i = 2;
+
+	if (argc > 3 && !strcmp(argv[1], "pack"))
+		return pack(argv[2], argv + 3, argc - 3);
+
+	if (argc > 2 && !strcmp(argv[1], "stats")) {
+		if (!strcmp(argv[i], "-j") && i + 2 < argc) {
+			threads = strtol(argv[++i], NULL, 0);
+			i++;
+		}
+		if (i == argc - 1) {
+			if (threads < 1)
+				threads = 1;
+			if (threads > MAX_THREADS)
+				threads = MAX_THREADS;
+			return stats(argv[i], threads);
+		}
+	}
+
+	fprintf(stderr, "usage: %s pack out file...\n"
+			"       %s stats [-j threads] archive\n", argv[0], argv[0]);
+	return 2;
+}
@@ -0,0 +1,109 @@
+/***************************************************************************************
+ * DEVICE
+ * 		See device.h. Moved out of render.c as it was so other tools can draw a game
+ * 		the way the unit does.
+ **************************************************************************************/
+#include <string.h>
+#include "../draw.h"
+#include "device.h"
+
+void (*deviceKeep)(int, unsigned int);
+
+/***************************************************************************************
+ * DEVICE START
+ * 		newGame on the unit. draw false is the first pass, which only keeps track.
+ **************************************************************************************/
+int deviceStart(Device *d, const unsigned char *data, size_t length, bool draw) {
+	memset(d, 0, sizeof *d);
+	if (replayOpen(&d->p, data, length, &d->g))
+		return REPLAY_BAD;
+	d->levelColor = levelColorFor(1);
+	d->clearRow = -1;
+	if (draw) {
+		initBackground();
+		fillLevelColor(d->levelColor);
+	} else if (deviceKeep) {
+		deviceKeep(-1, d->levelColor);
+	}
+	d->strip = 1;
+	return 0;
+}
+
+/***************************************************************************************
+ * DEVICE TICK
+ * 		One 10 ms tick of the unit, the same as handlePlaying / show / handleLineClear
+ * 		in main.c for a game with no pauses. REPLAY_BAD if the replay is.
+ **************************************************************************************/
+int deviceTick(Device *d, bool draw) {
+	unsigned char oldPiece = d->g.piece;
+	unsigned char oldRotation = d->g.rotation;
+	unsigned char oldX = d->g.xPos;
+	unsigned char oldY = d->g.yPos;
+	unsigned int n;
+	int ge;
+	int j;
+
+	d->tick++;
+	if (d->clearRow >= 0) {
+		if (draw)
+			for (j = 0; j < 10; j++)
+				drawSquare(SQUARE_X(j), SQUARE_Y(d->clearRow), d->grid[d->clearRow][j]);
+		if (++d->clearRow == 14) {
+			if (draw && d->g.pieceAlive)
+				paintPiece(SQUARE_X(d->g.xPos), SQUARE_Y(d->g.yPos), d->g.piece, d->g.rotation,
+						d->g.piece);
+			d->clearRow = -1;
+		}
+		return 0;
+	}
+	if (d->over)
+		return 0;
+
+	if ((ge = replayStep(&d->p, &d->g)) < 0) {
+		d->over = true;
+		return ge == REPLAY_BAD ? ge : 0;
+	}
+
+	followGrid(d->grid, &d->g, ge, oldPiece, oldRotation, oldX, oldY);
+
+	if (ge & GE_CLEAR) {
+		for (n = d->g.totalLines - d->g.lines; n < d->g.totalLines; n++) {
+			if (draw)
+				drawScore(n, d->levelColor);
+			else if (deviceKeep)
+				deviceKeep(n, d->levelColor);
+			d->strip++;
+		}
+		if (ge & GE_LEVEL) {
+			d->levelColor = levelColorFor(d->g.level);
+			if (draw)
+				fillLevelColor(d->levelColor);
+			else if (deviceKeep)
+				deviceKeep(-1, d->levelColor);
+			d->strip++;
+		}
+	}
+
+	if ((ge & (GE_CLEAR | GE_GARBAGE)) && !(ge & GE_OVER)) {
+		d->clearRow = 0;
+		return 0;
+	}
+
+	if (draw && (ge & GE_SPAWN)) {
+		paintPiece(SQUARE_X(d->g.xPos), SQUARE_Y(d->g.yPos), d->g.piece, d->g.rotation,
+				d->g.piece);
+	} else if (draw && (ge & GE_MOVED)) {
+		paintPiece(SQUARE_X(oldX), SQUARE_Y(oldY), oldPiece, oldRotation, 0);
+		paintPiece(SQUARE_X(d->g.xPos), SQUARE_Y(d->g.yPos), d->g.piece, d->g.rotation,
+				d->g.piece);
+	}
+
+	if (ge & GE_OVER) {
+		d->over = true;
+		if (draw) {
+			drawInstruction(85, 61, 0x0000);
+			drawInstruction(84, 60, 0xFFFF);
+		}
+	}
+	return 0;
+}
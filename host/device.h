@@ -0,0 +1,36 @@
+/***************************************************************************************
+ * DEVICE
+ * 		The unit's screen side of a replay, for host tools that draw what the unit
+ * 		drew. deviceTick is handlePlaying / show / handleLineClear from main.c for a
+ * 		game with no pauses, drawing with draw.c into whatever the platform's
+ * 		writeLCDControl / writeLCDData are, lcd.c's on a host.
+ *
+ * 		With draw false nothing is drawn, it only keeps up, and the score and level
+ * 		draws along the top strip go to deviceKeep if it's set. render's first pass
+ * 		keeps them that way for its redraws.
+ **************************************************************************************/
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <stddef.h>
+#include "../engine.h"
+#include "../replay.h"
+
+// Everything on the unit's side of a replay, what show() and handleLineClear keep
+typedef struct {
+	Game g;
+	Player p;
+	unsigned char grid[14][10];	// colors of g.rows
+	unsigned int levelColor;
+	int clearRow;								// next row to redraw after a clear, -1 if none
+	unsigned int strip;					// strip draws so far
+	unsigned long tick;					// device ticks run, line clears included
+	bool over;									// replay played out
+} Device;
+
+extern void (*deviceKeep)(int, unsigned int);	// drawScore line or -1 for fillLevelColor, color
+
+int deviceStart(Device *, const unsigned char *, size_t, bool);
+int deviceTick(Device *, bool);
+
+#endif
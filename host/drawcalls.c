@@ -0,0 +1,66 @@
+/***************************************************************************************
+ * DRAW CALLS
+ * 		See drawcalls.h
+ **************************************************************************************/
+#include "../draw.h"
+#include "drawcalls.h"
+
+static void square(void) {
+	drawSquare(SQUARE_X(4), SQUARE_Y(6), 7);
+}
+
+static void squareEmpty(void) {
+	drawSquare(SQUARE_X(4), SQUARE_Y(6), 0);
+}
+
+static void piece(void) {
+	paintPiece(SQUARE_X(4), SQUARE_Y(6), 7, 1, 7);
+}
+
+static void levelColor(void) {
+	fillLevelColor(levelColorFor(3));
+}
+
+static void score(void) {
+	drawScore(17, levelColorFor(2));
+}
+
+static void pixel(void) {
+	drawPixel(120, 160, 0xFFFF);
+}
+
+static void rect(void) {
+	fillRect(20, 30, 59, 69, 0xF800);
+}
+
+static void letter(void) {
+	drawLetter(0x61, 100, 100, 0xFFFF);
+}
+
+static void instruction(void) {
+	drawInstruction(84, 60, 0xFFFF);
+}
+
+static void background(void) {
+	initBackground();
+}
+
+static void screen(void) {
+	fillScreen(0x5B57);
+}
+
+const DrawCall drawCalls[] = {
+	{"drawSquare", square},
+	{"drawSquare-empty", squareEmpty},
+	{"paintPiece", piece},
+	{"fillLevelColor", levelColor},
+	{"drawScore", score},
+	{"drawPixel", pixel},
+	{"fillRect", rect},
+	{"drawLetter", letter},
+	{"drawInstruction", instruction},
+	{"initBackground", background},
+	{"fillScreen", screen},
+};
+
+const int drawCallCount = sizeof drawCalls / sizeof *drawCalls;
@@ -0,0 +1,18 @@
+/***************************************************************************************
+ * DRAW CALLS
+ * 		One call of every draw.c primitive, with the arguments they're measured at.
+ * 		lcdcheck checks the bytes and picture each leaves, bench times them, so both
+ * 		always look at the same draws.
+ **************************************************************************************/
+#ifndef DRAWCALLS_H
+#define DRAWCALLS_H
+
+typedef struct {
+	const char *name;
+	void (*draw)(void);
+} DrawCall;
+
+extern const DrawCall drawCalls[];
+extern const int drawCallCount;
+
+#endif
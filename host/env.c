@@ -0,0 +1,199 @@
+/***************************************************************************************
+ * ENV
+ * 		See env.h
+ **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "env.h"
+
+#define VIEW_BYTES	(14 * 2 + 6)		// buffer a board takes
+
+// The part of a Game the player doesn't see, together a board so a step touches
+// one line of it
+typedef struct {
+	uint32_t tick;
+	uint32_t games;									// games this board has started
+	uint16_t keyPress;
+	uint16_t dropCounter;
+	uint16_t totalLines;
+	uint16_t cleared;
+	uint8_t level;
+	uint8_t linesCleared;
+	uint8_t lines;
+	uint8_t graceTime;
+	uint8_t keys;
+	uint8_t garbage;
+	uint8_t raised;
+	uint8_t hole;
+	bool pieceAlive;
+	bool gameAlive;
+} Hidden;
+
+struct Env {
+	unsigned int count;
+	unsigned int seed;
+	EnvView view;										// in the caller's buffer
+	Hidden *hidden;
+};
+
+/***************************************************************************************
+ * ENV BUFFER SIZE
+ * 		Bytes the buffer for count boards needs
+ **************************************************************************************/
+size_t envBufferSize(unsigned int count) {
+	return (size_t)count * VIEW_BYTES;
+}
+
+/***************************************************************************************
+ * ENV NEW
+ * 		count boards in buffer, envBufferSize(count) bytes, 2 byte aligned. The boards
+ * 		start with seeds seed, seed+1, ... NULL if out of memory.
+ **************************************************************************************/
+Env *envNew(unsigned int count, void *buffer, unsigned int seed) {
+	Env *e = calloc(1, sizeof *e);
+	uint8_t *b = buffer;
+
+	if (!e || !(e->hidden = calloc(count, sizeof *e->hidden))) {
+		free(e);
+		return NULL;
+	}
+	e->count = count;
+	e->view.rows = (uint16_t (*)[14])b;
+	e->view.piece = b + count * 28;
+	e->view.rotation = e->view.piece + count;
+	e->view.x = e->view.rotation + count;
+	e->view.y = e->view.x + count;
+	e->view.reward = e->view.y + count;
+	e->view.done = e->view.reward + count;
+
+	e->seed = seed;
+	envReset(e, 0, count);
+	return e;
+}
+
+/***************************************************************************************
+ * ENV FREE
+ * 		The buffer is the caller's
+ **************************************************************************************/
+void envFree(Env *e) {
+	if (e)
+		free(e->hidden);
+	free(e);
+}
+
+/***************************************************************************************
+ * ENV VIEW
+ **************************************************************************************/
+EnvView envView(const Env *e) {
+	return e->view;
+}
+
+/***************************************************************************************
+ * LOAD / STORE
+ * 		Board i in and out of a Game
+ **************************************************************************************/
+static inline void load(const Env *e, unsigned int i, Game *g) {
+	const Hidden *h = &e->hidden[i];
+
+	memcpy(g->rows, e->view.rows[i], sizeof g->rows);
+	g->tick = h->tick;
+	g->keyPress = h->keyPress;
+	g->dropCounter = h->dropCounter;
+	g->totalLines = h->totalLines;
+	g->cleared = h->cleared;
+	g->level = h->level;
+	g->linesCleared = h->linesCleared;
+	g->lines = h->lines;
+	g->piece = e->view.piece[i];
+	g->rotation = e->view.rotation[i];
+	g->xPos = e->view.x[i];
+	g->yPos = e->view.y[i];
+	g->graceTime = h->graceTime;
+	g->keys = h->keys;
+	g->garbage = h->garbage;
+	g->raised = h->raised;
+	g->hole = h->hole;
+	g->pieceAlive = h->pieceAlive;
+	g->gameAlive = h->gameAlive;
+}
+
+static inline void store(Env *e, unsigned int i, const Game *g) {
+	Hidden *h = &e->hidden[i];
+
+	memcpy(e->view.rows[i], g->rows, sizeof g->rows);
+	h->tick = g->tick;
+	h->keyPress = g->keyPress;
+	h->dropCounter = g->dropCounter;
+	h->totalLines = g->totalLines;
+	h->cleared = g->cleared;
+	h->level = g->level;
+	h->linesCleared = g->linesCleared;
+	h->lines = g->lines;
+	e->view.piece[i] = g->piece;
+	e->view.rotation[i] = g->rotation;
+	e->view.x[i] = g->xPos;
+	e->view.y[i] = g->yPos;
+	h->graceTime = g->graceTime;
+	h->keys = g->keys;
+	h->garbage = g->garbage;
+	h->raised = g->raised;
+	h->hole = g->hole;
+	h->pieceAlive = g->pieceAlive;
+	h->gameAlive = g->gameAlive;
+}
+
+/***************************************************************************************
+ * START
+ * 		Board i's next game into g. Game n of board i gets seed + i + n * count, so
+ * 		which games a board plays doesn't depend on the others or on threads.
+ **************************************************************************************/
+static inline void start(Env *e, unsigned int i, Game *g) {
+	gameReset(g, e->seed + i + e->hidden[i].games++ * e->count);
+}
+
+/***************************************************************************************
+ * ENV RESET
+ * 		New games on boards first to first + count
+ **************************************************************************************/
+void envReset(Env *e, unsigned int first, unsigned int count) {
+	unsigned int i;
+	Game g;
+
+	for (i = first; i < first + count && i < e->count; i++) {
+		start(e, i, &g);
+		store(e, i, &g);
+		e->view.reward[i] = 0;
+		e->view.done[i] = 0;
+	}
+}
+
+/***************************************************************************************
+ * ENV STEP
+ * 		One tick of boards first to first + count, in[i] the input byte of board i.
+ * 		A board that was done starts over before it steps. Boards are independent,
+ * 		two threads can step two ranges of one Env at once.
+ **************************************************************************************/
+void envStep(Env *e, const uint8_t *in, unsigned int first, unsigned int count) {
+	unsigned int i;
+	unsigned char ge;
+	Game g;
+
+	for (i = first; i < first + count && i < e->count; i++) {
+		if (e->view.done[i])
+			start(e, i, &g);
+		else
+			load(e, i, &g);
+		ge = gameTick(&g, in[i]);
+		store(e, i, &g);
+		e->view.reward[i] = ge & GE_CLEAR ? g.lines : 0;
+		e->view.done[i] = (ge & GE_OVER) != 0;
+	}
+}
+
+/***************************************************************************************
+ * ENV GAME
+ * 		Board i as a Game, for anything that wants the engine's view of it
+ **************************************************************************************/
+void envGame(const Env *e, unsigned int i, Game *g) {
+	load(e, i, g);
+}
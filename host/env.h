@@ -0,0 +1,50 @@
+/***************************************************************************************
+ * ENV
+ * 		Many games stepped together, for training players. One call resets, steps or
+ * 		looks at a whole batch, one input byte a board a step, the same tick gameTick
+ * 		runs.
+ *
+ * 		What a player sees is kept a field at a time across the batch, not a Game per
+ * 		board, in a buffer the caller hands over, laid out as
+ * 			rows		count boards x 14 uint16_t, bit n of a row is column n
+ * 			piece, rotation, x, y		count bytes each, the piece in play
+ * 			reward	count bytes, lines the last step cleared
+ * 			done		count bytes, 1 if the last step ended the game
+ * 		and envView points straight into it, nothing is copied out. The rest of a
+ * 		game (tick, keyPress, drop counter...) stays inside the Env, a small record a
+ * 		board, as a step needs all of it at once.
+ *
+ * 		A board whose game ends starts again on the step after with a new seed, so a
+ * 		batch never runs dry. Each step gathers a board's fields into a Game,
+ * 		runs the engine's own gameTick and scatters it back, so the rules are the
+ * 		engine's and a board plays out bit for bit like a Game fed the same bytes.
+ * 		envStep takes a range, threads can each step their own part of one batch.
+ **************************************************************************************/
+#ifndef ENV_H
+#define ENV_H
+
+#include <stddef.h>
+#include "../engine.h"
+
+typedef struct Env Env;
+
+// Where everything is in the caller's buffer
+typedef struct {
+	uint16_t (*rows)[14];
+	uint8_t *piece;
+	uint8_t *rotation;
+	uint8_t *x;
+	uint8_t *y;
+	uint8_t *reward;
+	uint8_t *done;
+} EnvView;
+
+size_t envBufferSize(unsigned int);
+Env *envNew(unsigned int, void *, unsigned int);
+void envFree(Env *);
+EnvView envView(const Env *);
+void envReset(Env *, unsigned int, unsigned int);
+void envStep(Env *, const uint8_t *, unsigned int, unsigned int);
+void envGame(const Env *, unsigned int, Game *);
+
+#endif
@@ -0,0 +1,191 @@
+/***************************************************************************************
+ * ENV BENCH
+ * 		How many board steps a millisecond env.c manages, on random inputs, and a
+ * 		check that its boards play out the same as plain Games fed the same bytes.
+ *
+ * 		build/env [-n boards] [-t steps] [-j threads] [-s seed] [-c boards to check]
+ *
+ * 		Every step each thread makes up the inputs for its part of the batch and
+ * 		steps it, then they all wait for each other, like a training loop that
+ * 		hands a whole batch to the player between steps.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "env.h"
+
+#define MAX_THREADS		256
+
+typedef struct {
+	pthread_t thread;
+	unsigned int first;
+	unsigned int count;
+	unsigned long long rng;
+} Worker;
+
+Env *env;
+uint8_t *inputs;
+unsigned long steps = 2000;
+int threads;
+Worker workers[MAX_THREADS];
+pthread_barrier_t stepped;
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * MAKE INPUTS
+ * 		A press one tick in eight, the joystick somewhere
+ **************************************************************************************/
+void makeInputs(Worker *w) {
+	unsigned int i;
+
+	for (i = w->first; i < w->first + w->count; i++) {
+		w->rng ^= w->rng << 13;
+		w->rng ^= w->rng >> 7;
+		w->rng ^= w->rng << 17;
+		inputs[i] = ((w->rng >> 40 & 7) ? 0 : w->rng >> 32 & 7) |
+				(w->rng >> 48 & 3) << IN_STICK_SHIFT;
+	}
+}
+
+/***************************************************************************************
+ * WORK
+ **************************************************************************************/
+void *work(void *arg) {
+	Worker *w = arg;
+	unsigned long n;
+
+	for (n = 0; n < steps; n++) {
+		makeInputs(w);
+		envStep(env, inputs, w->first, w->count);
+		pthread_barrier_wait(&stepped);
+	}
+	return NULL;
+}
+
+/***************************************************************************************
+ * CHECK
+ * 		Steps env and plain Games side by side on the first boards boards, 0 if
+ * 		they never differ
+ **************************************************************************************/
+int check(unsigned int count, unsigned int boards, unsigned int seed) {
+	Game *games = malloc(boards * sizeof *games);
+	uint32_t *started = calloc(boards, sizeof *started);
+	EnvView v = envView(env);
+	unsigned char ge;
+	unsigned long n;
+	unsigned int i;
+	Worker w = {0, 0, count, 1};
+
+	for (i = 0; i < boards; i++)
+		gameReset(&games[i], seed + i + started[i]++ * count);
+	for (n = 0; n < steps; n++) {
+		makeInputs(&w);
+		envStep(env, inputs, 0, count);
+		for (i = 0; i < boards; i++) {
+			if (games[i].gameAlive == false)
+				gameReset(&games[i], seed + i + started[i]++ * count);
+			ge = gameTick(&games[i], inputs[i]);
+			if (memcmp(v.rows[i], games[i].rows, sizeof games[i].rows) ||
+					v.piece[i] != games[i].piece || v.rotation[i] != games[i].rotation ||
+					v.x[i] != games[i].xPos || v.y[i] != games[i].yPos ||
+					v.reward[i] != (ge & GE_CLEAR ? games[i].lines : 0) ||
+					v.done[i] != !!(ge & GE_OVER)) {
+				printf("env: board %u differs at step %lu\n", i, n);
+				return 1;
+			}
+		}
+	}
+	printf("env: %u boards match plain Games over %lu steps\n", boards, steps);
+	free(games);
+	free(started);
+	return 0;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned int count = 4096;
+	unsigned int seed = 1;
+	unsigned int checked = 0;
+	unsigned long long t0;
+	void *buffer;
+	double s;
+	int i;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			count = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			steps = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+			checked = strtoul(argv[++i], NULL, 0);
+		else {
+			fprintf(stderr, "usage: %s [-n boards] [-t steps] [-j threads] [-s seed]"
+					" [-c boards to check]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (count < 1)
+		count = 1;
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	if ((unsigned int)threads > count)
+		threads = count;
+
+	inputs = malloc(count);
+	if (posix_memalign(&buffer, 64, envBufferSize(count)) || !inputs || !(env = envNew(count, buffer, seed))) {
+		fprintf(stderr, "env: out of memory\n");
+		return 1;
+	}
+	if (checked)
+		return check(count, checked < count ? checked : count, seed);
+
+	// cut the batch into a part a thread, on cache line bounds where it can be
+	for (i = 0; i < threads; i++) {
+		workers[i].first = (unsigned long)count * i / threads & ~63UL;
+		workers[i].rng = seed * 2654435761ULL + i + 1;
+	}
+	for (i = 0; i < threads; i++)
+		workers[i].count = (i + 1 < threads ? workers[i + 1].first : count) - workers[i].first;
+
+	pthread_barrier_init(&stepped, NULL, threads);
+	t0 = now();
+	for (i = 1; i < threads; i++)
+		pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+	work(&workers[0]);
+	for (i = 1; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+	s = (now() - t0) / 1e9;
+
+	printf("env: %u boards, %lu steps, %d threads, %zu byte buffer\n", count, steps, threads,
+			envBufferSize(count));
+	printf("%.1f board steps/ms, %.3f s\n", count * (double)steps / s / 1000, s);
+
+	envFree(env);
+	free(buffer);
+	free(inputs);
+	return 0;
+}
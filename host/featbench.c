@@ -0,0 +1,139 @@
+/***************************************************************************************
+ * FEATURE BENCH
+ * 		How many boards a millisecond each feature kernel gets through, and a check
+ * 		that every kernel comes out byte for byte the same as the scalar one.
+ *
+ * 		build/features [-n boards] [-r rounds] [-s seed]
+ * 				make check runs -n 16384 -r 1 -s 1, a kernel that differs fails it
+ *
+ * 		Boards are made up: a random stack height a column, mostly filled below it
+ * 		with the odd hole, and now and then a full row, so every feature gets used.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../engine.h"
+#include "features.h"
+
+unsigned long long rng;
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+unsigned int random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng >> 32;
+}
+
+/***************************************************************************************
+ * MAKE BOARD
+ **************************************************************************************/
+void makeBoard(uint16_t *rows) {
+	int top[10];
+	int i;
+	int c;
+
+	for (c = 0; c < 10; c++)
+		top[c] = 14 - random32() % 15;
+	for (i = 0; i < 14; i++) {
+		rows[i] = 0;
+		for (c = 0; c < 10; c++)
+			if (i == top[c] || (i > top[c] && random32() % 6))
+				rows[i] |= 1 << c;
+		if (i > 6 && random32() % 8 == 0)
+			rows[i] = FULL_ROW;
+	}
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned int count = 65536;
+	unsigned int rounds = 50;
+	unsigned int seed = 1;
+	uint16_t (*boards)[14];
+	Features *want;
+	Features *got;
+	unsigned long long t0;
+	double s;
+	unsigned int n;
+	int failed = 0;
+	int ragged;
+	int k;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			count = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+			rounds = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoul(argv[++i], NULL, 0);
+		else {
+			fprintf(stderr, "usage: %s [-n boards] [-r rounds] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (count < 1)
+		count = 1;
+	if (rounds < 1)
+		rounds = 1;
+
+	boards = malloc(count * sizeof *boards);
+	want = malloc(count * sizeof *want);
+	got = malloc(count * sizeof *got);
+	if (!boards || !want || !got) {
+		fprintf(stderr, "features: out of memory\n");
+		return 1;
+	}
+	rng = seed * 2654435761ULL + 1;
+	for (n = 0; n < count; n++)
+		makeBoard(boards[n]);
+	for (n = 0; n < count; n++)
+		featuresOne(boards[n], &want[n]);
+
+	printf("features: %u boards, %u rounds\n", count, rounds);
+	for (k = 0; k < FEATURES_KERNELS; k++) {
+		if (featuresUse(k) != k) {
+			printf("%-7s not on this CPU\n", featuresNames[k]);
+			continue;
+		}
+		// every batch length up to a few lanes past the widest, for the ragged ends
+		for (ragged = 0, n = 1; n <= 40 && n <= count; n++) {
+			memset(got, 0xFF, n * sizeof *got);
+			featuresBatch(boards + count - n, n, got);
+			ragged |= memcmp(got, want + count - n, n * sizeof *got);
+		}
+		memset(got, 0xFF, count * sizeof *got);
+		t0 = now();
+		for (n = 0; n < rounds; n++)
+			featuresBatch(boards, count, got);
+		s = (now() - t0) / 1e9;
+		if (memcmp(got, want, count * sizeof *got) || ragged) {
+			printf("%-7s differs from scalar\n", featuresNames[k]);
+			failed = 1;
+			continue;
+		}
+		printf("%-7s %8.1f boards/ms, %.2f ns a board, matches scalar\n", featuresNames[k],
+				(double)count * rounds / s / 1e3, s * 1e9 / ((double)count * rounds));
+	}
+	printf("best here: %s\n", featuresNames[featuresUse(-1)]);
+
+	free(boards);
+	free(want);
+	free(got);
+	return failed;
+}
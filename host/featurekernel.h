@@ -0,0 +1,105 @@
+/***************************************************************************************
+ * FEATURE KERNEL
+ * 		The batch kernel, written once for LANES boards side by side and included by
+ * 		features.c once for each instruction set. Set KERNEL (its name), LANES and
+ * 		TARGET (a target attribute, or nothing) first. GCC vector extensions, so the
+ * 		compiler picks the instructions for the target.
+ **************************************************************************************/
+
+// bits set in each 16 bit lane of x
+#define POPCOUNT16(x)	(x = x - ((x >> 1) & 0x5555), \
+		x = (x & 0x3333) + ((x >> 2) & 0x3333), \
+		x = (x + (x >> 4)) & 0x0F0F, \
+		(x + (x >> 8)) & 0x1F)
+
+TARGET static void KERNEL(const uint16_t (*rows)[14], unsigned int n, Features *out) {
+	typedef uint16_t V __attribute__((vector_size(LANES * 2)));
+	uint16_t lanes[14][LANES];					// the rows turned sideways, a board a lane
+	uint16_t h[12][LANES];
+	V heights[12];											// a wall either side, as high as the board
+	V seen;
+	V plane0;														// heights so far, 4 bit counters in planes
+	V plane1;
+	V plane2;
+	V plane3;
+	V carry;
+	V holes;
+	V transitions;
+	V full;
+	V height;
+	V bumps;
+	V wells;
+	V r;
+	V x;
+	V d;
+	V m;
+	unsigned int base;
+	unsigned int count;
+	unsigned int i;
+	unsigned int l;
+	int c;
+
+	for (base = 0; base < n; base += LANES) {
+		count = n - base < LANES ? n - base : LANES;
+		for (i = 0; i < 14; i++)
+			for (l = 0; l < LANES; l++)
+				lanes[i][l] = l < count ? rows[base + l][i] : 0;
+
+		seen = plane0 = plane1 = plane2 = plane3 = holes = transitions = full = (V){0};
+		for (i = 0; i < 14; i++) {
+			memcpy(&r, lanes[i], sizeof r);
+			seen |= r;
+			x = seen & ~r;
+			holes += POPCOUNT16(x);
+			x = (r << 1) | 0x801;
+			x = (x ^ (x >> 1)) & 0x7FF;
+			transitions += POPCOUNT16(x);
+			full -= (V)(r == FULL_ROW);
+
+			// every covered column counts one more row of height
+			carry = plane0 & seen;
+			plane0 ^= seen;
+			x = plane1 & carry;
+			plane1 ^= carry;
+			carry = plane2 & x;
+			plane2 ^= x;
+			plane3 |= carry;
+		}
+
+		heights[0] = heights[11] = (V){0} + 14;
+		height = (V){0};
+		for (c = 0; c < 10; c++) {
+			heights[c + 1] = ((plane0 >> c) & 1) | ((plane1 >> c) & 1) << 1 |
+					((plane2 >> c) & 1) << 2 | ((plane3 >> c) & 1) << 3;
+			height += heights[c + 1];
+		}
+		bumps = wells = (V){0};
+		for (c = 1; c <= 10; c++) {
+			if (c < 10) {
+				m = (V)(heights[c] > heights[c + 1]);
+				bumps += ((heights[c] - heights[c + 1]) & m) | ((heights[c + 1] - heights[c]) & ~m);
+			}
+			m = (V)(heights[c - 1] < heights[c + 1]);
+			d = (heights[c - 1] & m) | (heights[c + 1] & ~m);
+			wells += (d - heights[c]) & (V)(d > heights[c]);
+		}
+
+		for (c = 0; c < 12; c++)
+			memcpy(h[c], &heights[c], sizeof h[c]);
+		for (l = 0; l < count; l++) {
+			for (c = 0; c < 10; c++)
+				out[base + l].heights[c] = h[c + 1][l];
+			out[base + l].height = height[l];
+			out[base + l].holes = holes[l];
+			out[base + l].bumps = bumps[l];
+			out[base + l].wells = wells[l];
+			out[base + l].transitions = transitions[l];
+			out[base + l].full = full[l];
+		}
+	}
+}
+
+#undef POPCOUNT16
+#undef KERNEL
+#undef LANES
+#undef TARGET
@@ -0,0 +1,132 @@
+/***************************************************************************************
+ * FEATURES
+ * 		See features.h
+ **************************************************************************************/
+#include <string.h>
+#include "features.h"
+
+const char *featuresNames[FEATURES_KERNELS] = {"scalar", "sse", "avx2"};
+
+#define KERNEL	batchSse
+#define LANES		8
+#define TARGET
+#include "featurekernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL	batchAvx2
+#define LANES		16
+#define TARGET	__attribute__((target("avx2")))
+#include "featurekernel.h"
+#endif
+
+static int kernel = -1;						// featuresUse, -1 until picked. Atomic, threads race to it
+
+/***************************************************************************************
+ * FEATURES ONE
+ * 		One board the plain way, what the kernels have to match
+ **************************************************************************************/
+void featuresOne(const uint16_t *rows, Features *f) {
+	int heights[12];
+	unsigned int seen = 0;
+	unsigned int m;
+	unsigned int x;
+	int d;
+	int i;
+	int c;
+
+	memset(f, 0, sizeof *f);
+	for (c = 1; c <= 10; c++)
+		heights[c] = 0;
+	heights[0] = heights[11] = 14;
+	for (i = 0; i < 14; i++) {
+		for (m = rows[i] & ~seen; m; m &= m - 1)
+			heights[__builtin_ctz(m) + 1] = 14 - i;
+		seen |= rows[i];
+		f->holes += __builtin_popcount(seen & ~rows[i]);
+		x = (unsigned int)rows[i] << 1 | 0x801;
+		f->transitions += __builtin_popcount((x ^ (x >> 1)) & 0x7FF);
+		f->full += rows[i] == FULL_ROW;
+	}
+	for (c = 1; c <= 10; c++) {
+		f->heights[c - 1] = heights[c];
+		f->height += heights[c];
+		if (c < 10)
+			f->bumps += heights[c] > heights[c + 1] ? heights[c] - heights[c + 1] :
+					heights[c + 1] - heights[c];
+		d = (heights[c - 1] < heights[c + 1] ? heights[c - 1] : heights[c + 1]) - heights[c];
+		if (d > 0)
+			f->wells += d;
+	}
+}
+
+#ifdef ENGINE_FEATURES
+/***************************************************************************************
+ * GAME FEATURES
+ * 		The engine's from scratch BoardFeatures (engine.h): featuresOne's, and the
+ * 		blocks in each column
+ **************************************************************************************/
+void gameFeatures(const uint16_t *rows, BoardFeatures *f) {
+	Features all;
+	unsigned int m;
+	int i;
+	int c;
+
+	featuresOne(rows, &all);
+	for (c = 0; c < 10; c++) {
+		f->heights[c] = all.heights[c];
+		f->filled[c] = 0;
+	}
+	for (i = 0; i < 14; i++)
+		for (m = rows[i]; m; m &= m - 1)
+			f->filled[__builtin_ctz(m)]++;
+	f->height = all.height;
+	f->holes = all.holes;
+	f->bumps = all.bumps;
+}
+#endif
+
+static void batchScalar(const uint16_t (*rows)[14], unsigned int n, Features *out) {
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		featuresOne(rows[i], &out[i]);
+}
+
+/***************************************************************************************
+ * FEATURES USE
+ * 		Runs batches on kernel k from now on, -1 for the best this CPU has. Returns
+ * 		the kernel picked, which is the next best down if k can't run here.
+ **************************************************************************************/
+int featuresUse(int k) {
+	if (k < 0 || k >= FEATURES_KERNELS)
+		k = FEATURES_AVX2;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (k == FEATURES_AVX2 && !__builtin_cpu_supports("avx2"))
+		k = FEATURES_SSE;
+#else
+	if (k == FEATURES_AVX2)
+		k = FEATURES_SSE;					// 128 bit vectors are whatever the host has
+#endif
+	__atomic_store_n(&kernel, k, __ATOMIC_RELAXED);
+	return k;
+}
+
+/***************************************************************************************
+ * FEATURES BATCH
+ * 		Features of n boards into out
+ **************************************************************************************/
+void featuresBatch(const uint16_t (*rows)[14], unsigned int n, Features *out) {
+	int k = __atomic_load_n(&kernel, __ATOMIC_RELAXED);
+
+	if (k < 0)
+		k = featuresUse(-1);
+	if (k == FEATURES_SCALAR)
+		batchScalar(rows, n, out);
+	else if (k == FEATURES_SSE)
+		batchSse(rows, n, out);
+#if defined(__x86_64__) || defined(__i386__)
+	else
+		batchAvx2(rows, n, out);
+#endif
+}
@@ -0,0 +1,44 @@
+/***************************************************************************************
+ * FEATURES
+ * 		What an evaluator wants to know about a board, for a whole batch of boards at
+ * 		once. A board is its 14 row masks, as Game.rows and env.c keep them.
+ *
+ * 		The batch kernel lines up 16 boards (AVX2) or 8 (SSE) side by side, a board a
+ * 		16 bit lane, and goes down the rows once for all of them. Heights come out of
+ * 		a 4 bit counter a column kept across the lanes in bit planes, the rest from
+ * 		the rows and the heights. Integers all the way, so every kernel gives the
+ * 		same bytes as featuresOne, the plain version. The best kernel the CPU has is
+ * 		picked the first time a batch runs, featuresUse picks one by hand.
+ *
+ * 		Everything that wants these off a board gets them here: ai.c and search.c
+ * 		score their placements a batch at a time, and an ENGINE_FEATURES engine's
+ * 		gameFeatures is featuresOne's.
+ **************************************************************************************/
+#ifndef FEATURES_H
+#define FEATURES_H
+
+#include "../engine.h"
+
+// Kernels
+#define FEATURES_SCALAR	0
+#define FEATURES_SSE		1
+#define FEATURES_AVX2		2
+#define FEATURES_KERNELS	3
+
+typedef struct {
+	uint8_t heights[10];				// rows from the bottom to the top block of each column
+	uint8_t height;							// heights added up
+	uint8_t holes;							// empty cells with a block somewhere above
+	uint8_t bumps;							// height steps between neighbours
+	uint8_t wells;							// depth of columns below both neighbours, walls 14 high
+	uint8_t transitions;				// filled/empty changes along the rows, walls filled
+	uint8_t full;								// rows with no gap
+} Features;
+
+extern const char *featuresNames[FEATURES_KERNELS];
+
+void featuresOne(const uint16_t *, Features *);
+void featuresBatch(const uint16_t (*)[14], unsigned int, Features *);
+int featuresUse(int);
+
+#endif
@@ -0,0 +1,353 @@
+/***************************************************************************************
+ * FIRMWARE BENCH
+ * 		The real firmware, build/tetris.elf, on the simulated MSP430G2553 of msp430.c,
+ * 		counting cycles for every function it calls and every interrupt it takes, so
+ * 		a change to main.c, draw.c or engine.c can be timed without a board.
+ *
+ * 		build/fwbench [-t seconds] [-s seed] [elf]
+ * 				elf is build/tetris.elf if not given (make firmware-bench builds both)
+ * 				-t most seconds of unit time for the demo and the game, RUN_SECONDS
+ * 				-s seeds the presses in the game
+ *
+ * 		It goes through what a unit does: boots, sits on the title until the demo
+ * 		starts itself, watches the demo, then taps and plays a game with a button
+ * 		pressed every so often and the joystick now and then, until it tops out.
+ * 		The touchscreen reads nothing but for the taps, the joystick sits in the
+ * 		middle but for its pulls.
+ *
+ * 		Each phase gets its active and idle cycles. Each function gets its calls, and
+ * 		its cycles with what it called (mean and most) and without (self), interrupts
+ * 		taken inside it counted in. Then what a step(), a line clear and an SPI byte
+ * 		came to.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "msp430.h"
+
+#define RUN_SECONDS		60
+#define SLICE					2000				// cycles between looks at the firmware, 100 us
+#define FRAMES				256					// call depth
+#define COUNTS				512
+#define TAP_MS				200
+#define PRESS_MS			30
+#define JOYSTICK_IDLE	512
+
+// main.c's
+#define STATE_PLAYING		1
+#define STATE_LINE_CLEAR	2
+#define BTN_ROT				0x40					// P1.6
+#define BTN_RGHT			0x10					// P2
+#define BTN_LFT				0x08
+#define TS_Z0					1							// ADC10 channels readTS takes z from
+#define TS_Z1					0
+#define JOYSTICK			4
+
+#define MS(n)					((unsigned long long)(n) * (MCU_HZ / 1000))
+
+typedef struct {
+	char name[40];
+	bool interrupt;
+	unsigned long long calls;
+	unsigned long long cycles;		// with what it called
+	unsigned long long self;
+	unsigned long long most;
+} Count;
+
+typedef struct {
+	int count;
+	uint16_t sp;
+	unsigned long long start;
+	unsigned long long children;
+} Frame;
+
+typedef struct {
+	const char *name;
+	unsigned long long cycles;
+	unsigned long long idle;
+} Phase;
+
+Mcu mcu;
+McuSymbol *symbols;
+size_t symbolCount;
+Count counts[COUNTS];
+int countCount;
+int countAt[65536];									// function address to counts, -1 none yet
+Frame frames[FRAMES];
+int depth;
+unsigned long long spiBytes;
+unsigned long long spiData;
+uint16_t stateAt;
+uint16_t demoAt;
+uint32_t rng;
+
+uint32_t random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+/***************************************************************************************
+ * HOOKS
+ * 		A call or interrupt pushes a frame, the RET or RETI off the same stack pops it
+ * 		and its cycles go to the function. Frames left deeper than a return (a branch
+ * 		out of a function, not a return) go with it.
+ **************************************************************************************/
+void spi(Mcu *m, unsigned char byte, bool data) {
+	(void)m;
+	(void)byte;
+	spiBytes++;
+	spiData += data;
+}
+
+void enter(Mcu *m, uint16_t to, uint16_t sp, bool interrupt) {
+	size_t i;
+	int c;
+
+	if ((c = countAt[to]) < 0) {
+		if (countCount == COUNTS)
+			return;
+		c = countAt[to] = countCount++;
+		snprintf(counts[c].name, sizeof counts[c].name, "0x%04x", to);
+		for (i = 0; i < symbolCount; i++)
+			if (symbols[i].function && symbols[i].address == to)
+				snprintf(counts[c].name, sizeof counts[c].name, "%s", symbols[i].name);
+		counts[c].interrupt = interrupt;
+	}
+	if (depth == FRAMES)
+		return;
+	frames[depth].count = c;
+	frames[depth].sp = sp;
+	frames[depth].start = m->at;
+	frames[depth].children = 0;
+	depth++;
+}
+
+void leave(Mcu *m, uint16_t sp) {
+	unsigned long long cycles;
+	Frame *f;
+	Count *c;
+
+	while (depth > 0 && frames[depth - 1].sp <= sp) {
+		f = &frames[--depth];
+		c = &counts[f->count];
+		cycles = m->cycles - f->start;
+		c->calls++;
+		c->cycles += cycles;
+		c->self += cycles - f->children;
+		c->most = cycles > c->most ? cycles : c->most;
+		if (depth > 0)
+			frames[depth - 1].children += cycles;
+		if (f->sp == sp)
+			break;
+	}
+}
+
+/***************************************************************************************
+ * RUN
+ * 		The unit until done says so or limit, with the buttons and joystick that play
+ * 		says. Counts into phase.
+ **************************************************************************************/
+typedef bool (*Until)(void);
+
+bool asleep(void) {
+	return mcu.r[MCU_SR] & MCU_CPUOFF;
+}
+
+bool demoStarted(void) {
+	return mcu.mem[stateAt] == STATE_PLAYING && mcu.mem[demoAt];
+}
+
+bool gameStarted(void) {
+	return mcu.mem[stateAt] == STATE_PLAYING && !mcu.mem[demoAt];
+}
+
+bool gameOver(void) {
+	return mcu.mem[stateAt] != STATE_PLAYING && mcu.mem[stateAt] != STATE_LINE_CLEAR;
+}
+
+void run(Phase *phase, Until done, unsigned long long limit, bool play) {
+	unsigned long long start = mcu.cycles;
+	unsigned long long idle = mcu.idle;
+	unsigned long long next = mcu.cycles + MS(100);
+	unsigned long long release = 0;
+	unsigned long long center = 0;
+	int port = 0;
+	int pin = 0;
+
+	while (!mcu.fault && mcu.cycles - start < limit && !done()) {
+		if (play && release && mcu.cycles >= release) {
+			mcuPin(&mcu, port, pin, false);
+			release = 0;
+		}
+		if (play && center && mcu.cycles >= center) {
+			mcu.adc[JOYSTICK] = JOYSTICK_IDLE;
+			center = 0;
+		}
+		if (play && mcu.cycles >= next) {
+			switch (random32() % 8) {
+			case 0:
+			case 1:
+			case 2:
+				port = 2;
+				pin = BTN_LFT;
+				break;
+			case 3:
+			case 4:
+			case 5:
+				port = 2;
+				pin = BTN_RGHT;
+				break;
+			case 6:
+				port = 1;
+				pin = BTN_ROT;
+				break;
+			default:
+				mcu.adc[JOYSTICK] = random32() % 455;
+				center = mcu.cycles + MS(200 + random32() % 600);
+				pin = 0;
+				break;
+			}
+			if (pin) {
+				mcuPin(&mcu, port, pin, true);
+				release = mcu.cycles + MS(PRESS_MS);
+			}
+			next = mcu.cycles + MS(60 + random32() % 300);
+		}
+		mcuRun(&mcu, mcu.cycles + SLICE);
+	}
+	if (release)
+		mcuPin(&mcu, port, pin, false);
+	mcu.adc[JOYSTICK] = JOYSTICK_IDLE;
+	phase->cycles = mcu.cycles - start;
+	phase->idle = mcu.idle - idle;
+}
+
+// touch the screen until the firmware's seen it
+void tap(Phase *phase, Until done) {
+	mcu.adc[TS_Z0] = 0;
+	mcu.adc[TS_Z1] = 0;
+	run(phase, done, MS(TAP_MS) * 10, false);
+	mcu.adc[TS_Z0] = 1023;
+	mcu.adc[TS_Z1] = 0;
+}
+
+int bySelf(const void *a, const void *b) {
+	const Count *x = a;
+	const Count *y = b;
+
+	return (x->self < y->self) - (x->self > y->self);
+}
+
+Count *find(const char *name) {
+	int i;
+
+	for (i = 0; i < countCount; i++)
+		if (!strcmp(counts[i].name, name))
+			return &counts[i];
+	return NULL;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *path = "build/tetris.elf";
+	unsigned long long limit = MS(RUN_SECONDS * 1000ULL);
+	unsigned long long active = 0;
+	Phase phases[5] = {{"boot", 0, 0}, {"title", 0, 0}, {"demo", 0, 0}, {"tap", 0, 0},
+			{"game", 0, 0}};
+	Phase all = {"all", 0, 0};
+	Count *c;
+	size_t i;
+	int j;
+
+	rng = 1;
+	for (j = 1; j < argc; j++) {
+		if (!strcmp(argv[j], "-t") && j + 1 < argc)
+			limit = MS(strtoull(argv[++j], NULL, 0) * 1000);
+		else if (!strcmp(argv[j], "-s") && j + 1 < argc)
+			rng = strtoul(argv[++j], NULL, 0) * 2654435761u | 1;
+		else if (argv[j][0] != '-' && j + 1 == argc)
+			path = argv[j];
+		else
+			break;
+	}
+	if (j < argc || !limit) {
+		fprintf(stderr, "usage: %s [-t seconds] [-s seed] [elf]\n", argv[0]);
+		return 2;
+	}
+
+	if (mcuLoad(&mcu, path, &symbols, &symbolCount))
+		return 1;
+	for (i = 0; i < symbolCount; i++) {
+		if (!strcmp(symbols[i].name, "state"))
+			stateAt = symbols[i].address;
+		else if (!strcmp(symbols[i].name, "demo"))
+			demoAt = symbols[i].address;
+	}
+	if (!stateAt || !demoAt) {
+		fprintf(stderr, "%s: no state or demo, not main.c's firmware?\n", path);
+		return 1;
+	}
+	memset(countAt, -1, sizeof countAt);
+	mcu.spi = spi;
+	mcu.enter = enter;
+	mcu.leave = leave;
+	mcu.adc[TS_Z0] = 1023;
+	mcu.adc[JOYSTICK] = JOYSTICK_IDLE;
+
+	run(&phases[0], asleep, MS(10000), false);
+	run(&phases[1], demoStarted, MS(60000), false);
+	run(&phases[2], gameOver, limit, false);
+	tap(&phases[3], gameStarted);
+	run(&phases[4], gameOver, limit, true);
+	if (mcu.fault) {
+		fprintf(stderr, "%s: %s at 0x%04x, %llu cycles in\n", path, mcu.fault, mcu.faultPc,
+				mcu.cycles);
+		return 1;
+	}
+
+	printf("fwbench: %s, %lu MHz, %llu instructions, %llu interrupts, %llu SPI bytes\n",
+			path, MCU_HZ / 1000000, mcu.instructions, mcu.interrupts, spiBytes);
+	printf("  %-8s %9s %14s %14s %8s\n", "phase", "seconds", "active", "idle", "active");
+	for (j = 0; j <= 5; j++) {
+		Phase *p = j < 5 ? &phases[j] : &all;
+
+		if (j < 5) {
+			all.cycles += p->cycles;
+			all.idle += p->idle;
+		}
+		printf("  %-8s %9.2f %14llu %14llu %7.1f%%\n", p->name, (double)p->cycles / MCU_HZ,
+				p->cycles - p->idle, p->idle, p->cycles ? 100.0 * (p->cycles - p->idle) /
+				p->cycles : 0.0);
+	}
+	active = all.cycles - all.idle;
+
+	qsort(counts, countCount, sizeof *counts, bySelf);
+	printf("  %-24s %9s %10s %10s %7s\n", "function", "calls", "mean", "most", "self");
+	for (j = 0; j < countCount; j++) {
+		c = &counts[j];
+		if (!c->calls)
+			continue;
+		printf("  %-24s %9llu %10llu %10llu %6.2f%%\n", c->name, c->calls, c->cycles / c->calls,
+				c->most, active ? 100.0 * c->self / active : 0.0);
+	}
+
+	if ((c = find("step")) && c->calls)
+		printf("a step: %llu cycles (%.1f us), most %llu\n", c->cycles / c->calls,
+				c->cycles * 1e6 / c->calls / MCU_HZ, c->most);
+	if ((c = find("handleLineClear")) && c->calls >= 14)
+		printf("a line clear: %llu cycles over 14 ticks, %llu clears\n",
+				c->cycles / (c->calls / 14), c->calls / 14);
+	// the USCI interrupt comes once the byte's out, after writeLCDData's back
+	if ((c = find("writeLCDData")) && c->calls) {
+		Count *isr = find("USCI");
+
+		printf("an SPI byte: %llu cycles in writeLCDData, %llu in USCI\n", c->cycles / c->calls,
+				isr && isr->calls ? isr->cycles / isr->calls : 0);
+	}
+	return 0;
+}
@@ -0,0 +1,358 @@
+/***************************************************************************************
+ * LATENCY
+ * 		How long from a button press to the piece it moved being all the way across the
+ * 		SPI, on the unit's clocks. A press goes in through Port_1 / Port_2 whenever,
+ * 		waits in events for the next 10 ms tick, step() runs the game and show() paints
+ * 		the piece out and back in. The paint is most of it: every byte is a
+ * 		writeLCDData call and a USCI interrupt, so the CPU and not the SPI clock sets
+ * 		how fast bytes go, and a move is two paintPieces.
+ *
+ * 		build/latency [-s seed] [-n games] [-t ticks] [-b cycles] [-k kHz] [-e cycles]
+ * 				-s first seed, 1 if not given, and -n games from there, GAMES
+ * 				-t ticks a game at most, GAME_TICKS
+ * 				-b CPU cycles a byte, BYTE_CYCLES, and -k the SPI clock, SPI_HZ
+ * 				-e cycles a step takes besides its bytes, STEP_CYCLES
+ *
+ * 		Each game is the AI playing a seed, recorded, then played back through device.c
+ * 		onto an emulated panel with a clock. The timer posts a tick every TICK_CYCLES,
+ * 		a step starts when one's posted and the CPU is free, and it takes STEP_CYCLES
+ * 		plus its bytes. A step that runs past the next tick has the next one start
+ * 		straight after it and any more ticks it ran over are lost, the same as the
+ * 		one EV_TICK bit in events.
+ *
+ * 		A press the AI made for a step happened at a random time after the step before
+ * 		it read events. It's on the glass when the step that moved the piece for it
+ * 		has its last byte out of the shift register, which is a later step if the piece
+ * 		didn't have room yet. Presses the piece never moved for (it dropped or set
+ * 		first, or the same button was already waiting) are dropped. The AI doesn't
+ * 		press during a line clear, where handleLineClear would drop them too.
+ *
+ * 		Out comes p50/p99/max for each button and each level the press was made at,
+ * 		and a histogram of all of them. The panel's own refresh, up to a frame at
+ * 		~70 Hz, comes on top. The cycle counts are worked out from what msp430-gcc -Os
+ * 		makes of writeLCDData and USCI, not measured on a unit.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../engine.h"
+#include "../replay.h"
+#include "ai.h"
+#include "device.h"
+#include "lcd.h"
+
+#define MCLK_HZ			20000000UL	// initClk's DCO, MCLK and SMCLK both
+#define TICK_CYCLES	200000UL		// TICK_FAST at SMCLK/8, 10 ms
+#define SPI_HZ			20000000UL	// UCB0BR never set, SMCLK undivided
+#define SPI_BITS		8
+#define BYTE_CYCLES	62					// call 7, writeLCDData 21, USCI interrupt 31, loop 3
+#define STEP_CYCLES	2000				// timer interrupt, main loop, readJoystick, gameTick, show
+#define GAMES				8
+#define GAME_TICKS	30000				// five minutes of game time
+#define LEVELS			20					// 20 and up together, it's as fast as it gets
+#define BUCKET_MS		4						// histogram
+#define BUCKETS			20
+
+typedef struct {
+	uint32_t tick;							// step it went in with
+	uint32_t shown;							// step that moved the piece for it, 0 never
+	uint8_t button;							// 0 left, 1 right, 2 rotate
+	uint8_t level;
+} Press;
+
+typedef struct {
+	double *ms;
+	size_t count;
+	size_t room;
+	unsigned long dropped;
+} Samples;
+
+typedef struct {
+	unsigned char *data;
+	size_t length;
+	size_t room;
+} Memory;
+
+const unsigned char buttons[3] = {IN_LEFT, IN_RIGHT, IN_ROTATE};
+const char *buttonNames[3] = {"left", "right", "rotate"};
+
+Lcd panel;
+Press *presses;
+size_t pressCount;
+size_t pressRoom;
+Samples byButton[3];
+Samples byLevel[LEVELS + 1];
+Samples all;
+unsigned long long readAt[GAME_TICKS + 1];	// when the step for a game tick read events
+unsigned long long fromAt[GAME_TICKS + 1];	// and the step before it did
+unsigned long long doneAt[GAME_TICKS + 1];	// its last byte out
+unsigned long long cycles;					// all games, start to last step done
+unsigned long long busy;						// of those, running steps
+unsigned long steps;
+unsigned long overran;							// steps that ran past the next tick
+unsigned long lost;									// ticks that never got a step
+uint32_t rng;
+
+uint32_t random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+void putMemory(void *context, unsigned char byte) {
+	Memory *m = context;
+
+	if (m->length == m->room) {
+		m->room = m->room ? 2 * m->room : 4096;
+		m->data = realloc(m->data, m->room);
+	}
+	m->data[m->length++] = byte;
+}
+
+void sample(Samples *s, double ms) {
+	if (s->count == s->room) {
+		s->room = s->room ? 2 * s->room : 1024;
+		s->ms = realloc(s->ms, s->room * sizeof *s->ms);
+	}
+	s->ms[s->count++] = ms;
+}
+
+/***************************************************************************************
+ * PLAY
+ * 		The AI plays seed into m, with every button press it made and the step that
+ * 		moved the piece for it
+ **************************************************************************************/
+void play(unsigned int seed, unsigned long ticks, Memory *m) {
+	long pending[3] = {-1, -1, -1};
+	unsigned char ge = 0;
+	unsigned char in;
+	Recorder r;
+	Game was;
+	Game g;
+	Ai ai;
+	int b;
+
+	aiStart(&ai, NULL);
+	gameReset(&g, seed);
+	recordStart(&r, putMemory, m, seed);
+	pressCount = 0;
+	while (g.gameAlive && g.tick < ticks) {
+		in = aiInput(&ai, &g, ge);
+		recordTick(&r, &g, in);
+		was = g;
+		for (b = 0; b < 3; b++) {
+			if (!(in & buttons[b]))
+				continue;
+			if (pending[b] >= 0) {
+				byButton[b].dropped++;			// same key bit, one move for both
+				byLevel[g.level < LEVELS ? g.level : LEVELS].dropped++;
+				all.dropped++;
+				continue;
+			}
+			if (pressCount == pressRoom) {
+				pressRoom = pressRoom ? 2 * pressRoom : 1024;
+				presses = realloc(presses, pressRoom * sizeof *presses);
+			}
+			pending[b] = pressCount;
+			presses[pressCount].tick = g.tick + 1;
+			presses[pressCount].shown = 0;
+			presses[pressCount].button = b;
+			presses[pressCount].level = g.level < LEVELS ? g.level : LEVELS;
+			pressCount++;
+		}
+		ge = gameTick(&g, in);
+
+		// a key bit gone is the move made, or the drop or a lock threw it away
+		for (b = 0; b < 3; b++) {
+			if (pending[b] < 0 || (g.keys & buttons[b]))
+				continue;
+			if (!(ge & (GE_SPAWN | GE_LOCK)) && (b == 0 ? g.xPos + 1 == was.xPos :
+					b == 1 ? g.xPos == was.xPos + 1 : g.rotation != was.rotation))
+				presses[pending[b]].shown = g.tick;
+			pending[b] = -1;
+		}
+	}
+	recordEnd(&r, &g);
+}
+
+/***************************************************************************************
+ * PLAY BACK
+ * 		The recording in m played back on the unit's clocks, when each game tick's step
+ * 		read events and got its last byte out. The step before the first read at 0.
+ **************************************************************************************/
+int playBack(const Memory *m, unsigned long long stepCycles, unsigned long long byteCycles,
+		unsigned long long wireCycles) {
+	unsigned long long now = 0;
+	unsigned long long read = 0;
+	unsigned long long from;
+	unsigned long long next;
+	unsigned long long was;
+	unsigned long long sent;
+	uint32_t tick;
+	Device d;
+
+	lcdReset(&panel);
+	if (deviceStart(&d, m->data, m->length, true))
+		return 1;
+	while (!d.over || d.clearRow >= 0) {
+		// the tick after the last read, or straight away if it's come and gone
+		next = (read / TICK_CYCLES + 1) * TICK_CYCLES;
+		if (now > next) {
+			overran++;
+			lost += now / TICK_CYCLES - next / TICK_CYCLES;
+		}
+		from = read;
+		read = now > next ? now : next;
+
+		was = panel.counts.commands + panel.counts.data;
+		tick = d.g.tick;
+		if (deviceTick(&d, true))
+			return 1;
+		sent = panel.counts.commands + panel.counts.data - was;
+		now = read + stepCycles + sent * byteCycles;
+		busy += now - read;
+		steps++;
+		if (d.g.tick != tick && d.g.tick <= GAME_TICKS) {
+			readAt[d.g.tick] = read;
+			fromAt[d.g.tick] = from;
+			doneAt[d.g.tick] = now + (sent ? wireCycles : 0);
+		}
+	}
+	cycles += now;
+	return 0;
+}
+
+int byMs(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// p percent of the way up s, sorted
+#define MS_AT(s, p)	((s)->count ? (s)->ms[((s)->count - 1) * (p) / 100] : 0.0)
+
+void report(const char *name, Samples *s) {
+	qsort(s->ms, s->count, sizeof *s->ms, byMs);
+	printf("  %-10s %8zu %8.1f %8.1f %8.1f %8lu\n", name, s->count, MS_AT(s, 50), MS_AT(s, 99),
+			MS_AT(s, 100), s->dropped);
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned long long stepCycles = STEP_CYCLES;
+	unsigned long long byteCycles = BYTE_CYCLES;
+	unsigned long long wireCycles;
+	unsigned long spiHz = SPI_HZ;
+	unsigned long ticks = GAME_TICKS;
+	unsigned long most = 0;
+	unsigned long counts[BUCKETS];
+	unsigned int seed = 1;
+	unsigned int games = GAMES;
+	unsigned int n;
+	char name[16];
+	Memory m = {NULL, 0, 0};
+	double ms;
+	size_t i;
+	int j;
+
+	for (j = 1; j < argc; j++) {
+		if (!strcmp(argv[j], "-s") && j + 1 < argc)
+			seed = strtoul(argv[++j], NULL, 0);
+		else if (!strcmp(argv[j], "-n") && j + 1 < argc)
+			games = strtoul(argv[++j], NULL, 0);
+		else if (!strcmp(argv[j], "-t") && j + 1 < argc)
+			ticks = strtoul(argv[++j], NULL, 0);
+		else if (!strcmp(argv[j], "-b") && j + 1 < argc)
+			byteCycles = strtoull(argv[++j], NULL, 0);
+		else if (!strcmp(argv[j], "-k") && j + 1 < argc)
+			spiHz = strtoul(argv[++j], NULL, 0) * 1000;
+		else if (!strcmp(argv[j], "-e") && j + 1 < argc)
+			stepCycles = strtoull(argv[++j], NULL, 0);
+		else
+			break;
+	}
+	if (j < argc || !games || !spiHz || !ticks || ticks > GAME_TICKS) {
+		fprintf(stderr, "usage: %s [-s seed] [-n games] [-t ticks, %d at most] [-b cycles] "
+				"[-k kHz] [-e cycles]\n", argv[0], GAME_TICKS);
+		return 2;
+	}
+
+	// a byte can't go faster than the SPI shifts it, the last one still has to
+	wireCycles = (SPI_BITS * MCLK_HZ + spiHz - 1) / spiHz;
+	if (byteCycles < wireCycles)
+		byteCycles = wireCycles;
+
+	lcd = &panel;
+	rng = seed * 2654435761u | 1;
+	for (n = 0; n < games; n++) {
+		m.length = 0;
+		play(seed + n, ticks, &m);
+		if (playBack(&m, stepCycles, byteCycles, wireCycles)) {
+			fprintf(stderr, "latency: seed %u didn't play back\n", seed + n);
+			free(m.data);
+			return 1;
+		}
+		for (i = 0; i < pressCount; i++) {
+			Press *p = &presses[i];
+
+			if (!p->shown) {
+				byButton[p->button].dropped++;
+				byLevel[p->level].dropped++;
+				all.dropped++;
+				continue;
+			}
+			ms = (doneAt[p->shown] - fromAt[p->tick] -
+					(readAt[p->tick] - fromAt[p->tick]) * (random32() / 4294967296.0)) *
+					1000.0 / MCLK_HZ;
+			sample(&byButton[p->button], ms);
+			sample(&byLevel[p->level], ms);
+			sample(&all, ms);
+		}
+	}
+	free(m.data);
+
+	printf("latency: %u games from seed %u, press to the piece's last byte out\n", games, seed);
+	printf("  MCLK %lu MHz, SPI %lu kHz, %llu cycles a byte (%.2f us), %llu a step, "
+			"tick %.1f ms\n", MCLK_HZ / 1000000, spiHz / 1000, byteCycles,
+			byteCycles * 1e6 / MCLK_HZ, stepCycles, TICK_CYCLES * 1000.0 / MCLK_HZ);
+	printf("  %lu steps, %.1f%% ran past the next tick, %lu ticks lost, CPU busy %.1f%%\n",
+			steps, steps ? 100.0 * overran / steps : 0.0, lost,
+			cycles ? 100.0 * busy / cycles : 0.0);
+	printf("  %-10s %8s %8s %8s %8s %8s\n", "", "presses", "p50 ms", "p99 ms", "max ms",
+			"dropped");
+	for (j = 0; j < 3; j++)
+		report(buttonNames[j], &byButton[j]);
+	report("all", &all);
+	for (j = 1; j <= LEVELS; j++) {
+		if (!byLevel[j].count && !byLevel[j].dropped)
+			continue;
+		snprintf(name, sizeof name, "level %d%s", j, j == LEVELS ? "+" : "");
+		report(name, &byLevel[j]);
+	}
+
+	memset(counts, 0, sizeof counts);
+	for (i = 0; i < all.count; i++) {
+		j = all.ms[i] / BUCKET_MS;
+		counts[j < BUCKETS ? j : BUCKETS - 1]++;
+	}
+	for (j = 0; j < BUCKETS; j++)
+		most = counts[j] > most ? counts[j] : most;
+	printf("all presses:\n");
+	for (j = 0; j < BUCKETS; j++) {
+		if (!counts[j])
+			continue;
+		if (j < BUCKETS - 1)
+			printf("  %3d-%3d ms %8lu ", j * BUCKET_MS, (j + 1) * BUCKET_MS, counts[j]);
+		else
+			printf("  %3d+    ms %8lu ", j * BUCKET_MS, counts[j]);
+		for (n = 0; n < 50 * counts[j] / most; n++)
+			putchar('#');
+		putchar('\n');
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+/***************************************************************************************
+ * LCD
+ * 		Emulated ILI9341, see lcd.h
+ **************************************************************************************/
+#include <string.h>
+#include "lcd.h"
+#include "../draw.h"
+
+__thread Lcd *lcd;
+
+/***************************************************************************************
+ * LCD RESET
+ * 		Black screen, full window, no scrolling, counts at 0
+ **************************************************************************************/
+void lcdReset(Lcd *l) {
+	memset(l, 0, sizeof *l);
+	l->x1 = LCD_WIDTH - 1;
+	l->y1 = LCD_HEIGHT - 1;
+	l->madctl = LCD_MADCTL_UNIT;
+	l->colmod = LCD_COLMOD_UNIT;
+	l->lines = LCD_HEIGHT;
+}
+
+/***************************************************************************************
+ * LCD LINE
+ * 		Line y of the picture on the glass, the scroll area shifted by VSCRSADD
+ **************************************************************************************/
+const uint16_t *lcdLine(const Lcd *l, unsigned int y) {
+	if (y >= l->top && y < l->top + l->lines && l->scroll >= l->top)
+		y = l->top + (y - l->top + l->scroll - l->top) % l->lines;
+	return l->fb[y < LCD_HEIGHT ? y : LCD_HEIGHT - 1];
+}
+
+/***************************************************************************************
+ * PIXEL
+ * 		c at the window's next spot, then on a column, wrapping a row at a time and
+ * 		back to the start, same as the real one. MADCTL says where in memory that is.
+ **************************************************************************************/
+static void pixel(Lcd *l, uint16_t c) {
+	unsigned int column = l->madctl & LCD_MV ? l->y : l->x;
+	unsigned int row = l->madctl & LCD_MV ? l->x : l->y;
+
+	if (column < LCD_WIDTH && row < LCD_HEIGHT) {
+		if (!(l->madctl & LCD_MX))
+			column = LCD_WIDTH - 1 - column;	// the module's mirrored, MX puts it back
+		if (l->madctl & LCD_MY)
+			row = LCD_HEIGHT - 1 - row;
+		if (!(l->madctl & LCD_BGR))
+			c = (c & 0x07E0) | c >> 11 | c << 11;	// the panel's BGR, red and blue swap
+		l->counts.same += l->fb[row][column] == c;
+		l->fb[row][column] = c;
+	}
+	l->counts.pixels++;
+	if (++l->x > l->x1) {
+		l->x = l->x0;
+		if (++l->y > l->y1)
+			l->y = l->y0;
+	}
+}
+
+/***************************************************************************************
+ * WRITE LCD CONTROL / WRITE LCD DATA
+ * 		The controller's end of the SPI
+ **************************************************************************************/
+void writeLCDControl(char data) {
+	lcd->command = data;
+	lcd->count = 0;
+	lcd->counts.commands++;
+	if (lcd->command == LCD_RAMWR) {
+		lcd->x = lcd->x0;
+		lcd->y = lcd->y0;
+	} else if (lcd->command == LCD_RAMWRC) {
+		lcd->command = LCD_RAMWR;		// on from wherever the last write got to
+	}
+}
+
+void writeLCDData(char data) {
+	Lcd *l = lcd;
+	unsigned char d = data;
+	unsigned char *p = l->params;
+
+	l->counts.data++;
+	switch (l->command) {
+	case LCD_RAMWR:
+		if ((l->colmod & 0x07) == 0x06) {
+			// 18 bit, a byte each of 6 bit red, green and blue, top bits
+			if (l->count < 2) {
+				p[l->count++] = d;
+				break;
+			}
+			l->count = 0;
+			pixel(l, (p[0] >> 3) << 11 | (p[1] >> 2) << 5 | d >> 3);
+		} else {
+			if (!l->count) {
+				p[l->count++] = d;
+				break;
+			}
+			l->count = 0;
+			pixel(l, p[0] << 8 | d);
+		}
+		break;
+	case LCD_CASET:
+	case LCD_PASET:
+		if (l->count < 3) {
+			p[l->count++] = d;
+			break;
+		}
+		if (l->command == LCD_CASET) {
+			l->x0 = p[0] << 8 | p[1];
+			l->x1 = p[2] << 8 | d;
+		} else {
+			l->y0 = p[0] << 8 | p[1];
+			l->y1 = p[2] << 8 | d;
+		}
+		l->count++;
+		break;
+	case LCD_MADCTL:
+		if (l->count++ == 0)
+			l->madctl = d;
+		break;
+	case LCD_COLMOD:
+		if (l->count++ == 0)
+			l->colmod = d;
+		break;
+	case LCD_VSCRDEF:
+		if (l->count < 5) {
+			p[l->count++] = d;
+			break;
+		}
+		if (l->count++ == 5 && (p[0] << 8 | p[1]) + (p[2] << 8 | p[3]) + (p[4] << 8 | d) ==
+				LCD_HEIGHT) {
+			l->top = p[0] << 8 | p[1];
+			l->lines = p[2] << 8 | p[3];
+		}
+		break;
+	case LCD_VSCRSADD:
+		if (l->count < 1) {
+			p[l->count++] = d;
+			break;
+		}
+		if (l->count++ == 1)
+			l->scroll = p[0] << 8 | d;
+		break;
+	}
+}
@@ -0,0 +1,85 @@
+/***************************************************************************************
+ * LCD
+ * 		Stand-in ILI9341 for the host tools. draw.c's writeLCDControl / writeLCDData
+ * 		land here instead of on SPI and build up the same 240x320 picture the glass
+ * 		would show, from the commands the firmware uses:
+ * 			CASET PASET		column / page window
+ * 			RAMWR 0x3C		memory write from the window's start / from where it got to
+ * 			MADCTL				row / column order and exchange, RGB or BGR
+ * 			COLMOD				16 bit (2 bytes a pixel) or 18 bit (3 bytes a pixel)
+ * 			VSCRDEF VSCRSADD	vertical scroll area and where it starts
+ * 		Other commands are taken and ignored.
+ *
+ * 		fb is the panel's memory the way the glass shows it unscrolled: the module
+ * 		is mounted mirrored, so main.c's MADCTL 0x48 (column order flipped, BGR) comes
+ * 		out the right way round and any other setting moves things the way it would
+ * 		on the unit. lcdLine gives a line of the picture with scrolling.
+ *
+ * 		Every byte is counted, commands and data apart, and pixels written, so a tool
+ * 		can take the counts before and after a draw and know what it cost on the SPI.
+ * 		lcdReset starts with the panel set up as main.c leaves it, host tools don't
+ * 		run the init sequence.
+ *
+ * 		Each thread draws into whichever Lcd lcd points at, so several can render at
+ * 		once.
+ **************************************************************************************/
+#ifndef LCD_H
+#define LCD_H
+
+#include <stdint.h>
+
+#define LCD_WIDTH		240
+#define LCD_HEIGHT	320
+
+// Commands
+#define LCD_CASET			0x2A
+#define LCD_PASET			0x2B
+#define LCD_RAMWR			0x2C
+#define LCD_VSCRDEF		0x33
+#define LCD_MADCTL		0x36
+#define LCD_VSCRSADD	0x37
+#define LCD_COLMOD		0x3A
+#define LCD_RAMWRC		0x3C
+
+// MADCTL bits
+#define LCD_MY				0x80		// rows bottom up
+#define LCD_MX				0x40		// columns right to left
+#define LCD_MV				0x20		// rows and columns swapped
+#define LCD_BGR				0x08
+
+#define LCD_MADCTL_UNIT	0x48		// main.c's
+#define LCD_COLMOD_UNIT	0x55		// 16 bit
+
+// SPI bytes and what they did, from lcdReset on
+typedef struct {
+	unsigned long long commands;	// bytes with D/C low
+	unsigned long long data;			// and high
+	unsigned long long pixels;		// written into the window
+	unsigned long long same;			// of those, the color that was already there
+} LcdCount;
+
+typedef struct {
+	uint16_t fb[LCD_HEIGHT][LCD_WIDTH];	// RGB565, as the glass shows it unscrolled
+	unsigned char command;			// last command byte
+	unsigned int count;					// data bytes since it
+	unsigned char params[6];
+	unsigned int x0;						// window from CASET / PASET
+	unsigned int x1;
+	unsigned int y0;
+	unsigned int y1;
+	unsigned int x;							// where the next pixel goes
+	unsigned int y;
+	unsigned char madctl;
+	unsigned char colmod;
+	unsigned int top;						// VSCRDEF fixed lines above the scroll area
+	unsigned int lines;					// and in it
+	unsigned int scroll;				// VSCRSADD, memory line at the top of the area
+	LcdCount counts;
+} Lcd;
+
+extern __thread Lcd *lcd;			// where this thread's drawing goes
+
+void lcdReset(Lcd *);
+const uint16_t *lcdLine(const Lcd *, unsigned int);
+
+#endif
@@ -0,0 +1,376 @@
+/***************************************************************************************
+ * LCD CHECK
+ * 		What the firmware's drawing puts on the SPI and on the glass, checked against
+ * 		a baseline so a change that draws something different, or the same thing with
+ * 		more bytes, shows up before it gets to a unit.
+ *
+ * 		build/lcdcheck [-u] [-o dir] [-c dir] [baseline]
+ * 				baseline is host/lcd.golden if not given, -u writes it from this build
+ * 				-o writes every picture as dir/name.ppm, -c compares every picture
+ * 				with dir/name.ppm from another build and says where they differ
+ *
+ * 		Each of drawcalls.c's draws, one call of every draw.c primitive, runs once on
+ * 		a blank panel with the bytes it took and the picture it left. Then a seeded
+ * 		AI game runs through device.c the way the unit draws it, a frame a tick, for
+ * 		the bytes a frame (p50, p99, most) and a picture every GAME_EVERY ticks.
+ *
+ * 		The baseline is one value a line. A .picture is a hash of the picture and has
+ * 		to be the same. Anything else is bytes and can't go up, going down is fine
+ * 		and -u takes the new numbers.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../engine.h"
+#include "../replay.h"
+#include "../draw.h"
+#include "ai.h"
+#include "device.h"
+#include "drawcalls.h"
+#include "lcd.h"
+
+#define GAME_SEED			7
+#define GAME_TICKS		20000			// at most
+#define GAME_EVERY		2000			// ticks between pictures
+#define MAX_VALUES		256
+
+typedef struct {
+	char name[48];
+	unsigned long long value;
+	bool picture;
+} Value;
+
+Lcd panel;
+Value values[MAX_VALUES];
+unsigned int valueCount;
+const char *outDir;
+const char *compareDir;
+unsigned int pictureDiffs;					// pictures -c found different
+
+/***************************************************************************************
+ * PICTURE HASH
+ * 		FNV-1a of the picture on the glass, a line at a time
+ **************************************************************************************/
+uint32_t pictureHash(const Lcd *l) {
+	const uint16_t *p;
+	uint32_t h = 2166136261u;
+	int x;
+	int y;
+
+	for (y = 0; y < LCD_HEIGHT; y++)
+		for (p = lcdLine(l, y), x = 0; x < LCD_WIDTH; x++) {
+			h = (h ^ (p[x] & 0xFF)) * 16777619u;
+			h = (h ^ (p[x] >> 8)) * 16777619u;
+		}
+	return h;
+}
+
+void add(const char *name, const char *what, unsigned long long value, bool picture) {
+	if (valueCount == MAX_VALUES)
+		return;
+	snprintf(values[valueCount].name, sizeof values[valueCount].name, "%s.%s", name, what);
+	values[valueCount].value = value;
+	values[valueCount].picture = picture;
+	valueCount++;
+}
+
+/***************************************************************************************
+ * PICTURE
+ * 		The picture as name: its hash, and out to -o / against -c
+ **************************************************************************************/
+void picture(const char *name) {
+	static unsigned char ppm[LCD_WIDTH * LCD_HEIGHT * 3];
+	char path[4096];
+	const uint16_t *p;
+	unsigned char *q;
+	unsigned int differ = 0;
+	int left = LCD_WIDTH;
+	int right = -1;
+	int top = LCD_HEIGHT;
+	int bottom = -1;
+	FILE *f;
+	int x;
+	int y;
+
+	add(name, "picture", pictureHash(&panel), true);
+	for (q = ppm, y = 0; y < LCD_HEIGHT; y++)
+		for (p = lcdLine(&panel, y), x = 0; x < LCD_WIDTH; x++) {
+			*q++ = (p[x] >> 11) << 3 | p[x] >> 13;
+			*q++ = (p[x] >> 5 & 0x3F) << 2 | (p[x] >> 9 & 3);
+			*q++ = (p[x] & 0x1F) << 3 | (p[x] >> 2 & 7);
+		}
+
+	if (outDir) {
+		snprintf(path, sizeof path, "%s/%s.ppm", outDir, name);
+		if ((f = fopen(path, "wb"))) {
+			fprintf(f, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+			fwrite(ppm, sizeof ppm, 1, f);
+			fclose(f);
+		} else {
+			perror(path);
+		}
+	}
+
+	if (compareDir) {
+		static unsigned char other[sizeof ppm];
+		int w;
+		int h;
+
+		snprintf(path, sizeof path, "%s/%s.ppm", compareDir, name);
+		if (!(f = fopen(path, "rb")) || fscanf(f, "P6 %d %d 255", &w, &h) != 2 ||
+				fgetc(f) == EOF || w != LCD_WIDTH || h != LCD_HEIGHT ||
+				fread(other, sizeof other, 1, f) != 1) {
+			printf("  %-24s no picture to compare with in %s\n", name, compareDir);
+			pictureDiffs++;
+			if (f)
+				fclose(f);
+			return;
+		}
+		fclose(f);
+		for (y = 0; y < LCD_HEIGHT; y++)
+			for (x = 0; x < LCD_WIDTH; x++)
+				if (memcmp(ppm + 3 * (y * LCD_WIDTH + x), other + 3 * (y * LCD_WIDTH + x), 3)) {
+					differ++;
+					left = x < left ? x : left;
+					right = x > right ? x : right;
+					top = y < top ? y : top;
+					bottom = y > bottom ? y : bottom;
+				}
+		if (differ) {
+			printf("  %-24s %u pixels differ, x %d-%d y %d-%d\n", name, differ, left, right,
+					top, bottom);
+			pictureDiffs++;
+		}
+	}
+}
+
+/***************************************************************************************
+ * PRIMITIVES
+ * 		What each of drawcalls.c's draws took, from a blank panel
+ **************************************************************************************/
+void primitives(void) {
+	const DrawCall *c;
+
+	printf("%-26s %6s %8s %8s\n", "draw call", "cmd", "data", "pixels");
+	for (c = drawCalls; c < drawCalls + drawCallCount; c++) {
+		lcdReset(&panel);
+		c->draw();
+		add(c->name, "commands", panel.counts.commands, false);
+		add(c->name, "data", panel.counts.data, false);
+		printf("  %-24s %6llu %8llu %8llu\n", c->name, panel.counts.commands,
+				panel.counts.data, panel.counts.pixels);
+		picture(c->name);
+	}
+}
+
+/***************************************************************************************
+ * PUT MEMORY
+ * 		Recorder sink into a growing buffer
+ **************************************************************************************/
+typedef struct {
+	unsigned char *data;
+	size_t length;
+	size_t room;
+} Memory;
+
+void putMemory(void *context, unsigned char byte) {
+	Memory *m = context;
+
+	if (m->length == m->room) {
+		m->room = m->room ? 2 * m->room : 4096;
+		m->data = realloc(m->data, m->room);
+	}
+	m->data[m->length++] = byte;
+}
+
+// p percent of the way up the frames that sent anything, sorted
+#define FRAME_AT(p)	(sent ? frames[count - sent + (sent - 1) * (p) / 100] : 0)
+
+int byBytes(const void *a, const void *b) {
+	unsigned long x = *(const unsigned long *)a;
+	unsigned long y = *(const unsigned long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/***************************************************************************************
+ * GAME
+ * 		A seeded AI game as the unit draws it, bytes a frame and pictures along the way
+ **************************************************************************************/
+int game(void) {
+	static unsigned long frames[GAME_TICKS * 2];
+	unsigned long long was;
+	unsigned long count = 0;
+	unsigned long sent = 0;
+	unsigned char ge = 0;
+	unsigned char in;
+	Memory m = {NULL, 0, 0};
+	char name[32];
+	Recorder r;
+	Device d;
+	Game g;
+	Ai ai;
+
+	aiStart(&ai, NULL);
+	gameReset(&g, GAME_SEED);
+	recordStart(&r, putMemory, &m, GAME_SEED);
+	while (g.gameAlive && g.tick < GAME_TICKS) {
+		in = aiInput(&ai, &g, ge);
+		recordTick(&r, &g, in);
+		ge = gameTick(&g, in);
+	}
+	recordEnd(&r, &g);
+
+	lcdReset(&panel);
+	if (!m.data || deviceStart(&d, m.data, m.length, true)) {
+		fprintf(stderr, "lcdcheck: the game didn't record\n");
+		free(m.data);
+		return 1;
+	}
+	add("start", "commands", panel.counts.commands, false);
+	add("start", "data", panel.counts.data, false);
+	picture("start");
+	while ((!d.over || d.clearRow >= 0) && count < sizeof frames / sizeof *frames) {
+		was = panel.counts.commands + panel.counts.data;
+		if (deviceTick(&d, true)) {
+			fprintf(stderr, "lcdcheck: the game didn't play back\n");
+			free(m.data);
+			return 1;
+		}
+		if ((frames[count] = panel.counts.commands + panel.counts.data - was))
+			sent++;
+		count++;
+		if (d.tick % GAME_EVERY == 0) {
+			snprintf(name, sizeof name, "game-%lu", d.tick);
+			picture(name);
+		}
+	}
+	picture("game-end");
+	free(m.data);
+
+	add("game", "commands", panel.counts.commands, false);
+	add("game", "data", panel.counts.data, false);
+	qsort(frames, count, sizeof *frames, byBytes);
+	printf("game: seed %d, %lu ticks, %u lines, %lu frames sent anything\n", GAME_SEED, count,
+			d.g.totalLines, sent);
+	printf("  %llu command and %llu data bytes, %.1f a frame sent, p50 %lu p99 %lu most %lu\n",
+			panel.counts.commands, panel.counts.data,
+			sent ? (double)(panel.counts.commands + panel.counts.data) / sent : 0.0,
+			FRAME_AT(50), FRAME_AT(99), FRAME_AT(100));
+	printf("  %llu pixels written, %.1f%% of them the color already there\n",
+			panel.counts.pixels, panel.counts.pixels ? 100.0 * panel.counts.same /
+			panel.counts.pixels : 0.0);
+	add("game", "frame-p50", FRAME_AT(50), false);
+	add("game", "frame-p99", FRAME_AT(99), false);
+	add("game", "frame-most", FRAME_AT(100), false);
+	return 0;
+}
+
+/***************************************************************************************
+ * CHECK
+ * 		This build's values against baseline at path. The number that failed.
+ **************************************************************************************/
+int check(const char *path) {
+	FILE *f = fopen(path, "r");
+	char line[256];
+	char name[64];
+	unsigned long long want;
+	unsigned int failed = 0;
+	unsigned int seen = 0;
+	unsigned int i;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof line, f)) {
+		if (line[0] == '#' || sscanf(line, "%63s %llx", name, &want) != 2)
+			continue;
+		for (i = 0; i < valueCount && strcmp(values[i].name, name); i++);
+		if (i == valueCount) {
+			printf("  %-28s gone\n", name);
+			failed++;
+			continue;
+		}
+		seen++;
+		if (values[i].picture && values[i].value != want) {
+			printf("  %-28s different picture\n", name);
+			failed++;
+		} else if (!values[i].picture && values[i].value > want) {
+			printf("  %-28s %llu bytes, was %llu\n", name, values[i].value, want);
+			failed++;
+		} else if (!values[i].picture && values[i].value < want) {
+			printf("  %-28s %llu bytes, down from %llu, -u to keep\n", name, values[i].value, want);
+		}
+	}
+	fclose(f);
+	if (seen < valueCount)
+		printf("  %u values not in the baseline, -u to add them\n", valueCount - seen);
+	return failed;
+}
+
+/***************************************************************************************
+ * WRITE BASELINE
+ **************************************************************************************/
+int writeBaseline(const char *path) {
+	FILE *f = fopen(path, "w");
+	unsigned int i;
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	fprintf(f, "# build/lcdcheck baseline, build/lcdcheck -u writes it. All hex: .picture is\n");
+	fprintf(f, "# a hash of the picture, everything else SPI bytes.\n");
+	for (i = 0; i < valueCount; i++)
+		fprintf(f, "%s %llx\n", values[i].name, values[i].value);
+	if (fclose(f)) {
+		perror(path);
+		return 1;
+	}
+	printf("%s: %u values\n", path, valueCount);
+	return 0;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *path = "host/lcd.golden";
+	bool update = false;
+	int failed;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-u"))
+			update = true;
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			outDir = argv[++i];
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+			compareDir = argv[++i];
+		else if (argv[i][0] != '-' && i + 1 == argc)
+			path = argv[i];
+		else
+			break;
+	}
+	if (i < argc) {
+		fprintf(stderr, "usage: %s [-u] [-o dir] [-c dir] [baseline]\n", argv[0]);
+		return 2;
+	}
+
+	lcd = &panel;
+	primitives();
+	if (game())
+		return 1;
+	if (compareDir)
+		printf("%u pictures differ from %s\n", pictureDiffs, compareDir);
+	if (update)
+		return writeBaseline(path);
+
+	failed = check(path);
+	if (failed < 0)
+		return 1;
+	printf("%s: %s\n", path, failed ? "FAILED" : "ok");
+	return failed || pictureDiffs ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+/***************************************************************************************
+ * LINK PEER
+ * 		Stands in for the second unit in versus play so one board can be tried on its
+ * 		own. Opens a pty (or an existing serial port with -c), says HELLO, then plays
+ * 		a real game on the engine with random presses and joystick pulls, in lockstep
+ * 		with whatever answers, the same framing and the same LINK_DELAY rule the unit
+ * 		uses. It runs the other side's game from its inputs too, so garbage goes both
+ * 		ways exactly as it does between two units. Prints what went over the wire each
+ * 		way at the end.
+ *
+ * 		Like the unit it checks each SYNC's hash against its copy of their game and
+ * 		ends the match when they differ. Exits 1 if the match ended that way or a
+ * 		frame couldn't be sent.
+ *
+ * 		make host, then build/linkpeer
+ * 		./linkpeer [-c /dev/ttyUSB0] [-s seed] [-b baud] [-t seconds]
+ *
+ * 		Two of them talk to each other: start one, then a second with -c and the pty
+ * 		the first printed.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "../link.h"
+
+#define TICK_NS			10000000L	// 10 ms, same as the unit
+#define HELLO_TICKS	50
+#define WRITE_MS		1000			// longest a frame waits for room to go out
+
+int fd;
+Game me;														// our game
+Game them;													// theirs, as far as their inputs have come in
+Garbage toMe[GARBAGE_QUEUE];				// from their clears
+Garbage toThem[GARBAGE_QUEUE];			// from ours
+unsigned char theirStick;						// joystick zone in their last frame
+unsigned long stalls;								// ticks we had to wait for them
+unsigned long framesOut[4];
+unsigned long framesIn[4];
+unsigned long bytesOut;
+unsigned long bytesIn;
+int started;
+int theyQuit;
+const char *broke;									// why the match ended early, NULL if it didn't
+
+/***************************************************************************************
+ * LINK OUT
+ * 		Sends a whole frame. The port is non-blocking, so a short write or EAGAIN
+ * 		waits for POLLOUT and carries on from where it got to. A frame that still
+ * 		can't go after WRITE_MS breaks the match, the other side would be missing it.
+ **************************************************************************************/
+void linkOut(unsigned char kind, unsigned char payload, unsigned long t) {
+	unsigned char frame[LINK_FRAME];
+	struct pollfd p = {fd, POLLOUT, 0};
+	size_t done = 0;
+	ssize_t n;
+
+	linkEncode(frame, kind, payload, t);
+	while (done < LINK_FRAME) {
+		n = write(fd, frame + done, LINK_FRAME - done);
+		if (n > 0) {
+			done += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if ((n < 0 && errno != EAGAIN) || poll(&p, 1, WRITE_MS) <= 0) {
+			if (started && !broke)
+				broke = "couldn't send a frame";
+			return;
+		}
+	}
+	framesOut[kind]++;
+	bytesOut += LINK_FRAME;
+}
+
+/***************************************************************************************
+ * THEM TICK
+ * 		Runs their game one tick on an input they sent, their clears send garbage to us
+ **************************************************************************************/
+void themTick(unsigned char in) {
+	dueGarbage(toThem, &them, true);
+	if (gameTick(&them, in) & GE_CLEAR)
+		queueGarbage(toMe, them.tick + LINK_DELAY, &them);
+}
+
+/***************************************************************************************
+ * THEM ADVANCE
+ * 		Runs their game up to tick t with no presses
+ **************************************************************************************/
+void themAdvance(unsigned long t) {
+	while (them.gameAlive && them.tick < t)
+		themTick(theirStick << IN_STICK_SHIFT);
+}
+
+/***************************************************************************************
+ * RECEIVE
+ * 		Reads whatever is waiting and runs their game on as far as it says
+ **************************************************************************************/
+void receive(LinkDecoder *d, unsigned int seed) {
+	unsigned char buf[64];
+	LinkFrame f;
+	unsigned long t;
+	ssize_t n;
+	ssize_t i;
+
+	while ((n = read(fd, buf, sizeof buf)) > 0) {
+		bytesIn += n;
+		for (i = 0; i < n; i++) {
+			if (!linkDecode(d, buf[i], &f))
+				continue;
+			framesIn[f.kind]++;
+			if (f.kind == LINK_HELLO) {
+				if (!started) {
+					linkOut(LINK_HELLO, 0, seed);
+					gameReset(&me, seed);
+					gameReset(&them, f.tick);
+					started = 1;
+				}
+				continue;
+			}
+			if (!started)
+				continue;
+
+			t = linkUnwrap(them.tick, f.tick);
+			if (f.kind == LINK_INPUT) {
+				themAdvance(t - 1);
+				theirStick = (f.payload & IN_STICK) >> IN_STICK_SHIFT;
+				if (them.tick + 1 == t)
+					themTick(f.payload);
+			} else {
+				themAdvance(t);
+			}
+			if (f.kind == LINK_SYNC && them.tick == t &&
+					(gameHash(&them) & LINK_HASH_MASK) != f.payload && !broke)
+				broke = "their game and our copy of it differ";
+			if (f.kind == LINK_BYE)
+				theyQuit = 1;
+		}
+	}
+	if (n == 0 || (n < 0 && errno != EAGAIN))
+		theyQuit = 1;						// other end of the pty or port went away
+}
+
+/***************************************************************************************
+ * BAUD SPEED
+ * 		termios speed for baud, 0 if there isn't one here
+ **************************************************************************************/
+speed_t baudSpeed(unsigned long baud) {
+	switch (baud) {
+	case 9600:
+		return B9600;
+	case 19200:
+		return B19200;
+	case 38400:
+		return B38400;
+	case 57600:
+		return B57600;
+	case 115200:
+		return B115200;
+	}
+	return 0;
+}
+
+/***************************************************************************************
+ * OPEN PORT
+ * 		Raw 8N1 at baud on path, or a fresh pty when path is NULL
+ **************************************************************************************/
+int openPort(const char *path, speed_t speed) {
+	struct termios tio;
+	int f;
+
+	if (path) {
+		f = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	} else {
+		f = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if (f >= 0 && (grantpt(f) || unlockpt(f))) {
+			close(f);
+			f = -1;
+		}
+	}
+	if (f < 0)
+		return -1;
+
+	if (tcgetattr(f, &tio) == 0) {
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, speed);
+		cfsetospeed(&tio, speed);
+		tcsetattr(f, TCSANOW, &tio);
+	}
+	if (!path)
+		printf("linkpeer: %s\n", ptsname(f));
+	fflush(stdout);
+	return f;
+}
+
+/***************************************************************************************
+ * MAIN
+ * 		10 ms tick loop. Waits for a HELLO back, then plays until time is up or the
+ * 		other side says BYE.
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *path = NULL;
+	unsigned int seed = 1;
+	unsigned long baud = 38400;
+	unsigned long seconds = 60;
+	unsigned long lastSent = 0;
+	unsigned long idle = 0;
+	unsigned char stick = 0;
+	unsigned char lastStick = 0;
+	unsigned char in;
+	unsigned char ge;
+	LinkDecoder d = {0};
+	struct timespec next;
+	double elapsed;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:s:b:t:")) != -1) {
+		switch (opt) {
+		case 'c':
+			path = optarg;
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0) & LINK_TICK_MASK;
+			break;
+		case 'b':
+			baud = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c tty] [-s seed] [-b baud] [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (!baudSpeed(baud)) {
+		fprintf(stderr, "linkpeer: no %lu baud, 9600 19200 38400 57600 or 115200\n", baud);
+		return 2;
+	}
+	fd = openPort(path, baudSpeed(baud));
+	if (fd < 0) {
+		fprintf(stderr, "linkpeer: %s\n", strerror(errno));
+		return 1;
+	}
+	srand(seed);
+	gameReset(&me, seed);
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (!theyQuit && !broke && me.gameAlive && me.tick < seconds * 100) {
+		next.tv_nsec += TICK_NS;
+		if (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		receive(&d, seed);
+		if (!started) {
+			if (idle-- == 0) {
+				idle = HELLO_TICKS;
+				linkOut(LINK_HELLO, 0, seed);
+			}
+			continue;
+		}
+
+		// lockstep, same rule as the unit
+		if (them.tick + LINK_DELAY < me.tick + 1) {
+			stalls++;
+			continue;
+		}
+
+		// something like a person: a press every ~8 ticks, the stick now and then
+		in = 0;
+		if (rand() % 8 == 0)
+			in |= 1 << (rand() % 3);
+		if (rand() % 200 == 0)
+			stick = rand() % 4;
+
+		dueGarbage(toMe, &me, true);
+		ge = gameTick(&me, in | (stick << IN_STICK_SHIFT));
+		if (ge & GE_CLEAR)
+			queueGarbage(toThem, me.tick + LINK_DELAY, &me);
+		if (ge & GE_OVER)
+			break;
+
+		if (in || stick != lastStick) {
+			linkOut(LINK_INPUT, in | (stick << IN_STICK_SHIFT), me.tick);
+			lastStick = stick;
+			lastSent = me.tick;
+		} else if (me.tick - lastSent >= LINK_SYNC_TICKS) {
+			linkOut(LINK_SYNC, gameHash(&me) & LINK_HASH_MASK, me.tick);
+			lastSent = me.tick;
+		}
+	}
+	if (started && !theyQuit)
+		linkOut(LINK_BYE, 0, me.tick);
+
+	elapsed = me.tick / 100.0 + stalls / 100.0;
+	if (elapsed <= 0)
+		elapsed = 1;
+	printf("ticks %lu  stalls %lu  their tick %lu%s%s\n", (unsigned long)me.tick, stalls,
+			(unsigned long)them.tick, me.gameAlive ? "" : "  (we topped out)",
+			theyQuit ? "  (they said BYE)" : "");
+	if (broke)
+		printf("match broken: %s\n", broke);
+	printf("lines: ours %u theirs %u\n", me.totalLines, them.totalLines);
+	printf("out: %lu hello %lu input %lu sync %lu bye, %.1f bytes/s\n",
+			framesOut[LINK_HELLO], framesOut[LINK_INPUT], framesOut[LINK_SYNC], framesOut[LINK_BYE],
+			bytesOut / elapsed);
+	printf("in:  %lu hello %lu input %lu sync %lu bye, %.1f bytes/s\n",
+			framesIn[LINK_HELLO], framesIn[LINK_INPUT], framesIn[LINK_SYNC], framesIn[LINK_BYE],
+			bytesIn / elapsed);
+	printf("%.1f%% of %lu baud each way at most\n",
+			100.0 * (bytesOut > bytesIn ? bytesOut : bytesIn) / elapsed / (baud / 10.0), baud);
+	tcdrain(fd);										// the BYE goes out before the port closes
+	close(fd);
+	return broke != NULL;
+}
@@ -0,0 +1,711 @@
+/***************************************************************************************
+ * MSP430
+ * 		Simulated MSP430G2553, see msp430.h. Cycle counts are the MSP430x2xx family
+ * 		guide's tables (SLAU144, 3.4.4): format I by source and destination mode,
+ * 		format II by mode, 2 for a jump, 6 to take an interrupt and 5 for RETI.
+ **************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "msp430.h"
+
+// Peripheral registers
+#define IE2					0x0001
+#define IFG2				0x0003
+#define P1IN				0x0020
+#define P1IFG				0x0023
+#define P1IE				0x0025
+#define P2IN				0x0028
+#define P2OUT				0x0029
+#define P2IFG				0x002B
+#define P2IE				0x002D
+#define UCA0CTL1		0x0061
+#define UCA0BR0			0x0062
+#define UCA0BR1			0x0063
+#define UCA0MCTL		0x0064
+#define UCA0TXBUF		0x0067
+#define UCB0CTL1		0x0069
+#define UCB0BR0			0x006A
+#define UCB0BR1			0x006B
+#define UCB0TXBUF		0x006F
+#define ADC10CTL0		0x01B0
+#define ADC10CTL1		0x01B2
+#define ADC10MEM		0x01B4
+#define TA0CTL			0x0160
+#define TA0CCTL0		0x0162
+#define TA0R				0x0170
+#define TA0CCR0			0x0172
+
+// Bits
+#define UCA0TXIFG		0x02
+#define UCB0TXIFG		0x08
+#define UCSWRST			0x01
+#define LCD_DC			0x04				// P2.2
+#define ADC10SC			0x0001
+#define ENC					0x0002
+#define ADC10IFG		0x0004
+#define ADC10IE			0x0008
+#define ADC10ON			0x0010
+#define ADC10BUSY		0x0001
+#define TACLR				0x0004
+#define CCIFG				0x0001
+#define CCIE				0x0010
+
+// Vectors, highest priority first
+#define VECTOR_TIMER0_A0	0xFFF2
+#define VECTOR_USCIAB0TX	0xFFEC
+#define VECTOR_ADC10			0xFFEA
+#define VECTOR_PORT2			0xFFE6
+#define VECTOR_PORT1			0xFFE4
+#define VECTOR_RESET			0xFFFE
+
+#define FLASH				0xC000
+#define ADC10OSC		4						// MCLK cycles an ADC10OSC clock, ~5 MHz
+
+#define PEEK16(m, a)	((m)->mem[(a) & 0xFFFE] | (m)->mem[((a) & 0xFFFE) + 1] << 8)
+#define POKE16(m, a, v)	do { (m)->mem[(a) & 0xFFFE] = (v); \
+		(m)->mem[((a) & 0xFFFE) + 1] = (v) >> 8; } while (0)
+
+/***************************************************************************************
+ * PERIPHERALS
+ **************************************************************************************/
+// Timer_A0 from TA0CTL and TA0CCR0, restarted if it was stopped or cleared
+static void timer(Mcu *m, bool restart) {
+	unsigned int ctl = PEEK16(m, TA0CTL);
+	unsigned long long ccr = PEEK16(m, TA0CCR0);
+	unsigned long long hz = (ctl >> 8 & 3) == 1 ? VLO_HZ : MCU_HZ;
+	unsigned long long div = 1 << (ctl >> 6 & 3);
+
+	if ((ctl >> 4 & 3) != 1 || !ccr) {
+		m->taNext = 0;
+		return;
+	}
+	if (restart || !m->taNext)
+		m->taStart = m->cycles;
+	m->taPeriod = (ccr + 1) * div * MCU_HZ / hz;
+	m->taNext = m->taStart + ccr * div * MCU_HZ / hz;
+	while (m->taNext <= m->cycles && m->taNext > m->taStart)
+		m->taNext += m->taPeriod;
+}
+
+// byte into a shift register's TXBUF, out now if it's empty
+static void shiftOut(Mcu *m, McuShift *s, uint8_t ifg, unsigned long long bit,
+		unsigned long long bits, int byte, bool data) {
+	m->mem[IFG2] &= ~ifg;
+	if (s->done > m->cycles) {
+		s->next = byte;
+		s->data = data;
+		return;
+	}
+	s->done = m->cycles + bit * bits;
+	s->ready = m->cycles + bit;
+	if (s == &m->usciB && m->spi)
+		m->spi(m, byte, data);
+}
+
+// BRCLK cycles a bit, SMCLK
+static unsigned long long spiBit(Mcu *m) {
+	unsigned int br = m->mem[UCB0BR0] | m->mem[UCB0BR1] << 8;
+
+	return br ? br : 1;
+}
+
+static unsigned long long uartBit(Mcu *m) {
+	unsigned int br = m->mem[UCA0BR0] | m->mem[UCA0BR1] << 8;
+	unsigned int mctl = m->mem[UCA0MCTL];
+
+	br = mctl & 1 ? 16 * br + (mctl >> 4) : br;
+	return br ? br : 1;
+}
+
+// the peripherals brought up to now
+static void update(Mcu *m) {
+	McuShift *s;
+	int i;
+
+	if (m->taNext && m->cycles >= m->taNext) {
+		m->mem[TA0CCTL0] |= CCIFG;
+		while (m->taNext <= m->cycles)
+			m->taNext += m->taPeriod;
+	}
+	for (i = 0; i < 2; i++) {
+		s = i ? &m->usciA : &m->usciB;
+		if (s->next >= 0 && m->cycles >= s->done) {
+			int byte = s->next;
+
+			s->next = -1;
+			s->done = m->cycles;		// the one behind goes now
+			if (i)
+				shiftOut(m, s, UCA0TXIFG, uartBit(m), 10, byte, false);
+			else
+				shiftOut(m, s, UCB0TXIFG, spiBit(m), 8, byte, s->data);
+		}
+		if (s->ready && m->cycles >= s->ready) {
+			m->mem[IFG2] |= i ? UCA0TXIFG : UCB0TXIFG;
+			s->ready = 0;
+		}
+	}
+	if (m->adcDone && m->cycles >= m->adcDone) {
+		m->adcDone = 0;
+		POKE16(m, ADC10MEM, m->adc[PEEK16(m, ADC10CTL1) >> 12] & 0x3FF);
+		POKE16(m, ADC10CTL0, PEEK16(m, ADC10CTL0) | ADC10IFG);
+	}
+}
+
+// the next time a peripheral does something by itself, 0 never
+static unsigned long long nextEvent(Mcu *m) {
+	unsigned long long t[6] = {
+		m->taNext, m->usciB.ready, m->usciA.ready, m->adcDone,
+		m->usciB.next >= 0 ? m->usciB.done : 0, m->usciA.next >= 0 ? m->usciA.done : 0
+	};
+	unsigned long long next = 0;
+	int i;
+
+	for (i = 0; i < 6; i++)
+		if (t[i] && (!next || t[i] < next))
+			next = t[i];
+	return next;
+}
+
+static void ioRead(Mcu *m, uint16_t a) {
+	unsigned int ctl;
+	unsigned long long hz;
+	unsigned long long div;
+	unsigned long long ccr;
+
+	update(m);
+	if (a == TA0R) {
+		ctl = PEEK16(m, TA0CTL);
+		hz = (ctl >> 8 & 3) == 1 ? VLO_HZ : MCU_HZ;
+		div = 1 << (ctl >> 6 & 3);
+		ccr = PEEK16(m, TA0CCR0);
+		POKE16(m, TA0R, m->taNext ?
+				(m->cycles - m->taStart) * hz / (MCU_HZ * div) % (ccr + 1) : 0);
+	} else if (a == ADC10CTL1) {
+		POKE16(m, ADC10CTL1, (PEEK16(m, ADC10CTL1) & ~ADC10BUSY) | (m->adcDone != 0));
+	}
+}
+
+static void ioWrite(Mcu *m, uint16_t a, uint16_t was) {
+	unsigned int v = a < 0x100 ? m->mem[a] : PEEK16(m, a);
+	static const unsigned int sample[4] = {4, 8, 16, 64};
+
+	switch (a) {
+	case UCB0TXBUF:
+		shiftOut(m, &m->usciB, UCB0TXIFG, spiBit(m), 8, v, m->mem[P2OUT] & LCD_DC);
+		break;
+	case UCA0TXBUF:
+		shiftOut(m, &m->usciA, UCA0TXIFG, uartBit(m), 10, v, false);
+		break;
+	case UCB0CTL1:
+	case UCA0CTL1:
+		if (v & UCSWRST)						// TXBUF empty while held in reset
+			m->mem[IFG2] |= a == UCB0CTL1 ? UCB0TXIFG : UCA0TXIFG;
+		break;
+	case TA0CTL:
+		if (v & TACLR)
+			POKE16(m, TA0CTL, v & ~TACLR);
+		timer(m, (v & TACLR) || (was >> 4 & 3) != 1);
+		break;
+	case TA0CCR0:
+		timer(m, false);
+		break;
+	case ADC10CTL0:
+		if ((v & (ENC | ADC10SC | ADC10ON)) == (ENC | ADC10SC | ADC10ON) && !m->adcDone) {
+			m->adcDone = m->cycles + (sample[v >> 11 & 3] + 13) * ADC10OSC;
+			POKE16(m, ADC10CTL0, (v & ~ADC10SC & ~ADC10IFG));
+		}
+		break;
+	}
+}
+
+/***************************************************************************************
+ * MEMORY
+ * 		Word accesses ignore bit 0. Anything under 0x200 is a peripheral and gets
+ * 		brought up to date first, and told about writes.
+ **************************************************************************************/
+static uint16_t rd(Mcu *m, uint16_t a, bool byte) {
+	if (!byte)
+		a &= 0xFFFE;
+	if (a < 0x200)
+		ioRead(m, a);
+	return byte ? m->mem[a] : PEEK16(m, a);
+}
+
+static void wr(Mcu *m, uint16_t a, uint16_t v, bool byte) {
+	uint16_t was;
+
+	if (!byte)
+		a &= 0xFFFE;
+	if (a >= FLASH) {
+		m->fault = "write to flash";
+		return;
+	}
+	was = byte ? m->mem[a] : PEEK16(m, a);
+	if (byte)
+		m->mem[a] = v;
+	else
+		POKE16(m, a, v);
+	if (a < 0x200)
+		ioWrite(m, a, was);
+}
+
+uint16_t mcuPeek(Mcu *m, uint16_t a, bool byte) {
+	return byte ? m->mem[a] : PEEK16(m, a);
+}
+
+static uint16_t fetch(Mcu *m) {
+	uint16_t w = PEEK16(m, m->r[MCU_PC]);
+
+	m->r[MCU_PC] += 2;
+	return w;
+}
+
+/***************************************************************************************
+ * OPERANDS
+ * 		Where an operand is, a register or an address, and the mode class the cycle
+ * 		tables go by: 0 register or constant, 1 @Rn, 2 @Rn+ or #N, 3 indexed
+ **************************************************************************************/
+typedef struct {
+	int reg;										// -1 memory, -2 constant
+	uint16_t address;
+	uint16_t value;
+	int mode;
+} Operand;
+
+static Operand source(Mcu *m, int reg, int as, bool byte) {
+	Operand o = {-2, 0, 0, 0};
+	uint16_t at;
+
+	if (reg == 3) {									// CG2: 0 1 2 -1
+		o.value = as == 3 ? (byte ? 0xFF : 0xFFFF) : as;
+		return o;
+	}
+	if (reg == MCU_SR && as >= 2) {		// CG1: 4 8
+		o.value = as == 2 ? 4 : 8;
+		return o;
+	}
+	switch (as) {
+	case 0:
+		o.reg = reg;
+		o.value = byte ? m->r[reg] & 0xFF : m->r[reg];
+		return o;
+	case 1:
+		at = m->r[MCU_PC];
+		o.address = fetch(m) + (reg == MCU_SR ? 0 : reg == MCU_PC ? at : m->r[reg]);
+		o.mode = 3;
+		break;
+	case 2:
+		o.address = m->r[reg];
+		o.mode = 1;
+		break;
+	default:
+		o.mode = 2;
+		if (reg == MCU_PC) {
+			o.value = fetch(m);
+			o.value = byte ? o.value & 0xFF : o.value;
+			return o;
+		}
+		o.address = m->r[reg];
+		m->r[reg] += byte && reg != MCU_SP ? 1 : 2;
+		break;
+	}
+	o.reg = -1;
+	o.value = rd(m, o.address, byte);
+	return o;
+}
+
+static void put(Mcu *m, const Operand *o, uint16_t v, bool byte) {
+	if (o->reg == -1)
+		wr(m, o->address, v, byte);
+	else if (o->reg != 3 && o->reg >= 0)
+		m->r[o->reg] = byte ? v & 0xFF : v;
+}
+
+static void flags(Mcu *m, uint16_t result, bool byte, int c, int v) {
+	uint16_t msb = byte ? 0x80 : 0x8000;
+	uint16_t sr = m->r[MCU_SR] & ~(MCU_C | MCU_Z | MCU_N | MCU_V);
+
+	result &= byte ? 0xFF : 0xFFFF;
+	sr |= result & msb ? MCU_N : 0;
+	sr |= result ? 0 : MCU_Z;
+	sr |= c ? MCU_C : 0;
+	sr |= v ? MCU_V : 0;
+	m->r[MCU_SR] = sr;
+}
+
+/***************************************************************************************
+ * DOUBLE OPERAND
+ **************************************************************************************/
+static void formatI(Mcu *m, uint16_t op) {
+	static const int toRegister[4] = {1, 2, 2, 3};
+	static const int toPc[4] = {2, 2, 3, 3};
+	static const int toMemory[4] = {4, 5, 5, 6};
+	int code = op >> 12;
+	bool byte = op & 0x40;
+	uint16_t mask = byte ? 0xFF : 0xFFFF;
+	uint16_t msb = byte ? 0x80 : 0x8000;
+	Operand s = source(m, op >> 8 & 15, op >> 4 & 3, byte);
+	Operand d = {op & 15, 0, 0, 0};
+	uint32_t sum;
+	uint16_t x;
+	uint16_t r = 0;
+	uint16_t at;
+	bool ret = (op & 0xFFFF) == 0x4130;	// mov @SP+, PC
+	int i;
+
+	if (op & 0x80) {
+		at = m->r[MCU_PC];
+		d.reg = -1;
+		d.address = fetch(m) + ((op & 15) == MCU_SR ? 0 : (op & 15) == MCU_PC ? at :
+				m->r[op & 15]);
+		if (code != 0x4)
+			d.value = rd(m, d.address, byte);
+		m->cycles += toMemory[s.mode];
+	} else {
+		d.value = byte ? m->r[d.reg] & 0xFF : m->r[d.reg];
+		m->cycles += d.reg == MCU_PC ? toPc[s.mode] : toRegister[s.mode];
+	}
+
+	switch (code) {
+	case 0x4:										// MOV
+		put(m, &d, s.value, byte);
+		break;
+	case 0x5:										// ADD ADDC SUBC SUB CMP
+	case 0x6:
+	case 0x7:
+	case 0x8:
+	case 0x9:
+		x = code >= 0x7 ? ~s.value & mask : s.value;
+		sum = (uint32_t)d.value + x + (code == 0x5 ? 0 : code == 0x6 || code == 0x7 ?
+				m->r[MCU_SR] & MCU_C : 1);
+		r = sum & mask;
+		flags(m, r, byte, sum > mask, (d.value ^ r) & (x ^ r) & msb);
+		if (code != 0x9)
+			put(m, &d, r, byte);
+		break;
+	case 0xA:										// DADD
+		sum = m->r[MCU_SR] & MCU_C;
+		for (i = 0; i < (byte ? 8 : 16); i += 4) {
+			sum += (s.value >> i & 15) + (d.value >> i & 15);
+			r |= (sum > 9 ? sum - 10 : sum) << i;
+			sum = sum > 9;
+		}
+		flags(m, r, byte, sum, 0);
+		put(m, &d, r, byte);
+		break;
+	case 0xB:										// BIT
+	case 0xF:										// AND
+		r = s.value & d.value;
+		flags(m, r, byte, r != 0, 0);
+		if (code == 0xF)
+			put(m, &d, r, byte);
+		break;
+	case 0xC:										// BIC
+		put(m, &d, d.value & ~s.value, byte);
+		break;
+	case 0xD:										// BIS
+		put(m, &d, d.value | s.value, byte);
+		break;
+	case 0xE:										// XOR
+		r = s.value ^ d.value;
+		flags(m, r, byte, (r & mask) != 0, (s.value & msb) && (d.value & msb));
+		put(m, &d, r, byte);
+		break;
+	}
+	if (ret && m->leave)
+		m->leave(m, m->r[MCU_SP] - 2);
+}
+
+/***************************************************************************************
+ * SINGLE OPERAND
+ **************************************************************************************/
+static void formatII(Mcu *m, uint16_t op) {
+	static const int shift[4] = {1, 3, 3, 4};
+	static const int push[4] = {3, 4, 5, 5};
+	static const int call[4] = {4, 4, 5, 5};
+	int code = op >> 7 & 7;
+	int reg = op & 15;
+	int as = op >> 4 & 3;
+	bool byte = op & 0x40;
+	uint16_t msb = byte ? 0x80 : 0x8000;
+	uint16_t c = m->r[MCU_SR] & MCU_C;
+	uint16_t sp;
+	Operand o;
+	uint16_t r;
+
+	if (code == 6) {								// RETI
+		sp = m->r[MCU_SP];
+		m->r[MCU_SR] = rd(m, m->r[MCU_SP], false);
+		m->r[MCU_PC] = rd(m, m->r[MCU_SP] + 2, false);
+		m->r[MCU_SP] += 4;
+		m->cycles += 5;
+		if (m->leave)
+			m->leave(m, sp);
+		return;
+	}
+	if (code == 7) {
+		m->fault = "illegal instruction";
+		return;
+	}
+
+	o = source(m, reg, as, byte && code != 5);
+	switch (code) {
+	case 0:											// RRC
+		r = (o.value >> 1) | (c ? msb : 0);
+		flags(m, r, byte, o.value & 1, 0);
+		put(m, &o, r, byte);
+		m->cycles += shift[o.mode];
+		break;
+	case 1:											// SWPB
+		put(m, &o, o.value >> 8 | o.value << 8, false);
+		m->cycles += shift[o.mode];
+		break;
+	case 2:											// RRA
+		r = (o.value >> 1) | (o.value & msb);
+		flags(m, r, byte, o.value & 1, 0);
+		put(m, &o, r, byte);
+		m->cycles += shift[o.mode];
+		break;
+	case 3:											// SXT
+		r = (uint16_t)(int16_t)(int8_t)o.value;
+		flags(m, r, false, r != 0, 0);
+		put(m, &o, r, false);
+		m->cycles += shift[o.mode];
+		break;
+	case 4:											// PUSH
+		m->r[MCU_SP] -= 2;
+		wr(m, m->r[MCU_SP], o.value, byte);
+		m->cycles += reg == MCU_PC && as == 3 ? 4 : push[o.mode];
+		break;
+	case 5:											// CALL
+		m->r[MCU_SP] -= 2;
+		wr(m, m->r[MCU_SP], m->r[MCU_PC], false);
+		m->r[MCU_PC] = o.value;
+		m->cycles += call[o.mode];
+		if (m->enter)
+			m->enter(m, o.value, m->r[MCU_SP], false);
+		break;
+	}
+}
+
+/***************************************************************************************
+ * JUMP
+ * 		Whether a jump's condition holds: JNE JEQ JNC JC JN JGE JL JMP
+ **************************************************************************************/
+static bool jump(uint16_t sr, int condition) {
+	bool n = sr & MCU_N;
+	bool v = sr & MCU_V;
+
+	switch (condition) {
+	case 0:
+		return !(sr & MCU_Z);
+	case 1:
+		return sr & MCU_Z;
+	case 2:
+		return !(sr & MCU_C);
+	case 3:
+		return sr & MCU_C;
+	case 4:
+		return n;
+	case 5:
+		return n == v;
+	case 6:
+		return n != v;
+	}
+	return true;
+}
+
+/***************************************************************************************
+ * INTERRUPT
+ * 		Takes the highest one pending if GIE's set. PC and SR go on the stack and SR
+ * 		clears but for SCG0, which wakes the CPU. Timer_A0 CCR0's flag clears as it's
+ * 		taken, the rest the handler clears.
+ **************************************************************************************/
+static bool interrupt(Mcu *m) {
+	uint16_t vector = 0;
+
+	if (!(m->r[MCU_SR] & MCU_GIE))
+		return false;
+	if ((m->mem[TA0CCTL0] & (CCIE | CCIFG)) == (CCIE | CCIFG)) {
+		vector = VECTOR_TIMER0_A0;
+		m->mem[TA0CCTL0] &= ~CCIFG;
+	} else if (m->mem[IE2] & m->mem[IFG2] & (UCA0TXIFG | UCB0TXIFG)) {
+		vector = VECTOR_USCIAB0TX;
+	} else if ((PEEK16(m, ADC10CTL0) & (ADC10IE | ADC10IFG)) == (ADC10IE | ADC10IFG)) {
+		vector = VECTOR_ADC10;
+	} else if (m->mem[P2IE] & m->mem[P2IFG]) {
+		vector = VECTOR_PORT2;
+	} else if (m->mem[P1IE] & m->mem[P1IFG]) {
+		vector = VECTOR_PORT1;
+	} else {
+		return false;
+	}
+
+	m->at = m->cycles;
+	m->r[MCU_SP] -= 2;
+	wr(m, m->r[MCU_SP], m->r[MCU_PC], false);
+	m->r[MCU_SP] -= 2;
+	wr(m, m->r[MCU_SP], m->r[MCU_SR], false);
+	m->r[MCU_SR] &= MCU_SCG0;
+	m->r[MCU_PC] = PEEK16(m, vector);
+	m->cycles += 6;
+	m->interrupts++;
+	if (m->enter)
+		m->enter(m, m->r[MCU_PC], m->r[MCU_SP], true);
+	return true;
+}
+
+/***************************************************************************************
+ * MCU RESET / MCU PIN
+ **************************************************************************************/
+void mcuReset(Mcu *m) {
+	memset(m->r, 0, sizeof m->r);
+	memset(m->mem, 0, 0x200);
+	m->mem[IFG2] = UCA0TXIFG | UCB0TXIFG;
+	m->mem[UCA0CTL1] = UCSWRST;
+	m->mem[UCB0CTL1] = UCSWRST;
+	m->cycles = m->at = m->idle = 0;
+	m->instructions = m->interrupts = 0;
+	m->taNext = 0;
+	memset(&m->usciA, 0, sizeof m->usciA);
+	memset(&m->usciB, 0, sizeof m->usciB);
+	m->usciA.next = m->usciB.next = -1;
+	m->adcDone = 0;
+	m->fault = NULL;
+	m->r[MCU_PC] = PEEK16(m, VECTOR_RESET);
+}
+
+// pins on port 1 or 2 high or low, going high sets their IFG
+void mcuPin(Mcu *m, int port, uint8_t pins, bool high) {
+	uint16_t in = port == 1 ? P1IN : P2IN;
+	uint16_t ifg = port == 1 ? P1IFG : P2IFG;
+
+	if (high) {
+		m->mem[ifg] |= pins & ~m->mem[in];
+		m->mem[in] |= pins;
+	} else {
+		m->mem[in] &= ~pins;
+	}
+}
+
+/***************************************************************************************
+ * MCU RUN
+ * 		Instructions until cycles gets to until or something goes wrong. Asleep it goes
+ * 		straight to whatever happens next, or until.
+ **************************************************************************************/
+void mcuRun(Mcu *m, unsigned long long until) {
+	unsigned long long next;
+	uint16_t op;
+
+	while (m->cycles < until && !m->fault) {
+		update(m);
+		if (interrupt(m))
+			continue;
+		if (m->r[MCU_SR] & MCU_CPUOFF) {
+			next = nextEvent(m);
+			if (!(m->r[MCU_SR] & MCU_GIE)) {
+				m->fault = "asleep with interrupts off";
+				break;
+			}
+			next = next && next < until ? next : until;
+			if (next > m->cycles) {
+				m->idle += next - m->cycles;
+				m->cycles = next;
+			}
+			continue;
+		}
+
+		m->at = m->cycles;
+		m->faultPc = m->r[MCU_PC];
+		op = fetch(m);
+		m->instructions++;
+		if (op >= 0x4000) {
+			formatI(m, op);
+		} else if ((op & 0xE000) == 0x2000) {
+			if (jump(m->r[MCU_SR], op >> 10 & 7))
+				m->r[MCU_PC] += (int16_t)(op << 6) >> 5;
+			m->cycles += 2;
+		} else if ((op & 0xFC00) == 0x1000) {
+			formatII(m, op);
+		} else {
+			m->fault = "illegal instruction";
+		}
+	}
+}
+
+/***************************************************************************************
+ * MCU LOAD
+ * 		An msp430-gcc ELF into memory by its program headers' load addresses, and its
+ * 		symbols. Then reset.
+ **************************************************************************************/
+#define U16(p)	((p)[0] | (p)[1] << 8)
+#define U32(p)	((uint32_t)U16(p) | (uint32_t)U16((p) + 2) << 16)
+
+int mcuLoad(Mcu *m, const char *path, McuSymbol **symbols, size_t *count) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *elf = NULL;
+	unsigned char *h;
+	unsigned char *s;
+	const char *names;
+	uint32_t at;
+	uint32_t size;
+	long length;
+	int i;
+	int j;
+
+	*symbols = NULL;
+	*count = 0;
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	if (fseek(f, 0, SEEK_END) || (length = ftell(f)) < 52 || fseek(f, 0, SEEK_SET) ||
+			!(elf = malloc(length)) || fread(elf, length, 1, f) != 1 ||
+			memcmp(elf, "\177ELF\001\001", 6) || U16(elf + 18) != 105) {
+		fprintf(stderr, "%s: not an MSP430 ELF\n", path);
+		fclose(f);
+		free(elf);
+		return 1;
+	}
+	fclose(f);
+
+	memset(m->mem, 0xFF, sizeof m->mem);		// erased flash
+	memset(m->mem, 0, FLASH);
+	for (i = 0; i < U16(elf + 44); i++) {
+		h = elf + U32(elf + 28) + i * U16(elf + 42);
+		at = U32(h + 12);										// p_paddr
+		size = U32(h + 16);									// p_filesz
+		if (U32(h) != 1 || !size)
+			continue;
+		if (U32(h + 4) + size > (uint32_t)length || at + size > sizeof m->mem) {
+			fprintf(stderr, "%s: bad program header\n", path);
+			free(elf);
+			return 1;
+		}
+		memcpy(m->mem + at, elf + U32(h + 4), size);
+	}
+
+	for (i = 0; i < U16(elf + 48); i++) {
+		h = elf + U32(elf + 32) + i * U16(elf + 46);
+		if (U32(h + 4) != 2)								// SHT_SYMTAB
+			continue;
+		names = (const char *)elf + U32(elf + U32(elf + 32) + U32(h + 24) * U16(elf + 46) + 16);
+		*symbols = calloc(U32(h + 20) / 16, sizeof **symbols);
+		for (j = 0; *symbols && j < (int)(U32(h + 20) / 16); j++) {
+			s = elf + U32(h + 16) + j * 16;
+			if ((s[12] & 15) != 1 && (s[12] & 15) != 2)		// STT_OBJECT, STT_FUNC
+				continue;
+			snprintf((*symbols)[*count].name, sizeof (*symbols)[*count].name, "%s",
+					names + U32(s));
+			(*symbols)[*count].address = U32(s + 4);
+			(*symbols)[*count].size = U32(s + 8);
+			(*symbols)[*count].function = (s[12] & 15) == 2;
+			(*count)++;
+		}
+		break;
+	}
+	free(elf);
+	mcuReset(m);
+	return 0;
+}
@@ -0,0 +1,91 @@
+/***************************************************************************************
+ * MSP430
+ * 		An MSP430G2553 for the host, enough of one to run build/tetris.elf and count its
+ * 		cycles. The CPU takes the family guide's cycles for every instruction, addressing
+ * 		mode and interrupt, there's 16K of flash and 512 bytes of RAM, and the
+ * 		peripherals main.c uses are cut down to what it can see of them:
+ * 			Timer_A0		up mode off SMCLK or the VLO, CCR0 and its interrupt, TA0R
+ * 			USCI_B0			SPI master, 8 BRCLKs a byte, TXIFG and its interrupt. Each
+ * 									byte goes to spi as it starts out, data if P2.2 (D/C) was
+ * 									high when it was written
+ * 			USCI_A0			UART, TXIFG back a character time after a write, nothing in
+ * 			ADC10				a conversion is the sample time plus 13 ADC10OSC clocks, then
+ * 									ADC10MEM is adc[] for the channel
+ * 			P1 P2				mcuPin sets the inputs, a press sets the pin's IFG
+ * 		No clock system: MCLK and SMCLK are MCU_HZ whatever BCSCTL1 and DCOCTL say,
+ * 		ACLK is the VLO at VLO_HZ. Time is MCLK cycles, asleep or not.
+ *
+ * 		mcuRun runs to a cycle count, sleeping straight through to whatever wakes it
+ * 		next. enter hears every CALL and interrupt with where it went and the stack
+ * 		after, leave every RET and RETI with the stack they return from, so a tool
+ * 		can match them up and count what each function cost.
+ **************************************************************************************/
+#ifndef MSP430_H
+#define MSP430_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MCU_HZ			20000000UL	// initClk's DCO
+#define VLO_HZ			12000UL
+#define MCU_PC			0
+#define MCU_SP			1
+#define MCU_SR			2
+
+// SR
+#define MCU_C				0x0001
+#define MCU_Z				0x0002
+#define MCU_N				0x0004
+#define MCU_GIE			0x0008
+#define MCU_CPUOFF	0x0010
+#define MCU_SCG0		0x0040
+#define MCU_V				0x0100
+
+typedef struct Mcu Mcu;
+
+typedef struct {
+	char name[40];
+	uint16_t address;
+	uint16_t size;
+	bool function;
+} McuSymbol;
+
+// a shift register, SPI or UART
+typedef struct {
+	unsigned long long done;		// empty from then
+	unsigned long long ready;		// TXIFG goes up then, 0 it isn't waiting to
+	int next;										// byte in TXBUF behind the one going, -1 none
+	bool data;
+} McuShift;
+
+struct Mcu {
+	uint16_t r[16];
+	uint8_t mem[65536];					// peripherals at 0-0x1FF in here too
+	unsigned long long cycles;
+	unsigned long long at;			// when the instruction running now started
+	unsigned long long idle;		// cycles asleep
+	unsigned long long instructions;
+	unsigned long long interrupts;
+	unsigned long long taStart;	// TA0R last 0
+	unsigned long long taNext;	// next CCR0 match, 0 stopped
+	unsigned long long taPeriod;
+	McuShift usciB;						// SPI to the panel
+	McuShift usciA;						// UART to the other unit
+	unsigned long long adcDone;
+	uint16_t adc[16];						// what each channel reads
+	void (*spi)(Mcu *, unsigned char, bool);
+	void (*enter)(Mcu *, uint16_t, uint16_t, bool);	// to, SP, interrupt
+	void (*leave)(Mcu *, uint16_t);
+	void *context;
+	const char *fault;					// why it stopped, NULL running
+	uint16_t faultPc;
+};
+
+int mcuLoad(Mcu *, const char *, McuSymbol **, size_t *);
+void mcuReset(Mcu *);
+void mcuPin(Mcu *, int, uint8_t, bool);
+void mcuRun(Mcu *, unsigned long long);
+uint16_t mcuPeek(Mcu *, uint16_t, bool);
+
+#endif
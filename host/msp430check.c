@@ -0,0 +1,269 @@
+/***************************************************************************************
+ * MSP430 CHECK
+ * 		msp430.c one instruction at a time against hand-assembled vectors, so a change
+ * 		to the core that gets an opcode, a flag or the family guide's cycles wrong
+ * 		shows up here and not as fwbench numbers that quietly moved.
+ *
+ * 		build/msp430check
+ *
+ * 		Each vector puts its words at CODE, sets SR, R4, R5, the RAM word at RAM and
+ * 		the two words at STACK, runs one instruction (or takes one interrupt) and wants
+ * 		the cycles, PC, SP, SR, R4, R5, the RAM word and the two words at SP after.
+ **************************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "msp430.h"
+
+#define CODE			0xC000
+#define HANDLER		0xC100				// port 1's vector points here
+#define RAM				0x0200
+#define STACK			0x03FC
+#define P1IFG			0x0023
+#define P1IE			0x0025
+#define VECTOR_PORT1	0xFFE4
+#define VECTOR_RESET	0xFFFE
+
+typedef struct {
+	uint16_t sr;
+	uint16_t r4;
+	uint16_t r5;
+	uint16_t ram;
+	uint16_t stack[2];					// at SP and SP+2
+} Regs;
+
+typedef struct {
+	const char *name;
+	uint16_t code[3];
+	Regs in;
+	int cycles;
+	uint16_t pc;
+	uint16_t sp;
+	Regs out;
+	bool irq;										// port 1 pending, takes that instead
+} Vector;
+
+#define C		MCU_C
+#define Z		MCU_Z
+#define N		MCU_N
+#define V		MCU_V
+
+/***************************************************************************************
+ * VECTORS
+ * 		name, words, {SR R4 R5 RAM stack} before, cycles, PC SP after, {...} after
+ **************************************************************************************/
+static const Vector vectors[] = {
+	// format I, MOV by source and destination mode
+	{"mov r4, r5", {0x4405}, {C, 0x1234, 0, 0, {0}},
+			1, CODE + 2, STACK, {C, 0x1234, 0x1234, 0, {0}}, false},
+	{"mov @r4, r5", {0x4425}, {0, RAM, 0, 0xBEEF, {0}},
+			2, CODE + 2, STACK, {0, RAM, 0xBEEF, 0xBEEF, {0}}, false},
+	{"mov @r4+, r5", {0x4435}, {0, RAM, 0, 0xBEEF, {0}},
+			2, CODE + 2, STACK, {0, RAM + 2, 0xBEEF, 0xBEEF, {0}}, false},
+	{"mov #0x1234, r5", {0x4035, 0x1234}, {0, 0, 0, 0, {0}},
+			2, CODE + 4, STACK, {0, 0, 0x1234, 0, {0}}, false},
+	{"mov 2(r4), r5", {0x4415, 0x0002}, {0, RAM - 2, 0, 0xBEEF, {0}},
+			3, CODE + 4, STACK, {0, RAM - 2, 0xBEEF, 0xBEEF, {0}}, false},
+	{"mov &RAM, r5", {0x4215, RAM}, {0, 0, 0, 0xBEEF, {0}},
+			3, CODE + 4, STACK, {0, 0, 0xBEEF, 0xBEEF, {0}}, false},
+	{"mov r4, &RAM", {0x4482, RAM}, {0, 0x1234, 0, 0, {0}},
+			4, CODE + 4, STACK, {0, 0x1234, 0, 0x1234, {0}}, false},
+	{"mov #0x5a5a, &RAM", {0x40B2, 0x5A5A, RAM}, {0, 0, 0, 0, {0}},
+			5, CODE + 6, STACK, {0, 0, 0, 0x5A5A, {0}}, false},
+	{"add 0(r4), &RAM", {0x5492, 0x0000, RAM}, {0, RAM, 0, 0x0101, {0}},
+			6, CODE + 6, STACK, {0, RAM, 0, 0x0202, {0}}, false},
+	{"mov r4, pc", {0x4400}, {0, 0xC100, 0, 0, {0}},
+			2, 0xC100, STACK, {0, 0xC100, 0, 0, {0}}, false},
+	{"ret", {0x4130}, {0, 0, 0, 0, {0xC200, 0x1111}},
+			3, 0xC200, STACK + 2, {0, 0, 0, 0, {0x1111, 0}}, false},
+
+	// constant generators
+	{"mov #0, r5", {0x4305}, {0, 0, 0xFFFF, 0, {0}},
+			1, CODE + 2, STACK, {0, 0, 0, 0, {0}}, false},
+	{"mov #-1, r5", {0x4335}, {0, 0, 0, 0, {0}},
+			1, CODE + 2, STACK, {0, 0, 0xFFFF, 0, {0}}, false},
+	{"mov #4, r5", {0x4225}, {0, 0, 0, 0, {0}},
+			1, CODE + 2, STACK, {0, 0, 4, 0, {0}}, false},
+	{"mov #8, r5", {0x4235}, {0, 0, 0, 0, {0}},
+			1, CODE + 2, STACK, {0, 0, 8, 0, {0}}, false},
+
+	// arithmetic and its flags
+	{"add #1, r5", {0x5315}, {0, 0, 0x7FFF, 0, {0}},
+			1, CODE + 2, STACK, {N | V, 0, 0x8000, 0, {0}}, false},
+	{"add r4, r5", {0x5405}, {0, 0x8000, 0x8000, 0, {0}},
+			1, CODE + 2, STACK, {C | Z | V, 0x8000, 0, 0, {0}}, false},
+	{"addc r4, r5", {0x6405}, {C, 1, 1, 0, {0}},
+			1, CODE + 2, STACK, {0, 1, 3, 0, {0}}, false},
+	{"sub r4, r5", {0x8405}, {0, 3, 5, 0, {0}},
+			1, CODE + 2, STACK, {C, 3, 2, 0, {0}}, false},
+	{"sub r4, r5 borrow", {0x8405}, {0, 5, 3, 0, {0}},
+			1, CODE + 2, STACK, {N, 5, 0xFFFE, 0, {0}}, false},
+	{"sub r4, r5 overflow", {0x8405}, {0, 1, 0x8000, 0, {0}},
+			1, CODE + 2, STACK, {C | V, 1, 0x7FFF, 0, {0}}, false},
+	{"subc r4, r5", {0x7405}, {0, 3, 5, 0, {0}},
+			1, CODE + 2, STACK, {C, 3, 1, 0, {0}}, false},
+	{"cmp r4, r5", {0x9405}, {0, 0x1234, 0x1234, 0, {0}},
+			1, CODE + 2, STACK, {C | Z, 0x1234, 0x1234, 0, {0}}, false},
+	{"cmp.b r4, r5", {0x9445}, {0, 0x0080, 0x017F, 0, {0}},
+			1, CODE + 2, STACK, {N | V, 0x0080, 0x017F, 0, {0}}, false},
+	{"dadd r4, r5", {0xA405}, {0, 0x0199, 0x0001, 0, {0}},
+			1, CODE + 2, STACK, {0, 0x0199, 0x0200, 0, {0}}, false},
+	{"dadd r4, r5 carry", {0xA405}, {0, 0x9999, 0x0001, 0, {0}},
+			1, CODE + 2, STACK, {C | Z, 0x9999, 0, 0, {0}}, false},
+	{"add.b #1, r5", {0x5355}, {0, 0, 0x00FF, 0, {0}},
+			1, CODE + 2, STACK, {C | Z, 0, 0, 0, {0}}, false},
+
+	// logic
+	{"bit r4, r5", {0xB405}, {0, 0x0F00, 0x0100, 0, {0}},
+			1, CODE + 2, STACK, {C, 0x0F00, 0x0100, 0, {0}}, false},
+	{"bit r4, r5 clear", {0xB405}, {0, 0x0F00, 0x00F0, 0, {0}},
+			1, CODE + 2, STACK, {Z, 0x0F00, 0x00F0, 0, {0}}, false},
+	{"bic r4, r5", {0xC405}, {C | Z, 0x00FF, 0x1234, 0, {0}},
+			1, CODE + 2, STACK, {C | Z, 0x00FF, 0x1200, 0, {0}}, false},
+	{"bis r4, r5", {0xD405}, {N, 0x00F0, 0x0F00, 0, {0}},
+			1, CODE + 2, STACK, {N, 0x00F0, 0x0FF0, 0, {0}}, false},
+	{"xor r4, r5", {0xE405}, {0, 0x8000, 0x8001, 0, {0}},
+			1, CODE + 2, STACK, {C | V, 0x8000, 0x0001, 0, {0}}, false},
+	{"and.b r4, r5", {0xF445}, {0, 0x12F0, 0x34F0, 0, {0}},
+			1, CODE + 2, STACK, {N | C, 0x12F0, 0x00F0, 0, {0}}, false},
+
+	// bytes in memory
+	{"mov.b @r4+, r5", {0x4475}, {0, RAM, 0, 0xBEEF, {0}},
+			2, CODE + 2, STACK, {0, RAM + 1, 0x00EF, 0xBEEF, {0}}, false},
+	{"mov.b r4, &RAM", {0x44C2, RAM}, {0, 0x12AB, 0, 0xBEEF, {0}},
+			4, CODE + 4, STACK, {0, 0x12AB, 0, 0xBEAB, {0}}, false},
+
+	// format II
+	{"rrc r5", {0x1005}, {C, 0, 0x0001, 0, {0}},
+			1, CODE + 2, STACK, {C | N, 0, 0x8000, 0, {0}}, false},
+	{"rra @r4", {0x1124}, {0, RAM, 0, 0x8002, {0}},
+			3, CODE + 2, STACK, {N, RAM, 0, 0xC001, {0}}, false},
+	{"rra.b r5", {0x1145}, {0, 0, 0x0081, 0, {0}},
+			1, CODE + 2, STACK, {C | N, 0, 0x00C0, 0, {0}}, false},
+	{"swpb r5", {0x1085}, {C | Z, 0, 0x1234, 0, {0}},
+			1, CODE + 2, STACK, {C | Z, 0, 0x3412, 0, {0}}, false},
+	{"sxt r5", {0x1185}, {0, 0, 0x0080, 0, {0}},
+			1, CODE + 2, STACK, {C | N, 0, 0xFF80, 0, {0}}, false},
+	{"sxt r5 zero", {0x1185}, {0, 0, 0xFF00, 0, {0}},
+			1, CODE + 2, STACK, {Z, 0, 0, 0, {0}}, false},
+	{"push r4", {0x1204}, {0, 0xABCD, 0, 0, {0x1111, 0}},
+			3, CODE + 2, STACK - 2, {0, 0xABCD, 0, 0, {0xABCD, 0x1111}}, false},
+	{"push #0x1234", {0x1230, 0x1234}, {0, 0, 0, 0, {0}},
+			4, CODE + 4, STACK - 2, {0, 0, 0, 0, {0x1234, 0}}, false},
+	{"push &RAM", {0x1212, RAM}, {0, 0, 0, 0xBEEF, {0}},
+			5, CODE + 4, STACK - 2, {0, 0, 0, 0xBEEF, {0xBEEF, 0}}, false},
+	{"call r4", {0x1284}, {0, 0xC100, 0, 0, {0}},
+			4, 0xC100, STACK - 2, {0, 0xC100, 0, 0, {CODE + 2, 0}}, false},
+	{"call #0xc200", {0x12B0, 0xC200}, {0, 0, 0, 0, {0}},
+			5, 0xC200, STACK - 2, {0, 0, 0, 0, {CODE + 4, 0}}, false},
+	{"call &RAM", {0x1292, RAM}, {0, 0, 0, 0xC300, {0}},
+			5, 0xC300, STACK - 2, {0, 0, 0, 0xC300, {CODE + 4, 0}}, false},
+	{"reti", {0x1300}, {0, 0, 0, 0, {C | Z | V, 0xC200}},
+			5, 0xC200, STACK + 4, {C | Z | V, 0, 0, 0, {0}}, false},
+
+	// jumps, taken and not
+	{"jne taken", {0x2002}, {0, 0, 0, 0, {0}},
+			2, CODE + 6, STACK, {0, 0, 0, 0, {0}}, false},
+	{"jne not", {0x2002}, {Z, 0, 0, 0, {0}},
+			2, CODE + 2, STACK, {Z, 0, 0, 0, {0}}, false},
+	{"jeq back", {0x27FD}, {Z, 0, 0, 0, {0}},
+			2, CODE - 4, STACK, {Z, 0, 0, 0, {0}}, false},
+	{"jnc not", {0x2802}, {C, 0, 0, 0, {0}},
+			2, CODE + 2, STACK, {C, 0, 0, 0, {0}}, false},
+	{"jc taken", {0x2C02}, {C, 0, 0, 0, {0}},
+			2, CODE + 6, STACK, {C, 0, 0, 0, {0}}, false},
+	{"jn taken", {0x3002}, {N, 0, 0, 0, {0}},
+			2, CODE + 6, STACK, {N, 0, 0, 0, {0}}, false},
+	{"jge n and v", {0x3402}, {N | V, 0, 0, 0, {0}},
+			2, CODE + 6, STACK, {N | V, 0, 0, 0, {0}}, false},
+	{"jge n not v", {0x3402}, {N, 0, 0, 0, {0}},
+			2, CODE + 2, STACK, {N, 0, 0, 0, {0}}, false},
+	{"jl n not v", {0x3802}, {N, 0, 0, 0, {0}},
+			2, CODE + 6, STACK, {N, 0, 0, 0, {0}}, false},
+	{"jmp $", {0x3FFF}, {0, 0, 0, 0, {0}},
+			2, CODE, STACK, {0, 0, 0, 0, {0}}, false},
+
+	// an interrupt, SR and PC pushed and SR cleared
+	{"port 1 interrupt", {0x4303}, {MCU_GIE | C, 0, 0, 0, {0}},
+			6, HANDLER, STACK - 4, {0, 0, 0, 0, {MCU_GIE | C, CODE}}, true},
+};
+
+#define VECTORS	(int)(sizeof vectors / sizeof *vectors)
+
+static Mcu m;
+
+static void poke(uint16_t a, uint16_t v) {
+	m.mem[a] = v;
+	m.mem[a + 1] = v >> 8;
+}
+
+// one value against what it should be, says so if it isn't
+static bool want(const Vector *t, const char *what, unsigned long long got,
+		unsigned long long should) {
+	if (got == should)
+		return true;
+	printf("  %-20s %-8s %04llx, want %04llx\n", t->name, what, got, should);
+	return false;
+}
+
+/***************************************************************************************
+ * RUN
+ * 		One vector on a fresh MCU, true if everything came out as it should
+ **************************************************************************************/
+static bool run(const Vector *t) {
+	uint16_t sp;
+	bool ok = true;
+	int i;
+
+	memset(m.mem, 0, sizeof m.mem);
+	poke(VECTOR_RESET, CODE);
+	poke(VECTOR_PORT1, HANDLER);
+	mcuReset(&m);
+	for (i = 0; i < 3; i++)
+		poke(CODE + 2 * i, t->code[i]);
+	m.r[MCU_SP] = STACK;
+	m.r[MCU_SR] = t->in.sr;
+	m.r[4] = t->in.r4;
+	m.r[5] = t->in.r5;
+	poke(RAM, t->in.ram);
+	poke(STACK, t->in.stack[0]);
+	poke(STACK + 2, t->in.stack[1]);
+	if (t->irq) {
+		m.mem[P1IE] = 1;
+		m.mem[P1IFG] = 1;
+	}
+
+	mcuRun(&m, 1);
+	if (m.fault) {
+		printf("  %-20s %s at %04x\n", t->name, m.fault, m.faultPc);
+		return false;
+	}
+	sp = m.r[MCU_SP];
+	ok &= want(t, "cycles", m.cycles, t->cycles);
+	ok &= want(t, "ran", m.instructions, !t->irq);
+	ok &= want(t, "pc", m.r[MCU_PC], t->pc);
+	ok &= want(t, "sp", sp, t->sp);
+	ok &= want(t, "sr", m.r[MCU_SR], t->out.sr);
+	ok &= want(t, "r4", m.r[4], t->out.r4);
+	ok &= want(t, "r5", m.r[5], t->out.r5);
+	ok &= want(t, "ram", mcuPeek(&m, RAM, false), t->out.ram);
+	ok &= want(t, "@sp", mcuPeek(&m, sp, false), t->out.stack[0]);
+	ok &= want(t, "2(sp)", mcuPeek(&m, sp + 2, false), t->out.stack[1]);
+	return ok;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	int wrong = 0;
+	int i;
+
+	if (argc > 1) {
+		fprintf(stderr, "usage: %s\n", argv[0]);
+		return 2;
+	}
+	for (i = 0; i < VECTORS; i++)
+		wrong += !run(&vectors[i]);
+	printf("msp430: %d vectors, %s\n", VECTORS, wrong ? "FAILED" : "ok");
+	return wrong ? 1 : 0;
+}
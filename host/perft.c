@@ -0,0 +1,449 @@
+/***************************************************************************************
+ * PERFT
+ * 		Counts the different boards a piece sequence can leave, depth by depth, the way
+ * 		chess engines count positions to check their move generators. Every piece goes
+ * 		to every rest reach.c finds from the spawn, full rows go, and a board that
+ * 		turns up again at the same depth, from any order of moves, counts once and is
+ * 		only searched once. The counts only depend on the board and the pieces, so
+ * 		they're the answer a move generator change has to keep giving, and placements
+ * 		a second is how fast it gives it.
+ *
+ * 		build/perft [-j threads] [-m table MB] [-r replay tick] [-e expected] pieces
+ * 				pieces is the sequence as letters, OIZSJLT, one depth each
+ * 				-r starts from the board of a replay after tick, else an empty one
+ * 				-e checks the boards at each depth against the line in expected
+ * 				that these pieces start (host/perft.expected), make check does
+ *
+ * 		Boards are told apart by a Zobrist hash, a random 64 bit key per cell XORed
+ * 		together, kept a row at a time so a board is 14 lookups. Seen boards go in one
+ * 		open addressed table all threads share, claimed with a compare and swap, so
+ * 		no locks on it. 64 bits makes a collision, two boards counted as one, about
+ * 		as likely as never.
+ *
+ * 		Each thread works depth first off its own deque of boards and, when it runs
+ * 		dry, steals the oldest board off another thread's. Oldest is nearest the root,
+ * 		the most work for one steal. head and tail only change under the deque's lock
+ * 		but are stored atomically, a thief looks at them without it first.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "../replay.h"
+#include "reach.h"
+
+#define MAX_DEPTH				32
+#define MAX_THREADS			256
+#define MAX_PROBES			256				// a table this full is too small
+#define DEFAULT_MB			512
+
+// A board waiting to be searched
+typedef struct {
+	uint16_t rows[14];
+	uint8_t depth;									// pieces placed to get it
+} Task;
+
+// One thread's deque, a ring the owner pushes and pops at the tail of and thieves
+// take from the head of
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	Task *tasks;
+	unsigned long head;
+	unsigned long tail;
+	unsigned long long boards[MAX_DEPTH + 1];			// new boards found at each depth
+	unsigned long long placements[MAX_DEPTH + 1];	// pieces placed to get there
+	unsigned long long steals;
+} __attribute__((aligned(64))) Worker;
+
+uint64_t zobrist[14][1024];					// key of each row's blocks, by row
+uint64_t depthKey[MAX_DEPTH + 1];
+uint64_t *table;
+unsigned long tableMask;
+bool tableFull;
+
+unsigned char sequence[MAX_DEPTH];
+int depth;
+Worker *workers;
+int threads;
+unsigned long ring;									// tasks a deque holds, a power of 2
+unsigned long outstanding;					// tasks pushed and not finished, all threads
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * MAKE KEYS
+ * 		A random key per cell, and every row's blocks XORed together ahead of time.
+ * 		Fixed seed, the same keys every run.
+ **************************************************************************************/
+void makeKeys(void) {
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	uint64_t cell[10];
+	int i;
+	int j;
+	int m;
+
+	for (i = 0; i < 14; i++) {
+		for (j = 0; j < 10; j++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			cell[j] = x;
+		}
+		zobrist[i][0] = 0;
+		for (m = 1; m < 1024; m++)
+			zobrist[i][m] = zobrist[i][m & (m - 1)] ^ cell[__builtin_ctz(m)];
+	}
+	for (i = 0; i <= MAX_DEPTH; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		depthKey[i] = x;
+	}
+}
+
+/***************************************************************************************
+ * FIRST SEEN
+ * 		Puts the board with hash h in the table, true if nobody had yet
+ **************************************************************************************/
+bool firstSeen(uint64_t h) {
+	unsigned long i = h & tableMask;
+	uint64_t empty;
+	int probes;
+
+	if (!h)
+		h = 1;													// 0 is an empty slot
+	for (probes = 0; probes < MAX_PROBES; probes++, i = (i + 1) & tableMask) {
+		empty = 0;
+		if (__atomic_compare_exchange_n(&table[i], &empty, h, false, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED))
+			return true;
+		if (empty == h)
+			return false;
+	}
+	tableFull = true;									// counts will come out high
+	return true;
+}
+
+/***************************************************************************************
+ * PUSH / POP / STEAL
+ **************************************************************************************/
+void push(Worker *w, const Task *t) {
+	__atomic_fetch_add(&outstanding, 1, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&w->lock);
+	w->tasks[w->tail & (ring - 1)] = *t;
+	__atomic_store_n(&w->tail, w->tail + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&w->lock);
+}
+
+bool pop(Worker *w, Task *t) {
+	bool got = false;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->tail != w->head) {
+		__atomic_store_n(&w->tail, w->tail - 1, __ATOMIC_RELAXED);
+		*t = w->tasks[w->tail & (ring - 1)];
+		got = true;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return got;
+}
+
+bool steal(Worker *from, Task *t) {
+	bool got = false;
+
+	if (__atomic_load_n(&from->tail, __ATOMIC_RELAXED) == __atomic_load_n(&from->head,
+			__ATOMIC_RELAXED))
+		return false;										// don't take the lock to find nothing
+	pthread_mutex_lock(&from->lock);
+	if (from->tail != from->head) {
+		*t = from->tasks[from->head & (ring - 1)];
+		__atomic_store_n(&from->head, from->head + 1, __ATOMIC_RELAXED);
+		got = true;
+	}
+	pthread_mutex_unlock(&from->lock);
+	return got;
+}
+
+/***************************************************************************************
+ * EXPAND
+ * 		Places the next piece every way it goes on t's board, pushes the boards
+ * 		nobody has seen
+ **************************************************************************************/
+void expand(Worker *w, Reach *m, const Task *t) {
+	const unsigned char *s;
+	unsigned int piece = sequence[t->depth];
+	unsigned int rests;
+	unsigned int n;
+	uint64_t h;
+	Task child;
+	int x;
+	int y;
+	int i;
+	int j;
+
+	rests = reachFind(m, t->rows, piece, 0, 4, 0);
+	w->placements[t->depth + 1] += rests;
+	child.depth = t->depth + 1;
+	for (n = 0; n < rests; n++) {
+		s = shapes[piece - 1][REACH_ROT(m->rests[n])];
+		x = REACH_X(m->rests[n]);
+		y = REACH_Y(m->rests[n]);
+		for (i = 0; i < 14; i++)
+			child.rows[i] = t->rows[i];
+		for (i = 0; i < 4 && s[i]; i++)
+			child.rows[y + i] |= (unsigned int)s[i] << x;
+
+		// full rows go, the rest come down
+		h = depthKey[child.depth];
+		for (i = 13, j = 13; i >= 0; i--)
+			if (child.rows[i] != FULL_ROW) {
+				child.rows[j] = child.rows[i];
+				h ^= zobrist[j--][child.rows[i]];
+			}
+		while (j >= 0)
+			child.rows[j--] = 0;
+
+		if (firstSeen(h)) {
+			w->boards[child.depth]++;
+			if (child.depth < depth)
+				push(w, &child);
+		}
+	}
+}
+
+/***************************************************************************************
+ * WORK
+ * 		Thread body, runs until every thread is out of boards
+ **************************************************************************************/
+void *work(void *arg) {
+	Worker *w = arg;
+	Reach m;
+	Task t;
+	int victim = w - workers;
+	int i;
+
+	for (;;) {
+		if (!pop(w, &t)) {
+			for (i = 1; i < threads; i++) {
+				victim = (victim + 1) % threads;
+				if (steal(&workers[victim], &t))
+					break;
+			}
+			if (i == threads) {
+				if (!__atomic_load_n(&outstanding, __ATOMIC_RELAXED))
+					return NULL;
+				sched_yield();
+				continue;
+			}
+			w->steals++;
+		}
+		expand(w, &m, &t);
+		__atomic_fetch_sub(&outstanding, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/***************************************************************************************
+ * START BOARD
+ * 		Board of the replay at path after tick into rows
+ **************************************************************************************/
+int startBoard(const char *path, unsigned long tick, uint16_t *rows) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+	size_t length;
+	Player p;
+	Game g;
+	long n;
+	int i;
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(n > 0 ? n : 1);
+	length = fread(data, 1, n > 0 ? n : 0, f);
+	fclose(f);
+	if (replayOpen(&p, data, length, &g) || replaySeek(&p, &g, tick) < 0) {
+		fprintf(stderr, "%s: can't play to tick %lu\n", path, tick);
+		free(data);
+		return 1;
+	}
+	for (i = 0; i < 14; i++)
+		rows[i] = g.rows[i];
+	free(data);
+	return 0;
+}
+
+/***************************************************************************************
+ * CHECK
+ * 		counts[1..depth] against the line of the file at path that pieces start, a
+ * 		line being a sequence then the boards at each depth. The number that differ.
+ **************************************************************************************/
+int check(const char *path, const char *pieces, const unsigned long long *counts) {
+	FILE *f = fopen(path, "r");
+	char line[512];
+	char name[MAX_DEPTH + 1];
+	unsigned long long want;
+	int failed = 0;
+	int offset;
+	int used;
+	int d;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof line, f)) {
+		if (line[0] == '#' || sscanf(line, "%32s%n", name, &offset) != 1 ||
+				strncmp(name, pieces, depth) || (int)strlen(name) < depth)
+			continue;
+		for (d = 1; d <= depth; d++, offset += used) {
+			if (sscanf(line + offset, "%llu%n", &want, &used) != 1) {
+				printf("  %s has no depth %d\n", name, d);
+				failed++;
+				break;
+			}
+			if (counts[d] != want) {
+				printf("  depth %d: %llu boards, want %llu\n", d, counts[d], want);
+				failed++;
+			}
+		}
+		fclose(f);
+		return failed;
+	}
+	fclose(f);
+	printf("  nothing for %s in %s\n", pieces, path);
+	return 1;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	static const char pieceNames[] = " OIZSJLT";
+	unsigned long long boards[MAX_DEPTH + 1];
+	unsigned long long placed;
+	unsigned long long placements = 0;
+	unsigned long long steals = 0;
+	unsigned long mb = DEFAULT_MB;
+	unsigned long entries;
+	const char *expected = NULL;
+	unsigned long long t0;
+	double s;
+	Task root;
+	const char *c;
+	int failed = 0;
+	int started;
+	int d;
+	int i = 1;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memset(&root, 0, sizeof root);
+	for (; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-j") && i + 2 < argc)
+			threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-m") && i + 2 < argc)
+			mb = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-r") && i + 3 < argc) {
+			if (startBoard(argv[i + 1], strtoul(argv[i + 2], NULL, 0), root.rows))
+				return 1;
+			i += 2;
+		} else if (!strcmp(argv[i], "-e") && i + 2 < argc)
+			expected = argv[++i];
+		else
+			break;
+	}
+	if (i != argc - 1 || !*argv[i] || strlen(argv[i]) > MAX_DEPTH) {
+		fprintf(stderr, "usage: %s [-j threads] [-m table MB] [-r replay tick] [-e expected]\n"
+				"       pieces, up to %d of OIZSJLT\n", argv[0], MAX_DEPTH);
+		return 2;
+	}
+	for (c = argv[i], depth = 0; *c; c++, depth++) {
+		if (*c == ' ' || !strchr(pieceNames, *c)) {
+			fprintf(stderr, "perft: %c isn't a piece, OIZSJLT\n", *c);
+			return 2;
+		}
+		sequence[depth] = strchr(pieceNames, *c) - pieceNames;
+	}
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	// table is the biggest power of 2 that fits in mb
+	for (entries = 1; entries * 2 * sizeof *table <= (mb ? mb : 1) << 20; entries *= 2)
+		;
+	for (ring = 1; ring < (unsigned long)depth * REACH_STATES; ring *= 2)
+		;
+	table = calloc(entries, sizeof *table);
+	if (posix_memalign((void **)&workers, 64, threads * sizeof *workers) || !table) {
+		fprintf(stderr, "perft: out of memory\n");
+		return 1;
+	}
+	tableMask = entries - 1;
+	makeKeys();
+	memset(workers, 0, threads * sizeof *workers);
+	for (i = 0; i < threads; i++) {
+		pthread_mutex_init(&workers[i].lock, NULL);
+		if (!(workers[i].tasks = malloc(ring * sizeof *workers[i].tasks))) {
+			fprintf(stderr, "perft: out of memory\n");
+			return 1;
+		}
+	}
+
+	t0 = now();
+	push(&workers[0], &root);
+	for (i = 1; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, work, &workers[i]))
+			break;
+	started = i;			// threads stays put, the rest are empty deques nobody runs
+	work(&workers[0]);
+	for (i = 1; i < started; i++)
+		pthread_join(workers[i].thread, NULL);
+	s = (now() - t0) / 1e9;
+
+	printf("perft: %s, %d threads, %lu table entries\n", argv[argc - 1], started, entries);
+	printf("%5s %5s %16s %16s\n", "depth", "piece", "boards", "placements");
+	for (d = 1; d <= depth; d++) {
+		boards[d] = 0;
+		placed = 0;
+		for (i = 0; i < threads; i++) {
+			boards[d] += workers[i].boards[d];
+			placed += workers[i].placements[d];
+		}
+		placements += placed;
+		printf("%5d %5c %16llu %16llu\n", d, pieceNames[sequence[d - 1]], boards[d], placed);
+	}
+	for (i = 0; i < threads; i++)
+		steals += workers[i].steals;
+	printf("%.1f placements/s, %llu steals, %.3f s\n", placements / s, steals, s);
+	if (tableFull)
+		fprintf(stderr, "perft: table full, boards may be counted twice, give -m more\n");
+	if (expected) {
+		failed = check(expected, argv[argc - 1], boards);
+		printf("%s: %s\n", expected, failed ? "FAILED" : "ok");
+	}
+
+	for (i = 0; i < threads; i++)
+		free(workers[i].tasks);
+	free(workers);
+	free(table);
+	return tableFull || failed;
+}
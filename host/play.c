@@ -0,0 +1,319 @@
+/***************************************************************************************
+ * PLAY
+ * 		The game in a terminal, to play or to watch the AI play, over SSH too. The
+ * 		board, the piece, the level and lines and the next piece, in the unit's own
+ * 		colors as near as xterm's 256 get.
+ *
+ * 		build/play [-a] [-s seed] [-t seconds]
+ * 				-a the AI plays, a new game a couple of seconds after each one ends
+ *
+ * 		a d or arrows move, w or up turns, s or down pulls the joystick for a bit,
+ * 		space pulls it all the way until the piece sets, p pauses, n starts over
+ * 		and q quits. A terminal never says when a key comes up, so a pull is held
+ * 		PULL_TICKS after the last press rather than for as long as the key is down.
+ *
+ * 		Ticks come off a timerfd, 10 ms like the unit, and every wakeup draws one
+ * 		frame that term.c diffs against the last, so only what moved goes out.
+ * 		"Next" is what the unit's generator would give if the piece spawned now,
+ * 		presses and drops stir it, same as on the unit. Bytes a frame are printed
+ * 		at the end.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "../engine.h"
+#include "../draw.h"
+#include "ai.h"
+#include "term.h"
+
+#define TICK_NS				10000000L	// 10 ms, same as the unit
+#define CATCH_UP			10				// ticks a wakeup at most, a stall past that is lost
+#define PULL_TICKS		15				// a down press holds the joystick this long
+#define RESTART_TICKS	200				// AI's next game after a game over
+
+// where things are, in cells
+#define BOARD_ROW			1
+#define BOARD_COLUMN	2					// a square is two cells wide
+#define HUD_COLUMN		25
+
+#define BACKGROUND		0x5B57		// initBackground's
+#define TEXT					0xFFFF
+
+// drawSquare's colors, by grid value, 0 empty
+const uint16_t squareColors[GARBAGE + 1] = {
+	0x110F, 0x69D6, 0x24BD, 0x053D, 0x05D9, 0x3A96, 0x9135, 0x03D2, 0x4208
+};
+
+Term term;
+Game game;
+Ai ai;
+unsigned char grid[14][10];				// colors of game.rows, same as main.c's
+unsigned char ge;										// what the last tick did
+unsigned char presses;							// since the last tick
+unsigned int pull;									// ticks the joystick stays pulled
+bool drop;													// pulled all the way until the piece sets
+bool useAi;
+bool paused;
+unsigned int seed;
+unsigned long ticks;
+unsigned long overTicks;						// since the game ended
+struct termios saved;
+bool raw;
+volatile sig_atomic_t quit;
+
+/***************************************************************************************
+ * NEW GAME
+ **************************************************************************************/
+void newGame(void) {
+	gameReset(&game, seed++);
+	memset(grid, 0, sizeof grid);
+	aiStart(&ai, &aiDefaults);
+	ge = 0;
+	presses = 0;
+	pull = 0;
+	drop = false;
+	overTicks = 0;
+}
+
+/***************************************************************************************
+ * TICK
+ * 		One 10 ms tick of the game on the keys since the last, or the AI's
+ **************************************************************************************/
+void tick(void) {
+	unsigned char oldPiece = game.piece;
+	unsigned char oldRotation = game.rotation;
+	unsigned char oldX = game.xPos;
+	unsigned char oldY = game.yPos;
+	unsigned char in;
+
+	ticks++;
+	if (!game.gameAlive) {
+		if (useAi && ++overTicks >= RESTART_TICKS)
+			newGame();
+		return;
+	}
+	if (useAi) {
+		in = aiInput(&ai, &game, ge);
+	} else {
+		in = presses | (pull || drop ? 3 : 0) << IN_STICK_SHIFT;
+		presses = 0;
+		if (pull)
+			pull--;
+	}
+	ge = gameTick(&game, in);
+	if (ge & GE_LOCK)
+		drop = false;
+	followGrid(grid, &game, ge, oldPiece, oldRotation, oldX, oldY);
+}
+
+/***************************************************************************************
+ * KEYS
+ * 		Whatever came in on stdin. Arrows are ESC [ A to D, escape carries over
+ * 		between reads.
+ **************************************************************************************/
+void keys(const unsigned char *buf, ssize_t n) {
+	static int escape;									// bytes of ESC [ seen
+	unsigned char c;
+	ssize_t i;
+
+	for (i = 0; i < n; i++) {
+		c = buf[i];
+		if (escape == 0 && c == 0x1B) {
+			escape = 1;
+			continue;
+		}
+		if (escape == 1) {
+			escape = c == '[' ? 2 : 0;
+			continue;
+		}
+		if (escape == 2) {
+			escape = 0;
+			c = c == 'A' ? 'w' : c == 'B' ? 's' : c == 'C' ? 'd' : c == 'D' ? 'a' : 0;
+		}
+		switch (c) {
+		case 'a':
+			presses |= IN_LEFT;
+			break;
+		case 'd':
+			presses |= IN_RIGHT;
+			break;
+		case 'w':
+			presses |= IN_ROTATE;
+			break;
+		case 's':
+			pull = PULL_TICKS;
+			break;
+		case ' ':
+			drop = game.pieceAlive;
+			break;
+		case 'p':
+			paused = !paused;
+			break;
+		case 'n':
+			newGame();
+			break;
+		case 'q':
+		case 0x03:												// ^C, raw mode doesn't signal
+			quit = 1;
+			break;
+		}
+	}
+}
+
+/***************************************************************************************
+ * DRAW
+ * 		The whole frame into term's cells. termFlush works out what changed.
+ **************************************************************************************/
+void draw(void) {
+	const unsigned char *s;
+	uint8_t back = termColor(BACKGROUND);
+	uint8_t text = termColor(TEXT);
+	uint8_t empty = termColor(squareColors[0]);
+	unsigned int next;
+	char line[TERM_COLUMNS + 1];
+	int i;
+	int j;
+
+	termFill(&term, 0, 0, TERM_COLUMNS, TERM_ROWS, back);
+	for (i = 0; i < 14; i++)
+		for (j = 0; j < 10; j++)
+			termFill(&term, BOARD_ROW + i, BOARD_COLUMN + 2 * j, 2, 1,
+					termColor(squareColors[gameCell(&game, i, j) == CELL_PIECE ?
+							game.piece : grid[i][j]]));
+
+	termFill(&term, BOARD_ROW, HUD_COLUMN, 2, 1, termColor(levelColorFor(game.level)));
+	snprintf(line, sizeof line, "LEVEL %u", game.level);
+	termText(&term, BOARD_ROW, HUD_COLUMN + 3, line, text, back);
+	snprintf(line, sizeof line, "LINES %u", game.totalLines);
+	termText(&term, BOARD_ROW + 2, HUD_COLUMN, line, text, back);
+
+	termText(&term, BOARD_ROW + 4, HUD_COLUMN, "NEXT", text, back);
+	termFill(&term, BOARD_ROW + 5, HUD_COLUMN, 8, 4, empty);
+	next = game.keyPress % 7 + 1;
+	s = shapes[next - 1][0];
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 4; j++)
+			if (s[i] & (1 << j))
+				termFill(&term, BOARD_ROW + 5 + i, HUD_COLUMN + 2 * j, 2, 1,
+						termColor(squareColors[next]));
+
+	termText(&term, BOARD_ROW + 10, HUD_COLUMN, !game.gameAlive ? "GAME OVER" :
+			paused ? "PAUSED" : useAi ? "AI PLAYING" : "", text, back);
+	if (!useAi) {
+		termText(&term, BOARD_ROW + 11, HUD_COLUMN, "ad move  w turn", text, back);
+		termText(&term, BOARD_ROW + 12, HUD_COLUMN, "s pull   spc drop", text, back);
+	}
+	termText(&term, BOARD_ROW + 13, HUD_COLUMN, "p pause  n new", text, back);
+	termText(&term, BOARD_ROW + 14, HUD_COLUMN, "q quit", text, back);
+}
+
+void stop(int sig) {
+	(void)sig;
+	quit = 1;
+}
+
+/***************************************************************************************
+ * MAIN
+ * 		Waits on the timer and the keyboard, runs the ticks that are due and draws a
+ * 		frame every wakeup
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	struct itimerspec its;
+	struct pollfd fds[2];
+	struct termios tio;
+	struct timespec t0;
+	struct timespec t1;
+	unsigned char buf[64];
+	unsigned long long due;
+	unsigned long long i;
+	unsigned long long firstBytes;
+	double seconds = 0;
+	double s;
+	ssize_t n;
+	int timer;
+	int opt;
+
+	seed = time(NULL);
+	while ((opt = getopt(argc, argv, "as:t:")) != -1) {
+		switch (opt) {
+		case 'a':
+			useAi = true;
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = strtod(optarg, NULL);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-a] [-s seed] [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timer < 0) {
+		fprintf(stderr, "play: no timerfd: %s\n", strerror(errno));
+		return 1;
+	}
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = TICK_NS;
+	its.it_value = its.it_interval;
+	timerfd_settime(timer, 0, &its, NULL);
+	fds[0].fd = timer;
+	fds[0].events = POLLIN;
+	fds[1].fd = STDIN_FILENO;
+	fds[1].events = POLLIN;
+
+	// keys as they're pressed, no echo, no line editing
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0) {
+		tio = saved;
+		cfmakeraw(&tio);
+		tio.c_cc[VMIN] = 0;
+		tio.c_cc[VTIME] = 0;
+		raw = tcsetattr(STDIN_FILENO, TCSANOW, &tio) == 0;
+	}
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	signal(SIGHUP, stop);
+
+	newGame();
+	termStart(&term, STDOUT_FILENO);
+	draw();
+	firstBytes = termFlush(&term);
+	term.frames = 0;											// counting from here on
+	term.bytes = 0;
+	term.most = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	while (!quit && (!seconds || ticks < seconds * 100)) {
+		if (poll(fds, raw ? 2 : 1, -1) < 0)
+			continue;
+		if (raw && (fds[1].revents & POLLIN) && (n = read(STDIN_FILENO, buf, sizeof buf)) > 0)
+			keys(buf, n);
+		if ((fds[0].revents & POLLIN) && read(timer, &due, sizeof due) == sizeof due)
+			for (i = 0; i < due && i < CATCH_UP; i++)
+				if (!paused)
+					tick();
+		draw();
+		termFlush(&term);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	termEnd(&term);
+	if (raw)
+		tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+
+	s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	fprintf(stderr, "play: %lu ticks in %.1f s, %llu frames sent after the first (%llu bytes)\n",
+			ticks, s, term.frames, firstBytes);
+	fprintf(stderr, "%.1f bytes a frame, %zu at most, %.0f bytes/s\n",
+			term.frames ? (double)term.bytes / term.frames : 0.0, term.most, s > 0 ? term.bytes / s : 0.0);
+	return 0;
+}
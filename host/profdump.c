@@ -0,0 +1,137 @@
+/***************************************************************************************
+ * PROFILE DUMP
+ * 		Reads the histograms a make firmware PROFILE=1 unit sends (see profile.h) and
+ * 		prints them, a line a region.
+ *
+ * 		build/profdump [path]
+ * 				path is a capture or the serial port on the unit's P1.2 (TXD), stdin if
+ * 				not given. A serial port gets set to LINK_BAUD 8N1 raw.
+ *
+ * 		Hold rotate and tap the title to send one. Every dump in the stream gets
+ * 		printed, a bad one says so and is skipped. calls is the counts put back
+ * 		together, ~ if they got halved on the unit, then how they went across the
+ * 		buckets and the most any one took.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../profile.h"
+
+#define MCU_MHZ		20
+#define BAUD			B38400			// main.c's LINK_BAUD
+
+const char *regionNames[PROF_REGIONS] = {
+	"fits", "lockPiece", "clearLines", "step", "readTS", "readJoystick", "Timer_A",
+	"Port_1/2", "drawSquare", "paintPiece", "fillLevelColor", "drawScore", "initBackground",
+	"fillScreen", "fillRect", "drawPixel", "drawInstruction", "drawLetter"
+};
+
+const char *bucketNames[PROF_BUCKETS] = {"<64", "<512", "<4K", "<32K", "<256K", "more"};
+
+/***************************************************************************************
+ * PROF BIG
+ * 		The most byte back to cycles, see profile.h
+ **************************************************************************************/
+unsigned long profBig(unsigned char small) {
+	if (small < 16)
+		return small;
+	return (8UL + (small & 7)) << ((small >> 3) - 1);
+}
+
+/***************************************************************************************
+ * PRINT DUMP
+ * 		d is a whole dump, checked
+ **************************************************************************************/
+void printDump(const unsigned char *d, unsigned int n) {
+	const ProfRegion *r;
+	unsigned long long calls;
+	unsigned int sum;
+	unsigned long most;
+	int i;
+	int b;
+
+	printf("dump %u, cycles at %d MHz\n", n, MCU_MHZ);
+	printf("  %-16s %10s", "region", "calls");
+	for (b = 0; b < PROF_BUCKETS; b++)
+		printf(" %6s", bucketNames[b]);
+	printf(" %9s %9s\n", "most", "us");
+	for (i = 0; i < PROF_REGIONS; i++) {
+		r = (const ProfRegion *)(d + 5) + i;
+		for (sum = 0, b = 0; b < PROF_BUCKETS; b++)
+			sum += r->counts[b];
+		calls = (unsigned long long)sum << r->halved;
+		printf("  %-16s %c%9llu", regionNames[i], r->halved ? '~' : ' ', calls);
+		for (b = 0; b < PROF_BUCKETS; b++) {
+			if (r->counts[b])
+				printf(" %5.1f%%", 100.0 * r->counts[b] / sum);
+			else
+				printf(" %6s", ".");
+		}
+		most = profBig(r->most);
+		printf(" %9lu %9.1f\n", most, (double)most / MCU_MHZ);
+	}
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned char d[PROF_DUMP];
+	struct termios tio;
+	FILE *in = stdin;
+	unsigned int have = 0;
+	unsigned int dumps = 0;
+	unsigned int bad = 0;
+	unsigned int sum;
+	unsigned int i;
+	int c;
+
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+		fprintf(stderr, "usage: %s [path]\n", argv[0]);
+		return 2;
+	}
+	if (argc == 2 && !(in = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (isatty(fileno(in)) && !tcgetattr(fileno(in), &tio)) {
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, BAUD);
+		cfsetospeed(&tio, BAUD);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fileno(in), TCSANOW, &tio);
+	}
+
+	// line up on the magic, then take a whole dump
+	while ((c = getc(in)) != EOF) {
+		if ((have == 0 && c != PROF_MAGIC0) || (have == 1 && c != PROF_MAGIC1)) {
+			have = c == PROF_MAGIC0;
+			d[0] = c;
+			continue;
+		}
+		d[have++] = c;
+		if (have < PROF_DUMP)
+			continue;
+		have = 0;
+
+		for (sum = 0, i = 0; i < PROF_DUMP - 2; i++)
+			sum += d[i];
+		if (d[2] != PROF_VERSION || d[3] != PROF_REGIONS || d[4] != PROF_BUCKETS) {
+			fprintf(stderr, "profdump: version %u, %u regions, %u buckets, not this build's\n",
+					d[2], d[3], d[4]);
+			bad++;
+		} else if ((sum & 0xFFFF) != (d[PROF_DUMP - 2] | (unsigned int)d[PROF_DUMP - 1] << 8)) {
+			fprintf(stderr, "profdump: a dump with a bad sum, skipped\n");
+			bad++;
+		} else {
+			printDump(d, ++dumps);
+			fflush(stdout);
+		}
+	}
+	if (!dumps && !bad)
+		fprintf(stderr, "profdump: no dump\n");
+	return dumps && !bad ? 0 : 1;
+}
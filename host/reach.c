@@ -0,0 +1,138 @@
+/***************************************************************************************
+ * REACH
+ * 		See reach.h
+ **************************************************************************************/
+#include "reach.h"
+
+/***************************************************************************************
+ * REACH SEEN
+ **************************************************************************************/
+bool reachSeen(const Reach *m, unsigned int s) {
+	return m->seen[s >> 6] >> (s & 63) & 1;
+}
+
+/***************************************************************************************
+ * REACH FIND
+ * 		Searches from piece p in rotation r at x, y on board rows. Fills m with every
+ * 		rest and returns how many, 0 if the piece doesn't fit where it starts.
+ **************************************************************************************/
+unsigned int reachFind(Reach *m, const uint16_t *rows, unsigned int p, unsigned int r, int x,
+		int y) {
+	unsigned int head = 0;
+	unsigned int tail = 0;
+	unsigned int s;
+	unsigned int n;
+	unsigned int move;
+	int nx;
+	int ny;
+	int nr;
+	int i;
+
+	for (i = 0; i < (REACH_STATES + 63) / 64; i++)
+		m->seen[i] = 0;
+	m->count = 0;
+	m->piece = p;
+	m->rotations = distinctRotations[p - 1];
+	r %= m->rotations;
+	if (!fits(rows, p, r, x, y))
+		return 0;
+
+	s = REACH_STATE(r, y, x);
+	m->seen[s >> 6] |= 1ULL << (s & 63);
+	m->via[s] = MOVE_NONE;
+	m->queue[tail++] = s;
+
+	while (head < tail) {
+		s = m->queue[head++];
+		x = REACH_X(s);
+		y = REACH_Y(s);
+		r = REACH_ROT(s);
+		if (!fits(rows, p, r, x, y + 1))
+			m->rests[m->count++] = s;
+
+		for (move = MOVE_LEFT; move <= MOVE_DOWN; move++) {
+			nx = x;
+			ny = y;
+			nr = r;
+			if (move == MOVE_LEFT)
+				nx--;
+			else if (move == MOVE_RIGHT)
+				nx++;
+			else if (move == MOVE_ROTATE)
+				nr = (r + 1) % m->rotations;
+			else
+				ny++;
+			if (nx < 0 || nx > 9 || ny > 13)
+				continue;
+			n = REACH_STATE(nr, ny, nx);
+			if (reachSeen(m, n) || !fits(rows, p, nr, nx, ny))
+				continue;
+			m->seen[n >> 6] |= 1ULL << (n & 63);
+			m->via[n] = move;
+			m->queue[tail++] = n;
+		}
+	}
+	return m->count;
+}
+
+/***************************************************************************************
+ * REACH PATH
+ * 		States from where the search started to s, both ends included, into path.
+ * 		Returns how many. s has to be seen.
+ **************************************************************************************/
+unsigned int reachPath(const Reach *m, unsigned int s, uint16_t *path) {
+	unsigned int n = 0;
+	unsigned int i;
+	uint16_t t;
+
+	for (;;) {
+		path[n++] = s;
+		if (m->via[s] == MOVE_NONE)
+			break;
+		if (m->via[s] == MOVE_LEFT)
+			s += 1;
+		else if (m->via[s] == MOVE_RIGHT)
+			s -= 1;
+		else if (m->via[s] == MOVE_DOWN)
+			s -= 10;
+		else
+			s = REACH_STATE((REACH_ROT(s) + m->rotations - 1) % m->rotations, REACH_Y(s),
+					REACH_X(s));
+	}
+	for (i = 0; i < n / 2; i++) {
+		t = path[i];
+		path[i] = path[n - 1 - i];
+		path[n - 1 - i] = t;
+	}
+	return n;
+}
+
+/***************************************************************************************
+ * REACH INPUT
+ * 		Input for the next tick of g to walk its piece along path, n states long. 0xFF
+ * 		if the piece isn't on it anymore. Down is the joystick all the way, which
+ * 		drops the piece a row the tick after.
+ **************************************************************************************/
+unsigned char reachInput(const Game *g, const uint16_t *path, unsigned int n) {
+	unsigned int rotations = distinctRotations[g->piece - 1];
+	unsigned int s = REACH_STATE(g->rotation % rotations, g->yPos, g->xPos);
+	unsigned int i;
+	unsigned int next;
+
+	for (i = 0; i < n && path[i] != s; i++)
+		;
+	if (i == n)
+		return 0xFF;
+	if (g->keys)
+		return 0;										// last press hasn't been used yet
+	if (i == n - 1)
+		return 3 << IN_STICK_SHIFT;
+	next = path[i + 1];
+	if (REACH_ROT(next) != REACH_ROT(s))
+		return IN_ROTATE;
+	if (REACH_X(next) < REACH_X(s))
+		return IN_LEFT;
+	if (REACH_X(next) > REACH_X(s))
+		return IN_RIGHT;
+	return 3 << IN_STICK_SHIFT;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************************
+ * REACH
+ * 		Every place a piece can come to rest from where it is now, by the engine's own
+ * 		moves: left, right, rotate and down, each only if fits says so, so it finds the
+ * 		tucks under overhangs and the spins into slots that dropping straight down
+ * 		from a column misses. A breadth first search over (rotation, row, column), so
+ * 		the path it keeps to each rest is one of the shortest.
+ *
+ * 		Gravity isn't in it, it assumes there is always time for the next move before
+ * 		the next drop. That holds up to level 19, where a row still takes 5 ticks and
+ * 		a move one. A walker that finds the piece somewhere off its path just asks
+ * 		again from there.
+ *
+ * 		Rotations that look the same are one state (an I turned twice is the same I),
+ * 		so every rest found is a different set of cells. Fixed size, no allocation,
+ * 		a few microseconds a piece.
+ **************************************************************************************/
+#ifndef REACH_H
+#define REACH_H
+
+#include "../engine.h"
+
+#define REACH_STATES	(4 * 14 * 10)		// rotation, row, column
+#define REACH_STATE(r, y, x)	(((r) * 14 + (y)) * 10 + (x))
+#define REACH_X(s)		((s) % 10)
+#define REACH_Y(s)		((s) / 10 % 14)
+#define REACH_ROT(s)	((s) / 140)
+
+// Moves
+#define MOVE_LEFT			0
+#define MOVE_RIGHT		1
+#define MOVE_ROTATE		2
+#define MOVE_DOWN			3
+#define MOVE_NONE			4					// the state the search started from
+
+typedef struct {
+	uint64_t seen[(REACH_STATES + 63) / 64];
+	uint8_t via[REACH_STATES];				// move into each seen state
+	uint16_t queue[REACH_STATES];
+	uint16_t rests[REACH_STATES];				// states the piece can lock in, count of them
+	unsigned int count;
+	unsigned int piece;
+	unsigned int rotations;						// distinct ones of piece
+} Reach;
+
+unsigned int reachFind(Reach *, const uint16_t *, unsigned int, unsigned int, int, int);
+bool reachSeen(const Reach *, unsigned int);
+unsigned int reachPath(const Reach *, unsigned int, uint16_t *);
+unsigned char reachInput(const Game *, const uint16_t *, unsigned int);
+
+#endif
@@ -0,0 +1,491 @@
+/***************************************************************************************
+ * RENDER
+ * 		Turns a replay into video, frame for frame what the unit's screen showed. The
+ * 		drawing is draw.c's, the same code the firmware runs, into an emulated panel.
+ *
+ * 		build/render [-j threads] [-e every] replay out
+ * 				out is a .y4m file or - for a Y4M stream on stdout, or a pattern with one %d
+ * 				like frames/%06d.ppm for one PPM a frame. A frame every 'every' 10 ms
+ * 				ticks, 4 (25 fps) if not given.
+ *
+ * 		The screen after a tick depends on everything drawn before it, locked blocks
+ * 		keep the color of the piece they came from and the score dots the color of
+ * 		the level they were cleared on, none of which is in a Game. So a first pass
+ * 		plays the whole replay with no drawing, just the grid colors and the score
+ * 		and level draws, and every SEGMENT_FRAMES frames keeps a keyframe of it all.
+ * 		That's about as quick as the engine. Then threads take a segment each, draw
+ * 		the screen whole from its keyframe and run on from there. The unit draws
+ * 		every cell over in full, so the redraw comes out the same as the unit's
+ * 		screen at that tick.
+ *
+ * 		Segments come back in any order and go out in order. Only SLOTS segments
+ * 		a thread are ever in flight, so memory stays the same for any length game.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "../replay.h"
+#include "../draw.h"
+#include "device.h"
+#include "lcd.h"
+
+#define SEGMENT_FRAMES	32			// frames between keyframes
+#define SLOTS						2				// segments in flight a thread
+#define MAX_THREADS			256
+
+// one draw to the strip along the top, in the order the unit did them
+typedef struct {
+	int line;										// drawScore line, -1 for fillLevelColor
+	unsigned int color;
+} StripDraw;
+
+typedef struct {
+	Device d;										// as it was after tick start
+	unsigned long start;
+	unsigned long frames;
+} Segment;
+
+typedef struct {
+	pthread_t thread;
+	Lcd lcd;
+} Worker;
+
+StripDraw *strip;									// the whole game's, from the first pass
+unsigned long stripSize;
+unsigned long stripRoom;
+Segment *segments;
+unsigned long segmentCount;
+unsigned long every = 4;
+unsigned long lastTick;							// device tick of the last frame
+bool ppm;
+size_t frameBytes;
+uint32_t rgb[65536];								// RGB565 to 0x00RRGGBB
+unsigned char luma[65536];					// and to Y, U and V parts x256, for Y4M
+short blue[65536];
+short red[65536];
+
+// the pipeline
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ready = PTHREAD_COND_INITIALIZER;	// a segment is finished
+pthread_cond_t freed = PTHREAD_COND_INITIALIZER;	// a segment was written out
+unsigned long nextSegment;					// first one no thread has taken
+unsigned long written;							// segments out so far
+unsigned char **slots;
+unsigned long *slotDone;						// segment + 1 once it's in the slot
+unsigned long slotCount;
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * FRAME NAME
+ * 		A PPM's name, pattern with its one %d (or %06d and the like) as frame and %%
+ * 		a %. False if there isn't exactly one, there's any other %, or it won't fit.
+ **************************************************************************************/
+bool frameName(char *name, size_t size, const char *pattern, unsigned long frame) {
+	const char *p;
+	size_t at = 0;
+	int numbers = 0;
+	int width;
+	int n;
+	bool zero;
+
+	for (p = pattern; *p; p++) {
+		if (*p == '%' && p[1] != '%') {
+			zero = *++p == '0';
+			for (width = 0; *p >= '0' && *p <= '9' && width < 100; p++)
+				width = width * 10 + *p - '0';
+			if (*p != 'd' || numbers++)
+				return false;
+			n = snprintf(name + at, size - at, zero ? "%0*lu" : "%*lu", width, frame);
+		} else {
+			p += *p == '%';
+			n = snprintf(name + at, size - at, "%c", *p);
+		}
+		if (n < 0 || (size_t)n >= size - at)
+			return false;
+		at += n;
+	}
+	return numbers == 1;
+}
+
+/***************************************************************************************
+ * STRIP ADD
+ * 		First pass, keeps a score or level draw for the redraws
+ **************************************************************************************/
+void stripAdd(int line, unsigned int color) {
+	if (stripSize == stripRoom) {
+		stripRoom = stripRoom ? 2 * stripRoom : 64;
+		strip = realloc(strip, stripRoom * sizeof *strip);
+	}
+	strip[stripSize].line = line;
+	strip[stripSize].color = color;
+	stripSize++;
+}
+
+/***************************************************************************************
+ * DEVICE REDRAW
+ * 		Draws the whole screen for d. Only right between line clears and before the
+ * 		end, when every cell on the unit shows the grid or the piece.
+ **************************************************************************************/
+void deviceRedraw(const Device *d) {
+	unsigned int n;
+	int i;
+	int j;
+
+	initBackground();
+	for (n = 0; n < d->strip; n++) {
+		if (strip[n].line < 0)
+			fillLevelColor(strip[n].color);
+		else
+			drawScore(strip[n].line, strip[n].color);
+	}
+	for (i = 0; i < 14; i++)
+		for (j = 0; j < 10; j++)
+			drawSquare(SQUARE_X(j), SQUARE_Y(i), d->grid[i][j]);
+	if (d->g.pieceAlive)
+		paintPiece(SQUARE_X(d->g.xPos), SQUARE_Y(d->g.yPos), d->g.piece, d->g.rotation,
+				d->g.piece);
+}
+
+/***************************************************************************************
+ * IS FRAME
+ * 		A frame goes out after tick t
+ **************************************************************************************/
+bool isFrame(unsigned long t) {
+	return t % every == 0 || t == lastTick;
+}
+
+/***************************************************************************************
+ * KEYFRAMES
+ * 		First pass. Plays the replay through without drawing, cutting it into segments
+ * 		where deviceRedraw can start one. -1 if the replay is bad.
+ **************************************************************************************/
+int keyframes(const unsigned char *data, size_t length) {
+	Device d;
+	unsigned long size = 0;
+	unsigned long next = 0;
+	unsigned long s;
+	unsigned long t;
+
+	if (deviceStart(&d, data, length, false))
+		return -1;
+	for (;;) {
+		if (d.tick >= next && d.clearRow < 0 && !d.over) {
+			if (segmentCount == size) {
+				size = size ? 2 * size : 64;
+				segments = realloc(segments, size * sizeof *segments);
+			}
+			segments[segmentCount].d = d;
+			segments[segmentCount].start = d.tick;
+			segmentCount++;
+			next = d.tick + SEGMENT_FRAMES * every;
+		}
+		if (d.over && d.clearRow < 0)
+			break;
+		if (deviceTick(&d, false))
+			return -1;
+	}
+
+	// the last tick that changed anything, the one that found the end didn't
+	lastTick = d.g.gameAlive ? d.tick - 1 : d.tick;
+	for (s = 0; s < segmentCount; s++) {
+		segments[s].frames = 0;
+		for (t = segments[s].start; t <= lastTick &&
+				(s + 1 == segmentCount || t < segments[s + 1].start); t++)
+			if (isFrame(t))
+				segments[s].frames++;
+	}
+	return 0;
+}
+
+/***************************************************************************************
+ * COLOR TABLES
+ * 		Every RGB565 color to 8 bit RGB, 5 and 6 bit channels with their top bits
+ * 		repeated in the bottom, and to BT.601 studio range Y, U and V
+ **************************************************************************************/
+void colorTables(void) {
+	unsigned int c;
+	int r;
+	int g;
+	int b;
+
+	for (c = 0; c < 65536; c++) {
+		r = (c >> 11) << 3 | c >> 13;
+		g = (c >> 5 & 0x3F) << 2 | (c >> 9 & 3);
+		b = (c & 0x1F) << 3 | (c >> 2 & 7);
+		rgb[c] = r << 16 | g << 8 | b;
+		luma[c] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+		blue[c] = -38 * r - 74 * g + 112 * b;
+		red[c] = 112 * r - 94 * g - 18 * b;
+	}
+}
+
+/***************************************************************************************
+ * FRAME OUT
+ * 		The panel as a PPM or a Y4M frame, Y4M with chroma averaged over each 2x2
+ **************************************************************************************/
+void frameOut(const Lcd *l, unsigned char *out) {
+	const uint16_t *p;
+	const uint16_t *q;
+	unsigned char *u;
+	unsigned char *v;
+	uint32_t c;
+	int x;
+	int y;
+
+	if (ppm) {
+		out += sprintf((char *)out, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+		for (y = 0; y < LCD_HEIGHT; y++)
+			for (p = lcdLine(l, y), x = 0; x < LCD_WIDTH; x++) {
+				c = rgb[p[x]];
+				*out++ = c >> 16;
+				*out++ = c >> 8;
+				*out++ = c;
+			}
+		return;
+	}
+
+	memcpy(out, "FRAME\n", 6);
+	out += 6;
+	for (y = 0; y < LCD_HEIGHT; y++)
+		for (p = lcdLine(l, y), x = 0; x < LCD_WIDTH; x++)
+			*out++ = luma[p[x]];
+	u = out;
+	v = out + LCD_WIDTH * LCD_HEIGHT / 4;
+	for (y = 0; y < LCD_HEIGHT; y += 2) {
+		p = lcdLine(l, y);
+		q = lcdLine(l, y + 1);
+		for (x = 0; x < LCD_WIDTH; x += 2) {
+			*u++ = ((blue[p[x]] + blue[p[x + 1]] + blue[q[x]] + blue[q[x + 1]] + 512) >> 10) + 128;
+			*v++ = ((red[p[x]] + red[p[x + 1]] + red[q[x]] + red[q[x + 1]] + 512) >> 10) + 128;
+		}
+	}
+}
+
+/***************************************************************************************
+ * RENDER SEGMENT
+ * 		Segment s's frames into out, on this thread's panel
+ **************************************************************************************/
+void renderSegment(unsigned long s, unsigned char *out) {
+	Device d = segments[s].d;
+	unsigned long end = s + 1 < segmentCount ? segments[s + 1].start : lastTick + 1;
+
+	deviceRedraw(&d);
+	for (;;) {
+		if (isFrame(d.tick) && d.tick <= lastTick) {
+			frameOut(lcd, out);
+			out += frameBytes;
+		}
+		if (d.tick + 1 >= end)
+			break;
+		deviceTick(&d, true);
+	}
+}
+
+/***************************************************************************************
+ * WORK
+ * 		Thread body, takes the next segment whenever a slot is free for it
+ **************************************************************************************/
+void *work(void *arg) {
+	Worker *w = arg;
+	unsigned long s;
+
+	lcd = &w->lcd;
+	lcdReset(lcd);
+	pthread_mutex_lock(&lock);
+	while (nextSegment < segmentCount) {
+		if (nextSegment >= written + slotCount) {
+			pthread_cond_wait(&freed, &lock);
+			continue;
+		}
+		s = nextSegment++;
+		pthread_mutex_unlock(&lock);
+		renderSegment(s, slots[s % slotCount]);
+		pthread_mutex_lock(&lock);
+		slotDone[s % slotCount] = s + 1;
+		pthread_cond_broadcast(&ready);
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/***************************************************************************************
+ * RENDER
+ * 		Replay at path out to out on threads threads
+ **************************************************************************************/
+int render(const char *path, const char *out, int threads) {
+	FILE *f = fopen(path, "rb");
+	FILE *o = NULL;
+	unsigned char *data;
+	unsigned long most = 0;
+	unsigned long frame = 0;
+	unsigned long long t0 = now();
+	unsigned long s;
+	unsigned long n;
+	Worker *workers;
+	char name[4096];
+	long length;
+	int failed = 0;
+	int i;
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	length = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (!(data = malloc(length > 0 ? length : 1))) {
+		fprintf(stderr, "%s: too big\n", path);
+		fclose(f);
+		return 1;
+	}
+	length = fread(data, 1, length > 0 ? length : 0, f);
+	fclose(f);
+
+	if (keyframes(data, length)) {
+		fprintf(stderr, "%s: not a replay for this build, or it doesn't play back\n", path);
+		free(data);
+		return 1;
+	}
+
+	if (!ppm) {
+		o = strcmp(out, "-") ? fopen(out, "wb") : stdout;
+		if (!o) {
+			perror(out);
+			free(data);
+			return 1;
+		}
+		fprintf(o, "YUV4MPEG2 W%d H%d F100:%lu Ip A1:1 C420jpeg\n", LCD_WIDTH, LCD_HEIGHT, every);
+	}
+
+	// every slot big enough for the longest segment
+	for (s = 0; s < segmentCount; s++)
+		if (segments[s].frames > most)
+			most = segments[s].frames;
+	slotCount = (unsigned long)threads * SLOTS;
+	slots = calloc(slotCount, sizeof *slots);
+	slotDone = calloc(slotCount, sizeof *slotDone);
+	workers = malloc(threads * sizeof *workers);
+	for (s = 0; slots && s < slotCount; s++)
+		if (!(slots[s] = malloc(most * frameBytes)))
+			break;
+	if (!slots || !slotDone || !workers || s < slotCount) {
+		fprintf(stderr, "render: no memory for %lu slots of %lu frames, try fewer -j\n",
+				slotCount, most);
+		threads = 0;
+		failed = 1;
+	}
+
+	for (i = 0; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, work, &workers[i]))
+			break;
+	threads = i;
+
+	// out in order as they come in
+	for (s = 0; s < segmentCount && !failed; s++) {
+		pthread_mutex_lock(&lock);
+		while (slotDone[s % slotCount] != s + 1)
+			pthread_cond_wait(&ready, &lock);
+		pthread_mutex_unlock(&lock);
+
+		for (n = 0; n < segments[s].frames && !failed; n++, frame++) {
+			if (ppm) {
+				if (!frameName(name, sizeof name, out, frame) || !(o = fopen(name, "wb"))) {
+					perror(name);
+					failed = 1;
+					break;
+				}
+			}
+			if (fwrite(slots[s % slotCount] + n * frameBytes, frameBytes, 1, o) != 1)
+				failed = 1;
+			if (ppm && fclose(o))
+				failed = 1;
+		}
+
+		pthread_mutex_lock(&lock);
+		written++;
+		pthread_cond_broadcast(&freed);
+		pthread_mutex_unlock(&lock);
+	}
+
+	// a failed write leaves the threads waiting on slots, let them go
+	pthread_mutex_lock(&lock);
+	written = segmentCount;
+	nextSegment = segmentCount;
+	pthread_cond_broadcast(&freed);
+	pthread_mutex_unlock(&lock);
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	if (!ppm && ((o == stdout ? fflush(o) : fclose(o)) || failed) && threads) {
+		perror(out);
+		failed = 1;
+	}
+	fprintf(stderr, "%s: %lu frames, %lu ticks, %lu segments, %d threads, %.3f s\n",
+			path, frame, lastTick, segmentCount, threads, (now() - t0) / 1e9);
+
+	for (s = 0; slots && s < slotCount; s++)
+		free(slots[s]);
+	free(slots);
+	free(slotDone);
+	free(workers);
+	free(segments);
+	free(strip);
+	free(data);
+	return failed;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	char name[4096];
+	int i;
+
+	for (i = 1; i < argc - 2; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc - 2)
+			threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-e") && i + 1 < argc - 2)
+			every = strtoul(argv[++i], NULL, 0);
+		else
+			break;
+	}
+	if (argc < 3 || i != argc - 2 || every == 0) {
+		fprintf(stderr, "usage: %s [-j threads] [-e every] replay out.y4m|-|pattern%%06d.ppm\n",
+				argv[0]);
+		return 2;
+	}
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	ppm = strchr(argv[argc - 1], '%') != NULL;
+	if ((!ppm && strcmp(argv[argc - 1], "-") && !strstr(argv[argc - 1], ".y4m")) ||
+			(ppm && !frameName(name, sizeof name, argv[argc - 1], 0))) {
+		fprintf(stderr, "render: out is a .y4m file, - or a pattern with one %%d for PPMs\n");
+		return 2;
+	}
+	frameBytes = ppm ? (size_t)snprintf(NULL, 0, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT) + LCD_WIDTH * LCD_HEIGHT * 3
+			: 6 + LCD_WIDTH * LCD_HEIGHT * 3 / 2;
+
+	colorTables();
+	deviceKeep = stripAdd;
+	return render(argv[argc - 2], argv[argc - 1], threads);
+}
@@ -0,0 +1,340 @@
+/***************************************************************************************
+ * REPLAY TOOL
+ * 		Records bot or AI games to replay files and plays replay files back, checking they
+ * 		come out bit for bit the same as when they were recorded.
+ *
+ * 		build/replay record [-s seed] [-n games] [-t max ticks] [-k key ticks] [-a] out
+ * 				n > 1 writes out.0, out.1, ... with seeds seed, seed+1, ...
+ * 				-a plays the AI instead of the random bot, long games with real clears
+ * 				-k puts a keyframe in every key ticks, with an index at the end
+ * 		build/replay play file...
+ * 		build/replay seek file tick...
+ * 				the game after each tick, from the nearest keyframe and from the start
+ * 		build/replay check
+ * 				records AI games in memory with garbage coming up on and around keyframe
+ * 				ticks, then plays and seeks them, make check runs it
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../engine.h"
+#include "../replay.h"
+#include "bot.h"
+#include "ai.h"
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * LOAD
+ * 		Whole file into memory, NULL if it can't be read
+ **************************************************************************************/
+unsigned char *load(const char *path, size_t *length) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+	long n;
+
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(n > 0 ? n : 1);
+	*length = fread(data, 1, n > 0 ? n : 0, f);
+	fclose(f);
+	return data;
+}
+
+/***************************************************************************************
+ * PUT FILE
+ * 		Recorder sink, straight into a FILE
+ **************************************************************************************/
+void putFile(void *context, unsigned char byte) {
+	putc(byte, (FILE *)context);
+}
+
+/***************************************************************************************
+ * RECORD
+ * 		Plays one bot or AI game while recording it to path
+ **************************************************************************************/
+int record(const char *path, unsigned int seed, unsigned long maxTicks, uint32_t keyEvery,
+		bool useAi) {
+	FILE *f = fopen(path, "wb");
+	uint32_t *index = NULL;
+	unsigned int indexSize = 0;
+	Recorder r;
+	Game g;
+	Bot bot;
+	Ai ai;
+	unsigned char ge = 0;
+	unsigned char in;
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	botSeed(&bot, seed);
+	aiStart(&ai, NULL);
+	gameReset(&g, seed);
+	recordStart(&r, putFile, f, seed);
+	if (keyEvery) {
+		indexSize = maxTicks / keyEvery + 1;
+		index = malloc(indexSize * 2 * sizeof *index);
+		recordKeyframes(&r, keyEvery, index, index ? indexSize : 0);
+	}
+	while (g.gameAlive && g.tick < maxTicks) {
+		in = useAi ? aiInput(&ai, &g, ge) : botInput(&bot, &g, ge);
+		recordTick(&r, &g, in);
+		ge = gameTick(&g, in);
+	}
+	recordEnd(&r, &g);
+	free(index);
+	if (fclose(f)) {
+		perror(path);
+		return 1;
+	}
+	printf("%s: seed %u, %lu ticks, %u lines, %u keyframes, %lu bytes\n", path, seed,
+			(unsigned long)g.tick, g.totalLines, r.keys, r.bytes);
+	return 0;
+}
+
+/***************************************************************************************
+ * PLAY
+ * 		Plays path back to the end. 0 if it matched.
+ **************************************************************************************/
+int play(const char *path) {
+	size_t length;
+	unsigned char *data = load(path, &length);
+	unsigned long pieces = 0;
+	int ge;
+	Player p;
+	Game g;
+
+	if (!data)
+		return 1;
+	if (replayOpen(&p, data, length, &g)) {
+		printf("%s: not a replay for this build\n", path);
+		free(data);
+		return 1;
+	}
+	while ((ge = replayStep(&p, &g)) >= 0)
+		if (ge & GE_SPAWN)
+			pieces++;
+	printf("%s: %s, %lu ticks, %lu pieces, %u lines, level %u, %lu bytes\n", path,
+			ge == REPLAY_DONE ? "ok" : "MISMATCH", (unsigned long)g.tick, pieces,
+			g.totalLines, g.level, (unsigned long)length);
+	free(data);
+	return ge == REPLAY_DONE ? 0 : 1;
+}
+
+/***************************************************************************************
+ * SEEK
+ * 		Seeks path to tick and checks it against playing there from the first tick.
+ * 		0 if they agree.
+ **************************************************************************************/
+int seek(const char *path, uint32_t tick) {
+	size_t length;
+	unsigned char *data = load(path, &length);
+	unsigned long long t0;
+	unsigned long long seekNs;
+	unsigned long long linearNs;
+	int fast;
+	int slow = 0;
+	Player p;
+	Game g;
+	Game h;
+
+	if (!data)
+		return 1;
+	if (replayOpen(&p, data, length, &g)) {
+		printf("%s: not a replay for this build\n", path);
+		free(data);
+		return 1;
+	}
+	t0 = now();
+	fast = replaySeek(&p, &g, tick);
+	seekNs = now() - t0;
+
+	t0 = now();
+	replayOpen(&p, data, length, &h);
+	while (h.tick < tick && (slow = replayStep(&p, &h)) >= 0);
+	linearNs = now() - t0;
+
+	printf("%s: tick %lu, %s at %lu, %u lines, level %u, hash %08lx, "
+			"seek %.1f us, from start %.1f us\n", path, (unsigned long)tick,
+			fast == REPLAY_BAD ? "BAD" : gameHash(&g) == gameHash(&h) ? "ok" : "MISMATCH",
+			(unsigned long)g.tick, g.totalLines, g.level, (unsigned long)gameHash(&g),
+			seekNs / 1e3, linearNs / 1e3);
+	free(data);
+	return fast == REPLAY_BAD || slow == REPLAY_BAD || gameHash(&g) != gameHash(&h);
+}
+
+/***************************************************************************************
+ * CHECK
+ * 		Garbage on a keyframe tick has to be in the keyframe and come out the same from
+ * 		the start, from a seek with the index and from one without. Keyframes every
+ * 		CHECK_KEYS ticks, garbage due on every tick in CHECK_DUE, one game per due tick.
+ * 		0 if every game played back and every seek agreed.
+ **************************************************************************************/
+#define CHECK_KEYS		50
+#define CHECK_TICKS		600
+
+typedef struct {
+	unsigned char data[1 << 16];
+	size_t length;
+} Buffer;
+
+void putBuffer(void *context, unsigned char byte) {
+	Buffer *b = context;
+
+	if (b->length < sizeof b->data)
+		b->data[b->length++] = byte;
+}
+
+int check(void) {
+	static const uint32_t due[] = {50, 149, 150, 151, 200, 250, 401};
+	static Buffer b;
+	uint32_t index[2 * (CHECK_TICKS / CHECK_KEYS + 1)];
+	Garbage q[GARBAGE_QUEUE];
+	uint32_t tick;
+	uint32_t end;
+	size_t length;
+	unsigned int i;
+	unsigned char ge;
+	unsigned char in;
+	int played;
+	int failed = 0;
+	Recorder r;
+	Player p;
+	Game g;
+	Game h;
+	Ai ai;
+
+	for (i = 0; i < sizeof due / sizeof *due; i++) {
+		memset(q, 0, sizeof q);
+		q[0].tick = due[i];
+		q[0].rows = 2;
+		q[0].hole = i % 10;
+		q[1].tick = due[i] + CHECK_KEYS;
+		q[1].rows = 1;
+		q[1].hole = 9 - i % 10;
+
+		b.length = 0;
+		ge = 0;
+		aiStart(&ai, NULL);
+		gameReset(&g, i + 1);
+		recordStart(&r, putBuffer, &b, i + 1);
+		recordKeyframes(&r, CHECK_KEYS, index, sizeof index / sizeof *index / 2);
+		while (g.gameAlive && g.tick < CHECK_TICKS) {
+			dueGarbage(q, &g, true);
+			in = aiInput(&ai, &g, ge);
+			recordTick(&r, &g, in);
+			ge = gameTick(&g, in);
+		}
+		recordEnd(&r, &g);
+		end = g.tick;
+
+		// from the start, then seeks with the index and without (cut off after the end)
+		if (replayOpen(&p, b.data, b.length, &h))
+			played = REPLAY_BAD;
+		else
+			while ((played = replayStep(&p, &h)) >= 0);
+		if (played != REPLAY_DONE) {
+			printf("check: garbage at %lu, BAD at tick %lu playing from the start\n",
+					(unsigned long)due[i], (unsigned long)h.tick);
+			failed = 1;
+			continue;
+		}
+		length = b.length - 8 - 8 * (r.keys < sizeof index / sizeof *index / 2 ? r.keys :
+				sizeof index / sizeof *index / 2);
+		for (tick = due[i] - 2; tick <= due[i] + CHECK_KEYS + 1 && tick < end; tick++) {
+			replayOpen(&p, b.data, b.length, &h);
+			while (h.tick < tick && replayStep(&p, &h) >= 0);
+			replayOpen(&p, b.data, b.length, &g);
+			if (replaySeek(&p, &g, tick) < 0 || gameHash(&g) != gameHash(&h)) {
+				printf("check: garbage at %lu, seek to %lu with the index came out different\n",
+						(unsigned long)due[i], (unsigned long)tick);
+				failed = 1;
+			}
+			replayOpen(&p, b.data, length, &g);
+			if (replaySeek(&p, &g, tick) < 0 || gameHash(&g) != gameHash(&h)) {
+				printf("check: garbage at %lu, seek to %lu without it came out different\n",
+						(unsigned long)due[i], (unsigned long)tick);
+				failed = 1;
+			}
+		}
+	}
+	printf("check: %s, %u games with keyframes every %d ticks\n", failed ? "FAILED" : "ok",
+			i, CHECK_KEYS);
+	return failed;
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned int seed = 1;
+	unsigned long games = 1;
+	unsigned long maxTicks = 1000000;
+	unsigned long keyEvery = 0;
+	unsigned long n;
+	bool useAi = false;
+	char path[4096];
+	int failed = 0;
+	int i = 2;
+
+	if (argc > 2 && !strcmp(argv[1], "record")) {
+		for (; i < argc - 1; i++) {
+			if (!strcmp(argv[i], "-s") && i + 1 < argc - 1)
+				seed = strtoul(argv[++i], NULL, 0);
+			else if (!strcmp(argv[i], "-n") && i + 1 < argc - 1)
+				games = strtoul(argv[++i], NULL, 0);
+			else if (!strcmp(argv[i], "-t") && i + 1 < argc - 1)
+				maxTicks = strtoul(argv[++i], NULL, 0);
+			else if (!strcmp(argv[i], "-k") && i + 1 < argc - 1)
+				keyEvery = strtoul(argv[++i], NULL, 0);
+			else if (!strcmp(argv[i], "-a"))
+				useAi = true;
+			else
+				break;
+		}
+		if (i == argc - 1) {
+			for (n = 0; n < games; n++) {
+				if (games == 1)
+					snprintf(path, sizeof path, "%s", argv[i]);
+				else
+					snprintf(path, sizeof path, "%s.%lu", argv[i], n);
+				failed |= record(path, seed + n, maxTicks, keyEvery, useAi);
+			}
+			return failed;
+		}
+	} else if (argc > 2 && !strcmp(argv[1], "play")) {
+		for (; i < argc; i++)
+			failed |= play(argv[i]);
+		return failed;
+	} else if (argc == 2 && !strcmp(argv[1], "check")) {
+		return check();
+	} else if (argc > 3 && !strcmp(argv[1], "seek")) {
+		for (i = 3; i < argc; i++)
+			failed |= seek(argv[2], strtoul(argv[i], NULL, 0));
+		return failed;
+	}
+
+	fprintf(stderr, "usage: %s record [-s seed] [-n games] [-t max ticks] [-k key ticks] [-a] out\n"
+			"       %s play file...\n"
+			"       %s seek file tick...\n"
+			"       %s check\n", argv[0], argv[0], argv[0], argv[0]);
+	return 2;
+}
@@ -0,0 +1,321 @@
+/***************************************************************************************
+ * SEARCH
+ * 		See search.h
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "search.h"
+
+#define MAX_WALK		10000			// ticks, a piece that isn't down by now never will be
+#define PLACEMENTS	34				// most a piece has, T, J and L
+#define DEAD				(-2000000000)	// score of a game the placement ended
+
+// A board the search got to
+typedef struct {
+	Game game;									// just after the piece that made it spawned
+	int score;
+	unsigned int order;					// parent's place in the beam, then which placement,
+															// so ties go the same way on any thread count
+	unsigned char rotation;			// first move on the way here
+	unsigned char column;
+} Node;
+
+typedef struct {
+	pthread_t thread;
+	Search *search;
+	Node *arena;								// this move's nodes
+	unsigned int used;
+	unsigned int size;
+	unsigned int plyStart;			// first node of this ply in arena
+	unsigned int next;					// next beam node of its share nobody has taken
+	unsigned int end;
+} __attribute__((aligned(64))) Worker;
+
+struct Search {
+	Worker *workers;
+	int threads;
+	int plies;
+	int width;
+	unsigned long long budget;	// ns a plan, 0 for none
+	unsigned long long deadline;
+	pthread_barrier_t start;		// a ply is ready to expand
+	pthread_barrier_t done;			// and it has been
+	bool ready;									// every thread is up and the barriers are set
+	bool failed;								// or not, go home
+	bool quit;
+	bool late;									// the ply ran out of time
+	const AiWeights *weights;
+	unsigned int rootLines;
+	Node root;
+	Node **beam;
+	unsigned int beamSize;
+	Node **pool;								// every node of a ply, to pick the beam from
+};
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+static unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * EXPAND
+ * 		Every placement of n's next piece into w's arena. false if time ran out.
+ **************************************************************************************/
+static bool expand(Search *s, Worker *w, unsigned int parent, bool timed) {
+	const Node *n = s->beam[parent];
+	const unsigned char *shape;
+	uint16_t boards[PLACEMENTS][14];
+	Features features[PLACEMENTS];
+	Node *scored[PLACEMENTS];
+	unsigned int count = 0;
+	bool late = false;
+	unsigned int i;
+	unsigned int piece = n->game.piece;
+	unsigned int r;
+	unsigned int width;
+	unsigned int x;
+	unsigned int placement = 0;
+	unsigned char ge;
+	Node *c;
+	int t;
+
+	for (r = 0; r < distinctRotations[piece - 1] && !late; r++) {
+		shape = shapes[piece - 1][r];
+		width = 32 - __builtin_clz(shape[0] | shape[1] | shape[2] | shape[3]);
+		for (x = 0; x + width <= 10; x++) {
+			if (timed && s->budget && now() > s->deadline) {
+				late = true;
+				break;
+			}
+			c = &w->arena[w->used++];
+			c->game = n->game;
+			c->order = parent * PLACEMENTS + placement++;
+			c->rotation = n == &s->root ? r : n->rotation;
+			c->column = n == &s->root ? x : n->column;
+
+			// play it out to the next spawn, as the AI will
+			for (t = 0, ge = 0; t < MAX_WALK && !(ge & (GE_SPAWN | GE_OVER)); t++)
+				ge = gameTick(&c->game, aiWalk(&c->game, r, x));
+			if (!(ge & GE_SPAWN) || (ge & GE_OVER)) {
+				c->score = DEAD;
+				continue;
+			}
+			memcpy(boards[count], c->game.rows, sizeof boards[count]);
+			scored[count++] = c;
+		}
+	}
+
+	// the placement's full rows are gone already, lines are the ones it cleared
+	featuresBatch((const uint16_t (*)[14])boards, count, features);
+	for (i = 0; i < count; i++)
+		scored[i]->score = aiWeigh(s->weights, &features[i],
+				scored[i]->game.totalLines - s->rootLines);
+	return !late;
+}
+
+/***************************************************************************************
+ * EXPAND PLY
+ * 		One thread's part of a ply, its own share of the beam then anyone's
+ **************************************************************************************/
+static void expandPly(Search *s, Worker *w, bool timed) {
+	Worker *v;
+	unsigned int n;
+	int i;
+
+	w->plyStart = w->used;
+	for (i = 0; i < s->threads && !__atomic_load_n(&s->late, __ATOMIC_RELAXED); ) {
+		v = &s->workers[(w - s->workers + i) % s->threads];
+		if ((n = __atomic_fetch_add(&v->next, 1, __ATOMIC_RELAXED)) >= v->end) {
+			i++;											// share's gone, try the next thread's
+			continue;
+		}
+		if (!expand(s, w, n, timed))
+			__atomic_store_n(&s->late, true, __ATOMIC_RELAXED);
+	}
+}
+
+/***************************************************************************************
+ * WORK
+ * 		Thread body for all but the first thread, which is whoever plans
+ **************************************************************************************/
+static void *work(void *arg) {
+	Worker *w = arg;
+	Search *s = w->search;
+
+	while (!__atomic_load_n(&s->ready, __ATOMIC_ACQUIRE))
+		sched_yield();
+	if (s->failed)
+		return NULL;
+	for (;;) {
+		pthread_barrier_wait(&s->start);
+		if (s->quit)
+			return NULL;
+		expandPly(s, w, true);
+		pthread_barrier_wait(&s->done);
+	}
+}
+
+/***************************************************************************************
+ * BY SCORE
+ * 		qsort order for the beam, best first
+ **************************************************************************************/
+static int byScore(const void *a, const void *b) {
+	const Node *na = *(Node *const *)a;
+	const Node *nb = *(Node *const *)b;
+
+	if (na->score != nb->score)
+		return na->score < nb->score ? 1 : -1;
+	return na->order < nb->order ? -1 : na->order > nb->order;
+}
+
+/***************************************************************************************
+ * SEARCH NEW
+ * 		threads to search with, looking plies pieces ahead, keeping the best width
+ * 		boards a ply, budget microseconds a plan (0 for no limit, the same plan every
+ * 		time). NULL if it can't start.
+ **************************************************************************************/
+Search *searchNew(int threads, int plies, int width, unsigned long budget) {
+	Search *s = calloc(1, sizeof *s);
+	unsigned int nodes = (1 + (unsigned int)width * (plies - 1)) * PLACEMENTS;
+	int i;
+
+	if (!s || threads < 1 || plies < 1 || width < 1) {
+		free(s);
+		return NULL;
+	}
+	s->plies = plies;
+	s->width = width;
+	s->budget = budget * 1000ULL;
+	s->beam = malloc(width * sizeof *s->beam);
+	s->pool = malloc((size_t)width * PLACEMENTS * sizeof *s->pool);
+	if (posix_memalign((void **)&s->workers, 64, threads * sizeof *s->workers) || !s->beam ||
+			!s->pool) {
+		free(s->beam);
+		free(s->pool);
+		free(s);
+		return NULL;
+	}
+	memset(s->workers, 0, threads * sizeof *s->workers);
+	for (i = 0; i < threads; i++) {
+		s->workers[i].search = s;
+		s->workers[i].size = nodes;
+		s->workers[i].arena = malloc(nodes * sizeof *s->workers[i].arena);
+		s->failed |= !s->workers[i].arena;
+	}
+	for (s->threads = 1; s->threads < threads && !s->failed; s->threads++)
+		if (pthread_create(&s->workers[s->threads].thread, NULL, work, &s->workers[s->threads])) {
+			s->failed = true;
+			break;
+		}
+	if (!s->failed) {
+		pthread_barrier_init(&s->start, NULL, threads);
+		pthread_barrier_init(&s->done, NULL, threads);
+	}
+	__atomic_store_n(&s->ready, true, __ATOMIC_RELEASE);
+	if (s->failed) {
+		searchFree(s);
+		return NULL;
+	}
+	return s;
+}
+
+/***************************************************************************************
+ * SEARCH FREE
+ **************************************************************************************/
+void searchFree(Search *s) {
+	int i;
+
+	if (!s)
+		return;
+	s->quit = true;
+	if (!s->failed && s->threads > 1)
+		pthread_barrier_wait(&s->start);
+	for (i = 1; i < s->threads; i++)
+		pthread_join(s->workers[i].thread, NULL);
+	if (!s->failed) {
+		pthread_barrier_destroy(&s->start);
+		pthread_barrier_destroy(&s->done);
+	}
+	for (i = 0; i < s->threads; i++)
+		free(s->workers[i].arena);
+	free(s->workers);
+	free(s->beam);
+	free(s->pool);
+	free(s);
+}
+
+/***************************************************************************************
+ * SEARCH PLAN
+ * 		Planner for Ai, context is the Search. Puts the move in a and returns its
+ * 		score, the best board's score, aiPlan's answer if every placement ends the
+ * 		game.
+ **************************************************************************************/
+int searchPlan(void *context, Ai *a, const Game *g) {
+	Search *s = context;
+	Node *best = NULL;
+	unsigned int pooled;
+	unsigned int n;
+	int ply;
+	int i;
+
+	s->deadline = now() + s->budget;
+	s->weights = &a->weights;
+	s->rootLines = g->totalLines;
+	s->root.game = *g;
+	s->beam[0] = &s->root;
+	s->beamSize = 1;
+	for (i = 0; i < s->threads; i++)
+		s->workers[i].used = s->workers[i].plyStart = 0;
+	a->plans++;
+
+	for (ply = 1; ply <= s->plies && s->beamSize; ply++) {
+		// share the beam out, then everyone expands
+		for (i = 0; i < s->threads; i++) {
+			s->workers[i].next = s->beamSize * i / s->threads;
+			s->workers[i].end = s->beamSize * (i + 1) / s->threads;
+		}
+		s->late = false;
+		if (ply == 1) {
+			expandPly(s, &s->workers[0], false);
+		} else {
+			if (s->threads > 1)
+				pthread_barrier_wait(&s->start);
+			expandPly(s, &s->workers[0], true);
+			if (s->threads > 1)
+				pthread_barrier_wait(&s->done);
+			if (s->late)
+				break;									// best of the last ply stands
+		}
+
+		// the best width of everything this ply found go on
+		pooled = 0;
+		for (i = 0; i < s->threads; i++)
+			for (n = s->workers[i].plyStart; n < s->workers[i].used; n++)
+				if (s->workers[i].arena[n].score != DEAD)
+					s->pool[pooled++] = &s->workers[i].arena[n];
+		for (i = 0; i < s->threads; i++)
+			a->placements += s->workers[i].used - s->workers[i].plyStart;
+		qsort(s->pool, pooled, sizeof *s->pool, byScore);
+		s->beamSize = pooled < (unsigned int)s->width ? pooled : (unsigned int)s->width;
+		memcpy(s->beam, s->pool, s->beamSize * sizeof *s->beam);
+		if (pooled)
+			best = s->pool[0];
+	}
+
+	if (!best)
+		return aiPlan(a, g);
+	a->rotation = best->rotation;
+	a->column = best->column;
+	a->score = best->score;
+	return a->score;
+}
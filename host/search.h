@@ -0,0 +1,31 @@
+/***************************************************************************************
+ * SEARCH
+ * 		Lookahead for the AI, a planner it can use instead of aiPlan. The game has no
+ * 		preview, the next piece comes out of keyPress, which the presses walking this
+ * 		piece and the drops on the way change. So the search plays each placement out
+ * 		on a copy of the game with aiWalk, the same inputs the AI will really give,
+ * 		and the copy's next piece is the one that will really come.
+ *
+ * 		Beam search: every placement of the piece in play, the best width of those
+ * 		boards each get every placement of the piece after, the best width of all of
+ * 		those go on, and so on for plies. The move is the first one on the way to the
+ * 		best board of the deepest ply it finished.
+ *
+ * 		A ply's boards are shared out across the threads, each takes from its own
+ * 		share first and then from the others'. Nodes come from an arena per thread,
+ * 		emptied every move. The first ply always finishes, about as long as aiPlan,
+ * 		and a later one that runs past the budget is dropped, so a plan never takes
+ * 		much over budget. More cores, more plies inside the budget.
+ **************************************************************************************/
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "ai.h"
+
+typedef struct Search Search;
+
+Search *searchNew(int, int, int, unsigned long);
+void searchFree(Search *);
+int searchPlan(void *, Ai *, const Game *);
+
+#endif
@@ -0,0 +1,913 @@
+/***************************************************************************************
+ * SERVER
+ * 		Hosts a lot of games on one box, the device's own rules: remote players over
+ * 		local TCP or a Unix socket, and bots playing the AI in ai.c, all as sessions
+ * 		on one scheduler.
+ *
+ * 		build/server [-u path] [-p port] [-w path] [-b bots] [-j threads]
+ * 				[-m max sessions] [-t seconds]
+ *
+ * 		Players talk link.h frames, the same as the other unit does in versus. HELLO
+ * 		with a seed starts a game, INPUT asks for a press (and joystick zone) on a
+ * 		tick, BYE quits. The server runs the game in real time, 100 ticks a second,
+ * 		and answers like a unit would: INPUT for every tick it applied something,
+ * 		with the tick it went in on (the asked one, or the next if that's gone by),
+ * 		SYNC (with the game's hash bits) when it's been quiet LINK_SYNC_TICKS, BYE at
+ * 		game over. A client that plays the echoes into its own Game from the seed has
+ * 		the server's game.
+ *
+ * 		Sessions are tasks. A timer thread turns a timer wheel of 1 ms slots and
+ * 		hands each ms's due sessions to their home thread's ring. A thread runs its
+ * 		ring a batch at a time, and with nothing left steals half of someone else's.
+ * 		A session runs one tick and goes back on the wheel 10 ms after it was due,
+ * 		put back a batch at a time. Jitter is how late a tick starts against when it
+ * 		was due.
+ *
+ * 		Sockets are non-blocking. One IO thread waits on epoll, edge triggered, and
+ * 		takes up to IO_EVENTS readies a call. It accepts, and for a ready session
+ * 		only sets a flag, the session reads everything waiting on its next tick and
+ * 		writes everything it has once at the end of it. Runs until -t seconds are up
+ * 		or a signal, then prints what it saw.
+ *
+ * 		Anyone can watch a session on the -w socket: connect, send its number (2
+ * 		bytes, low first, bots are 0 up) and read spectate.h updates from the next
+ * 		keyframe on. The session's own tick encodes them and fans them out.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../engine.h"
+#include "../link.h"
+#include "ai.h"
+#include "spectate.h"
+
+#define TICK_MS				10				// same as the unit
+#define WHEEL_SLOTS		64				// 1 ms each, more than a tick ahead
+#define BATCH					32				// sessions a thread takes off its ring at once
+#define MAX_THREADS		64
+#define IO_EVENTS			512
+#define INPUT_QUEUE		16				// asked for presses not yet applied
+#define OUT_BYTES			512				// a client this far behind reading is dropped
+#define QUIET_TICKS		1000			// to say HELLO, or to take the last frames
+#define JITTER_US			10				// histogram bucket
+#define JITTER_BUCKETS	10000			// last one is 100 ms or later
+#define LISTENERS			3				// Unix, TCP, watchers
+#define WATCHING			1024			// watchers yet to say what they're watching
+
+typedef struct Session Session;
+
+struct Session {
+	Session *next;							// on the wheel, a dispatch chain or the free list
+	uint64_t due;								// ms since start of its next tick
+	int home;										// thread whose ring it goes on
+	int fd;											// -1 for a bot
+	int readable;								// the IO thread saw data, atomic
+	Ai *ai;											// bots only
+	SpecStream *watch;					// whoever's watching
+	Game game;
+	unsigned char ge;						// last tick's events, for the AI
+	unsigned int seed;
+	bool playing;								// HELLO came in
+	bool closing;								// BYE either way, close once written
+	unsigned int waited;				// ticks waiting on the client
+	LinkDecoder decoder;
+	struct {
+		uint32_t tick;
+		uint8_t payload;
+	} inputs[INPUT_QUEUE];
+	unsigned int inputHead;
+	unsigned int inputCount;
+	uint8_t stick;							// zone in the last input, held until the next
+	uint32_t lastSent;					// tick of the last frame out
+	unsigned int outLength;
+	unsigned char out[OUT_BYTES];
+};
+
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	Session **ring;							// due sessions, capacity maxSessions
+	unsigned int head;
+	unsigned int count;
+	Session *rearm;							// run this batch, back on the wheel after it
+	Session *rearmTail;
+	unsigned long long ticks;
+	unsigned long long steals;
+	unsigned long long games;
+	unsigned long long framesIn;
+	unsigned long long framesOut;
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	unsigned long long closed;
+	SpecStats spec;
+	uint32_t jitter[JITTER_BUCKETS];
+} Worker;
+
+// A watcher who hasn't sent its session number yet
+typedef struct {
+	int fd;											// -1 for a free slot
+	unsigned char have;
+	unsigned char id[2];
+} Watcher;
+
+Worker workers[MAX_THREADS];
+int threads;
+Session *sessions;
+unsigned int maxSessions = 16384;
+Session *freeSessions;
+unsigned int live;									// sessions in play, atomic
+unsigned long long accepted;
+pthread_mutex_t freeLock = PTHREAD_MUTEX_INITIALIZER;
+Session *wheel[WHEEL_SLOTS];
+uint64_t wheelTime;									// last ms dispatched
+pthread_mutex_t wheelLock = PTHREAD_MUTEX_INITIALIZER;
+unsigned long long start;
+int epfd;
+int listeners[LISTENERS];
+Watcher watchers[WATCHING];					// IO thread's
+volatile sig_atomic_t stopping;
+int stop;														// atomic, workers and IO wind down
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void onSignal(int sig) {
+	(void)sig;
+	stopping = 1;
+}
+
+/***************************************************************************************
+ * REARM
+ * 		s goes back on the wheel after its batch
+ **************************************************************************************/
+void rearm(Worker *w, Session *s) {
+	s->next = NULL;
+	if (w->rearm)
+		w->rearmTail->next = s;
+	else
+		w->rearm = s;
+	w->rearmTail = s;
+}
+
+/***************************************************************************************
+ * WHEEL PUT
+ * 		A chain of sessions onto the wheel, one lock for the lot. A tick already gone
+ * 		by goes on the next ms, it runs late rather than twice.
+ **************************************************************************************/
+void wheelPut(Session *chain) {
+	Session *s;
+	unsigned int slot;
+
+	pthread_mutex_lock(&wheelLock);
+	while ((s = chain)) {
+		chain = s->next;
+		if (s->due <= wheelTime)
+			s->due = wheelTime + 1;
+		slot = s->due % WHEEL_SLOTS;
+		s->next = wheel[slot];
+		wheel[slot] = s;
+	}
+	pthread_mutex_unlock(&wheelLock);
+}
+
+void flushRearm(Worker *w) {
+	if (w->rearm) {
+		wheelPut(w->rearm);
+		w->rearm = w->rearmTail = NULL;
+	}
+}
+
+/***************************************************************************************
+ * SESSION NEW
+ * 		A session off the free list, starting on the wheel in the next few ms. NULL
+ * 		if we're full.
+ **************************************************************************************/
+Session *sessionNew(int fd) {
+	Session *s;
+	unsigned int n;
+
+	pthread_mutex_lock(&freeLock);
+	if ((s = freeSessions))
+		freeSessions = s->next;
+	pthread_mutex_unlock(&freeLock);
+	if (!s)
+		return NULL;
+
+	n = s - sessions;
+	s->home = n % threads;
+	s->fd = fd;
+	s->ai = NULL;
+	__atomic_store_n(&s->readable, 1, __ATOMIC_RELAXED);
+	s->ge = 0;
+	s->playing = false;
+	s->closing = false;
+	s->waited = 0;
+	s->decoder.have = 0;
+	s->inputHead = 0;
+	s->inputCount = 0;
+	s->stick = 0;
+	s->lastSent = 0;
+	s->outLength = 0;
+	s->game.gameAlive = false;
+	specOpen(s->watch);
+	__atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+
+	// spread sessions over the ms of a tick
+	pthread_mutex_lock(&wheelLock);
+	s->due = wheelTime + 1 + n % TICK_MS;
+	s->next = wheel[s->due % WHEEL_SLOTS];
+	wheel[s->due % WHEEL_SLOTS] = s;
+	pthread_mutex_unlock(&wheelLock);
+	return s;
+}
+
+/***************************************************************************************
+ * SESSION CLOSE
+ * 		Done with s. Its memory is never handed back, the IO thread may still have
+ * 		an event for it, which at worst costs a read that finds nothing.
+ **************************************************************************************/
+void sessionClose(Worker *w, Session *s) {
+	if (s->fd >= 0) {
+		close(s->fd);
+		w->closed++;
+	}
+	s->fd = -1;
+	specClose(s->watch);
+	__atomic_fetch_sub(&live, 1, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&freeLock);
+	s->next = freeSessions;
+	freeSessions = s;
+	pthread_mutex_unlock(&freeLock);
+}
+
+/***************************************************************************************
+ * SEND FRAME
+ **************************************************************************************/
+void sendFrame(Worker *w, Session *s, unsigned char kind, unsigned char payload, unsigned long t) {
+	if (s->outLength + LINK_FRAME > OUT_BYTES) {
+		s->closing = true;					// not reading, let it go
+		return;
+	}
+	linkEncode(s->out + s->outLength, kind, payload, t);
+	s->outLength += LINK_FRAME;
+	s->lastSent = t;
+	w->framesOut++;
+}
+
+/***************************************************************************************
+ * SESSION READ
+ * 		Everything waiting on s's socket, into its queue of asked for inputs. false
+ * 		if the client's gone.
+ **************************************************************************************/
+bool sessionRead(Worker *w, Session *s) {
+	unsigned char buf[256];
+	LinkFrame f;
+	unsigned long t;
+	unsigned int k;
+	ssize_t n;
+	ssize_t i;
+
+	if (!__atomic_exchange_n(&s->readable, 0, __ATOMIC_ACQUIRE))
+		return true;
+	for (;;) {
+		n = recv(s->fd, buf, sizeof buf, 0);
+		if (n == 0)
+			return false;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		w->bytesIn += n;
+		for (i = 0; i < n; i++) {
+			if (!linkDecode(&s->decoder, buf[i], &f))
+				continue;
+			w->framesIn++;
+			if (f.kind == LINK_HELLO) {
+				if (!s->playing) {
+					s->seed = f.tick;
+					gameReset(&s->game, s->seed);
+					s->playing = true;
+					sendFrame(w, s, LINK_HELLO, 0, s->seed);
+					s->lastSent = 0;
+				}
+			} else if (f.kind == LINK_BYE) {
+				s->closing = true;
+			} else if (f.kind == LINK_INPUT && s->playing && s->inputCount < INPUT_QUEUE) {
+				t = linkUnwrap(s->game.tick, f.tick);
+				k = (s->inputHead + s->inputCount++) % INPUT_QUEUE;
+				s->inputs[k].tick = t;
+				s->inputs[k].payload = f.payload;
+			}
+		}
+		if ((size_t)n < sizeof buf)
+			return true;
+	}
+}
+
+/***************************************************************************************
+ * SESSION WRITE
+ * 		What s has for its client, in one send if the socket takes it. false if the
+ * 		client's gone.
+ **************************************************************************************/
+bool sessionWrite(Worker *w, Session *s) {
+	ssize_t n = send(s->fd, s->out, s->outLength, MSG_NOSIGNAL);
+
+	if (n < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	w->bytesOut += n;
+	memmove(s->out, s->out + n, s->outLength - n);
+	s->outLength -= n;
+	return true;
+}
+
+/***************************************************************************************
+ * PLAYER TICK
+ * 		One tick of a client's game on whatever it asked for by now
+ **************************************************************************************/
+void playerTick(Worker *w, Session *s) {
+	uint32_t t = s->game.tick + 1;
+	unsigned char stick = s->stick;
+	unsigned char in = 0;
+	unsigned char p;
+
+	while (s->inputCount && s->inputs[s->inputHead].tick <= t) {
+		p = s->inputs[s->inputHead].payload;
+		in |= p & (IN_LEFT | IN_RIGHT | IN_ROTATE);
+		stick = (p & IN_STICK) >> IN_STICK_SHIFT;
+		s->inputHead = (s->inputHead + 1) % INPUT_QUEUE;
+		s->inputCount--;
+	}
+	in |= stick << IN_STICK_SHIFT;
+
+	s->ge = gameTick(&s->game, in);
+	if ((in & ~IN_STICK) || stick != s->stick)
+		sendFrame(w, s, LINK_INPUT, in, t);
+	else if (t - s->lastSent >= LINK_SYNC_TICKS)
+		sendFrame(w, s, LINK_SYNC, gameHash(&s->game) & LINK_HASH_MASK, t);
+	s->stick = stick;
+	if (s->ge & GE_OVER) {
+		sendFrame(w, s, LINK_BYE, 0, t);
+		s->closing = true;
+		w->games++;
+	}
+}
+
+/***************************************************************************************
+ * BOT TICK
+ * 		One tick of a bot, a new game when one ends
+ **************************************************************************************/
+void botTick(Worker *w, Session *s) {
+	s->ge = gameTick(&s->game, aiInput(s->ai, &s->game, s->ge));
+	if (s->ge & GE_OVER) {
+		w->games++;
+		gameReset(&s->game, ++s->seed);
+		s->ge = 0;
+	}
+}
+
+/***************************************************************************************
+ * RUN SESSION
+ * 		One tick of s, then back on the wheel unless it's done. Late is from when this
+ * 		one starts, not the batch, or the end of a batch reads on time.
+ **************************************************************************************/
+void runSession(Worker *w, Session *s) {
+	long long late = (long long)(now() - start) / 1000 - (long long)s->due * 1000;
+	unsigned long bucket = late < 0 ? 0 : late / JITTER_US;
+
+	w->jitter[bucket < JITTER_BUCKETS ? bucket : JITTER_BUCKETS - 1]++;
+	w->ticks++;
+	if (s->ai) {
+		botTick(w, s);
+		specTick(s->watch, &s->game, &w->spec);
+	} else {
+		if (!sessionRead(w, s)) {
+			sessionClose(w, s);
+			return;
+		}
+		if (s->playing && !s->closing) {
+			playerTick(w, s);
+			specTick(s->watch, &s->game, &w->spec);
+		} else if (!s->playing && ++s->waited > QUIET_TICKS)
+			s->closing = true;
+		if (s->outLength && !sessionWrite(w, s)) {
+			sessionClose(w, s);
+			return;
+		}
+		if (s->closing && (s->outLength == 0 || ++s->waited > QUIET_TICKS)) {
+			sessionClose(w, s);
+			return;
+		}
+	}
+	s->due += TICK_MS;
+	rearm(w, s);
+}
+
+/***************************************************************************************
+ * TAKE
+ * 		Up to BATCH due sessions off w's ring into batch, or with none there half of
+ * 		the first ring it finds with some
+ **************************************************************************************/
+unsigned int take(Worker *w, Session **batch) {
+	Worker *v;
+	unsigned int n;
+	unsigned int i;
+	int k;
+
+	pthread_mutex_lock(&w->lock);
+	n = w->count < BATCH ? w->count : BATCH;
+	for (i = 0; i < n; i++)
+		batch[i] = w->ring[(w->head + i) % maxSessions];
+	w->head = (w->head + n) % maxSessions;
+	w->count -= n;
+	pthread_mutex_unlock(&w->lock);
+	if (n)
+		return n;
+
+	for (k = 1; k < threads; k++) {
+		v = &workers[(w - workers + k) % threads];
+		pthread_mutex_lock(&v->lock);
+		n = (v->count + 1) / 2;
+		if (n > BATCH)
+			n = BATCH;
+		for (i = 0; i < n; i++)
+			batch[i] = v->ring[(v->head + v->count - n + i) % maxSessions];
+		v->count -= n;
+		pthread_mutex_unlock(&v->lock);
+		if (n) {
+			w->steals++;
+			return n;
+		}
+	}
+	return 0;
+}
+
+/***************************************************************************************
+ * WORK
+ **************************************************************************************/
+void *work(void *arg) {
+	Worker *w = arg;
+	Session *batch[BATCH];
+	unsigned int n;
+	unsigned int i;
+	bool done;
+
+	for (;;) {
+		if ((n = take(w, batch)) == 0) {
+			flushRearm(w);
+			pthread_mutex_lock(&w->lock);
+			while (w->count == 0 && !__atomic_load_n(&stop, __ATOMIC_RELAXED))
+				pthread_cond_wait(&w->wake, &w->lock);
+			done = w->count == 0;
+			pthread_mutex_unlock(&w->lock);
+			if (done)
+				return NULL;
+			continue;
+		}
+		for (i = 0; i < n; i++)
+			runSession(w, batch[i]);
+		flushRearm(w);
+	}
+}
+
+/***************************************************************************************
+ * TIMER
+ * 		Turns the wheel a ms at a time, each slot's sessions to their home rings
+ **************************************************************************************/
+void *timer(void *arg) {
+	Session *chains[MAX_THREADS];
+	Session *s;
+	Worker *w;
+	struct timespec ts;
+	unsigned long long next = start;
+	uint64_t ms;
+	int i;
+
+	(void)arg;
+	while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+		next += 1000000;
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		ms = (now() - start) / 1000000;
+
+		memset(chains, 0, sizeof chains);
+		pthread_mutex_lock(&wheelLock);
+		for (; wheelTime < ms; wheelTime++) {
+			s = wheel[(wheelTime + 1) % WHEEL_SLOTS];
+			wheel[(wheelTime + 1) % WHEEL_SLOTS] = NULL;
+			while (s) {
+				Session *after = s->next;
+
+				s->next = chains[s->home];
+				chains[s->home] = s;
+				s = after;
+			}
+		}
+		pthread_mutex_unlock(&wheelLock);
+
+		for (i = 0; i < threads; i++) {
+			if (!chains[i])
+				continue;
+			w = &workers[i];
+			pthread_mutex_lock(&w->lock);
+			for (s = chains[i]; s; s = s->next)
+				w->ring[(w->head + w->count++) % maxSessions] = s;
+			pthread_cond_signal(&w->wake);
+			pthread_mutex_unlock(&w->lock);
+		}
+	}
+	return NULL;
+}
+
+/***************************************************************************************
+ * LISTEN ON
+ * 		A non-blocking listening socket on a Unix path or a local TCP port
+ **************************************************************************************/
+int listenOn(const char *path, int port) {
+	struct sockaddr_un un;
+	struct sockaddr_in in;
+	int one = 1;
+	int fd;
+
+	if (path) {
+		memset(&un, 0, sizeof un);
+		un.sun_family = AF_UNIX;
+		strncpy(un.sun_path, path, sizeof un.sun_path - 1);
+		unlink(path);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || bind(fd, (struct sockaddr *)&un, sizeof un) < 0)
+			return -1;
+	} else {
+		memset(&in, 0, sizeof in);
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+		if (bind(fd, (struct sockaddr *)&in, sizeof in) < 0)
+			return -1;
+	}
+	if (listen(fd, 4096) < 0)
+		return -1;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+/***************************************************************************************
+ * ACCEPT ALL
+ * 		Every connection waiting on listener fd into a session, frames go out as
+ * 		they're written on TCP
+ **************************************************************************************/
+void acceptAll(int fd, bool tcp) {
+	struct epoll_event ev;
+	Session *s;
+	int one = 1;
+	int c;
+
+	while ((c = accept(fd, NULL, NULL)) >= 0) {
+		fcntl(c, F_SETFL, fcntl(c, F_GETFL) | O_NONBLOCK);
+		if (tcp)
+			setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+		if (!(s = sessionNew(c))) {
+			close(c);
+			continue;
+		}
+		accepted++;
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		ev.data.ptr = s;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, c, &ev);
+	}
+}
+
+/***************************************************************************************
+ * ACCEPT WATCHERS
+ * 		Every watcher waiting on listener fd, into a slot until it says what for
+ **************************************************************************************/
+void acceptWatchers(int fd) {
+	struct epoll_event ev;
+	int c;
+	int k;
+
+	while ((c = accept(fd, NULL, NULL)) >= 0) {
+		for (k = 0; k < WATCHING && watchers[k].fd >= 0; k++);
+		if (k == WATCHING) {
+			close(c);
+			continue;
+		}
+		fcntl(c, F_SETFL, fcntl(c, F_GETFL) | O_NONBLOCK);
+		watchers[k].fd = c;
+		watchers[k].have = 0;
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		ev.data.ptr = &watchers[k];
+		epoll_ctl(epfd, EPOLL_CTL_ADD, c, &ev);
+	}
+}
+
+/***************************************************************************************
+ * WATCHER READ
+ * 		A watcher's session number, then it's the session's to feed. Whether the
+ * 		session's still on is specJoin's to say, under its lock, a session closing
+ * 		on its own thread right now can't miss it.
+ **************************************************************************************/
+void watcherRead(Watcher *v) {
+	Session *s;
+	unsigned int id;
+	ssize_t n;
+
+	while (v->have < 2 && (n = recv(v->fd, v->id + v->have, 2 - v->have, 0)) > 0)
+		v->have += n;
+	if (v->have < 2 && (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))) {
+		close(v->fd);
+		v->fd = -1;
+		return;
+	}
+	if (v->have < 2)
+		return;
+
+	id = v->id[0] | v->id[1] << 8;
+	s = id < maxSessions ? &sessions[id] : NULL;
+	epoll_ctl(epfd, EPOLL_CTL_DEL, v->fd, NULL);
+	if (s)
+		specJoin(s->watch, v->fd);
+	else
+		close(v->fd);
+	v->fd = -1;
+}
+
+/***************************************************************************************
+ * IO
+ * 		Accepts and flags readable sessions until told to stop
+ **************************************************************************************/
+void io(void) {
+	struct epoll_event events[IO_EVENTS];
+	Session *s;
+	int n;
+	int i;
+	int k;
+
+	while (!stopping) {
+		n = epoll_wait(epfd, events, IO_EVENTS, 100);
+		for (i = 0; i < n; i++) {
+			for (k = 0; k < LISTENERS; k++)
+				if (events[i].data.ptr == &listeners[k])
+					break;
+			if (k == 2) {
+				acceptWatchers(listeners[k]);
+				continue;
+			}
+			if (k < LISTENERS) {
+				acceptAll(listeners[k], k == 1);
+				continue;
+			}
+			if ((Watcher *)events[i].data.ptr >= watchers &&
+					(Watcher *)events[i].data.ptr < watchers + WATCHING) {
+				watcherRead(events[i].data.ptr);
+				continue;
+			}
+			s = events[i].data.ptr;
+			__atomic_store_n(&s->readable, 1, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *path = NULL;
+	const char *watchPath = NULL;
+	int port = 0;
+	unsigned int bots = 0;
+	double seconds = 0;
+	struct epoll_event ev;
+	struct sigaction sa;
+	struct rlimit rl;
+	pthread_t timerThread;
+	unsigned long long jitter[JITTER_BUCKETS];
+	unsigned long long ticks = 0;
+	unsigned long long total;
+	unsigned long long seen;
+	unsigned long long games = 0;
+	unsigned long long steals = 0;
+	unsigned long long framesIn = 0;
+	unsigned long long framesOut = 0;
+	unsigned long long bytesIn = 0;
+	unsigned long long bytesOut = 0;
+	unsigned long long closed = 0;
+	SpecStats spec;
+	unsigned long long t0;
+	double s;
+	unsigned int p50 = 0;
+	unsigned int p99 = 0;
+	unsigned int max = 0;
+	unsigned int j;
+	int i;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-u") && i + 1 < argc)
+			path = argv[++i];
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			port = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			watchPath = argv[++i];
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+			bots = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+			maxSessions = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			seconds = strtod(argv[++i], NULL);
+		else {
+			fprintf(stderr, "usage: %s [-u path] [-p port] [-w path] [-b bots] [-j threads]"
+					" [-m max sessions] [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	if (maxSessions < bots + 1)
+		maxSessions = bots + 1;
+
+	// a socket a session, ask for as many descriptors as we're allowed
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	sessions = calloc(maxSessions, sizeof *sessions);
+	if (!sessions) {
+		fprintf(stderr, "server: out of memory\n");
+		return 1;
+	}
+	for (j = maxSessions; j-- > 0; ) {
+		sessions[j].next = freeSessions;
+		freeSessions = &sessions[j];
+		sessions[j].fd = -1;
+		if (!(sessions[j].watch = specNew())) {
+			fprintf(stderr, "server: out of memory\n");
+			return 1;
+		}
+	}
+	for (j = 0; j < WATCHING; j++)
+		watchers[j].fd = -1;
+	for (i = 0; i < threads; i++) {
+		workers[i].ring = malloc(maxSessions * sizeof *workers[i].ring);
+		if (!workers[i].ring) {
+			fprintf(stderr, "server: out of memory\n");
+			return 1;
+		}
+		pthread_mutex_init(&workers[i].lock, NULL);
+		pthread_cond_init(&workers[i].wake, NULL);
+	}
+
+	epfd = epoll_create1(0);
+	for (i = 0; i < LISTENERS; i++)
+		listeners[i] = -1;
+	if (path && (listeners[0] = listenOn(path, 0)) < 0) {
+		fprintf(stderr, "server: can't listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	if (port && (listeners[1] = listenOn(NULL, port)) < 0) {
+		fprintf(stderr, "server: can't listen on port %d: %s\n", port, strerror(errno));
+		return 1;
+	}
+	if (watchPath && (listeners[2] = listenOn(watchPath, 0)) < 0) {
+		fprintf(stderr, "server: can't listen on %s: %s\n", watchPath, strerror(errno));
+		return 1;
+	}
+	for (i = 0; i < LISTENERS; i++) {
+		if (listeners[i] < 0)
+			continue;
+		ev.events = EPOLLIN | EPOLLET;
+		ev.data.ptr = &listeners[i];
+		epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i], &ev);
+	}
+
+	memset(&sa, 0, sizeof sa);
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+	sa.sa_handler = onSignal;
+	sigaction(SIGALRM, &sa, NULL);
+	if (seconds > 0)
+		alarm((unsigned int)(seconds + 0.999));
+
+	start = t0 = now();
+	for (j = 0; j < bots; j++) {
+		Session *b = sessionNew(-1);
+
+		b->ai = malloc(sizeof *b->ai);
+		if (!b->ai) {
+			fprintf(stderr, "server: out of memory\n");
+			return 1;
+		}
+		aiStart(b->ai, NULL);
+		b->seed = j;
+		gameReset(&b->game, b->seed);
+		b->playing = true;
+	}
+	for (i = 0; i < threads; i++)
+		pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+	pthread_create(&timerThread, NULL, timer, NULL);
+	printf("server: %d threads, %u bots", threads, bots);
+	if (path)
+		printf(", %s", path);
+	if (port)
+		printf(", 127.0.0.1:%d", port);
+	if (watchPath)
+		printf(", watchers on %s", watchPath);
+	printf("\n");
+	fflush(stdout);
+
+	io();
+	s = (now() - t0) / 1e9;
+	__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+	pthread_join(timerThread, NULL);
+	for (i = 0; i < threads; i++) {
+		pthread_mutex_lock(&workers[i].lock);
+		workers[i].count = 0;								// what's left isn't run
+		pthread_cond_signal(&workers[i].wake);
+		pthread_mutex_unlock(&workers[i].lock);
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	memset(jitter, 0, sizeof jitter);
+	memset(&spec, 0, sizeof spec);
+	for (i = 0; i < threads; i++) {
+		ticks += workers[i].ticks;
+		games += workers[i].games;
+		steals += workers[i].steals;
+		framesIn += workers[i].framesIn;
+		framesOut += workers[i].framesOut;
+		bytesIn += workers[i].bytesIn;
+		bytesOut += workers[i].bytesOut;
+		closed += workers[i].closed;
+		spec.updates += workers[i].spec.updates;
+		spec.keys += workers[i].spec.keys;
+		spec.bytes += workers[i].spec.bytes;
+		spec.sends += workers[i].spec.sends;
+		spec.resyncs += workers[i].spec.resyncs;
+		spec.time += workers[i].spec.time;
+		for (j = 0; j < JITTER_BUCKETS; j++)
+			jitter[j] += workers[i].jitter[j];
+	}
+	for (total = j = 0; j < JITTER_BUCKETS; j++)
+		total += jitter[j];
+	for (seen = j = 0; j < JITTER_BUCKETS; j++) {
+		if (!jitter[j])
+			continue;
+		seen += jitter[j];
+		if (!p50 && seen * 2 >= total)
+			p50 = j * JITTER_US + JITTER_US;
+		if (!p99 && seen * 100 >= total * 99)
+			p99 = j * JITTER_US + JITTER_US;
+		max = j * JITTER_US + JITTER_US;
+	}
+
+	printf("%.1f s, %u bots, %llu players connected, %llu closed, %u sessions at the end\n",
+			s, bots, accepted, closed, live);
+	printf("ticks      %12llu %12.1f/s, %llu steals\n", ticks, ticks / s, steals);
+	printf("jitter     p50 <%u us, p99 <%u us, max <%u us\n", p50, p99, max);
+	printf("games      %12llu\n", games);
+	printf("frames in  %12llu, %llu bytes\n", framesIn, bytesIn);
+	printf("frames out %12llu, %llu bytes\n", framesOut, bytesOut);
+	if (spec.updates)
+		printf("spectate   %12llu updates (%llu keyframes), %.1f bytes each, %llu sends,"
+				" %llu resyncs, %.0f ns an update\n", spec.updates, spec.keys,
+				(double)spec.bytes / spec.updates, spec.sends, spec.resyncs,
+				(double)spec.time / spec.updates);
+	if (path)
+		unlink(path);
+	if (watchPath)
+		unlink(watchPath);
+	return 0;
+}
@@ -0,0 +1,326 @@
+/***************************************************************************************
+ * SERVER LOAD
+ * 		Lots of players for build/server at once, from one thread, and a check that
+ * 		the server plays the games by the rules.
+ *
+ * 		build/serverload [-u path | -p port] [-n clients] [-t seconds] [-s seed]
+ *
+ * 		Each client says HELLO with its own seed and asks for a random press now and
+ * 		then, a couple of ticks ahead of where it last heard the server was. It plays
+ * 		every echo the server sends into its own Game, the way linkpeer runs the
+ * 		other unit's, and when BYE comes its game has to have ended on that tick
+ * 		too. Then it connects again with the next seed. Reads and writes are batched
+ * 		a 10 ms round, everything waiting is read, everything asked for is sent.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../engine.h"
+#include "../link.h"
+
+#define ROUND_NS		10000000L		// a tick
+#define IO_EVENTS		512
+#define ASK_AHEAD		2						// ticks past the last heard from the server
+
+typedef struct {
+	int fd;
+	unsigned int seed;
+	bool started;								// HELLO came back
+	Game game;									// the server's game, from its echoes
+	unsigned char stick;				// zone in its last INPUT
+	LinkDecoder decoder;
+	unsigned int outLength;
+	unsigned char out[LINK_FRAME * 4];
+} Client;
+
+Client *clients;
+unsigned int count = 100;
+const char *path;
+int port;
+int epfd;
+unsigned int nextSeed;
+unsigned long long rng;
+unsigned long long games;
+unsigned long long mismatches;
+unsigned long long drops;
+unsigned long long framesIn;
+unsigned long long framesOut;
+unsigned long long bytesIn;
+unsigned long long bytesOut;
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+unsigned int random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng >> 32;
+}
+
+void queueFrame(Client *c, unsigned char kind, unsigned char payload, unsigned long t) {
+	if (c->outLength + LINK_FRAME > sizeof c->out)
+		return;
+	linkEncode(c->out + c->outLength, kind, payload, t);
+	c->outLength += LINK_FRAME;
+	framesOut++;
+}
+
+/***************************************************************************************
+ * CLIENT CONNECT
+ * 		c onto the server, non-blocking, with its HELLO waiting to go
+ **************************************************************************************/
+bool clientConnect(Client *c) {
+	struct sockaddr_un un;
+	struct sockaddr_in in;
+	struct epoll_event ev;
+	int one = 1;
+
+	if (path) {
+		memset(&un, 0, sizeof un);
+		un.sun_family = AF_UNIX;
+		strncpy(un.sun_path, path, sizeof un.sun_path - 1);
+		c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&un, sizeof un) < 0)
+			goto fail;
+	} else {
+		memset(&in, 0, sizeof in);
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		c->fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&in, sizeof in) < 0)
+			goto fail;
+		setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+	}
+	fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = c;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+
+	c->seed = nextSeed++ & LINK_TICK_MASK;
+	c->started = false;
+	c->stick = 0;
+	c->decoder.have = 0;
+	c->outLength = 0;
+	queueFrame(c, LINK_HELLO, 0, c->seed);
+	return true;
+
+fail:
+	if (c->fd >= 0)
+		close(c->fd);
+	c->fd = -1;
+	return false;
+}
+
+void clientClose(Client *c) {
+	close(c->fd);
+	c->fd = -1;
+}
+
+/***************************************************************************************
+ * ADVANCE
+ * 		c's copy of the game on to tick t on the held joystick zone
+ **************************************************************************************/
+void advance(Client *c, unsigned long t) {
+	while (c->game.gameAlive && c->game.tick < t)
+		gameTick(&c->game, c->stick << IN_STICK_SHIFT);
+}
+
+/***************************************************************************************
+ * FRAME IN
+ * 		One frame from the server into c's copy of the game. false once c is done
+ * 		with, at BYE or on a game that went differently.
+ **************************************************************************************/
+bool frameIn(Client *c, const LinkFrame *f) {
+	unsigned long t;
+
+	framesIn++;
+	if (f->kind == LINK_HELLO) {
+		gameReset(&c->game, c->seed);
+		c->started = true;
+		return true;
+	}
+	if (!c->started)
+		return true;
+	t = linkUnwrap(c->game.tick, f->tick);
+	if (f->kind == LINK_INPUT) {
+		advance(c, t - 1);
+		if (!c->game.gameAlive || c->game.tick + 1 != t) {
+			mismatches++;
+			return false;
+		}
+		gameTick(&c->game, f->payload);
+		c->stick = (f->payload & IN_STICK) >> IN_STICK_SHIFT;
+	} else if (f->kind == LINK_SYNC) {
+		advance(c, t);
+		if (c->game.tick == t && (gameHash(&c->game) & LINK_HASH_MASK) != f->payload) {
+			mismatches++;
+			return false;
+		}
+	} else if (f->kind == LINK_BYE) {
+		advance(c, t);
+		if (c->game.gameAlive || c->game.tick != t)
+			mismatches++;
+		else
+			games++;
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************************
+ * CLIENT READ
+ * 		Everything waiting for c. false once c's connection is done with.
+ **************************************************************************************/
+bool clientRead(Client *c) {
+	unsigned char buf[512];
+	LinkFrame f;
+	ssize_t n;
+	ssize_t i;
+
+	for (;;) {
+		n = recv(c->fd, buf, sizeof buf, 0);
+		if (n == 0) {
+			drops++;
+			return false;
+		}
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				return true;
+			drops++;
+			return false;
+		}
+		bytesIn += n;
+		for (i = 0; i < n; i++)
+			if (linkDecode(&c->decoder, buf[i], &f) && !frameIn(c, &f))
+				return false;
+	}
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	struct epoll_event events[IO_EVENTS];
+	struct timespec ts;
+	struct rlimit rl;
+	double seconds = 10;
+	unsigned long long t0;
+	unsigned long long next;
+	unsigned long long end;
+	unsigned char in;
+	Client *c;
+	ssize_t sent;
+	double s;
+	unsigned int j;
+	int n;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-u") && i + 1 < argc)
+			path = argv[++i];
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			port = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			count = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			seconds = strtod(argv[++i], NULL);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			nextSeed = strtoul(argv[++i], NULL, 0);
+		else
+			break;
+	}
+	if (i < argc || (!path && !port)) {
+		fprintf(stderr, "usage: %s [-u path | -p port] [-n clients] [-t seconds] [-s seed]\n",
+				argv[0]);
+		return 2;
+	}
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	rng = nextSeed * 2654435761ULL + 1;
+	epfd = epoll_create1(0);
+	clients = calloc(count, sizeof *clients);
+	if (!clients) {
+		fprintf(stderr, "serverload: out of memory\n");
+		return 1;
+	}
+	for (j = 0; j < count; j++) {
+		if (!clientConnect(&clients[j])) {
+			fprintf(stderr, "serverload: can't connect: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+
+	t0 = next = now();
+	end = t0 + (unsigned long long)(seconds * 1e9);
+	while (next < end) {
+		next += ROUND_NS;
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+		while ((n = epoll_wait(epfd, events, IO_EVENTS, 0)) > 0) {
+			for (i = 0; i < n; i++) {
+				c = events[i].data.ptr;
+				if (c->fd >= 0 && !clientRead(c))
+					clientClose(c);
+			}
+			if (n < IO_EVENTS)
+				break;
+		}
+
+		for (j = 0; j < count; j++) {
+			c = &clients[j];
+			if (c->fd < 0 && !clientConnect(c))
+				continue;
+			if (c->started && random32() % 16 == 0) {
+				in = (random32() & 7) | (random32() % 4) << IN_STICK_SHIFT;
+				queueFrame(c, LINK_INPUT, in, c->game.tick + ASK_AHEAD);
+			}
+			if (!c->outLength)
+				continue;
+			sent = send(c->fd, c->out, c->outLength, MSG_NOSIGNAL);
+			if (sent < 0) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					drops++;
+					clientClose(c);
+				}
+				continue;
+			}
+			bytesOut += sent;
+			memmove(c->out, c->out + sent, c->outLength - sent);
+			c->outLength -= sent;
+		}
+	}
+	s = (now() - t0) / 1e9;
+
+	printf("serverload: %u clients, %.1f s\n", count, s);
+	printf("games      %12llu checked, %llu mismatches, %llu dropped\n", games, mismatches,
+			drops);
+	printf("frames in  %12llu, %llu bytes\n", framesIn, bytesIn);
+	printf("frames out %12llu, %llu bytes\n", framesOut, bytesOut);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+/***************************************************************************************
+ * SIM
+ * 		Runs the engine as fast as it goes, no screen and no 10 ms tick, and reports
+ * 		games, pieces and line clears a second. Inputs come from the random bot, the
+ * 		AI (-a) or a script file, one input byte a tick. The same seed on the same
+ * 		build plays the same games, the checksum at the end says so. With the AI it
+ * 		also says how fast the AI scores placements, timed on its own. -r is the AI
+ * 		scoring every rest it can reach, tucks and spins, not just straight drops.
+ * 		-l is the AI looking plies pieces ahead with search.c, on -j threads, keeping
+ * 		-w boards a ply and giving up on a ply after -d microseconds a move (0, the
+ * 		default, never gives up, so the games come out the same every run).
+ *
+ * 		make host, then
+ * 		build/sim [-n games] [-s seed] [-a | -r | -f script] [-t max ticks a game]
+ * 				[-l plies [-w width] [-d us] [-j threads]]
+ * 		build/simstats ...	same, plus a breakdown of collision, lock and clear
+ * 		build/simcheck ...	same, every features update checked against a recompute
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "bot.h"
+#include "ai.h"
+#include "search.h"
+#if defined(ENGINE_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#define MAX_TICKS		1000000UL	// a game this long isn't ending on its own
+
+unsigned char *script;							// input bytes a tick, or NULL for the bot
+size_t scriptLength;
+Bot bot;
+Ai ai;
+bool useAi;
+bool useReach;
+Search *search;											// lookahead, NULL for none
+unsigned long long planning;				// ns the AI spent planning
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * LOAD SCRIPT
+ **************************************************************************************/
+int loadScript(const char *path) {
+	FILE *f = fopen(path, "rb");
+	long n;
+
+	if (!f)
+		return -1;
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	script = malloc(n > 0 ? n : 1);
+	scriptLength = fread(script, 1, n > 0 ? n : 0, f);
+	fclose(f);
+	return scriptLength ? 0 : -1;
+}
+
+/***************************************************************************************
+ * PLAY
+ * 		One game start to finish, on the script, the AI or the bot. Each game only
+ * 		depends on its own seed, so game n here is the same game as replay record
+ * 		-s seed+n (with -a on both for the AI). Returns pieces.
+ **************************************************************************************/
+unsigned long play(Game *g, unsigned int seed, unsigned long maxTicks) {
+	unsigned long pieces = 0;
+	unsigned char ge = 0;
+	unsigned char in;
+	unsigned long long t0;
+	size_t at = 0;
+
+	gameReset(g, seed);
+	botSeed(&bot, seed);
+	aiStart(&ai, NULL);
+	ai.reach = useReach;
+	if (search) {
+		ai.planner = searchPlan;
+		ai.plannerContext = search;
+	}
+	while (g->gameAlive && g->tick < maxTicks) {
+		if (script) {
+			in = script[at++];
+			if (at == scriptLength)
+				at = 0;
+		} else if (useAi) {
+			t0 = ge & (GE_SPAWN | GE_GARBAGE) ? now() : 0;	// it only plans on these
+			in = aiInput(&ai, g, ge);
+			if (t0)
+				planning += now() - t0;
+		} else {
+			in = botInput(&bot, g, ge);
+		}
+		ge = gameTick(g, in);
+		if (ge & GE_SPAWN)
+			pieces++;
+	}
+	return pieces;
+}
+
+#ifdef ENGINE_STATS
+/***************************************************************************************
+ * STAT CLOCK
+ * 		Engine clock for the breakdown, the TSC where there is one. Even that costs
+ * 		about as much as a collision test, so the cost of an empty start/stop is
+ * 		measured and taken back out.
+ **************************************************************************************/
+#if defined(__x86_64__) || defined(__i386__)
+unsigned long long statClock(void) {
+	return __rdtsc();
+}
+#else
+unsigned long long statClock(void) {
+	return now();
+}
+#endif
+
+double clockOverhead(void) {
+	unsigned long long t0 = statClock();
+	unsigned long long sink = 0;
+	int i;
+
+	for (i = 0; i < 1000000; i++)
+		sink += statClock() - statClock();
+	return (double)(statClock() - t0 + (sink & 1)) / 1000000 / 2;
+}
+
+/***************************************************************************************
+ * BREAKDOWN
+ * 		Plays the same games again with the engine timing itself
+ **************************************************************************************/
+void breakdown(unsigned long games, unsigned int seed, unsigned long maxTicks) {
+	static const char *names[STAT_OPS] = {"collision", "lock", "clear"};
+	unsigned long long ns0;
+	unsigned long long c0;
+	unsigned long long calls = 0;
+	double overhead = clockOverhead();
+	double perNs;										// clock units a nanosecond
+	double total;
+	double ns;
+	Game g;
+	unsigned long n;
+	int op;
+
+	memset(engineStats, 0, sizeof engineStats);
+	engineClock = statClock;
+	ns0 = now();
+	c0 = statClock();
+	for (n = 0; n < games; n++)
+		play(&g, seed + n, maxTicks);
+	perNs = (double)(statClock() - c0) / (now() - ns0);
+	total = now() - ns0;
+	engineClock = NULL;
+
+	// what the run would have taken without the timer
+	for (op = 0; op < STAT_OPS; op++)
+		calls += engineStats[op].calls;
+	total -= calls * overhead / perNs;
+
+	printf("\n%-10s %14s %12s %10s %7s\n", "op", "calls", "calls/game", "ns/call", "share");
+	for (op = 0; op < STAT_OPS; op++) {
+		ns = ((double)engineStats[op].time / engineStats[op].calls - overhead) / perNs;
+		if (ns < 0)
+			ns = 0;
+		printf("%-10s %14llu %12.1f %10.1f %6.1f%%\n", names[op], engineStats[op].calls,
+				(double)engineStats[op].calls / games, ns, 100.0 * ns * engineStats[op].calls / total);
+	}
+	printf("(timer overhead %.1f ns a call taken out)\n", overhead / perNs);
+}
+#endif
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	unsigned long games = 1000;
+	unsigned int seed = 1;
+	unsigned long maxTicks = MAX_TICKS;
+	unsigned long long pieces = 0;
+	unsigned long long lines = 0;
+	unsigned long long ticks = 0;
+	unsigned long long placements = 0;
+	unsigned long long plans = 0;
+	unsigned long long check = 1469598103934665603ULL;	// FNV-1a over every game's end
+	unsigned long long t0;
+	unsigned long budget = 0;
+	long plies = 0;
+	long width = 8;
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	double s;
+	Game g;
+	unsigned long n;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			games = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			maxTicks = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-a"))
+			useAi = true;
+		else if (!strcmp(argv[i], "-r"))
+			useAi = useReach = true;
+		else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+			plies = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			width = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+			budget = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+			if (loadScript(argv[++i])) {
+				fprintf(stderr, "sim: can't read script %s\n", argv[i]);
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "usage: %s [-n games] [-s seed] [-a | -r | -f script] [-t max ticks]\n"
+					"       [-l plies [-w width] [-d us] [-j threads]]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (games == 0)
+		games = 1;
+	if (plies > 0) {
+		if (!(search = searchNew(threads > 0 ? threads : 1, plies, width, budget))) {
+			fprintf(stderr, "sim: can't start the search\n");
+			return 1;
+		}
+		useAi = true;
+		useReach = false;
+	}
+
+	t0 = now();
+	for (n = 0; n < games; n++) {
+		pieces += play(&g, seed + n, maxTicks);
+		lines += g.totalLines;
+		ticks += g.tick;
+		placements += ai.placements;
+		plans += ai.plans;
+		for (i = 0; i < 14; i++)
+			check = (check ^ g.rows[i]) * 1099511628211ULL;
+		check = (check ^ g.tick) * 1099511628211ULL;
+		check = (check ^ g.totalLines) * 1099511628211ULL;
+	}
+	s = (now() - t0) / 1e9;
+
+	printf("sim: %lu games, seed %u, %s\n", games, seed,
+			script ? "scripted" : search ? "AI, lookahead" : useReach ? "AI, reach" : useAi ? "AI" :
+			"random");
+	printf("%-8s %14lu %14.1f/s\n", "games", games, games / s);
+	printf("%-8s %14llu %14.1f/s\n", "pieces", pieces, pieces / s);
+	printf("%-8s %14llu %14.1f/s\n", "lines", lines, lines / s);
+	printf("%-8s %14llu %14.1f/s\n", "ticks", ticks, ticks / s);
+	if (useAi && !script) {
+		printf("%-8s %14llu %14.1f/s planning, %.3f s of it\n", "placed", placements,
+				placements / (planning / 1e9), planning / 1e9);
+		printf("%-8s %14llu %14.2f us each\n", "plans", plans, plans ? planning / 1e3 / plans : 0.0);
+	}
+	printf("checksum %016llx  (%.3f s)\n", check, s);
+
+#ifdef ENGINE_STATS
+	breakdown(games, seed, maxTicks);
+#endif
+	searchFree(search);
+	free(script);
+	return 0;
+}
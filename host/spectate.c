@@ -0,0 +1,401 @@
+/***************************************************************************************
+ * SPECTATE
+ * 		See spectate.h
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "spectate.h"
+
+// One encoded update, shared by every viewer it's queued to
+typedef struct {
+	unsigned int refs;						// atomic, viewers still to send it
+	unsigned int length;
+	unsigned char data[SPEC_MAX];
+} SpecBuffer;
+
+typedef struct Viewer Viewer;
+
+struct Viewer {
+	Viewer *next;
+	int fd;
+	bool synced;									// has had a keyframe since it joined or fell behind
+	SpecBuffer *queue[SPEC_QUEUE];
+	unsigned int head;
+	unsigned int count;
+	unsigned int sent;						// bytes of the head update already out
+};
+
+struct SpecStream {
+	pthread_mutex_t lock;					// for joining and open
+	Viewer *joining;
+	bool open;										// a game's on, specJoin takes viewers
+	Viewer *viewers;
+	unsigned int count;						// atomic, viewers and joining
+	SpecView view;								// what the updates so far add up to
+	bool known;										// view is, nobody watching loses it
+	uint32_t lastKey;							// tick of the last keyframe
+};
+
+static unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * SPEC VIEW
+ * 		What a viewer of g sees
+ **************************************************************************************/
+void specView(const Game *g, SpecView *v) {
+	memcpy(v->rows, g->rows, sizeof v->rows);
+	v->tick = g->tick;
+	v->totalLines = g->totalLines;
+	v->level = g->level;
+	v->piece = g->piece;
+	v->rotation = g->rotation;
+	v->xPos = g->xPos;
+	v->yPos = g->yPos;
+	v->pieceAlive = g->pieceAlive;
+	v->gameAlive = g->gameAlive;
+}
+
+/***************************************************************************************
+ * SPEC ENCODE
+ * 		The delta from a viewer seeing was to seeing g into out, at most SPEC_MAX
+ * 		bytes. 0 if nothing a viewer sees changed.
+ **************************************************************************************/
+size_t specEncode(const SpecView *was, const Game *g, unsigned char *out) {
+	unsigned char *p = out + 1;
+	unsigned int mask = 0;
+	unsigned char piece = g->piece | g->rotation << 3 | g->pieceAlive << 5 | g->gameAlive << 6;
+	int i;
+
+	for (i = 0; i < 14; i++)
+		if (g->rows[i] != was->rows[i])
+			mask |= 1 << i;
+	out[0] = 0;
+	if (mask) {
+		out[0] |= SPEC_ROWS;
+		*p++ = mask;
+		*p++ = mask >> 8;
+		for (i = 0; i < 14; i++) {
+			if (mask & (1 << i)) {
+				*p++ = g->rows[i];
+				*p++ = g->rows[i] >> 8;
+			}
+		}
+	}
+	if (piece != (was->piece | was->rotation << 3 | was->pieceAlive << 5 | was->gameAlive << 6)) {
+		out[0] |= SPEC_PIECE;
+		*p++ = piece;
+	}
+	if (g->xPos != was->xPos || g->yPos != was->yPos) {
+		out[0] |= SPEC_AT;
+		*p++ = g->xPos | g->yPos << 4;
+	}
+	if (g->level != was->level || g->totalLines != was->totalLines) {
+		out[0] |= SPEC_SCORE;
+		*p++ = g->level;
+		*p++ = g->totalLines;
+		*p++ = g->totalLines >> 8;
+	}
+	return out[0] ? (size_t)(p - out) : 0;
+}
+
+/***************************************************************************************
+ * SPEC APPLY
+ * 		The update at in onto v. Returns its length, 0 if it isn't all in yet. A
+ * 		kind byte that means nothing is skipped.
+ **************************************************************************************/
+size_t specApply(SpecView *v, const unsigned char *in, size_t n) {
+	const unsigned char *p = in + 1;
+	unsigned int mask = 0;
+	size_t need = 1;
+	Game g;
+	int i;
+
+	if (n == 0)
+		return 0;
+	if (in[0] == SPEC_KEY) {
+		if (n < 1 + GAME_PACKED)
+			return 0;
+		gameUnpack(&g, in + 1);
+		specView(&g, v);
+		return 1 + GAME_PACKED;
+	}
+	if (in[0] == 0 || in[0] > 0x0F)
+		return 1;
+
+	if (in[0] & SPEC_ROWS) {
+		if (n < 3)
+			return 0;
+		mask = in[1] | in[2] << 8;
+		need += 2 + 2 * __builtin_popcount(mask);
+	}
+	need += !!(in[0] & SPEC_PIECE) + !!(in[0] & SPEC_AT) + 3 * !!(in[0] & SPEC_SCORE);
+	if (n < need)
+		return 0;
+
+	if (in[0] & SPEC_ROWS) {
+		p += 2;
+		for (i = 0; i < 14; i++) {
+			if (mask & (1 << i)) {
+				v->rows[i] = p[0] | p[1] << 8;
+				p += 2;
+			}
+		}
+	}
+	if (in[0] & SPEC_PIECE) {
+		v->piece = *p & 0x07;
+		v->rotation = (*p >> 3) & 0x03;
+		v->pieceAlive = (*p >> 5) & 1;
+		v->gameAlive = (*p++ >> 6) & 1;
+	}
+	if (in[0] & SPEC_AT) {
+		v->xPos = *p & 0x0F;
+		v->yPos = *p++ >> 4;
+	}
+	if (in[0] & SPEC_SCORE) {
+		v->level = p[0];
+		v->totalLines = p[1] | p[2] << 8;
+	}
+	return need;
+}
+
+/***************************************************************************************
+ * SPEC NEW
+ **************************************************************************************/
+SpecStream *specNew(void) {
+	SpecStream *st = calloc(1, sizeof *st);
+
+	if (st)
+		pthread_mutex_init(&st->lock, NULL);
+	return st;
+}
+
+static void release(SpecBuffer *b) {
+	if (__atomic_sub_fetch(&b->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		free(b);
+}
+
+// drops everything queued to v
+static void drain(Viewer *v) {
+	while (v->count) {
+		release(v->queue[v->head]);
+		v->head = (v->head + 1) % SPEC_QUEUE;
+		v->count--;
+	}
+	v->sent = 0;
+}
+
+static void viewerFree(Viewer *v) {
+	drain(v);
+	close(v->fd);
+	free(v);
+}
+
+/***************************************************************************************
+ * SPEC OPEN
+ * 		A game starts on st, viewers can join until specClose
+ **************************************************************************************/
+void specOpen(SpecStream *st) {
+	pthread_mutex_lock(&st->lock);
+	st->open = true;
+	pthread_mutex_unlock(&st->lock);
+}
+
+/***************************************************************************************
+ * SPEC CLOSE
+ * 		Closes every viewer, joiners too, the game they were watching is gone. A join
+ * 		after this is turned away. st stays for the next game.
+ **************************************************************************************/
+void specClose(SpecStream *st) {
+	Viewer *v;
+
+	pthread_mutex_lock(&st->lock);
+	st->open = false;
+	while ((v = st->joining)) {
+		st->joining = v->next;
+		v->next = st->viewers;
+		st->viewers = v;
+	}
+	while ((v = st->viewers)) {
+		st->viewers = v->next;
+		viewerFree(v);
+		__atomic_fetch_sub(&st->count, 1, __ATOMIC_RELEASE);
+	}
+	st->known = false;
+	pthread_mutex_unlock(&st->lock);
+}
+
+void specFree(SpecStream *st) {
+	specClose(st);
+	pthread_mutex_destroy(&st->lock);
+	free(st);
+}
+
+/***************************************************************************************
+ * SPEC JOIN
+ * 		A viewer on non-blocking socket fd starts watching st, from the next keyframe.
+ * 		st owns fd from here. false if there's no game on st to watch, fd is closed.
+ **************************************************************************************/
+bool specJoin(SpecStream *st, int fd) {
+	Viewer *v = calloc(1, sizeof *v);
+
+	if (!v) {
+		close(fd);
+		return false;
+	}
+	v->fd = fd;
+	pthread_mutex_lock(&st->lock);
+	if (!st->open) {
+		pthread_mutex_unlock(&st->lock);
+		free(v);
+		close(fd);
+		return false;
+	}
+	v->next = st->joining;
+	st->joining = v;
+	__atomic_fetch_add(&st->count, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&st->lock);
+	return true;
+}
+
+unsigned int specViewers(SpecStream *st) {
+	return __atomic_load_n(&st->count, __ATOMIC_ACQUIRE);
+}
+
+/***************************************************************************************
+ * FLUSH
+ * 		Whatever v's socket takes of its queue, in one sendmsg. false if v's gone.
+ **************************************************************************************/
+static bool flush(Viewer *v) {
+	struct iovec iov[SPEC_QUEUE];
+	struct msghdr msg;
+	SpecBuffer *b;
+	unsigned int i;
+	ssize_t n;
+
+	for (i = 0; i < v->count; i++) {
+		b = v->queue[(v->head + i) % SPEC_QUEUE];
+		iov[i].iov_base = b->data + (i ? 0 : v->sent);
+		iov[i].iov_len = b->length - (i ? 0 : v->sent);
+	}
+	memset(&msg, 0, sizeof msg);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = v->count;
+	n = sendmsg(v->fd, &msg, MSG_NOSIGNAL);
+	if (n < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	n += v->sent;
+	while (v->count && (size_t)n >= v->queue[v->head]->length) {
+		n -= v->queue[v->head]->length;
+		release(v->queue[v->head]);
+		v->head = (v->head + 1) % SPEC_QUEUE;
+		v->count--;
+	}
+	v->sent = n;
+	return true;
+}
+
+// b onto v's queue, or v's too far behind and starts again at a keyframe
+static void push(Viewer *v, SpecBuffer *b, SpecStats *stats) {
+	if (v->count == SPEC_QUEUE) {
+		drain(v);
+		v->synced = false;
+		stats->resyncs++;
+		release(b);
+		return;
+	}
+	v->queue[(v->head + v->count++) % SPEC_QUEUE] = b;
+	v->synced = true;
+	stats->sends++;
+}
+
+// a new buffer for refs viewers, or NULL
+static SpecBuffer *buffer(unsigned int refs) {
+	SpecBuffer *b = refs ? malloc(sizeof *b) : NULL;
+
+	if (b)
+		b->refs = refs;
+	return b;
+}
+
+/***************************************************************************************
+ * SPEC TICK
+ * 		g just ran a tick. Encodes what changed once for every synced viewer, and on
+ * 		a keyframe tick the keyframe after it for everybody, so a synced viewer's
+ * 		deltas always add up to the keyframe. Queues and writes them out. Nothing at
+ * 		all with nobody watching.
+ **************************************************************************************/
+void specTick(SpecStream *st, const Game *g, SpecStats *stats) {
+	unsigned long long t0;
+	SpecBuffer *delta;
+	SpecBuffer *key = NULL;
+	Viewer **link;
+	Viewer *v;
+	unsigned int viewers = 0;
+	unsigned int synced = 0;
+
+	if (!specViewers(st)) {
+		st->known = false;
+		return;
+	}
+	t0 = now();
+
+	// joiners in, they wait for a keyframe
+	if (__atomic_load_n(&st->joining, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&st->lock);
+		while ((v = st->joining)) {
+			st->joining = v->next;
+			v->next = st->viewers;
+			st->viewers = v;
+		}
+		pthread_mutex_unlock(&st->lock);
+	}
+	for (v = st->viewers; v; v = v->next) {
+		viewers++;
+		synced += v->synced;
+	}
+
+	if ((delta = buffer(synced)) && !(delta->length = specEncode(&st->view, g, delta->data))) {
+		free(delta);
+		delta = NULL;
+	}
+	if (!st->known || g->tick - st->lastKey >= SPEC_KEY_TICKS) {
+		if ((key = buffer(viewers))) {
+			key->data[0] = SPEC_KEY;
+			gamePack(g, key->data + 1);
+			key->length = 1 + GAME_PACKED;
+			stats->keys++;
+		}
+		st->lastKey = g->tick;
+		st->known = true;
+	}
+	specView(g, &st->view);
+	stats->updates += !!delta + !!key;
+	stats->bytes += (delta ? delta->length : 0) + (key ? key->length : 0);
+
+	for (link = &st->viewers; (v = *link); ) {
+		if (delta && v->synced)
+			push(v, delta, stats);
+		if (key)
+			push(v, key, stats);
+		if (v->count && !flush(v)) {
+			*link = v->next;
+			viewerFree(v);
+			__atomic_fetch_sub(&st->count, 1, __ATOMIC_RELEASE);
+			continue;
+		}
+		link = &v->next;
+	}
+	stats->time += now() - t0;
+}
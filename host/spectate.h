@@ -0,0 +1,79 @@
+/***************************************************************************************
+ * SPECTATE
+ * 		Watching a game live. A game's stream is what changed since the last update,
+ * 		not the board every tick, with a keyframe every SPEC_KEY_TICKS for whoever
+ * 		just started watching.
+ *
+ * 		An update is a kind byte and what it says is there:
+ * 			KEY		0x80, then GAME_PACKED bytes of gamePack, the whole game
+ * 			DELTA	0x0f flags, then as flagged
+ * 				SPEC_ROWS		16 bit mask of rows that changed, bit n row n, then
+ * 										each of them 16 bits, low byte first
+ * 				SPEC_PIECE	piece | rotation << 3 | pieceAlive << 5 | gameAlive << 6
+ * 				SPEC_AT			xPos | yPos << 4
+ * 				SPEC_SCORE	level, then totalLines 16 bits
+ * 		A piece walking down is 2 bytes a step, a lock and clear a few more.
+ *
+ * 		Whoever runs the game calls specTick after each tick. A keyframe tick still
+ * 		sends its delta first, so a viewer's view before a keyframe is the keyframe.
+ * 		Each update is encoded once into a SpecBuffer, and every viewer's queue gets the same buffer with a
+ * 		reference each, nothing copied. A viewer's queue is written out with one
+ * 		sendmsg, the buffer goes when the last viewer has sent it. A viewer too far
+ * 		behind loses its queue and waits for the next keyframe. specJoin can be
+ * 		called from any thread, everything else from the game's. specOpen and
+ * 		specClose bracket a game, a join outside them is turned away under the same
+ * 		lock, so none is left behind when a game ends.
+ **************************************************************************************/
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stddef.h>
+#include "../engine.h"
+
+#define SPEC_KEY				0x80
+#define SPEC_ROWS				0x01
+#define SPEC_PIECE			0x02
+#define SPEC_AT					0x04
+#define SPEC_SCORE			0x08
+#define SPEC_KEY_TICKS	100				// a second
+#define SPEC_MAX				(1 + GAME_PACKED)	// longest update, a keyframe
+#define SPEC_QUEUE			64				// updates a viewer can be behind
+
+// What a viewer sees
+typedef struct {
+	uint16_t rows[14];
+	uint32_t tick;							// as of the last keyframe
+	uint16_t totalLines;
+	uint8_t level;
+	uint8_t piece;
+	uint8_t rotation;
+	uint8_t xPos;
+	uint8_t yPos;
+	bool pieceAlive;
+	bool gameAlive;
+} SpecView;
+
+typedef struct SpecStream SpecStream;
+
+typedef struct {
+	unsigned long long updates;		// encoded
+	unsigned long long keys;
+	unsigned long long bytes;			// encoded
+	unsigned long long sends;			// updates queued to viewers
+	unsigned long long resyncs;		// viewers that fell behind
+	unsigned long long time;			// ns in specTick
+} SpecStats;
+
+void specView(const Game *, SpecView *);
+size_t specEncode(const SpecView *, const Game *, unsigned char *);
+size_t specApply(SpecView *, const unsigned char *, size_t);
+
+SpecStream *specNew(void);
+void specFree(SpecStream *);
+void specOpen(SpecStream *);
+void specClose(SpecStream *);
+bool specJoin(SpecStream *, int);
+void specTick(SpecStream *, const Game *, SpecStats *);
+unsigned int specViewers(SpecStream *);
+
+#endif
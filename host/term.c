@@ -0,0 +1,268 @@
+/***************************************************************************************
+ * TERM
+ * 		See term.h
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "term.h"
+
+/***************************************************************************************
+ * TERM COLOR
+ * 		Nearest of xterm's 6x6x6 color cube to an RGB565 color
+ **************************************************************************************/
+uint8_t termColor(uint16_t c) {
+	unsigned int v[3];
+	int i;
+
+	v[0] = (c >> 11) * 255 / 31;
+	v[1] = ((c >> 5) & 0x3F) * 255 / 63;
+	v[2] = (c & 0x1F) * 255 / 31;
+	for (i = 0; i < 3; i++)					// cube levels are 0, 95, 135, 175, 215, 255
+		v[i] = v[i] < 48 ? 0 : v[i] < 115 ? 1 : (v[i] - 35) / 40;
+	return 16 + 36 * v[0] + 6 * v[1] + v[2];
+}
+
+static void put(Term *t, const char *s, size_t n) {
+	if (t->length + n <= sizeof t->out) {
+		memcpy(t->out + t->length, s, n);
+		t->length += n;
+	}
+}
+
+/***************************************************************************************
+ * TERM START
+ * 		The alternate screen on fd, cleared, with the cursor hidden. Nothing's known
+ * 		shown, so the first flush draws every cell.
+ **************************************************************************************/
+void termStart(Term *t, int fd) {
+	static const char start[] = "\033[?1049h\033[?25l\033[0m\033[2J";
+
+	memset(t->cells, 0, sizeof t->cells);
+	memset(t->shown, 0, sizeof t->shown);
+	t->fd = fd;
+	t->row = -1;
+	t->column = -1;
+	t->fg = -1;
+	t->bg = -1;
+	t->length = 0;
+	t->frames = 0;
+	t->bytes = 0;
+	t->most = 0;
+	put(t, start, sizeof start - 1);
+}
+
+/***************************************************************************************
+ * TERM END
+ * 		Back to the screen and colors the terminal had
+ **************************************************************************************/
+void termEnd(Term *t) {
+	static const char end[] = "\033[0m\033[?25h\033[?1049l";
+	ssize_t n;
+
+	put(t, end, sizeof end - 1);
+	n = write(t->fd, t->out, t->length);
+	(void)n;
+	t->length = 0;
+}
+
+/***************************************************************************************
+ * TERM FILL
+ * 		width x height blank cells in bg from row, column. Off screen is clipped.
+ **************************************************************************************/
+void termFill(Term *t, int row, int column, int width, int height, uint8_t bg) {
+	int i;
+	int j;
+
+	for (i = row; i < row + height; i++)
+		for (j = column; j < column + width; j++)
+			if (i >= 0 && i < TERM_ROWS && j >= 0 && j < TERM_COLUMNS) {
+				t->cells[i][j].ch = ' ';
+				t->cells[i][j].fg = 0;
+				t->cells[i][j].bg = bg;
+			}
+}
+
+/***************************************************************************************
+ * TERM TEXT
+ * 		s at row, column in fg on bg, cut off at the edge
+ **************************************************************************************/
+void termText(Term *t, int row, int column, const char *s, uint8_t fg, uint8_t bg) {
+	if (row < 0 || row >= TERM_ROWS)
+		return;
+	for (; *s && column < TERM_COLUMNS; s++, column++) {
+		if (column < 0)
+			continue;
+		t->cells[row][column].ch = *s;
+		t->cells[row][column].fg = *s == ' ' ? 0 : fg;
+		t->cells[row][column].bg = bg;
+	}
+}
+
+// c goes out as it is with the colors already set
+static int fitsColors(const Term *t, const TermCell *c) {
+	return c->bg == t->bg && (c->ch == ' ' || c->fg == t->fg);
+}
+
+// along row from column from to column to into s, the shortest way, its length
+static size_t across(const Term *t, int row, int from, int to, char *s) {
+	size_t n;
+	int j;
+
+	if (to < from) {
+		if (from - to <= 3) {					// backspaces
+			memset(s, '\b', from - to);
+			return from - to;
+		}
+		return sprintf(s, "\033[%dD", from - to);
+	}
+	if (to == from)
+		return 0;
+	n = sprintf(s, "\033[%dC", to - from);
+	if ((size_t)(to - from) <= n) {
+		// the cells in between again, if they need no color change
+		for (j = from; j < to && t->shown[row][j].ch && fitsColors(t, &t->shown[row][j]); j++);
+		if (j == to) {
+			for (j = from; j < to; j++)
+				s[j - from] = t->shown[row][j].ch;
+			n = to - from;
+		}
+	}
+	return n;
+}
+
+// rows down (up if less than 0) into s, its length
+static size_t down(int rows, char *s) {
+	if (rows == 0)
+		return 0;
+	if (rows == 1 || rows == -1)
+		return sprintf(s, "\033[%c", rows > 0 ? 'B' : 'A');
+	return sprintf(s, "\033[%d%c", rows > 0 ? rows : -rows, rows > 0 ? 'B' : 'A');
+}
+
+/***************************************************************************************
+ * MOVE
+ * 		Cursor to row, column the cheapest way there: up or down and across, back to
+ * 		the left edge and across, or straight there
+ **************************************************************************************/
+static void move(Term *t, int row, int column) {
+	char best[48];
+	char s[48];
+	size_t most;
+	size_t n;
+
+	if (row == t->row && column == t->column)
+		return;
+	most = sprintf(best, "\033[%d;%dH", row + 1, column + 1);
+	if (t->row >= 0) {
+		n = down(row - t->row, s);
+		n += across(t, row, t->column, column, s + n);
+		if (n < most) {
+			memcpy(best, s, n);
+			most = n;
+		}
+		if (row == t->row + 1) {
+			memcpy(s, "\r\n", 2);
+			n = 2;
+		} else {
+			s[0] = '\r';
+			n = 1 + down(row - t->row, s + 1);
+		}
+		n += across(t, row, 0, column, s + n);
+		if (n < most) {
+			memcpy(best, s, n);
+			most = n;
+		}
+	}
+	put(t, best, most);
+	t->row = row;
+	t->column = column;
+}
+
+/***************************************************************************************
+ * COLORS
+ * 		What has to change for c to go out right
+ **************************************************************************************/
+static void colors(Term *t, const TermCell *c) {
+	char s[32];
+	int n;
+
+	if (fitsColors(t, c))
+		return;
+	if (c->bg == t->bg)
+		n = snprintf(s, sizeof s, "\033[38;5;%dm", c->fg);
+	else if (c->ch == ' ' || c->fg == t->fg)
+		n = snprintf(s, sizeof s, "\033[48;5;%dm", c->bg);
+	else
+		n = snprintf(s, sizeof s, "\033[38;5;%d;48;5;%dm", c->fg, c->bg);
+	put(t, s, n);
+	if (c->ch != ' ')
+		t->fg = c->fg;
+	t->bg = c->bg;
+}
+
+/***************************************************************************************
+ * TERM FLUSH
+ * 		Every cell that differs from what's shown, in one write. They go out a color
+ * 		at a time, whatever needs no change first, then every cell that wants the
+ * 		next color, top to bottom, so a frame sets each color once rather than once
+ * 		a run. Returns the bytes sent, 0 when nothing changed.
+ **************************************************************************************/
+size_t termFlush(Term *t) {
+	static unsigned short changed[TERM_ROWS * TERM_COLUMNS];
+	const TermCell *c;
+	unsigned int count = 0;
+	unsigned int left;
+	unsigned int i;
+	unsigned int k;
+	size_t done;
+	ssize_t n;
+
+	for (i = 0; i < TERM_ROWS * TERM_COLUMNS; i++) {
+		c = &t->cells[i / TERM_COLUMNS][i % TERM_COLUMNS];
+		if (c->ch && memcmp(c, &t->shown[i / TERM_COLUMNS][i % TERM_COLUMNS], sizeof *c))
+			changed[count++] = i;
+	}
+
+	for (left = count; left; ) {
+		for (k = 0; k < count && (changed[k] == 0xFFFF ||
+				!fitsColors(t, &t->cells[changed[k] / TERM_COLUMNS][changed[k] % TERM_COLUMNS])); k++);
+		if (k == count) {
+			for (k = 0; changed[k] == 0xFFFF; k++);
+			colors(t, &t->cells[changed[k] / TERM_COLUMNS][changed[k] % TERM_COLUMNS]);
+		}
+		for (; k < count; k++) {
+			if (changed[k] == 0xFFFF)
+				continue;
+			c = &t->cells[changed[k] / TERM_COLUMNS][changed[k] % TERM_COLUMNS];
+			if (!fitsColors(t, c))
+				continue;
+			move(t, changed[k] / TERM_COLUMNS, changed[k] % TERM_COLUMNS);
+			put(t, (const char *)&c->ch, 1);
+			t->shown[changed[k] / TERM_COLUMNS][changed[k] % TERM_COLUMNS] = *c;
+			if (++t->column == TERM_COLUMNS)
+				t->row = -1;						// where it went depends on the terminal
+			changed[k] = 0xFFFF;
+			left--;
+		}
+	}
+	if (!t->length)
+		return 0;
+
+	for (done = 0; done < t->length; done += n) {
+		n = write(t->fd, t->out + done, t->length - done);
+		if (n < 0 && errno != EINTR && errno != EAGAIN)
+			break;
+		if (n < 0)
+			n = 0;
+	}
+	done = t->length;
+	t->frames++;
+	t->bytes += done;
+	if (done > t->most)
+		t->most = done;
+	t->length = 0;
+	return done;
+}
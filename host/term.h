@@ -0,0 +1,54 @@
+/***************************************************************************************
+ * TERM
+ * 		A screen of character cells for an ANSI terminal, drawn the way the unit draws
+ * 		its panel: only what changed. Draw a whole frame into cells with termText and
+ * 		termFill, then termFlush compares it with what the terminal already shows and
+ * 		sends just the cells that differ, in one write.
+ *
+ * 		Cursor moves are the cheapest of staying put, a few unchanged cells written
+ * 		again, a cursor forward, \r\n or a full position. Colors go out only when they
+ * 		change, and a space doesn't care what its foreground is. A piece falling a
+ * 		row comes to a few tens of bytes.
+ *
+ * 		Colors are xterm's 256, termColor picks one for an RGB565 panel color so
+ * 		the board looks like the unit's.
+ **************************************************************************************/
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TERM_ROWS			18
+#define TERM_COLUMNS	40
+#define TERM_OUT			32768			// a whole screen of changes fits
+
+typedef struct {
+	uint8_t ch;									// ASCII, 0 never shown
+	uint8_t fg;
+	uint8_t bg;
+} TermCell;
+
+typedef struct {
+	TermCell cells[TERM_ROWS][TERM_COLUMNS];	// the frame being drawn
+	TermCell shown[TERM_ROWS][TERM_COLUMNS];	// what the terminal has
+	int fd;
+	int row;										// cursor, -1 not known
+	int column;
+	int fg;											// colors set, -1 not known
+	int bg;
+	size_t length;
+	char out[TERM_OUT];
+	unsigned long long frames;	// flushes that sent anything
+	unsigned long long bytes;
+	size_t most;								// biggest frame
+} Term;
+
+uint8_t termColor(uint16_t);
+void termStart(Term *, int);
+void termEnd(Term *);
+void termFill(Term *, int, int, int, int, uint8_t);
+void termText(Term *, int, int, const char *, uint8_t, uint8_t);
+size_t termFlush(Term *);
+
+#endif
@@ -0,0 +1,427 @@
+/***************************************************************************************
+ * TUNE
+ * 		Breeds AI weights instead of picking them by hand. A genetic algorithm: every
+ * 		generation each set of weights plays the same fixed seed games, the best few
+ * 		go through as they are and the rest of the next generation are children of
+ * 		tournament winners, each weight from one parent or the other, nudged by a
+ * 		little noise.
+ *
+ * 		build/tune [-j threads] [-p population] [-g games] [-n generations]
+ * 				[-t max ticks] [-s seed] [-c checkpoint]
+ *
+ * 		A game is the greedy AI from ai.c with a garbage row coming up every few
+ * 		seconds, its hole from the game's seed. Without it a good set of weights plays
+ * 		to the tick limit and they all look the same, and since the next piece comes
+ * 		out of keyPress % 7 there'd be only 7 different games anyway. A set scores
+ * 		the lines it clears over all the games.
+ *
+ * 		Every game of a generation is a job for the pool, threads take them a few at
+ * 		a time off one counter, so a generation takes about a core count's share of
+ * 		the time. Results go in a slot per game and are added up in order, the same
+ * 		answer on any number of threads. -c saves the population after every
+ * 		generation and carries on from it if it's already there, with its own
+ * 		population, games, ticks and seed. -p, -g, -t or -s saying different gets a
+ * 		warning.
+ **************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../engine.h"
+#include "ai.h"
+
+#define MAX_THREADS		256
+#define BATCH					4					// games a thread takes at a time
+#define ELITE					4					// best sets kept as they are
+#define TOURNAMENT		3					// sets drawn to pick each parent
+#define GARBAGE_EVERY	1500				// ticks between garbage rows
+#define CHECKPOINT_VERSION	1
+
+// AiWeights' members, so breeding can go over them in a loop
+const size_t weightAt[] = {
+	offsetof(AiWeights, height), offsetof(AiWeights, lines), offsetof(AiWeights, holes),
+	offsetof(AiWeights, bumps), offsetof(AiWeights, wells)
+};
+#define WEIGHTS				(int)(sizeof weightAt / sizeof *weightAt)
+#define WEIGHT(w, k)		(*(int *)((char *)(w) + weightAt[k]))
+#define WEIGHT_OF(w, k)	(*(const int *)((const char *)(w) + weightAt[k]))
+
+typedef struct {
+	AiWeights weights;
+	unsigned long long score;			// lines over all the games
+} Candidate;
+
+Candidate *population;
+int populationSize = 24;
+int games = 100;
+unsigned long maxTicks = 50000;
+unsigned int seed = 1;
+int generation;
+unsigned long long rng = 88172645463325252ULL;
+
+// the pool
+pthread_t threads[MAX_THREADS];
+int threadCount;
+pthread_barrier_t start;
+pthread_barrier_t done;
+bool quit;
+unsigned long jobs;								// games this generation, candidate * games + game
+unsigned long nextJob;
+unsigned long *lines;							// result of each job
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/***************************************************************************************
+ * RANDOM
+ * 		xorshift64, uniform in [0, 1) and roughly normal
+ **************************************************************************************/
+unsigned int randomInt(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (unsigned int)(rng >> 32);
+}
+
+double uniform(void) {
+	return randomInt() / 4294967296.0;
+}
+
+double normal(void) {
+	double u = uniform();
+
+	return sqrt(-2 * log(u > 0 ? u : 1e-12)) * cos(6.283185307179586 * uniform());
+}
+
+/***************************************************************************************
+ * PLAY
+ * 		One game of job n, lines cleared
+ **************************************************************************************/
+unsigned long play(unsigned long n) {
+	const Candidate *c = &population[n / games];
+	unsigned int gameSeed = seed + n % games;
+	unsigned long long holes = gameSeed * 2654435761ULL + 1;
+	Garbage q[GARBAGE_QUEUE];
+	unsigned char ge = 0;
+	Game g;
+	Ai a;
+
+	memset(q, 0, sizeof q);
+	aiStart(&a, &c->weights);
+	gameReset(&g, gameSeed);
+	while (g.gameAlive && g.tick < maxTicks) {
+		if (g.tick % GARBAGE_EVERY == GARBAGE_EVERY - 2) {
+			holes ^= holes << 13;
+			holes ^= holes >> 7;
+			holes ^= holes << 17;
+			q[0].tick = g.tick + 2;
+			q[0].rows = 1;
+			q[0].hole = (holes >> 32) % 10;
+		}
+		dueGarbage(q, &g, true);
+		ge = gameTick(&g, aiInput(&a, &g, ge));
+	}
+	return g.totalLines;
+}
+
+/***************************************************************************************
+ * WORK
+ * 		Takes jobs until the generation's are gone. The pool threads loop on it.
+ **************************************************************************************/
+void work(void) {
+	unsigned long first;
+	unsigned long n;
+
+	while ((first = __atomic_fetch_add(&nextJob, BATCH, __ATOMIC_RELAXED)) < jobs)
+		for (n = first; n < first + BATCH && n < jobs; n++)
+			lines[n] = play(n);
+}
+
+void *poolThread(void *arg) {
+	(void)arg;
+	for (;;) {
+		pthread_barrier_wait(&start);
+		if (quit)
+			return NULL;
+		work();
+		pthread_barrier_wait(&done);
+	}
+}
+
+/***************************************************************************************
+ * EVALUATE
+ * 		Plays every candidate's games across the pool
+ **************************************************************************************/
+void evaluate(void) {
+	int i;
+	int j;
+
+	jobs = (unsigned long)populationSize * games;
+	nextJob = 0;
+	if (threadCount > 1)
+		pthread_barrier_wait(&start);
+	work();
+	if (threadCount > 1)
+		pthread_barrier_wait(&done);
+
+	for (i = 0; i < populationSize; i++) {
+		population[i].score = 0;
+		for (j = 0; j < games; j++)
+			population[i].score += lines[(unsigned long)i * games + j];
+	}
+}
+
+/***************************************************************************************
+ * BREED
+ * 		Next generation from this one, sorted best first
+ **************************************************************************************/
+int byScore(const void *a, const void *b) {
+	const Candidate *ca = a;
+	const Candidate *cb = b;
+
+	return ca->score < cb->score ? 1 : ca->score > cb->score ? -1 : 0;
+}
+
+const Candidate *tournament(void) {
+	const Candidate *best = NULL;
+	const Candidate *c;
+	int i;
+
+	for (i = 0; i < TOURNAMENT; i++) {
+		c = &population[randomInt() % populationSize];
+		if (!best || c->score > best->score)
+			best = c;
+	}
+	return best;
+}
+
+void breed(void) {
+	Candidate *next = malloc(populationSize * sizeof *next);
+	const Candidate *mother;
+	const Candidate *father;
+	const AiWeights *m;
+	const AiWeights *f;
+	AiWeights *w;
+	int i;
+	int k;
+
+	qsort(population, populationSize, sizeof *population, byScore);
+	for (i = 0; i < populationSize; i++) {
+		if (i < ELITE) {
+			next[i] = population[i];
+			continue;
+		}
+		mother = tournament();
+		father = tournament();
+		m = &mother->weights;
+		f = &father->weights;
+		w = &next[i].weights;
+		for (k = 0; k < WEIGHTS; k++) {
+			WEIGHT(w, k) = randomInt() & 1 ? WEIGHT_OF(m, k) : WEIGHT_OF(f, k);
+			WEIGHT(w, k) += (int)lround(normal() * (abs(WEIGHT(w, k)) / 10.0 + 2));
+		}
+		next[i].score = 0;
+	}
+	memcpy(population, next, populationSize * sizeof *next);
+	free(next);
+}
+
+/***************************************************************************************
+ * CHECKPOINT
+ * 		The population and where the generator was, as text. Written to a temporary
+ * 		file and renamed over, so a run killed halfway leaves the last one whole.
+ **************************************************************************************/
+int save(const char *path) {
+	char temporary[4096];
+	const AiWeights *w;
+	FILE *f;
+	int i;
+	int k;
+
+	snprintf(temporary, sizeof temporary, "%s.tmp", path);
+	if (!(f = fopen(temporary, "w"))) {
+		perror(temporary);
+		return 1;
+	}
+	fprintf(f, "tune %d\ngeneration %d\nrng %llu\nseed %u\ngames %d\nticks %lu\npopulation %d\n",
+			CHECKPOINT_VERSION, generation, rng, seed, games, maxTicks, populationSize);
+	for (i = 0; i < populationSize; i++) {
+		w = &population[i].weights;
+		for (k = 0; k < WEIGHTS; k++)
+			fprintf(f, "%d%c", WEIGHT_OF(w, k), k < WEIGHTS - 1 ? ' ' : '\n');
+	}
+	if (fclose(f) || rename(temporary, path)) {
+		perror(path);
+		return 1;
+	}
+	return 0;
+}
+
+int restore(const char *path) {
+	FILE *f = fopen(path, "r");
+	int version = 0;
+	AiWeights *w;
+	int i;
+	int k;
+
+	if (!f)
+		return 1;										// nothing to carry on from
+	if (fscanf(f, "tune %d generation %d rng %llu seed %u games %d ticks %lu population %d",
+			&version, &generation, &rng, &seed, &games, &maxTicks, &populationSize) != 7 ||
+			version != CHECKPOINT_VERSION || populationSize < 1 || games < 1) {
+		fprintf(stderr, "%s: not a tune checkpoint\n", path);
+		exit(1);
+	}
+	population = calloc(populationSize, sizeof *population);
+	for (i = 0; i < populationSize; i++) {
+		w = &population[i].weights;
+		for (k = 0; k < WEIGHTS; k++)
+			if (fscanf(f, "%d", &WEIGHT(w, k)) != 1) {
+				fprintf(stderr, "%s: cut short\n", path);
+				exit(1);
+			}
+	}
+	fclose(f);
+	printf("tune: carrying on from %s, generation %d\n", path, generation);
+	return 0;
+}
+
+/***************************************************************************************
+ * DIFFERS
+ * 		Warns when a flag asked for something other than the checkpoint had
+ **************************************************************************************/
+void differs(const char *path, const char *flag, bool given, unsigned long asked,
+		unsigned long had) {
+	if (given && asked != had)
+		fprintf(stderr, "tune: %s %lu but %s has %lu, carrying on with that\n", flag, asked,
+				path, had);
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	const char *checkpoint = NULL;
+	const AiWeights *b;
+	int generations = 50;
+	long wanted = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long long t0;
+	unsigned long long total;
+	bool given[4] = {false, false, false, false};	// -p -g -t -s
+	int askedPopulation;
+	int askedGames;
+	unsigned long askedTicks;
+	unsigned int askedSeed;
+	int i;
+	int k;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+			wanted = strtol(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+			populationSize = strtol(argv[++i], NULL, 0);
+			given[0] = true;
+		} else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+			games = strtol(argv[++i], NULL, 0);
+			given[1] = true;
+		} else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			generations = strtol(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			maxTicks = strtoul(argv[++i], NULL, 0);
+			given[2] = true;
+		} else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			seed = strtoul(argv[++i], NULL, 0);
+			given[3] = true;
+		} else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+			checkpoint = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [-j threads] [-p population] [-g games] [-n generations]\n"
+					"       [-t max ticks] [-s seed] [-c checkpoint]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (populationSize <= ELITE || games < 1) {
+		fprintf(stderr, "tune: needs more than %d in the population and a game\n", ELITE);
+		return 2;
+	}
+
+	// first generation is aiDefaults and a cloud of mutants around it
+	askedPopulation = populationSize;
+	askedGames = games;
+	askedTicks = maxTicks;
+	askedSeed = seed;
+	if (checkpoint && !restore(checkpoint)) {
+		differs(checkpoint, "-p", given[0], askedPopulation, populationSize);
+		differs(checkpoint, "-g", given[1], askedGames, games);
+		differs(checkpoint, "-t", given[2], askedTicks, maxTicks);
+		differs(checkpoint, "-s", given[3], askedSeed, seed);
+	} else {
+		rng ^= seed;
+		population = calloc(populationSize, sizeof *population);
+		for (i = 0; i < populationSize; i++) {
+			population[i].weights = aiDefaults;
+			for (k = 0; i && k < WEIGHTS; k++)
+				WEIGHT(&population[i].weights, k) += (int)lround(normal() *
+						(abs(WEIGHT_OF(&aiDefaults, k)) / 2.0 + 10));
+		}
+	}
+	lines = malloc((size_t)populationSize * games * sizeof *lines);
+	if (!population || !lines) {
+		fprintf(stderr, "tune: out of memory\n");
+		return 1;
+	}
+
+	if (wanted < 1)
+		wanted = 1;
+	if (wanted > MAX_THREADS)
+		wanted = MAX_THREADS;
+	pthread_barrier_init(&start, NULL, wanted);
+	pthread_barrier_init(&done, NULL, wanted);
+	for (threadCount = 1; threadCount < wanted; threadCount++)
+		if (pthread_create(&threads[threadCount], NULL, poolThread, NULL)) {
+			fprintf(stderr, "tune: can't start thread %d\n", threadCount);
+			return 1;
+		}
+
+	printf("tune: %d sets, %d games of %lu ticks each, %d threads\n", populationSize, games,
+			maxTicks, threadCount);
+	printf("%4s %12s %12s %8s  %s\n", "gen", "best", "mean", "s", "best weights");
+	while (generation < generations) {
+		t0 = now();
+		evaluate();
+		total = 0;
+		for (i = 0; i < populationSize; i++)
+			total += population[i].score;
+		breed();									// sorts, so population[0] is the best
+		b = &population[0].weights;
+		printf("%4d %12.1f %12.1f %8.2f  {%d, %d, %d, %d, %d}\n", generation,
+				(double)population[0].score / games, (double)total / populationSize / games,
+				(now() - t0) / 1e9, b->height, b->lines, b->holes, b->bumps, b->wells);
+		fflush(stdout);
+		generation++;
+		if (checkpoint && save(checkpoint))
+			return 1;
+	}
+
+	quit = true;
+	if (threadCount > 1)
+		pthread_barrier_wait(&start);
+	for (i = 1; i < threadCount; i++)
+		pthread_join(threads[i], NULL);
+	free(lines);
+	free(population);
+	return 0;
+}
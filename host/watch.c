@@ -0,0 +1,193 @@
+/***************************************************************************************
+ * WATCH
+ * 		A crowd of viewers on one of build/server's sessions, and a check that the
+ * 		updates add up.
+ *
+ * 		build/watch -w path [-i session] [-n viewers] [-t seconds]
+ *
+ * 		Every viewer keeps its own SpecView from the updates. From the second
+ * 		keyframe on, what the deltas since the last one built has to be what the
+ * 		keyframe says, or the stream dropped or garbled something. Reads as fast as
+ * 		it can, so the server shouldn't ever have to resync these.
+ **************************************************************************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../engine.h"
+#include "spectate.h"
+
+#define IO_EVENTS		512
+
+typedef struct {
+	int fd;
+	bool keyed;									// had a keyframe
+	SpecView view;
+	unsigned int have;
+	unsigned char buf[1024];
+} Viewer;
+
+unsigned long long updates;
+unsigned long long keys;
+unsigned long long checked;
+unsigned long long mismatches;
+unsigned long long bytes;
+
+/***************************************************************************************
+ * NOW
+ * 		Monotonic nanoseconds
+ **************************************************************************************/
+unsigned long long now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// everything a keyframe and the deltas before it should agree on
+bool same(const SpecView *a, const SpecView *b) {
+	return !memcmp(a->rows, b->rows, sizeof a->rows) && a->totalLines == b->totalLines &&
+			a->level == b->level && a->piece == b->piece && a->rotation == b->rotation &&
+			a->xPos == b->xPos && a->yPos == b->yPos && a->pieceAlive == b->pieceAlive &&
+			a->gameAlive == b->gameAlive;
+}
+
+/***************************************************************************************
+ * VIEWER READ
+ * 		Everything waiting for v, applied. false once the server's closed it.
+ **************************************************************************************/
+bool viewerRead(Viewer *v) {
+	SpecView was;
+	ssize_t n;
+	size_t used;
+	unsigned int at;
+
+	for (;;) {
+		n = recv(v->fd, v->buf + v->have, sizeof v->buf - v->have, 0);
+		if (n == 0)
+			return false;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		bytes += n;
+		v->have += n;
+		for (at = 0; ; at += used) {
+			was = v->view;
+			if (!(used = specApply(&v->view, v->buf + at, v->have - at)))
+				break;
+			updates++;
+			if (v->buf[at] != SPEC_KEY)
+				continue;
+			keys++;
+			if (v->keyed) {
+				checked++;
+				mismatches += !same(&was, &v->view);
+			}
+			v->keyed = true;
+		}
+		memmove(v->buf, v->buf + at, v->have - at);
+		v->have -= at;
+	}
+}
+
+/***************************************************************************************
+ * MAIN
+ **************************************************************************************/
+int main(int argc, char **argv) {
+	struct epoll_event events[IO_EVENTS];
+	struct epoll_event ev;
+	struct sockaddr_un un;
+	struct rlimit rl;
+	const char *path = NULL;
+	unsigned int id = 0;
+	unsigned int count = 100;
+	unsigned int open;
+	double seconds = 10;
+	unsigned long long t0;
+	unsigned long long end;
+	unsigned char hello[2];
+	Viewer *viewers;
+	Viewer *v;
+	double s;
+	unsigned int j;
+	int epfd;
+	int n;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			path = argv[++i];
+		else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			id = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			count = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			seconds = strtod(argv[++i], NULL);
+		else
+			break;
+	}
+	if (i < argc || !path || count < 1) {
+		fprintf(stderr, "usage: %s -w path [-i session] [-n viewers] [-t seconds]\n", argv[0]);
+		return 2;
+	}
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	viewers = calloc(count, sizeof *viewers);
+	epfd = epoll_create1(0);
+	if (!viewers || epfd < 0) {
+		fprintf(stderr, "watch: out of memory\n");
+		return 1;
+	}
+	memset(&un, 0, sizeof un);
+	un.sun_family = AF_UNIX;
+	strncpy(un.sun_path, path, sizeof un.sun_path - 1);
+	hello[0] = id;
+	hello[1] = id >> 8;
+	for (j = 0; j < count; j++) {
+		v = &viewers[j];
+		v->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (v->fd < 0 || connect(v->fd, (struct sockaddr *)&un, sizeof un) < 0 ||
+				send(v->fd, hello, 2, MSG_NOSIGNAL) != 2) {
+			fprintf(stderr, "watch: can't connect to %s: %s\n", path, strerror(errno));
+			return 1;
+		}
+		fcntl(v->fd, F_SETFL, fcntl(v->fd, F_GETFL) | O_NONBLOCK);
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		ev.data.ptr = v;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, v->fd, &ev);
+	}
+
+	open = count;
+	t0 = now();
+	end = t0 + (unsigned long long)(seconds * 1e9);
+	while (open && now() < end) {
+		n = epoll_wait(epfd, events, IO_EVENTS, 100);
+		for (i = 0; i < n; i++) {
+			v = events[i].data.ptr;
+			if (v->fd >= 0 && !viewerRead(v)) {
+				close(v->fd);
+				v->fd = -1;
+				open--;
+			}
+		}
+	}
+	s = (now() - t0) / 1e9;
+
+	printf("watch: %u viewers of session %u, %.1f s, %u still open\n", count, id, s, open);
+	printf("updates    %12llu, %llu keyframes, %.1f bytes each\n", updates, keys,
+			updates ? (double)bytes / updates : 0.0);
+	printf("keyframes  %12llu checked against the deltas, %llu mismatches\n", checked,
+			mismatches);
+	printf("%.1f bytes/s a viewer\n", bytes / s / count);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************************
+ * LINK
+ * 		Frame encode/decode for versus play. No hardware in here, the same code runs on
+ * 		the unit and in the host stand-in.
+ **************************************************************************************/
+#include "link.h"
+
+/***************************************************************************************
+ * LINK ENCODE
+ * 		Packs a frame into the 3 bytes at out
+ **************************************************************************************/
+void linkEncode(unsigned char *out, unsigned char kind, unsigned char payload, unsigned long tick) {
+	out[0] = 0x80 | (kind << 5) | (payload & 0x1F);
+	out[1] = (tick >> 7) & 0x7F;
+	out[2] = tick & 0x7F;
+}
+
+/***************************************************************************************
+ * LINK DECODE
+ * 		Feeds one received byte in. Returns true and fills f when it finishes a frame.
+ * 		A byte with the top bit set always starts a new frame, stray bytes are dropped.
+ **************************************************************************************/
+bool linkDecode(LinkDecoder *d, unsigned char byte, LinkFrame *f) {
+	if (byte & 0x80) {
+		d->buf[0] = byte;
+		d->have = 1;
+		return false;
+	}
+	if (d->have == 0)
+		return false;							// middle of a frame we never saw start
+
+	d->buf[d->have++] = byte;
+	if (d->have < LINK_FRAME)
+		return false;
+
+	d->have = 0;
+	f->kind = (d->buf[0] >> 5) & 0x03;
+	f->payload = d->buf[0] & 0x1F;
+	f->tick = ((unsigned int)d->buf[1] << 7) | d->buf[2];
+	return true;
+}
+
+/***************************************************************************************
+ * LINK UNWRAP
+ * 		Turns the 14 tick bits off the wire back into a full tick, picking whichever
+ * 		one is nearest ref (the last tick we know about from that side)
+ **************************************************************************************/
+unsigned long linkUnwrap(unsigned long ref, unsigned int tick) {
+	unsigned long t = (ref & ~(unsigned long)LINK_TICK_MASK) | (tick & LINK_TICK_MASK);
+
+	if (t + (LINK_TICK_MASK + 1) / 2 < ref)
+		t += LINK_TICK_MASK + 1;
+	else if (t > ref + (LINK_TICK_MASK + 1) / 2 && t > LINK_TICK_MASK)
+		t -= LINK_TICK_MASK + 1;
+	return t;
+}
@@ -0,0 +1,54 @@
+/***************************************************************************************
+ * LINK
+ * 		Framing for two unit versus play over the USCI_A0 UART. Only inputs go over the
+ * 		wire, each side runs both games from them.
+ *
+ * 		Every frame is 3 bytes, only the first has its top bit set so a receiver that
+ * 		comes in half way through a frame lines itself back up:
+ * 			1kkppppp  0ttttttt  0ttttttt
+ * 		k is the kind, p a 5 bit payload and t the low 14 bits of the game tick.
+ *
+ * 		A unit sends an INPUT frame on any tick with a press or a new joystick zone and
+ * 		a SYNC frame every LINK_SYNC_TICKS otherwise. At 100 ticks/s that is 75 bytes/s
+ * 		idle and a few hundred with someone mashing buttons, well under the 960 bytes/s
+ * 		of a 9600 baud link.
+ *
+ * 		A SYNC's payload is the low bits of the sender's gameHash at its tick. Lose an
+ * 		INPUT and the other side's copy of that game stops hashing the same, so the
+ * 		next SYNC gives it away instead of the match quietly going two ways.
+ **************************************************************************************/
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdbool.h>
+
+// Frame Kinds
+#define LINK_HELLO			0			// want a match, tick field is our seed
+#define LINK_INPUT			1			// presses and joystick zone at tick
+#define LINK_SYNC				2			// nothing else from us up to and including tick,
+															// payload is gameHash & LINK_HASH_MASK
+#define LINK_BYE				3			// topped out at tick
+
+#define LINK_FRAME			3			// bytes in a frame
+#define LINK_TICK_MASK	0x3FFF	// tick bits that go over the wire
+#define LINK_DELAY			8			// ticks before garbage comes up on the other side,
+															// also how far one side may run ahead
+#define LINK_SYNC_TICKS	4			// longest quiet spell before a SYNC goes out
+#define LINK_HASH_MASK	0x1F		// gameHash bits a SYNC carries
+
+typedef struct {
+	unsigned char kind;
+	unsigned char payload;
+	unsigned int tick;					// low 14 bits only, see linkUnwrap
+} LinkFrame;
+
+typedef struct {
+	unsigned char have;					// bytes of the current frame so far
+	unsigned char buf[LINK_FRAME];
+} LinkDecoder;
+
+void linkEncode(unsigned char *, unsigned char, unsigned char, unsigned long);
+bool linkDecode(LinkDecoder *, unsigned char, LinkFrame *);
+unsigned long linkUnwrap(unsigned long, unsigned int);
+
+#endif
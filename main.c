@@ -7,11 +7,15 @@
  **************************************************************************************/
 #include "msp430g2553.h"
 #include <stdbool.h>
+#include "engine.h"
+#include "draw.h"
+#include "link.h"
+#include "profile.h"
 
 // Pin Definitions
 #define TS_XM			0x0001		// P1.0 : X-
-#define TS_YP			0x0002		// P1.1 : Y+
-#define TS_XP			0x0004		// P1.2 : X+
+#define TS_YP			0x0002		// P1.1 : Y+		(UART RXD in versus)
+#define TS_XP			0x0004		// P1.2 : X+		(UART TXD in versus)
 #define TS_YM			0x0008		// P1.3 : Y-
 														// P1.4 : J1 (Y-axis Joystick)
 #define BTN_ROT		0x0040		// P1.6 : rotate btn
@@ -23,1339 +27,852 @@
 #define LCD_RST 	0x0001		// P2.0 : reset
 #define LCD_CS		0x0002		// P2.1 : chip select
 #define LCD_DC		0x0004		// P2.2 : Data/Cmd
+#define LINK_RXD	0x0002		// P1.1 : UART from the other unit
+#define LINK_TXD	0x0004		// P1.2 : UART to the other unit
+
+// Game States
+#define STATE_TITLE				0		// "tap to start", waiting for the first touch
+#define STATE_PLAYING			1		// piece in play, one step per tick
+#define STATE_LINE_CLEAR	2		// board collapsed, redrawing one row per tick
+#define STATE_GAME_OVER		3		// "tap to start", waiting for a new game
+#define STATE_PAUSED			4		// touch during play, touch again to resume
+#define STATE_LINK_WAIT		5		// versus, waiting to hear from the other unit
+#define STATE_VERSUS			6		// versus, piece in play in lockstep with the other unit
+
+// Events										// set by interrupts, consumed by the main loop
+#define EV_TICK			0x01
+#define EV_LEFT			0x02
+#define EV_RIGHT		0x04
+#define EV_ROTATE		0x08
+#define EV_LINK			0x10		// bytes from the other unit
+
+// Timing
+#define TICK_FAST		25000		// SMCLK/8 : 10 ms game tick
+#define TICK_SLOW		1200		// ACLK (VLO ~12 kHz) : ~100 ms idle touch poll
+#define TOUCH_TICKS	10			// poll touchscreen for pause every 100 ms
+#define ATTRACT_TICKS	100		// idle ticks (~10 s) before the demo starts playing
+#define HELLO_TICKS	50			// resend HELLO every 500 ms while waiting
+
+// Link
+#define SMCLK_HZ		20000000UL
+#define LINK_BAUD		38400UL
+#define LINK_DIV		((SMCLK_HZ + LINK_BAUD / 2) / LINK_BAUD)	// UCOS16, UCBR x16 + UCBRF
+#define LINK_RING		16			// UART buffer bytes, power of 2
+
+// Attract Mode AI							// weights x100 on aggregate height, cleared lines,
+#define AI_HEIGHT		-51			// holes and bumpiness
+#define AI_LINES		76
+#define AI_HOLES		-36
+#define AI_BUMPS		-18
+#define AI_EVALS_PER_TICK	4		// placements scored per tick, keeps a tick ~1 ms
 
 // Function Prototypes
-void writeLCDData(char);
-void writeLCDControl(char);
 void waitMS(unsigned int);
 void initClk(void);
 void initPins(void);
 void initLCD(void);
 void initUSCI(void);
-void initBackground(void);
+void initTimer(void);
 void readTS(void);
-void drawPixel(int, int, int);
-void drawLetter(char, char, char, int);
-void drawInstruction(char, char, int);
-void fillScreen(int);
-void checkCollisions(void);
-void placePiece(void);
-void removePiece(void);
+bool tapped(void);
 void drawGrid(void);
-void drawSquare(int, int, int);
-void drawPiece(int, int);
-void erasePiece(int, int);
+void drawRow(int);
 void setLevelColor(void);
 void drawLevelColor(void);
-void drawScore(void);
-void checkGameOver(void);
+void drawMeter(unsigned int);
+void newGame(unsigned int);
+void setTick(bool);
+void enterState(unsigned char);
+void handleTitle(unsigned char);
+void handlePlaying(unsigned char);
+void handleLineClear(unsigned char);
+void handleGameOver(unsigned char);
+void handlePaused(unsigned char);
+void handleLinkWait(unsigned char);
+void handleVersus(unsigned char);
 void step(void);
+void show(unsigned char, unsigned char, unsigned char, unsigned char, unsigned char);
+unsigned int readJoystick(void);
+unsigned char stickZone(unsigned int);
+void aiTick(void);
+int aiEvaluate(unsigned int, int);
+void linkOpen(void);
+void linkClose(void);
+void linkSend(unsigned char, unsigned char, unsigned long);
+void linkReceive(void);
+void peerTick(unsigned char);
+void peerAdvance(unsigned long);
+void peerGuessAgain(void);
+#ifdef PROFILE
+void initProfile(void);
+unsigned char profSmall(unsigned long);
+void profSend(void);
+unsigned char profByte(unsigned char);
+#endif
 
 // Global Variables												// most are self descriptive
 unsigned int z;														// touchscreen touch pressure
-unsigned int level = 1;
-unsigned int linesCleared = 0;
-unsigned int scoreVerticlePosition = 0;		// scoring system on top right
-unsigned int piece;												// what piece is in play
-unsigned int rotation;										// rotation of piece
-unsigned int xPos;												// top left corner of piece
-unsigned int yPos;
-unsigned int dropCounter = 0;							// timer to slow/speed up block fall
-unsigned int keyPress = 1;								// needed for 'random' algorithm
-unsigned int levelColor = 0xAEBB;					// cycles as level up
-unsigned int scoreColumn = 0;							// scoring variables
-unsigned int scoreRow = 0;
+unsigned int levelColor;									// cycles as level up
 unsigned int downJoystick;
-unsigned int graceTime = 0;								// block touches but it's still 'alive'
-bool start = false;
-bool pieceAlive = false;
-bool leftKey = false;
-bool rightKey = false;
-bool rotateKey = false;
-bool fullLine = false;
-bool canRotate = true;
-bool canRight = true;
-bool canLeft = true;
-bool canDown = true;
-bool gameAlive = true;
-
-unsigned int grid[14][10] = {
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+unsigned int clearRow;										// next row to redraw after a line clear
+unsigned int touchCounter;								// ticks until next pause poll
+unsigned int idleTicks;										// slow ticks spent waiting for a tap
+unsigned char state = STATE_TITLE;				// what the main loop is doing
+unsigned char presses;										// IN_ presses since the last tick
+volatile unsigned char events = 0;				// pending EV_ flags from interrupts
+bool touchHeld = false;										// so one touch is one tap
+bool demo = false;												// the AI is playing (attract mode)
+
+Game game;																// the game on this screen
+
+// Versus. peer is the other unit's game run only as far as its inputs have come in,
+// peerGuess is peer run on to our tick assuming no more presses, which is right
+// nearly every tick. When a press shows up late the guess is thrown away and run
+// again from peer. Not in the profile build, the histograms go where they were.
+#ifndef PROFILE
+Game peer;
+Game peerGuess;
+Garbage toUs[GARBAGE_QUEUE];							// from peer's clears, for game
+Garbage toPeer[GARBAGE_QUEUE];						// from our clears, for peer
+LinkDecoder linkDecoder;
+#else
+ProfRegion profRegions[PROF_REGIONS];
+volatile unsigned int profHigh;						// Timer1_A wraps, the top of profNow
+unsigned int profRandom = 1;							// LFSR, which calls a halved region counts
+#endif
+unsigned long lastSent;										// tick of our last frame out
+unsigned int seed;												// our seed for the match
+unsigned char lastStick;									// joystick zone in our last frame
+unsigned char peerStick;									// joystick zone in peer's last frame
+unsigned char meterHeight;								// peer stack height on screen
+unsigned char linkRx[LINK_RING];					// bytes in from the UART
+unsigned char linkTx[LINK_RING];					// bytes out to the UART
+volatile unsigned char linkRxHead;
+unsigned char linkRxTail;
+unsigned char linkTxHead;
+volatile unsigned char linkTxTail;
+volatile bool linkLost;										// a byte lost coming in, or a SYNC that didn't match
+bool linkOpened = false;
+
+// Attract mode AI, the whole search state. Scratch board and heights live on the
+// stack in aiEvaluate so the AI never holds more than ~60 bytes of RAM
+unsigned char aiRotation;									// placement being scored next
+signed char aiColumn;
+unsigned char aiBestRotation;							// best placement so far
+signed char aiBestColumn;
+int aiBestScore;
+unsigned int aiStick;											// pretend joystick reading
+bool aiSearching = false;									// still scoring placements
+bool aiNewPiece = false;									// step spawned, plan again
+
+unsigned char grid[14][10];								// colors of game.rows, 0 is empty
 
 /***************************************************************************************
  * MAIN
- * 		Initialize game variables and setup. Send control to STEP for main game logic
+ * 		Setup, then sleep until an interrupt posts an event and hand it to the current
+ * 		state. Every state returns straight back here, so the CPU only runs when a tick
+ * 		or a button needs it.
  **************************************************************************************/
 void main(void) {
+	unsigned char ev;
+
 	WDTCTL = WDTPW + WDTHOLD;		// Stop watchdog timer
 
 	initClk();									// Init clock to 20 MHz
 	initPins();									// Init Pin Functionality
 	initUSCI();									// Init USCI (SPI)
 	initLCD();									// Init LCD Controller
-	fillScreen(0x5B57);					// Init start screen w/ instruction
-	drawInstruction(85, 61, 0x0000);
-	drawInstruction(84, 60, 0xFFFF);
-
-	// Don't start until a touchscreen input
-	while (!start) {
-		readTS();
-		if (z > 100) {
-			initBackground();				// main UI draw
-			drawLevelColor();
-			start = true;
+	initTimer();								// Init Timer_A tick
+#ifdef PROFILE
+	initProfile();							// Timer1_A counting cycles
+#endif
+	enterState(STATE_TITLE);		// start screen w/ instruction
+
+	while (1) {
+		_DINT();
+		if (events == 0) {
+			// playing needs SMCLK for the tick, SPI and UART, idle screens only need ACLK
+			if (state == STATE_TITLE || state == STATE_GAME_OVER || state == STATE_PAUSED)
+				_BIS_SR(LPM3_bits + GIE);
+			else
+				_BIS_SR(LPM0_bits + GIE);
+			_DINT();
 		}
-	}
+		ev = events;
+		events = 0;
+		_EINT();
 
-	start = false;							// for when we start again
+#ifndef PROFILE
+		// the other unit doesn't stop talking while we redraw
+		if ((ev & EV_LINK) && linkOpened)
+			linkReceive();
+#endif
 
-	while (1) {
-		step();										// always stay in this loop
+		switch (state) {
+		case STATE_TITLE:
+			handleTitle(ev);
+			break;
+		case STATE_PLAYING:
+			handlePlaying(ev);
+			break;
+		case STATE_LINE_CLEAR:
+			handleLineClear(ev);
+			break;
+		case STATE_GAME_OVER:
+			handleGameOver(ev);
+			break;
+		case STATE_PAUSED:
+			handlePaused(ev);
+			break;
+#ifndef PROFILE
+		case STATE_LINK_WAIT:
+			handleLinkWait(ev);
+			break;
+		case STATE_VERSUS:
+			handleVersus(ev);
+			break;
+#endif
+		}
 	}
 }
 
 /***************************************************************************************
- * STEP
- * 		All game movement handling per cycle
+ * ENTER STATE
+ * 		Switches state, doing whatever drawing the new state needs once and picking the
+ * 		tick rate it runs at.
  **************************************************************************************/
-void step() {
-	int i;					// for loops
-	int j;
-	int k;
-
-	while (gameAlive) {
-		checkCollisions();				// get status of where piece can move
-
-		if (!canDown) {
-			graceTime++;						// increment so piece stays alive
-
-			if (graceTime > 9000) {
-				pieceAlive = false;		// okay, piece is set
-
-				// loop through rows to see if one is full
-				for (i = 0; i < 14; i++) {
-					fullLine = true;
-					for (j = 0; j < 10; j++)
-						if (grid[i][j] == 0)
-							fullLine = false;
-
-					// if so, delete line
-					if (fullLine) {
-						for (k = 0; (i - k) >= 0; k++)
-							for (j = 0; j < 10; j++)
-								if (i - k == 0)				// fill with zero if top row
-									grid[i - k][j] = 0;
-								else									// else fill with above row
-									grid[i - k][j] = grid[i - (1 + k)][j];
-
-						drawScore();								// score columns formatting and outputting
-						linesCleared++;
-						scoreRow += 2;
-						if (linesCleared % 10 == 0) {
-							scoreColumn += 2;
-							scoreRow = 0;
-						}
-
-						// level up logic, color
-						if (linesCleared == level * 10) {
-							level++;
-							linesCleared = 0;
-							setLevelColor();
-							drawLevelColor();
-						}
-						drawGrid();									// and draw the entire board
-					}
-				}
-				graceTime = 0;
-			}
+void enterState(unsigned char next) {
+	switch (next) {
+	case STATE_GAME_OVER:
+		if (linkOpened) {
+			linkSend(LINK_BYE, 0, game.tick);
+			linkClose();
 		}
-
-		// piece move/draw logic
-		if (!pieceAlive) {
-			// new piece, start loc, random piece gen, check gameover
-			xPos = 4;
-			yPos = 0;
-			piece = (keyPress % 7) + 1;
-			rotation = 0;
-			checkGameOver();
-			placePiece();
-			pieceAlive = true;
-			drawPiece(20+(20*xPos), 30+(20*yPos));
-		} else if (leftKey && canLeft) {						// simple left shift
-			erasePiece(20+(20*xPos), 30+(20*yPos));
-			removePiece();
-			xPos--;
-			placePiece();
-			drawPiece(20+(20*xPos), 30+(20*yPos));
-			leftKey = false;
-		} else if (rightKey && canRight) {					// simple right shift
-			erasePiece(20+(20*xPos), 30+(20*yPos));
-			removePiece();
-			xPos++;
-			placePiece();
-			drawPiece(20+(20*xPos), 30+(20*yPos));
-			rightKey = false;
-		} else if (rotateKey && canRotate) {				// rotate logic and erase/draw
-			erasePiece(20+(20*xPos), 30+(20*yPos));
-			removePiece();
-			if (rotation <3)
-				rotation++;
-			else
-				rotation = 0;
-			placePiece();
-			drawPiece(20+(20*xPos), 30+(20*yPos));
-			rotateKey = false;
+		if (!demo) {
+			drawInstruction(85, 61, 0x0000);
+			drawInstruction(84, 60, 0xFFFF);
+			idleTicks = 0;
+			setTick(false);
+			break;
 		}
+		demo = false;								// demo game ended, back to the title
+		next = STATE_TITLE;
+		// fall through
+	case STATE_TITLE:
+		fillScreen(0x5B57);
+		drawInstruction(85, 61, 0x0000);
+		drawInstruction(84, 60, 0xFFFF);
+		idleTicks = 0;
+		setTick(false);
+		break;
+	case STATE_PLAYING:
+		if (state == STATE_PAUSED)
+			drawLevelColor();				// put the level back
+		touchCounter = TOUCH_TICKS;
+		setTick(true);
+		break;
+	case STATE_LINE_CLEAR:
+		clearRow = 0;
+		break;
+	case STATE_PAUSED:
+		fillLevelColor(0x5B57);		// level hidden while paused
+		setTick(false);
+		break;
+	case STATE_LINK_WAIT:
+		linkOpen();
+		idleTicks = 0;
+		setTick(true);
+		break;
+	case STATE_VERSUS:
+		if (state == STATE_LINK_WAIT)
+			drawMeter(0);
+		break;
+	}
+	state = next;
+}
+
+/***************************************************************************************
+ * NEW GAME
+ * 		Starts our game from seed and draws the board
+ **************************************************************************************/
+void newGame(unsigned int s) {
+	int i;
+	int j;
+
+	gameReset(&game, s);
+	levelColor = 0xAEBB;
+	presses = 0;
+
+	// fills grid to full empty 0's
+	for (i = 0; i < 14; i++)
+		for (j = 0; j < 10; j++)
+			grid[i][j] = 0;
+	aiSearching = false;
+	aiNewPiece = false;
+
+	initBackground();							// main UI draw
+	drawLevelColor();
+}
 
-		// with arbitrary counter, piece drops at according rate
-		if (dropCounter > (24000 - (level-1)*1166) && canDown) {
-			erasePiece(20+(20*xPos), 30+(20*yPos));
-			removePiece();
-			yPos++;
-			placePiece();
-			drawPiece(20+(20*xPos), 30+(20*yPos));
-			leftKey = false;
-			rightKey = false;
-			rotateKey = false;
-			keyPress++;
-			dropCounter = 0;
+/***************************************************************************************
+ * HANDLE TITLE / GAME OVER
+ * 		Idle on the slow tick, polling the touchscreen. A tap starts a new game, a tap
+ * 		with rotate held starts versus, nobody tapping for long enough starts the demo.
+ **************************************************************************************/
+void handleTitle(unsigned char ev) {
+	if (!(ev & EV_TICK))
+		return;
+
+	if (tapped()) {
+		if (P1IN & BTN_ROT) {
+#ifdef PROFILE
+			profSend();								// the profile build's versus, see profile.h
+#else
+			seed = TA0R & LINK_TICK_MASK;	// VLO count, different every time
+			enterState(STATE_LINK_WAIT);
+#endif
+		} else {
+			newGame(1);
+			enterState(STATE_PLAYING);
 		}
+	} else if (++idleTicks == ATTRACT_TICKS) {
+		demo = true;
+		newGame(1);
+		enterState(STATE_PLAYING);
+	}
+}
 
-		// joystick y-axis read
-		ADC10CTL0 = ADC10SHT_2 + ADC10ON;
-		ADC10CTL1 = INCH_4;
-		ADC10AE0 = BIT4;
-		ADC10CTL0 |= ENC + ADC10SC;
-		while (ADC10CTL1 & 0x0001);
-		downJoystick = ADC10MEM;
-
-		// different amounts of pull, pulls piece faster
-		if (downJoystick < 100)
-			dropCounter += 24000;
-		else if (downJoystick < 200)
-			dropCounter += 500;
-		else if (downJoystick < 455)
-			dropCounter += 100;
-
-		// each cycle increments to give drop rate
-		dropCounter++;
+void handleGameOver(unsigned char ev) {
+	handleTitle(ev);
+}
+
+/***************************************************************************************
+ * HANDLE PLAYING
+ * 		Buttons are remembered until the next step, every tick runs one step and every
+ * 		so often the touchscreen is checked for a pause.
+ **************************************************************************************/
+void handlePlaying(unsigned char ev) {
+	if (!demo) {								// the demo doesn't listen to buttons
+		if (ev & EV_LEFT)
+			presses |= IN_LEFT;
+		if (ev & EV_RIGHT)
+			presses |= IN_RIGHT;
+		if (ev & EV_ROTATE)
+			presses |= IN_ROTATE;
 	}
 
-	// if we get a game over we come here
-	// "tap to start"
-	drawInstruction(85, 61, 0x0000);
-	drawInstruction(84, 60, 0xFFFF);
-
-	// reinitialize everything after waiting for touchscreen
-	while (!start) {
-		readTS();
-		if (z > 100) {
-			level = 1;
-			linesCleared = 0;
-			scoreVerticlePosition = 0;
-			dropCounter = 0;
-			keyPress = 1;
-			levelColor = 0xAEBB;
-			scoreColumn = 0;
-			scoreRow = 0;
-			pieceAlive = false;
-			leftKey = false;
-			rightKey = false;
-			rotateKey = false;
-			fullLine = false;
-			canRotate = true;
-			canRight = true;
-			canLeft = true;
-			canDown = true;
-			gameAlive = true;
-			initBackground();
-			drawLevelColor();
-			start = true;
+	if (!(ev & EV_TICK))
+		return;
 
-			// fills grid to full empty 0's
-			for (i = 0; i < 14; i++) {
-				for (j = 0; j < 10; j++) {
-					grid[i][j] = 0;
-				}
+	if (demo)
+		aiTick();
+	step();
+
+	if (state != STATE_PLAYING)		// step moved us on
+		return;
+
+	if (--touchCounter == 0) {
+		touchCounter = TOUCH_TICKS;
+		if (tapped()) {
+			if (demo) {							// tap during the demo starts a real game
+				demo = false;
+				newGame(1);
+			} else {
+				enterState(STATE_PAUSED);
 			}
 		}
 	}
-	start = false;
 }
 
 /***************************************************************************************
- * CHECK COLLISIONS
- * 		Self exlpanatory, but checks alive piece's ability to go left, right, down, rotate
- * 		High asserted, everything is true until set false.
+ * HANDLE LINE CLEAR
+ * 		The grid has already changed, redraw it a row a tick so buttons and the timer
+ * 		are never held off for a whole board redraw. Then back to whoever was playing.
  **************************************************************************************/
-void checkCollisions(void) {
-	canLeft = true;
-	canRight = true;
-	canRotate = true;
-	canDown = true;
-
-	if (xPos == 0)
-		canLeft = false;							// Regardless of piece, cant go left from here
-
-	// takes piece then rotation -> checks left, right, rotate down
-	switch (piece) {
-	case 1:	// O
-		if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-		if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-		if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-			canDown = false;
-		break;
-	case 2: // I
-		switch (rotation) {
-		case 0:
-		case 2:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos - 1] != 0 || grid[yPos + 3][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 3][xPos + 1] != 0 || xPos == 9)
-				canRight = false;
-			if (xPos > 6 || grid[yPos][xPos + 1] != 0 || grid[yPos][xPos + 2] != 0 || grid[yPos][xPos + 3] != 0)
-				canRotate = false;
-			if (yPos == 10 || grid[yPos + 4][xPos] != 0)
-				canDown = false;
-			break;
-		case 1:
-		case 3:
-			if (grid[yPos][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 4] != 0 || xPos == 6)
-				canRight = false;
-			if (xPos == 9 || grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos] != 0 || grid[yPos + 3][xPos] != 0)
-				canRotate = false;
-			if (yPos == 13 || grid[yPos + 1][xPos] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 1][xPos + 3] != 0)
-				canDown = false;
-			break;
-		}
-		break;
-	case 3: // Z
-		switch (rotation) {
-		case 0:
-		case 2:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 3] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 1:
-		case 3:
-			if (grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos == 9 || grid[yPos][xPos] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 3][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canDown = false;
-			break;
-		}
-		break;
-	case 4: // S
-		switch (rotation) {
-		case 0:
-		case 2:
-			if (grid[yPos][xPos] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 3] != 0 || grid[yPos + 1][xPos + 2] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 1:
-		case 3:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 2][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos == 9 || grid[yPos][xPos + 1] != 0 || grid[yPos][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 2][xPos] != 0 || grid[yPos + 3][xPos + 1] != 0)
-				canDown = false;
-			break;
-		}
-		break;
-	case 5: // J
-		switch (rotation) {
-		case 0:
-			if (grid[yPos][xPos] != 0 || grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 2][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos][xPos] != 0 || grid[yPos + 1][xPos] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 3][xPos] != 0 || grid[yPos + 3][xPos + 1] != 0)
-				canDown = false;
-			break;
-		case 1:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos + 3] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 2][xPos] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 2:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos + 1] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 3][xPos] != 0 || grid[yPos + 1][xPos + 1] != 0)
-				canDown = false;
-			break;
-		case 3:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos + 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 3] != 0 || grid[yPos + 1][xPos + 3] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 1][xPos] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0)
-				canDown = false;
-			break;
-		}
-		break;
-	case 6: // L
-		switch (rotation) {
-		case 0:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos][xPos + 1] != 0 || grid[yPos][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 3][xPos] != 0 || grid[yPos + 3][xPos + 1] != 0)
-				canDown = false;
-			break;
-		case 1:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 3] != 0 || grid[yPos + 1][xPos + 1] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 1][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 2:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 2][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 1][xPos] != 0 || grid[yPos + 3][xPos + 1] != 0)
-				canDown = false;
-			break;
-		case 3:
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 3] != 0 || grid[yPos + 1][xPos + 3] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos][xPos] != 0 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0)
-				canDown = false;
-			break;
-		}
-		break;
-	case 7: // T
-		switch (rotation) {
-		case 0:
-			if (grid[yPos][xPos] != 0 || grid[yPos + 1][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 3] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos][xPos] != 0 || grid[yPos + 2][xPos] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 2][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 2][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 1:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos - 1] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 2][xPos + 1] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos][xPos + 1] != 0 || grid[yPos][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 3][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canDown = false;
-			break;
-		case 2:
-			if (grid[yPos][xPos - 1] != 0 || grid[yPos + 1][xPos] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 3] != 0 || grid[yPos + 1][xPos + 2] != 0 || xPos == 7)
-				canRight = false;
-			if (grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0)
-				canRotate = false;
-			if (yPos == 12 || grid[yPos + 1][xPos] != 0 || grid[yPos + 2][xPos + 1] != 0 || grid[yPos + 1][xPos + 2] != 0)
-				canDown = false;
-			break;
-		case 3:
-			if (grid[yPos][xPos] != 0 || grid[yPos + 1][xPos - 1] != 0 || grid[yPos + 2][xPos] != 0)
-				canLeft = false;
-			if (grid[yPos][xPos + 2] != 0 || grid[yPos + 1][xPos + 2] != 0 || grid[yPos + 2][xPos + 2] != 0 || xPos == 8)
-				canRight = false;
-			if (xPos > 7 || grid[yPos + 1][xPos + 2] != 0)
-				canRotate = false;
-			if (yPos == 11 || grid[yPos + 2][xPos] != 0 || grid[yPos + 3][xPos + 1] != 0)
-				canDown = false;
-			break;
-		}
-		break;
+void handleLineClear(unsigned char ev) {
+	if (!(ev & EV_TICK))
+		return;
+
+	drawRow(clearRow++);
+	if (clearRow == 14) {
+		if (game.pieceAlive)				// garbage came up under it
+			paintPiece(20+(20*game.xPos), 30+(20*game.yPos), game.piece, game.rotation, game.piece);
+		enterState(linkOpened ? STATE_VERSUS : STATE_PLAYING);
 	}
 }
 
 /***************************************************************************************
- * CHECK GAME OVER
- * 		Checks to see if there is already blocks in the place the new piece is generated.
- * 		If so, the game is over.
+ * HANDLE PAUSED
+ * 		Nothing moves, buttons are dropped. A tap goes back to playing.
  **************************************************************************************/
-void checkGameOver(void) {
-	switch (piece) {
-	case 1:
-		if (grid[yPos][xPos] != 0 | grid[yPos + 1][xPos] != 0 | grid[yPos][xPos + 1] != 0 | grid[yPos + 1][xPos + 1] != 0)
-			gameAlive = false;
-		break;
-	case 2:
-		if (grid[yPos][xPos] != 0 | grid[yPos + 1][xPos] != 0 | grid[yPos + 2][xPos] != 0 | grid[yPos + 3][xPos] != 0)
-			gameAlive = false;
-		break;
-	case 3:
-		if (grid[yPos][xPos] != 0 | grid[yPos][xPos + 1] != 0 | grid[yPos + 1][xPos + 1] != 0 | grid[yPos + 1][xPos + 2] != 0)
-			gameAlive = false;
-		break;
-	case 4:
-		if (grid[yPos][xPos + 1] != 0 | grid[yPos][xPos + 2] != 0 | grid[yPos + 1][xPos] != 0 | grid[yPos + 1][xPos + 1] != 0)
-			gameAlive = false;
-		break;
-	case 5:
-		if (grid[yPos][xPos + 1] != 0 | grid[yPos + 1][xPos + 1] != 0 | grid[yPos + 2][xPos] != 0 | grid[yPos + 2][xPos + 1] != 0)
-			gameAlive = false;
-		break;
-	case 6:
-		if (grid[yPos][xPos] != 0 | grid[yPos + 1][xPos] != 0 | grid[yPos + 2][xPos] != 0 | grid[yPos + 2][xPos + 1] != 0)
-			gameAlive = false;
-		break;
-	case 7:
-		if (grid[yPos][xPos + 1] != 0 | grid[yPos + 1][xPos] != 0 | grid[yPos +1][xPos + 1] != 0 | grid[yPos + 1][xPos + 2] != 0)
-			gameAlive = false;
-		break;
+void handlePaused(unsigned char ev) {
+	if ((ev & EV_TICK) && tapped())
+		enterState(STATE_PLAYING);
+}
+
+#ifndef PROFILE
+/***************************************************************************************
+ * HANDLE LINK WAIT
+ * 		Keep saying HELLO until the other unit does. Any button gives up. linkReceive
+ * 		starts the match.
+ **************************************************************************************/
+void handleLinkWait(unsigned char ev) {
+	if (ev & (EV_LEFT | EV_RIGHT | EV_ROTATE)) {
+		linkClose();
+		enterState(STATE_TITLE);
+		return;
+	}
+
+	if ((ev & EV_TICK) && idleTicks-- == 0) {
+		idleTicks = HELLO_TICKS;
+		linkSend(LINK_HELLO, 0, seed);
 	}
 }
 
 /***************************************************************************************
- * PLACE PIECE
- * 		Based on the piece and the rotation, this places the piece on the grid array,
- * 		starting with the top left location
+ * HANDLE VERSUS
+ * 		Same as playing, except our tick can't get more than LINK_DELAY ticks ahead of
+ * 		what we've heard from the other unit. Garbage from its clears comes up
+ * 		LINK_DELAY ticks after them, so by then both sides know about it.
  **************************************************************************************/
-void placePiece(void) {
-	switch (piece) {
-	case 1: // O
-		grid[yPos][xPos] = piece;
-		grid[yPos + 1][xPos] = piece;
-		grid[yPos][xPos + 1] = piece;
-		grid[yPos + 1][xPos + 1] = piece;
-		break;
-	case 2: // I
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 2][xPos] = piece;
-			grid[yPos + 3][xPos] = piece;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos][xPos + 3] = piece;
-			break;
-		}
-		break;
-	case 3: // Z
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 2] = piece;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos] = piece;
-			break;
-		}
-		break;
-	case 4: // S
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos + 1] = piece;
-			break;
-		}
-		break;
-	case 5: // J
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos] = piece;
-			grid[yPos + 2][xPos + 1] = piece;
-			break;
-		case 1:
-			grid[yPos][xPos] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 2] = piece;
-			break;
-		case 2:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 2][xPos] = piece;
-			break;
-		case 3:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos + 1][xPos + 2] = piece;
-			break;
-		}
-		break;
-	case 6: // L
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 2][xPos] = piece;
-			grid[yPos + 2][xPos + 1] = piece;
-			break;
-		case 1:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos + 1][xPos] = piece;
-			break;
-		case 2:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos + 1] = piece;
-			break;
-		case 3:
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 2] = piece;
-			break;
-		}
-		break;
-	case 7: // T
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 1][xPos + 2] = piece;
-			break;
-		case 1:
-			grid[yPos][xPos] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos] = piece;
-			break;
-		case 2:
-			grid[yPos][xPos] = piece;
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos][xPos + 2] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			break;
-		case 3:
-			grid[yPos][xPos + 1] = piece;
-			grid[yPos + 1][xPos] = piece;
-			grid[yPos + 1][xPos + 1] = piece;
-			grid[yPos + 2][xPos + 1] = piece;
-			break;
-		}
-		break;
+void handleVersus(unsigned char ev) {
+	unsigned char in;
+	unsigned char stick;
+	unsigned int clears;
+
+	if (ev & EV_LEFT)
+		presses |= IN_LEFT;
+	if (ev & EV_RIGHT)
+		presses |= IN_RIGHT;
+	if (ev & EV_ROTATE)
+		presses |= IN_ROTATE;
+
+	if (!(ev & EV_TICK))
+		return;
+
+	if (!peer.gameAlive) {					// they topped out, we win
+		enterState(STATE_GAME_OVER);
+		return;
 	}
+
+	if (peer.tick + LINK_DELAY < game.tick + 1)
+		return;											// lockstep, wait to hear from them
+
+	in = presses;
+	clears = game.totalLines;
+	dueGarbage(toUs, &game, true);
+	step();
+	if (!linkOpened)
+		return;											// we topped out, BYE already went
+
+	stick = stickZone(downJoystick);
+	in |= stick << IN_STICK_SHIFT;
+
+	// tell them what we did, or at least that we did nothing
+	if ((in & ~IN_STICK) || stick != lastStick) {
+		linkSend(LINK_INPUT, in, game.tick);
+		lastStick = stick;
+	} else if (game.tick - lastSent >= LINK_SYNC_TICKS) {
+		linkSend(LINK_SYNC, gameHash(&game) & LINK_HASH_MASK, game.tick);
+	}
+
+	// our clears come up in their game LINK_DELAY ticks from now
+	if (game.totalLines != clears)
+		queueGarbage(toPeer, game.tick + LINK_DELAY, &game);
+
+	// run the guess on with us, and show how high their stack is
+	if (peerGuess.gameAlive && peerGuess.tick < game.tick) {
+		dueGarbage(toPeer, &peerGuess, false);
+		gameTick(&peerGuess, peerStick << IN_STICK_SHIFT);
+	}
+	drawMeter(peerGuess.gameAlive ? stackHeight(&peerGuess) : 14);
 }
+#endif
 
 /***************************************************************************************
- * REMOVE PIECE
- * 		Based on the piece and the rotation, this removes the piece from the grid array,
- * 		starting with the top left location
+ * STEP
+ * 		Runs our game one tick with the presses and joystick since the last one, then
+ * 		brings the screen up to date
  **************************************************************************************/
-void removePiece(void) {
-	switch (piece) {
-	case 1: // O
-		grid[yPos][xPos] = 0;
-		grid[yPos + 1][xPos] = 0;
-		grid[yPos][xPos + 1] = 0;
-		grid[yPos + 1][xPos + 1] = 0;
-		break;
-	case 2: // I
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 2][xPos] = 0;
-			grid[yPos + 3][xPos] = 0;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos][xPos + 3] = 0;
-			break;
-		}
-		break;
-	case 3: // Z
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 2] = 0;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos] = 0;
-			break;
-		}
-		break;
-	case 4: // S
-		switch (rotation) {
-		case 0:
-		case 2:
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			break;
-		case 1:
-		case 3:
-			grid[yPos][xPos] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos + 1] = 0;
-			break;
-		}
-		break;
-	case 5: // J
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos] = 0;
-			grid[yPos + 2][xPos + 1] = 0;
-			break;
-		case 1:
-			grid[yPos][xPos] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 2] = 0;
-			break;
-		case 2:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 2][xPos] = 0;
-			break;
-		case 3:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos + 1][xPos + 2] = 0;
-			break;
-		}
-		break;
-	case 6: // L
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 2][xPos] = 0;
-			grid[yPos + 2][xPos + 1] = 0;
-			break;
-		case 1:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos + 1][xPos] = 0;
-			break;
-		case 2:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos + 1] = 0;
-			break;
-		case 3:
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 2] = 0;
-			break;
+void step(void) {
+	unsigned char oldPiece = game.piece;
+	unsigned char oldRotation = game.rotation;
+	unsigned char oldX = game.xPos;
+	unsigned char oldY = game.yPos;
+	unsigned char in;
+	PROF_START();
+
+	// joystick y-axis read, the demo pulls its own
+	downJoystick = demo ? aiStick : readJoystick();
+	in = presses | (stickZone(downJoystick) << IN_STICK_SHIFT);
+	presses = 0;
+
+	show(gameTick(&game, in), oldPiece, oldRotation, oldX, oldY);
+	PROF_STOP(PROF_STEP);
+}
+
+/***************************************************************************************
+ * SHOW
+ * 		Draws what gameTick just did to our game. old is where the piece was before.
+ **************************************************************************************/
+void show(unsigned char ge, unsigned char oldPiece, unsigned char oldRotation,
+		unsigned char oldX, unsigned char oldY) {
+	unsigned int n;
+
+	followGrid(grid, &game, ge, oldPiece, oldRotation, oldX, oldY);
+
+	if (ge & GE_CLEAR) {
+		// score columns formatting and outputting
+		for (n = game.totalLines - game.lines; n < game.totalLines; n++)
+			drawScore(n, levelColor);
+
+		// level up logic, color
+		if (ge & GE_LEVEL) {
+			setLevelColor();
+			drawLevelColor();
 		}
-		break;
-	case 7: // T
-		switch (rotation) {
-		case 0:
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 1][xPos + 2] = 0;
-			break;
-		case 1:
-			grid[yPos][xPos] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos] = 0;
-			break;
-		case 2:
-			grid[yPos][xPos] = 0;
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos][xPos + 2] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			break;
-		case 3:
-			grid[yPos][xPos + 1] = 0;
-			grid[yPos + 1][xPos] = 0;
-			grid[yPos + 1][xPos + 1] = 0;
-			grid[yPos + 2][xPos + 1] = 0;
-			break;
+	}
+
+	if ((ge & (GE_CLEAR | GE_GARBAGE)) && !(ge & GE_OVER)) {
+		// the board gets redrawn over the next ticks
+		enterState(STATE_LINE_CLEAR);
+		return;
+	}
+
+	if (ge & GE_SPAWN) {
+		aiNewPiece = true;
+		paintPiece(20+(20*game.xPos), 30+(20*game.yPos), game.piece, game.rotation, game.piece);
+	} else if (ge & GE_MOVED) {
+		paintPiece(20+(20*oldX), 30+(20*oldY), oldPiece, oldRotation, 0);
+		paintPiece(20+(20*game.xPos), 30+(20*game.yPos), game.piece, game.rotation, game.piece);
+	}
+
+	if (ge & GE_OVER)
+		enterState(STATE_GAME_OVER);
+}
+
+/***************************************************************************************
+ * READ JOYSTICK
+ * 		Reads the joystick y-axis off P1.4, lower is pulled down further
+ **************************************************************************************/
+unsigned int readJoystick(void) {
+	PROF_START();
+
+	ADC10CTL0 = ADC10SHT_2 + ADC10ON;
+	ADC10CTL1 = INCH_4;
+	ADC10AE0 = BIT4;
+	ADC10CTL0 |= ENC + ADC10SC;
+	while (ADC10CTL1 & 0x0001);
+	PROF_STOP(PROF_STICK);
+	return ADC10MEM;
+}
+
+/***************************************************************************************
+ * STICK ZONE
+ * 		Different amounts of pull, 0 for none up to 3 for all the way
+ **************************************************************************************/
+unsigned char stickZone(unsigned int reading) {
+	if (reading < 100)
+		return 3;
+	else if (reading < 200)
+		return 2;
+	else if (reading < 455)
+		return 1;
+	return 0;
+}
+
+/***************************************************************************************
+ * AI TICK
+ * 		Attract mode. When a piece spawns the AI scores every rotation and column, a
+ * 		few a tick so it never holds up a tick. Then it walks the piece there one button
+ * 		press at a time, the same as a person, and pulls the joystick down.
+ **************************************************************************************/
+void aiTick(void) {
+	int n;
+	int score;
+
+	aiStick = 1023;								// hands off the joystick
+
+	if (aiNewPiece) {							// new piece, start scoring its placements
+		aiNewPiece = false;
+		aiSearching = true;
+		aiRotation = 0;
+		aiColumn = 0;
+		aiBestScore = -32767;
+		aiBestRotation = game.rotation;
+		aiBestColumn = game.xPos;
+	}
+
+	if (!game.pieceAlive)
+		return;
+
+	if (aiSearching) {
+		for (n = 0; n < AI_EVALS_PER_TICK; n++) {
+			score = aiEvaluate(aiRotation, aiColumn);
+			if (score > aiBestScore) {
+				aiBestScore = score;
+				aiBestRotation = aiRotation;
+				aiBestColumn = aiColumn;
+			}
+
+			// next column, then next rotation
+			if (++aiColumn == 10) {
+				aiColumn = 0;
+				if (++aiRotation == distinctRotations[game.piece - 1]) {
+					aiSearching = false;
+					break;
+				}
+			}
 		}
-		break;
+		return;
 	}
+
+	if (game.keys || presses)
+		return;										// last press hasn't been used yet
+
+	if (game.rotation != aiBestRotation)
+		presses = IN_ROTATE;
+	else if (game.xPos > aiBestColumn)
+		presses = IN_LEFT;
+	else if (game.xPos < aiBestColumn)
+		presses = IN_RIGHT;
+	else
+		aiStick = 0;								// lined up, pull all the way down
 }
 
 /***************************************************************************************
- * DRAW SQUARE
- * 		Based on the piece, this draws the outer then inner square starting at the top
- * 		left x, y position. Different pieces have different colors.
+ * AI EVALUATE
+ * 		Drops the piece in play straight down at rotation r and column x on a copy of
+ * 		the bitboard, clears full rows and scores what's left on aggregate height,
+ * 		lines, holes and bumpiness. Returns -32767 if the piece can't go there.
  **************************************************************************************/
-void drawSquare(int x0, int y, int pieceNumber) {
+int aiEvaluate(unsigned int r, int x) {
+	uint16_t board[14];
+	unsigned char heights[10];
+	const unsigned char *s = shapes[game.piece - 1][r];
+	unsigned int seen = 0;
+	unsigned int m;
+	int y = game.yPos;
+	int lines = 0;
+	int height = 0;
+	int holes = 0;
+	int bumps = 0;
 	int i;
-	// because we have to split up the location bytes for y
-	int y0 = y / 256;
-	int y1 = y % 256;
-	int y2 = (y+19) / 256;
-	int y3 = (y+19) % 256;
-	int y4 = (y+2) / 256;
-	int y5 = (y+2) % 256;
-	int y6 = (y+17) / 256;
-	int y7 = (y+17) % 256;
-
-	// outer square
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(x0);					// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(x0+19);			// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(y0);					// Setup beginning row address
-	writeLCDData(y1);					// Setup beginning row address
-	writeLCDData(y2);					// Setup ending row address
-	writeLCDData(y3);					// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	switch (pieceNumber) {
-	case 0:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x110F >> 8);		// Write data to LCD memory
-			writeLCDData(0x110F & 0xff);	// Write data to LCD memory
-			writeLCDData(0x110F >> 8);		// Write data to LCD memory
-			writeLCDData(0x110F & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 1:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x69D6 >> 8);		// Write data to LCD memory
-			writeLCDData(0x69D6 & 0xff);	// Write data to LCD memory
-			writeLCDData(0x69D6 >> 8);		// Write data to LCD memory
-			writeLCDData(0x69D6 & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 2:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x24BD >> 8);		// Write data to LCD memory
-			writeLCDData(0x24BD & 0xff);	// Write data to LCD memory
-			writeLCDData(0x24BD >> 8);		// Write data to LCD memory
-			writeLCDData(0x24BD & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 3:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x053D >> 8);		// Write data to LCD memory
-			writeLCDData(0x053D & 0xff);	// Write data to LCD memory
-			writeLCDData(0x053D >> 8);		// Write data to LCD memory
-			writeLCDData(0x053D & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 4:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x05D9 >> 8);		// Write data to LCD memory
-			writeLCDData(0x05D9 & 0xff);	// Write data to LCD memory
-			writeLCDData(0x05D9 >> 8);		// Write data to LCD memory
-			writeLCDData(0x05D9 & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 5:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x3A96 >> 8);		// Write data to LCD memory
-			writeLCDData(0x3A96 & 0xff);	// Write data to LCD memory
-			writeLCDData(0x3A96 >> 8);		// Write data to LCD memory
-			writeLCDData(0x3A96 & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 6:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x9135 >> 8);		// Write data to LCD memory
-			writeLCDData(0x9135 & 0xff);	// Write data to LCD memory
-			writeLCDData(0x9135 >> 8);		// Write data to LCD memory
-			writeLCDData(0x9135 & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 7:
-		for (i = 220; i > 0; i--) {			// Loop through all memory locations 16 bit color
-			writeLCDData(0x03D2 >> 8);		// Write data to LCD memory
-			writeLCDData(0x03D2 & 0xff);	// Write data to LCD memory
-			writeLCDData(0x03D2 >> 8);		// Write data to LCD memory
-			writeLCDData(0x03D2 & 0xff);	// Write data to LCD memory
-		}
-		break;
+	int j;
+
+	if (!fits(game.rows, game.piece, r, x, y))
+		return -32767;
+	while (fits(game.rows, game.piece, r, x, y + 1))
+		y++;
+
+	for (i = 0; i < 14; i++)
+		board[i] = game.rows[i];
+	for (i = 0; i < 4 && s[i]; i++)
+		board[y + i] |= (unsigned int)s[i] << x;
+
+	// squeeze out full rows from the bottom up
+	for (i = 13, j = 13; i >= 0; i--) {
+		if (board[i] == FULL_ROW)
+			lines++;
+		else
+			board[j--] = board[i];
 	}
+	while (j >= 0)
+		board[j--] = 0;
 
-	// inner square
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(x0+2);				// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(x0+17);			// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(y4);					// Setup beginning row address
-	writeLCDData(y5);					// Setup beginning row address
-	writeLCDData(y6);					// Setup ending row address
-	writeLCDData(y7);					// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	switch (pieceNumber) {
-	case 1:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0xAC3F >> 8);		// Write data to LCD memory
-			writeLCDData(0xAC3F & 0xff);	// Write data to LCD memory
-			writeLCDData(0xAC3F >> 8);		// Write data to LCD memory
-			writeLCDData(0xAC3F & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 2:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0x7D7F >> 8);		// Write data to LCD memory
-			writeLCDData(0x7D7F & 0xff);	// Write data to LCD memory
-			writeLCDData(0x7D7F >> 8);		// Write data to LCD memory
-			writeLCDData(0x7D7F & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 3:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0x7EBF >> 8);		// Write data to LCD memory
-			writeLCDData(0x7EBF & 0xff);	// Write data to LCD memory
-			writeLCDData(0x7EBF >> 8);		// Write data to LCD memory
-			writeLCDData(0x7EBF & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 4:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0xAF5D >> 8);		// Write data to LCD memory
-			writeLCDData(0xAF5D & 0xff);	// Write data to LCD memory
-			writeLCDData(0xAF5D >> 8);		// Write data to LCD memory
-			writeLCDData(0xAF5D & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 5:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0x8CFF >> 8);		// Write data to LCD memory
-			writeLCDData(0x8CFF & 0xff);	// Write data to LCD memory
-			writeLCDData(0x8CFF >> 8);		// Write data to LCD memory
-			writeLCDData(0x8CFF & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 6:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0xD37C >> 8);		// Write data to LCD memory
-			writeLCDData(0xD37C & 0xff);	// Write data to LCD memory
-			writeLCDData(0xD37C >> 8);		// Write data to LCD memory
-			writeLCDData(0xD37C & 0xff);	// Write data to LCD memory
-		}
-		break;
-	case 7:
-		for (i = 162; i > 0; i--)	{ 		// Loop through all memory locations 16 bit color
-			writeLCDData(0xAEBB >> 8);		// Write data to LCD memory
-			writeLCDData(0xAEBB & 0xff);	// Write data to LCD memory
-			writeLCDData(0xAEBB >> 8);		// Write data to LCD memory
-			writeLCDData(0xAEBB & 0xff);	// Write data to LCD memory
+	// top down, the first block seen in a column is its height and every gap under
+	// a seen block is a hole
+	for (j = 0; j < 10; j++)
+		heights[j] = 0;
+	for (i = 0; i < 14; i++) {
+		m = board[i] & ~seen;
+		for (j = 0; m; j++, m >>= 1) {
+			if (m & 1) {
+				heights[j] = 14 - i;
+				height += 14 - i;
+			}
 		}
-		break;
+		for (m = seen & ~board[i]; m; m &= m - 1)
+			holes++;
+		seen |= board[i];
 	}
+	for (j = 0; j < 9; j++)
+		bumps += heights[j] > heights[j + 1] ? heights[j] - heights[j + 1] : heights[j + 1] - heights[j];
+
+	return AI_HEIGHT * height + AI_LINES * lines + AI_HOLES * holes + AI_BUMPS * bumps;
 }
 
 /***************************************************************************************
- * DRAW PIECE
- * 		Based on the piece and rotation, this draws the piece starting with the top left
- * 		location
+ * LINK OPEN
+ * 		Hands P1.1/P1.2 from the touchscreen to USCI_A0 as a UART and clears out both
+ * 		games and the garbage queues for a match
  **************************************************************************************/
-void drawPiece(int x, int y) {
-	switch (piece) {
-	case 1: // O
-		drawSquare(x, y, piece);
-		drawSquare(x+20, y, piece);
-		drawSquare(x, y+20, piece);
-		drawSquare(x+20, y+20, piece);
-		break;
-	case 2: // I
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x, y+40, piece);
-			drawSquare(x, y+60, piece);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+40, y, piece);
-			drawSquare(x+60, y, piece);
-			break;
-		}
-		break;
-	case 3: // Z
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+40, y+20, piece);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x+20, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x, y+40, piece);
-			break;
-		}
-		break;
-	case 4: // S
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x+20, y, piece);
-			drawSquare(x+40, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+20, y+40, piece);
-			break;
-		}
-		break;
-	case 5: // J
-		switch (rotation) {
-		case 0:
-			drawSquare(x+20, y, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x, y+40, piece);
-			drawSquare(x+20, y+40, piece);
-			break;
-		case 1:
-			drawSquare(x, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+40, y+20, piece);
-			break;
-		case 2:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x, y+40, piece);
-			break;
-		case 3:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+40, y, piece);
-			drawSquare(x+40, y+20, piece);
-			break;
-		}
-		break;
-	case 6: // L
-		switch (rotation) {
-		case 0:
-			drawSquare(x, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x, y+40, piece);
-			drawSquare(x+20, y+40, piece);
-			break;
-		case 1:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+40, y, piece);
-			drawSquare(x, y+20, piece);
-			break;
-		case 2:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+20, y+40, piece);
-			break;
-		case 3:
-			drawSquare(x+40, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+40, y+20, piece);
-			break;
-		}
-		break;
-	case 7: // T
-		switch (rotation) {
-		case 0:
-			drawSquare(x+20, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+40, y+20, piece);
-			break;
-		case 1:
-			drawSquare(x, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x, y+40, piece);
-			break;
-		case 2:
-			drawSquare(x, y, piece);
-			drawSquare(x+20, y, piece);
-			drawSquare(x+40, y, piece);
-			drawSquare(x+20, y+20, piece);
-			break;
-		case 3:
-			drawSquare(x+20, y, piece);
-			drawSquare(x, y+20, piece);
-			drawSquare(x+20, y+20, piece);
-			drawSquare(x+20, y+40, piece);
-			break;
-		}
-		break;
+void linkOpen(void) {
+#ifndef PROFILE
+	int i;
+#endif
+
+	P1SEL |= LINK_RXD + LINK_TXD;
+	P1SEL2 |= LINK_RXD + LINK_TXD;
+	UCA0CTL1 |= UCSWRST;					// USCI in reset state
+	UCA0CTL1 |= UCSSEL_2;					// SMCLK
+	UCA0BR0 = (LINK_DIV / 16) & 0xFF;
+	UCA0BR1 = (LINK_DIV / 16) >> 8;
+	UCA0MCTL = ((LINK_DIV % 16) << 4) | UCOS16;
+	UCA0CTL1 &= ~UCSWRST;					// USCI released for operation
+	IE2 |= UCA0RXIE;							// enable RX interrupt
+
+#ifndef PROFILE
+	for (i = 0; i < GARBAGE_QUEUE; i++) {
+		toUs[i].rows = 0;
+		toPeer[i].rows = 0;
 	}
+	linkDecoder.have = 0;
+#endif
+	linkRxHead = linkRxTail = 0;
+	linkTxHead = linkTxTail = 0;
+	linkLost = false;
+	lastSent = 0;
+	lastStick = 0;
+	peerStick = 0;
+	meterHeight = 0;
+	linkOpened = true;
 }
 
 /***************************************************************************************
- * ERASE PIECE
- * 		Based on the piece and rotation, this draws the background color starting with the
- * 		top left location, effectively erasing it
+ * LINK CLOSE
+ * 		Waits for the last bytes to go and gives the pins back to the touchscreen
  **************************************************************************************/
-void erasePiece(int x, int y) {
-	switch (piece) {
-	case 1: // O
-		drawSquare(x, y, 0);
-		drawSquare(x+20, y, 0);
-		drawSquare(x, y+20, 0);
-		drawSquare(x+20, y+20, 0);
-		break;
-	case 2: // I
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x, y+40, 0);
-			drawSquare(x, y+60, 0);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+40, y, 0);
-			drawSquare(x+60, y, 0);
-			break;
-		}
-		break;
-	case 3: // Z
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+40, y+20, 0);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x+20, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x, y+40, 0);
-			break;
-		}
-		break;
-	case 4: // S
-		switch (rotation) {
-		case 0:
-		case 2:
-			drawSquare(x+20, y, 0);
-			drawSquare(x+40, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			break;
-		case 1:
-		case 3:
-			drawSquare(x, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+20, y+40, 0);
-			break;
-		}
-		break;
-	case 5: // J
-		switch (rotation) {
-		case 0:
-			drawSquare(x+20, y, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x, y+40, 0);
-			drawSquare(x+20, y+40, 0);
-			break;
-		case 1:
-			drawSquare(x, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+40, y+20, 0);
-			break;
-		case 2:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x, y+40, 0);
-			break;
-		case 3:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+40, y, 0);
-			drawSquare(x+40, y+20, 0);
-			break;
+void linkClose(void) {
+	while (linkTxTail != linkTxHead);
+	while (!(IFG2 & UCA0TXIFG));
+	IE2 &= ~(UCA0RXIE + UCA0TXIE);
+	UCA0CTL1 |= UCSWRST;
+	P1SEL &= ~(LINK_RXD + LINK_TXD);
+	P1SEL2 &= ~(LINK_RXD + LINK_TXD);
+	linkOpened = false;
+}
+
+/***************************************************************************************
+ * LINK SEND
+ * 		Queues a frame for the TX interrupt. The ring only ever holds a few frames, if
+ * 		it's full we wait for room.
+ **************************************************************************************/
+void linkSend(unsigned char kind, unsigned char payload, unsigned long tick) {
+	unsigned char frame[LINK_FRAME];
+	int i;
+
+	linkEncode(frame, kind, payload, tick);
+	for (i = 0; i < LINK_FRAME; i++) {
+		while ((unsigned char)(linkTxHead - linkTxTail) == LINK_RING);
+		linkTx[linkTxHead & (LINK_RING - 1)] = frame[i];
+		linkTxHead++;
+	}
+	IE2 |= UCA0TXIE;							// TX interrupt takes it from here
+	lastSent = tick;
+}
+
+#ifndef PROFILE
+/***************************************************************************************
+ * LINK RECEIVE
+ * 		Decodes whatever has come in. HELLO starts the match, INPUT and SYNC move peer
+ * 		on, BYE means they topped out. A press lands in the past of peerGuess so the
+ * 		guess gets thrown out and run again.
+ *
+ * 		Only inputs come over, so one dropped byte leaves peer wrong for good. When
+ * 		the ring overflowed or a SYNC's hash doesn't match peer the match is over,
+ * 		game over and a BYE so the other unit stops too. Waiting for a HELLO it
+ * 		doesn't matter, they keep coming.
+ **************************************************************************************/
+void linkReceive(void) {
+	LinkFrame f;
+	unsigned long t;
+	bool late = false;
+
+	while (!linkLost && linkRxTail != linkRxHead) {
+		if (!linkDecode(&linkDecoder, linkRx[linkRxTail++ & (LINK_RING - 1)], &f))
+			continue;
+
+		if (f.kind == LINK_HELLO) {
+			if (state != STATE_LINK_WAIT)
+				continue;							// they missed our last one, already playing
+			linkSend(LINK_HELLO, 0, seed);
+			gameReset(&peer, f.tick);
+			peerGuess = peer;
+			newGame(seed);
+			lastSent = 0;
+			enterState(STATE_VERSUS);
+			continue;
 		}
-		break;
-	case 6: // L
-		switch (rotation) {
-		case 0:
-			drawSquare(x, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x, y+40, 0);
-			drawSquare(x+20, y+40, 0);
-			break;
-		case 1:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+40, y, 0);
-			drawSquare(x, y+20, 0);
-			break;
-		case 2:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+20, y+40, 0);
-			break;
-		case 3:
-			drawSquare(x+40, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+40, y+20, 0);
+		if (state == STATE_LINK_WAIT)
+			continue;
+
+		t = linkUnwrap(peer.tick, f.tick);
+		switch (f.kind) {
+		case LINK_INPUT:
+			peerAdvance(t - 1);
+			peerStick = (f.payload & IN_STICK) >> IN_STICK_SHIFT;
+			if (peer.tick + 1 == t)
+				peerTick(f.payload);
+			late = true;
+			break;
+		case LINK_SYNC:
+			peerAdvance(t);
+			if (peer.tick == t && (gameHash(&peer) & LINK_HASH_MASK) != f.payload)
+				linkLost = true;
+			break;
+		case LINK_BYE:
+			peerAdvance(t);
+			peer.gameAlive = false;
 			break;
 		}
-		break;
-	case 7: // T
-		switch (rotation) {
-		case 0:
-			drawSquare(x+20, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+40, y+20, 0);
-			break;
-		case 1:
-			drawSquare(x, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x, y+40, 0);
-			break;
-		case 2:
-			drawSquare(x, y, 0);
-			drawSquare(x+20, y, 0);
-			drawSquare(x+40, y, 0);
-			drawSquare(x+20, y+20, 0);
-			break;
-		case 3:
-			drawSquare(x+20, y, 0);
-			drawSquare(x, y+20, 0);
-			drawSquare(x+20, y+20, 0);
-			drawSquare(x+20, y+40, 0);
-			break;
+	}
+
+	if (linkLost) {
+		if (state == STATE_VERSUS) {
+			enterState(STATE_GAME_OVER);
+			return;
 		}
-		break;
+		linkLost = false;
 	}
+	if (late || peer.tick > peerGuess.tick)
+		peerGuessAgain();
+}
+
+/***************************************************************************************
+ * PEER TICK
+ * 		Runs the other unit's game one tick on inputs it has sent us. Its clears send
+ * 		garbage our way.
+ **************************************************************************************/
+void peerTick(unsigned char in) {
+	dueGarbage(toPeer, &peer, true);
+	if (gameTick(&peer, in) & GE_CLEAR)
+		queueGarbage(toUs, peer.tick + LINK_DELAY, &peer);
 }
 
+/***************************************************************************************
+ * PEER ADVANCE
+ * 		Runs peer up to tick t with no presses, they've told us there weren't any
+ **************************************************************************************/
+void peerAdvance(unsigned long t) {
+	while (peer.gameAlive && peer.tick < t)
+		peerTick(peerStick << IN_STICK_SHIFT);
+}
+
+/***************************************************************************************
+ * PEER GUESS AGAIN
+ * 		Rollback. Starts the guess over from what we know for sure and runs it on to
+ * 		our tick.
+ **************************************************************************************/
+void peerGuessAgain(void) {
+	peerGuess = peer;
+	while (peerGuess.gameAlive && peerGuess.tick < game.tick) {
+		dueGarbage(toPeer, &peerGuess, false);
+		gameTick(&peerGuess, peerStick << IN_STICK_SHIFT);
+	}
+}
+#endif
+
 /***************************************************************************************
  * DRAW GRID
  * 		Draws the entire grid, drawing the background color for empty squares and the
@@ -1363,20 +880,21 @@ void erasePiece(int x, int y) {
  **************************************************************************************/
 void drawGrid(void) {
 	int i;
+
+	for (i = 0; i < 14; i++)
+		drawRow(i);
+}
+
+/***************************************************************************************
+ * DRAW ROW
+ * 		Draws one row of the grid, same as DRAW GRID does for all of them
+ **************************************************************************************/
+void drawRow(int i) {
 	int j;
-	int dX;
-	int dY = 30;
 
-	// row
-	for (i = 0; i < 14; i++) {
-		if (i != 0)
-			dY += 20;
-		// column
-		for (j = 0; j < 10; j++) {
-			dX = 20*j;
-			drawSquare(dX+20, dY, grid[i][j]);
-		}
-	}
+	// column
+	for (j = 0; j < 10; j++)
+		drawSquare(20+(20*j), 30+(20*i), grid[i][j]);
 }
 
 /***************************************************************************************
@@ -1385,34 +903,7 @@ void drawGrid(void) {
  * 		used when incrementing the score in the top right.
  **************************************************************************************/
 void setLevelColor(void) {
-	switch (level) {
-	case 1:
-	case 8:
-		levelColor = 0xAEBB;
-		break;
-	case 2:
-	case 9:
-		levelColor = 0xAF5D;
-		break;
-	case 3:
-	case 10:
-		levelColor = 0x7EBF;
-		break;
-	case 4:
-	case 11:
-		levelColor = 0x7D7F;
-		break;
-	case 5:
-	case 12:
-		levelColor = 0x8CFF;
-		break;
-	case 6:
-		levelColor = 0xAC3F;
-		break;
-	case 7:
-		levelColor = 0xD37C;
-		break;
-	}
+	levelColor = levelColorFor(game.level);
 }
 
 /***************************************************************************************
@@ -1420,119 +911,21 @@ void setLevelColor(void) {
  * 		Draws the level color at the top left of the screen
  **************************************************************************************/
 void drawLevelColor(void) {
-	int i;
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(20);					// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(40);					// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(5);					// Setup beginning row address
-	writeLCDData(0);					// Setup ending row address
-	writeLCDData(25);					// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 231; i > 0; i--) {					// Loop through all memory locations 16 bit color
-		writeLCDData(levelColor >> 8);		// Write data to LCD memory
-		writeLCDData(levelColor & 0xff);	// Write data to LCD memory
-		writeLCDData(levelColor >> 8);		// Write data to LCD memory
-		writeLCDData(levelColor & 0xff);	// Write data to LCD memory
-	}
+	fillLevelColor(levelColor);
 }
 
 /***************************************************************************************
- * DRAW SCORE
- * 		Prints a 2x2 pixel point based on the level color and the shift given by lines
- * 		cleared and how many decades of lines cleared
+ * DRAW METER
+ * 		Shows how high the other unit's stack is down the right edge, a pixel column
+ * 		20 high for every row. Only redrawn when it changes.
  **************************************************************************************/
-void drawScore(void) {
-	drawPixel(218-scoreColumn, 23-scoreRow, levelColor);
-	drawPixel(218-scoreColumn, 24-scoreRow, levelColor);
-	drawPixel(219-scoreColumn, 23-scoreRow, levelColor);
-	drawPixel(219-scoreColumn, 24-scoreRow, levelColor);
-}
-
-/***************************************************************************************
- * INITIALIZE BACKGROUND
- * 		Draws the main UI. This consists of a light blue background and darker blue
- * 		foreground, with a small amount of shade underneath it
- **************************************************************************************/
-void initBackground(void) {
-	int i;
-	fillScreen(0x5B57);
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0x11);				// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(0xDE);				// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0x21);				// Setup beginning row address
-	writeLCDData(0x01);				// Setup ending row address
-	writeLCDData(0x38);				// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 207 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
-		writeLCDData(0x5316 >> 8);				// Write data to LCD memory
-		writeLCDData(0x5316 & 0xff);			// Write data to LCD memory
-		writeLCDData(0x5316 >> 8);				// Write data to LCD memory
-		writeLCDData(0x5316 & 0xff);			// Write data to LCD memory
-	}
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0x12);				// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(0xDD);				// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0x20);				// Setup beginning row address
-	writeLCDData(0x01);				// Setup ending row address
-	writeLCDData(0x37);				// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 205 * 141; i > 0; i--)	{		// Loop through all memory locations 16 bit color
-		writeLCDData(0x4AF4 >> 8);				// Write data to LCD memory
-		writeLCDData(0x4AF4 & 0xff);			// Write data to LCD memory
-		writeLCDData(0x4AF4 >> 8);				// Write data to LCD memory
-		writeLCDData(0x4AF4 & 0xff);			// Write data to LCD memory
-	}
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0x13);				// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(0xDC);				// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0x1F);				// Setup beginning row address
-	writeLCDData(0x01);				// Setup ending row address
-	writeLCDData(0x36);				// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 203 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
-		writeLCDData(0x42B2 >> 8);				// Write data to LCD memory
-		writeLCDData(0x42B2 & 0xff);			// Write data to LCD memory
-		writeLCDData(0x42B2 >> 8);				// Write data to LCD memory
-		writeLCDData(0x42B2 & 0xff);			// Write data to LCD memory
-	}
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0x14);				// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(0xDB);				// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0x1E);				// Setup beginning row address
-	writeLCDData(0x01);				// Setup ending row address
-	writeLCDData(0x35);				// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 201 * 141; i > 0; i--)	{ 	// Loop through all memory locations 16 bit color
-		writeLCDData(0x110F >> 8);				// Write data to LCD memory
-		writeLCDData(0x110F & 0xff);			// Write data to LCD memory
-		writeLCDData(0x110F >> 8);				// Write data to LCD memory
-		writeLCDData(0x110F & 0xff);			// Write data to LCD memory
-	}
+void drawMeter(unsigned int height) {
+	if (height == meterHeight && state != STATE_LINK_WAIT)
+		return;
+	meterHeight = height;
+	fillRect(226, 30, 233, 309 - 20*height, 0x5B57);
+	if (height)
+		fillRect(226, 310 - 20*height, 233, 309, 0x9135);
 }
 
 /***************************************************************************************
@@ -1543,6 +936,7 @@ void initBackground(void) {
 void readTS(void) {
 	unsigned int z0;
 	unsigned int z1;
+	PROF_START();
 
 	// read z value
 	P1DIR &= ~TS_YP;
@@ -1578,6 +972,20 @@ void readTS(void) {
 	z1 = ADC10MEM;
 
 	z = 1023 - z0 + z1;
+	PROF_STOP(PROF_TOUCH);
+}
+
+/***************************************************************************************
+ * TAPPED
+ * 		Reads the touchscreen and says if it just got pressed. Holding a finger down
+ * 		only counts once.
+ **************************************************************************************/
+bool tapped(void) {
+	bool wasHeld = touchHeld;
+
+	readTS();
+	touchHeld = z > 100;
+	return touchHeld && !wasHeld;
 }
 
 /***************************************************************************************
@@ -1589,6 +997,142 @@ void initClk(void) {
 	DCOCTL = 0xFF;
 }
 
+/***************************************************************************************
+ * INITIALIZE TIMER
+ * 		Timer_A CCR0 interrupt is the game tick. ACLK comes off the VLO so the slow tick
+ * 		keeps running in LPM3.
+ **************************************************************************************/
+void initTimer(void) {
+	BCSCTL3 |= LFXT1S_2;					// ACLK = VLO
+	TA0CCTL0 = CCIE;							// interrupt on CCR0
+}
+
+/***************************************************************************************
+ * SET TICK
+ * 		Fast is the 10 ms game tick off SMCLK, slow is the ~100 ms idle tick off ACLK
+ **************************************************************************************/
+void setTick(bool fast) {
+	TA0CTL = TACLR;
+	if (fast) {
+		TA0CCR0 = TICK_FAST - 1;
+		TA0CTL = TASSEL_2 + ID_3 + MC_1;		// SMCLK/8, up mode
+	} else {
+		TA0CCR0 = TICK_SLOW - 1;
+		TA0CTL = TASSEL_1 + MC_1;				// ACLK, up mode
+	}
+}
+
+#ifdef PROFILE
+/***************************************************************************************
+ * INITIALIZE PROFILE
+ * 		Timer1_A counts SMCLK, so MCLK cycles, all the way round. Its overflow
+ * 		interrupt keeps the top 16 bits.
+ **************************************************************************************/
+void initProfile(void) {
+	TA1CTL = TASSEL_2 + MC_2 + TACLR + TAIE;	// SMCLK, continuous
+}
+
+/***************************************************************************************
+ * PROF NOW
+ * 		Cycles since initProfile, good for ~3.5 minutes a wrap and a region never
+ * 		takes that long
+ **************************************************************************************/
+unsigned long profNow(void) {
+	unsigned int gie = __get_SR_register() & GIE;
+	unsigned int high;
+	unsigned int low;
+
+	_DINT();
+	high = profHigh;
+	low = TA1R;
+	if ((TA1CTL & TAIFG) && low < 0x8000)
+		high++;											// wrapped, its interrupt hasn't run yet
+	if (gie)
+		_EINT();
+	return ((unsigned long)high << 16) | low;
+}
+
+/***************************************************************************************
+ * PROF ADD
+ * 		One go of region that took cycles, into its histogram. Once it's been halved
+ * 		only 1 in 2^halved goes in, picked off the LFSR. Interrupts off while it's at
+ * 		the histograms and the LFSR, the timer and button ISRs add too.
+ **************************************************************************************/
+void profAdd(unsigned char region, unsigned long cycles) {
+	unsigned int gie = __get_SR_register() & GIE;
+	ProfRegion *r = &profRegions[region];
+	unsigned long edge = PROF_FIRST;
+	unsigned char most = profSmall(cycles);
+	unsigned char b;
+	int i;
+
+	for (b = 0; b < PROF_BUCKETS - 1 && cycles >= edge; b++)
+		edge <<= 3;
+
+	_DINT();
+	if (most > r->most)
+		r->most = most;
+	profRandom = (profRandom >> 1) ^ (-(profRandom & 1) & 0xB400);
+	if (!(profRandom & ((1U << r->halved) - 1)) &&
+			(r->counts[b] < 255 || r->halved < PROF_HALVED)) {		// else full up, hours of it
+		if (r->counts[b] == 255) {
+			for (i = 0; i < PROF_BUCKETS; i++)
+				r->counts[i] >>= 1;			// halve the lot, the shape stays
+			r->halved++;
+		}
+		r->counts[b]++;
+	}
+	if (gie)
+		_EINT();
+}
+
+/***************************************************************************************
+ * PROF SMALL
+ * 		Cycles in a byte, see profile.h
+ **************************************************************************************/
+unsigned char profSmall(unsigned long cycles) {
+	unsigned char e = 0;
+
+	while (cycles >= 16) {
+		cycles >>= 1;
+		e++;
+	}
+	return e ? ((e + 1) << 3) | (cycles - 8) : cycles;
+}
+
+/***************************************************************************************
+ * PROF SEND
+ * 		The histograms out of the UART as a dump and start them over. Takes ~40 ms at
+ * 		LINK_BAUD, the title can wait.
+ **************************************************************************************/
+void profSend(void) {
+	unsigned char head[5] = {PROF_MAGIC0, PROF_MAGIC1, PROF_VERSION, PROF_REGIONS, PROF_BUCKETS};
+	unsigned char *regions = (unsigned char *)profRegions;
+	unsigned int sum = 0;
+	unsigned int i;
+
+	linkOpen();
+	for (i = 0; i < sizeof head; i++)
+		sum += profByte(head[i]);
+	for (i = 0; i < sizeof profRegions; i++)
+		sum += profByte(regions[i]);
+	profByte(sum & 0xFF);
+	profByte(sum >> 8);
+	while (UCA0STAT & UCBUSY);			// last one all the way out
+	linkClose();
+
+	for (i = 0; i < sizeof profRegions; i++)
+		regions[i] = 0;
+}
+
+// one byte out as soon as there's room, no interrupts
+unsigned char profByte(unsigned char byte) {
+	while (!(IFG2 & UCA0TXIFG));
+	UCA0TXBUF = byte;
+	return byte;
+}
+#endif
+
 /***************************************************************************************
  * INITIALIZE PINS
  * 		Initializes all the pins for output when needed and sets interrupt flags
@@ -1619,52 +1163,6 @@ void initPins(void) {
 	_BIS_SR(GIE);
 }
 
-/***************************************************************************************
- * FILL SCREEN
- * 		Fills the entire screen with the given color.
- **************************************************************************************/
-void fillScreen(int color) {
-	unsigned int i;
-
-	writeLCDControl(0x2A);		// Select Column Address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0);					// Setup beginning column address
-	writeLCDData(0);					// Setup ending column address
-	writeLCDData(239);				// Setup ending column address
-	writeLCDControl(0x2B);		// Select Row Address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0);					// Setup beginning row address
-	writeLCDData(0x01);				// Setup ending row address
-	writeLCDData(0x3F);				// Setup ending row address
-	writeLCDControl(0x2C);		// Select Memory Write
-	for (i = 240 * 161; i > 0; i--) {		// Loop through all memory locations 16 bit color
-		writeLCDData(color >> 8);					// Write data to LCD memory
-		writeLCDData(color & 0xff);				// Write data to LCD memory
-		writeLCDData(color >> 8);					// Write data to LCD memory
-		writeLCDData(color & 0xff);				// Write data to LCD memory
-	}
-}
-
-/***************************************************************************************
- * DRAW PIXEL
- * 		Draws one pixel given and x, y, and color value
- **************************************************************************************/
-void drawPixel(int x, int y, int color) {
-	writeLCDControl(0x2A);				// Select Column Address
-	writeLCDData(x >> 8);					// Starting x Address (Most Sig 8 bits of address)
-	writeLCDData(x & 0xff);				// Starting x Address (Least Sig 8 bits of address)
-	writeLCDData(x >> 8);					// Ending x Address (Most Sig 8 bits of address)
-	writeLCDData(x & 0xff);				// Ending x Address (Least Sig 8 bits of address)
-	writeLCDControl(0x2B);				// Select Row Address
-	writeLCDData(y >> 8);					// Starting y Address (Most Sig 8 bits of address)
-	writeLCDData(y & 0xff);				// Starting y Address (Least Sig 8 bits of address)
-	writeLCDData(y >> 8);					// Ending y Address (Most Sig 8 bits of address)
-	writeLCDData(y & 0xff);				// Ending y Address (Least Sig 8 bits of address)
-	writeLCDControl(0x2C);				// Select Color to write to the pixel
-	writeLCDData(color >> 8);			// Send Most Significant 8 bits of 16 bit color
-	writeLCDData(color & 0xff);		// Send Least Significant 8 bits of 16 bit color
-}
-
 /***************************************************************************************
  * WRITE LCD CONTROL
  **************************************************************************************/
@@ -1803,134 +1301,6 @@ void initLCD(void) {
 	writeLCDControl(0x29);    		// Display on
 }
 
-/***************************************************************************************
- * DRAW INSTRUCTION
- * 		Draws the instructions to start the game "tap to start"
- **************************************************************************************/
-void drawInstruction(char x0, char y0, int color) {
-	drawLetter(0x74, x0, y0, color);			// t
-	drawLetter(0x61, x0+4, y0, color);		// a
-	drawLetter(0x70, x0+12, y0, color);		// p
-
-	drawLetter(0x74, x0+26, y0, color);		// t
-	drawLetter(0x6F, x0+30, y0, color);		// o
-
-	drawLetter(0x73, x0+44, y0, color);		// s
-	drawLetter(0x74, x0+51, y0, color);		// t
-	drawLetter(0x61, x0+55, y0, color);		// a
-	drawLetter(0x72, x0+63, y0, color);		// r
-	drawLetter(0x74, x0+69, y0, color);		// t
-}
-
-/***************************************************************************************
- * DRAW LETTER
- * 		Draws a letter based off what value is based, the x and y value of the top left
- * 		coordinate and the color of the text
- **************************************************************************************/
-void drawLetter(char data, char x0, char y0, int color) {
-	switch (data) {
-		case 0x61: // a
-			drawPixel(x0+1, y0+4, color);
-			drawPixel(x0+1, y0+7, color);
-			drawPixel(x0+1, y0+8, color);
-			drawPixel(x0+2, y0+3, color);
-			drawPixel(x0+2, y0+6, color);
-			drawPixel(x0+2, y0+9, color);
-			drawPixel(x0+3, y0+3, color);
-			drawPixel(x0+3, y0+6, color);
-			drawPixel(x0+3, y0+9, color);
-			drawPixel(x0+4, y0+3, color);
-			drawPixel(x0+4, y0+6, color);
-			drawPixel(x0+4, y0+9, color);
-			drawPixel(x0+5, y0+4, color);
-			drawPixel(x0+5, y0+5, color);
-			drawPixel(x0+5, y0+6, color);
-			drawPixel(x0+5, y0+7, color);
-			drawPixel(x0+5, y0+8, color);
-			drawPixel(x0+6, y0+9, color);
-			break;
-		case 0x6F: // o
-			drawPixel(x0+1, y0+5, color);
-			drawPixel(x0+1, y0+6, color);
-			drawPixel(x0+1, y0+7, color);
-			drawPixel(x0+2, y0+4, color);
-			drawPixel(x0+2, y0+8, color);
-			drawPixel(x0+3, y0+3, color);
-			drawPixel(x0+3, y0+9, color);
-			drawPixel(x0+4, y0+3, color);
-			drawPixel(x0+4, y0+9, color);
-			drawPixel(x0+5, y0+4, color);
-			drawPixel(x0+5, y0+8, color);
-			drawPixel(x0+6, y0+5, color);
-			drawPixel(x0+6, y0+6, color);
-			drawPixel(x0+6, y0+7, color);
-			break;
-		case 0x70: // p
-			drawPixel(x0+1, y0+3, color);
-			drawPixel(x0+1, y0+4, color);
-			drawPixel(x0+1, y0+5, color);
-			drawPixel(x0+1, y0+6, color);
-			drawPixel(x0+1, y0+7, color);
-			drawPixel(x0+1, y0+8, color);
-			drawPixel(x0+1, y0+9, color);
-			drawPixel(x0+1, y0+10, color);
-			drawPixel(x0+1, y0+11, color);
-			drawPixel(x0+2, y0+4, color);
-			drawPixel(x0+2, y0+8, color);
-			drawPixel(x0+3, y0+3, color);
-			drawPixel(x0+3, y0+9, color);
-			drawPixel(x0+4, y0+3, color);
-			drawPixel(x0+4, y0+9, color);
-			drawPixel(x0+5, y0+4, color);
-			drawPixel(x0+5, y0+8, color);
-			drawPixel(x0+6, y0+5, color);
-			drawPixel(x0+6, y0+6, color);
-			drawPixel(x0+6, y0+7, color);
-			break;
-		case 0x72: // r
-			drawPixel(x0+1, y0+3, color);
-			drawPixel(x0+1, y0+4, color);
-			drawPixel(x0+1, y0+5, color);
-			drawPixel(x0+1, y0+6, color);
-			drawPixel(x0+1, y0+7, color);
-			drawPixel(x0+1, y0+8, color);
-			drawPixel(x0+1, y0+9, color);
-			drawPixel(x0+2, y0+4, color);
-			drawPixel(x0+3, y0+3, color);
-			break;
-		case 0x73: // s
-			drawPixel(x0+1, y0+4, color);
-			drawPixel(x0+1, y0+5, color);
-			drawPixel(x0+1, y0+8, color);
-			drawPixel(x0+2, y0+3, color);
-			drawPixel(x0+2, y0+6, color);
-			drawPixel(x0+2, y0+9, color);
-			drawPixel(x0+3, y0+3, color);
-			drawPixel(x0+3, y0+6, color);
-			drawPixel(x0+3, y0+9, color);
-			drawPixel(x0+4, y0+4, color);
-			drawPixel(x0+4, y0+6, color);
-			drawPixel(x0+4, y0+9, color);
-			drawPixel(x0+5, y0+7, color);
-			drawPixel(x0+5, y0+8, color);
-			break;
-		case 0x74: // t
-			drawPixel(x0, y0+2, color);
-			drawPixel(x0+1, y0, color);
-			drawPixel(x0+1, y0+1, color);
-			drawPixel(x0+1, y0+2, color);
-			drawPixel(x0+1, y0+3, color);
-			drawPixel(x0+1, y0+4, color);
-			drawPixel(x0+1, y0+5, color);
-			drawPixel(x0+1, y0+6, color);
-			drawPixel(x0+1, y0+7, color);
-			drawPixel(x0+1, y0+8, color);
-			drawPixel(x0+2, y0+2, color);
-			drawPixel(x0+2, y0+9, color);
-			break;
-	}
-}
-
 /***************************************************************************************
  * INITIALIZE USCI
  **************************************************************************************/
@@ -1947,45 +1317,125 @@ void initUSCI(void) {
 
 /***************************************************************************************
  * INTERRUPT USCI
+ * 		SPI byte to the LCD done, or the UART has room for the next link byte
  **************************************************************************************/
-#pragma INTERRUPT (USCI)
+#if defined(__TI_COMPILER_VERSION__)
 #pragma vector=USCIAB0TX_VECTOR
-void USCI(void) {
-	P2OUT |= LCD_CS;						// transmission done
-	IFG2 &= ~UCB0TXIFG;					// clear TXIFG
+__interrupt void USCI(void) {
+#else
+void __attribute__((interrupt(USCIAB0TX_VECTOR))) USCI(void) {
+#endif
+	if (IFG2 & UCB0TXIFG) {
+		P2OUT |= LCD_CS;						// transmission done
+		IFG2 &= ~UCB0TXIFG;					// clear TXIFG
+	}
+	if ((IE2 & UCA0TXIE) && (IFG2 & UCA0TXIFG)) {
+		if (linkTxTail != linkTxHead)
+			UCA0TXBUF = linkTx[linkTxTail++ & (LINK_RING - 1)];
+		else
+			IE2 &= ~UCA0TXIE;					// ring empty
+	}
+}
+
+/***************************************************************************************
+ * INTERRUPT LINK RX
+ * 		Byte in from the other unit, into the ring and wake the main loop. A full ring
+ * 		or a UART overrun loses a byte, linkLost tells linkReceive.
+ **************************************************************************************/
+#if defined(__TI_COMPILER_VERSION__)
+#pragma vector=USCIAB0RX_VECTOR
+__interrupt void Link_RX(void) {
+#else
+void __attribute__((interrupt(USCIAB0RX_VECTOR))) Link_RX(void) {
+#endif
+	unsigned char stat = UCA0STAT;		// before RXBUF, reading that clears UCOE
+	unsigned char byte = UCA0RXBUF;
+
+	if ((stat & UCOE) || (unsigned char)(linkRxHead - linkRxTail) == LINK_RING)
+		linkLost = true;
+	else
+		linkRx[linkRxHead++ & (LINK_RING - 1)] = byte;
+	events |= EV_LINK;
+	_BIC_SR_IRQ(LPM4_bits);
+}
+
+/***************************************************************************************
+ * INTERRUPT TIMER
+ * 		Posts the tick and wakes the main loop
+ **************************************************************************************/
+#if defined(__TI_COMPILER_VERSION__)
+#pragma vector=TIMER0_A0_VECTOR
+__interrupt void Timer_A(void) {
+#else
+void __attribute__((interrupt(TIMER0_A0_VECTOR))) Timer_A(void) {
+#endif
+	PROF_START();
+
+	events |= EV_TICK;
+	PROF_STOP(PROF_TICK);
+	_BIC_SR_IRQ(LPM4_bits);
 }
 
 /***************************************************************************************
  * INTERRUPT PORT1
- * 		Interrupt happens when the rotate key gets pressed. It sets the rotate key
- * 		variable to true.
+ * 		Interrupt happens when the rotate key gets pressed. It posts the rotate event
+ * 		and wakes the main loop.
  **************************************************************************************/
+#if defined(__TI_COMPILER_VERSION__)
 #pragma vector=PORT1_VECTOR
 __interrupt void Port_1(void) {
-	rotateKey = true;
-	keyPress += 18;
+#else
+void __attribute__((interrupt(PORT1_VECTOR))) Port_1(void) {
+#endif
+	PROF_START();
+
+	events |= EV_ROTATE;
 	P1IFG &= ~BTN_ROT;
 	P2IFG &= ~BTN_LFT;
 	P2IFG &= ~BTN_RGHT;
+	PROF_STOP(PROF_BUTTON);
+	_BIC_SR_IRQ(LPM4_bits);
 }
 
 /***************************************************************************************
  * INTERRUPT PORT2
- * 		Interrupt happens when the left or right key gets pressed. It sets the left or
- * 		right key variable to true, accordingly, based off what pin is turned on. (It's
- * 		actually wired backwards because I forgot that the buttons are high asserted. It
- * 		works regardless).
+ * 		Interrupt happens when the left or right key gets pressed. It posts the left or
+ * 		right event, accordingly, based off what pin is turned on. (It's actually wired
+ * 		backwards because I forgot that the buttons are high asserted. It works
+ * 		regardless).
  **************************************************************************************/
+#if defined(__TI_COMPILER_VERSION__)
 #pragma vector=PORT2_VECTOR
 __interrupt void Port_2(void) {
+#else
+void __attribute__((interrupt(PORT2_VECTOR))) Port_2(void) {
+#endif
+	PROF_START();
+
 	if (P2IN & BTN_RGHT) {
-		rightKey = true;
-		keyPress += 33;
+		events |= EV_RIGHT;
 	}	else if (P2IN & BTN_LFT) {
-		leftKey = true;
-		keyPress += 29;
+		events |= EV_LEFT;
 	}
 	P1IFG &= ~BTN_ROT;
 	P2IFG &= ~BTN_LFT;
 	P2IFG &= ~BTN_RGHT;
+	PROF_STOP(PROF_BUTTON);
+	_BIC_SR_IRQ(LPM4_bits);
+}
+
+#ifdef PROFILE
+/***************************************************************************************
+ * INTERRUPT PROFILE
+ * 		Timer1_A went round, every 65536 cycles
+ **************************************************************************************/
+#if defined(__TI_COMPILER_VERSION__)
+#pragma vector=TIMER1_A1_VECTOR
+__interrupt void Profile(void) {
+#else
+void __attribute__((interrupt(TIMER1_A1_VECTOR))) Profile(void) {
+#endif
+	if (TA1IV == TA1IV_TAIFG)			// reading it clears it
+		profHigh++;
 }
+#endif
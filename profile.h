@@ -0,0 +1,76 @@
+/***************************************************************************************
+ * PROFILE
+ * 		Where a unit's cycles go, measured on the unit. make firmware PROFILE=1 builds
+ * 		with -DPROFILE, anything else builds PROF_START and PROF_STOP to nothing.
+ *
+ * 		A region is timed with Timer1_A counting SMCLK, so in MCLK cycles, and goes into
+ * 		its own histogram: PROF_BUCKETS counts by powers of 8 cycles from 64 up, and the
+ * 		most it ever took. Counts are a byte, when one would go over they all halve,
+ * 		halved goes up and from then on only a random 1 in 2^halved calls is counted.
+ * 		So the shape stays right and calls is about the sum << halved.
+ * 		A region counts everything it called and any interrupt taken in it.
+ *
+ * 		Not the SPI interrupt, it's ~20 cycles a byte and timing it would double what
+ * 		every draw costs. build/fwbench has it.
+ *
+ * 		Holding rotate and tapping the title sends the histograms out of the UART pins
+ * 		at LINK_BAUD 8N1 and starts them over. The profile build has no versus: its
+ * 		RAM is where the two peer Games were, and the UART is the one they'd talk
+ * 		over. build/profdump reads a dump. A dump is
+ * 			PROF_MAGIC0 PROF_MAGIC1 PROF_VERSION regions buckets
+ * 			then for each region: counts[buckets] halved most
+ * 			then the sum of every byte before it, 16 bits low first
+ * 		most is cycles in a byte, 3 bits of mantissa: under 16 as is, else bits 7-3
+ * 		are e + 1 and it's (8 + bits 2-0) << e, about 1 in 8 either way.
+ **************************************************************************************/
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Regions
+#define PROF_FITS				0				// engine.c
+#define PROF_LOCK				1
+#define PROF_CLEAR			2
+#define PROF_STEP				3				// main.c, a whole game tick with its drawing
+#define PROF_TOUCH			4				// readTS, both ADC reads
+#define PROF_STICK			5				// readJoystick
+#define PROF_TICK				6				// Timer_A interrupt
+#define PROF_BUTTON			7				// Port_1 and Port_2 interrupts
+#define PROF_SQUARE			8				// draw.c
+#define PROF_PIECE			9
+#define PROF_LEVEL			10			// fillLevelColor
+#define PROF_SCORE			11
+#define PROF_BACKGROUND	12
+#define PROF_SCREEN			13			// fillScreen
+#define PROF_RECT				14
+#define PROF_PIXEL			15
+#define PROF_TEXT				16			// drawInstruction
+#define PROF_LETTER			17
+#define PROF_REGIONS		18
+
+#define PROF_BUCKETS		6				// < 64, < 512, < 4K, < 32K, < 256K, more
+#define PROF_FIRST			64			// cycles the first bucket ends at
+#define PROF_HALVED			15			// most halvings, counts stop there
+#define PROF_MAGIC0			0xC5
+#define PROF_MAGIC1			0x3A
+#define PROF_VERSION		1
+#define PROF_DUMP				(5 + PROF_REGIONS * (2 + PROF_BUCKETS) + 2)	// bytes a dump
+
+typedef struct {
+	unsigned char counts[PROF_BUCKETS];
+	unsigned char halved;
+	unsigned char most;					// the most cycles, in a byte as a dump has it
+} ProfRegion;
+
+#ifdef PROFILE
+// from the platform
+unsigned long profNow(void);
+void profAdd(unsigned char, unsigned long);
+
+#define PROF_START()		unsigned long profTime = profNow()
+#define PROF_STOP(region)	profAdd(region, profNow() - profTime)
+#else
+#define PROF_START()
+#define PROF_STOP(region)
+#endif
+
+#endif
@@ -0,0 +1,387 @@
+/***************************************************************************************
+ * REPLAY
+ * 		Recorder and player for the replay format in replay.h. No hardware and no
+ * 		malloc, the same code runs on the unit and on a host.
+ **************************************************************************************/
+#include "replay.h"
+
+static void put16(Recorder *, unsigned int);
+static void put32(Recorder *, uint32_t);
+static void putVarint(Recorder *, uint32_t);
+static bool getVarint(Player *, uint32_t *);
+static uint32_t get32(const unsigned char *);
+static bool keyframeLoad(Player *, Game *);
+static bool indexFind(Player *, uint32_t);
+
+/***************************************************************************************
+ * RECORD START
+ * 		Writes the header. put gets every byte of the replay, context goes along with it.
+ **************************************************************************************/
+void recordStart(Recorder *r, void (*put)(void *, unsigned char), void *context, unsigned int seed) {
+	r->put = put;
+	r->context = context;
+	r->last = 0;
+	r->stick = 0;
+	r->bytes = 0;
+	r->keyEvery = 0;
+	r->lastKey = 0;
+	r->index = NULL;
+	r->indexSize = 0;
+	r->keys = 0;
+
+	r->put(r->context, 'T');
+	r->put(r->context, 'R');
+	r->put(r->context, 'P');
+	r->put(r->context, 'L');
+	r->put(r->context, REPLAY_VERSION);
+	r->put(r->context, GRACE_TICKS);
+	r->put(r->context, PRESS_ROT);
+	r->put(r->context, PRESS_RGHT);
+	r->put(r->context, PRESS_LFT);
+	r->put(r->context, 0);
+	r->bytes = 10;
+	put16(r, ENGINE_BUILD);
+	put16(r, seed);
+}
+
+/***************************************************************************************
+ * RECORD KEYFRAMES
+ * 		Asks for a keyframe every so many ticks. Closer together seeks faster and
+ * 		costs 2 + GAME_PACKED bytes more each. With index (room for size tick, offset
+ * 		pairs) recordEnd writes the index after the end record.
+ **************************************************************************************/
+void recordKeyframes(Recorder *r, uint32_t every, uint32_t *index, unsigned int size) {
+	r->keyEvery = every;
+	r->lastKey = r->last;
+	r->index = index;
+	r->indexSize = index ? size : 0;
+}
+
+/***************************************************************************************
+ * RECORD TICK
+ * 		Call with the game and input just before gameTick. Writes garbage about to
+ * 		come up, and the input if it has presses or a new joystick zone.
+ **************************************************************************************/
+void recordTick(Recorder *r, const Game *g, unsigned char in) {
+	uint32_t tick = g->tick + 1;
+	unsigned char packed[GAME_PACKED];
+	int i;
+
+	// garbage before the keyframe, g already has it so the snapshot does too
+	if (g->garbage) {
+		putVarint(r, tick - r->last);
+		r->put(r->context, REPLAY_GARBAGE + g->garbage);
+		r->put(r->context, g->hole);
+		r->bytes += 2;
+		r->last = tick;
+	}
+	// then the keyframe, so the input plays on from it
+	if (r->keyEvery && tick - r->lastKey >= r->keyEvery) {
+		putVarint(r, tick - r->last);
+		if (r->keys < r->indexSize) {
+			r->index[2 * r->keys] = tick;
+			r->index[2 * r->keys + 1] = r->bytes;
+		}
+		r->keys++;
+		r->put(r->context, REPLAY_KEYFRAME);
+		r->put(r->context, r->stick);
+		gamePack(g, packed);
+		for (i = 0; i < GAME_PACKED; i++)
+			r->put(r->context, packed[i]);
+		r->bytes += 2 + GAME_PACKED;
+		r->last = tick;
+		r->lastKey = tick;
+	}
+	if ((in & ~IN_STICK) || (in & IN_STICK) != r->stick) {
+		putVarint(r, tick - r->last);
+		r->put(r->context, in & 0x1F);
+		r->bytes++;
+		r->last = tick;
+		r->stick = in & IN_STICK;
+	}
+}
+
+/***************************************************************************************
+ * RECORD END
+ * 		Game over (or stopped), marks the tick and what the game looked like then
+ **************************************************************************************/
+void recordEnd(Recorder *r, const Game *g) {
+	uint32_t h = gameHash(g);
+	unsigned int n = r->keys < r->indexSize ? r->keys : r->indexSize;
+	unsigned int i;
+
+	putVarint(r, g->tick - r->last);
+	r->put(r->context, REPLAY_END);
+	r->put(r->context, h);
+	r->put(r->context, h >> 8);
+	r->put(r->context, h >> 16);
+	r->put(r->context, h >> 24);
+	r->bytes += 5;
+	r->last = g->tick;
+
+	if (r->index) {
+		for (i = 0; i < 2 * n; i++)
+			put32(r, r->index[i]);
+		put32(r, n);
+		r->put(r->context, 'T');
+		r->put(r->context, 'K');
+		r->put(r->context, 'I');
+		r->put(r->context, 'X');
+		r->bytes += 4;
+	}
+}
+
+/***************************************************************************************
+ * REPLAY OPEN
+ * 		Checks the header against this build and starts g from the replay's seed.
+ * 		Returns 0, or REPLAY_BAD if it isn't a replay this engine can play.
+ **************************************************************************************/
+int replayOpen(Player *p, const unsigned char *data, size_t length, Game *g) {
+	uint32_t delta;
+
+	p->data = data;
+	p->length = length;
+	p->at = REPLAY_HEADER;
+	p->stick = 0;
+	p->ended = false;
+
+	if (length < REPLAY_HEADER || data[0] != 'T' || data[1] != 'R' || data[2] != 'P' ||
+			data[3] != 'L' || data[4] != REPLAY_VERSION)
+		return REPLAY_BAD;
+	if (data[5] != GRACE_TICKS || data[6] != PRESS_ROT || data[7] != PRESS_RGHT ||
+			data[8] != PRESS_LFT || (data[10] | (data[11] << 8)) != ENGINE_BUILD)
+		return REPLAY_BAD;							// different rules, it would play out differently
+
+	gameReset(g, data[12] | (data[13] << 8));
+	if (!getVarint(p, &delta))
+		return REPLAY_BAD;
+	p->next = delta;
+	return 0;
+}
+
+/***************************************************************************************
+ * REPLAY STEP
+ * 		Runs g one tick on the recorded input. Returns what gameTick did, or REPLAY_DONE
+ * 		at the end if g came out the same as when it was recorded, REPLAY_BAD if not.
+ **************************************************************************************/
+int replayStep(Player *p, Game *g) {
+	unsigned char in = p->stick;
+	unsigned char kind;
+	unsigned char packed[GAME_PACKED];
+	uint32_t h;
+	uint32_t delta;
+	int i;
+
+	if (p->ended)
+		return REPLAY_BAD;
+
+	for (;;) {
+		if (p->at >= p->length)
+			return REPLAY_BAD;
+		kind = p->data[p->at];
+
+		if (kind == REPLAY_END) {
+			if (p->next != g->tick)
+				break;									// still ticks to run before it
+			p->ended = true;
+			if (p->at + 5 > p->length)
+				return REPLAY_BAD;
+			h = get32(p->data + p->at + 1);
+			p->at += 5;
+			return h == gameHash(g) ? REPLAY_DONE : REPLAY_BAD;
+		}
+		if (p->next != g->tick + 1)
+			break;										// nothing more for this tick
+		p->at++;
+
+		if (kind == REPLAY_KEYFRAME) {
+			// played here from the start, so it should match exactly
+			if (p->at + REPLAY_KEY_SIZE > p->length)
+				return REPLAY_BAD;
+			gamePack(g, packed);
+			for (i = 0; i < GAME_PACKED; i++)
+				if (packed[i] != p->data[p->at + 1 + i])
+					return REPLAY_BAD;
+			p->stick = p->data[p->at];
+			p->at += REPLAY_KEY_SIZE;
+		} else if (kind > REPLAY_GARBAGE) {
+			if (p->at >= p->length)
+				return REPLAY_BAD;
+			g->garbage = kind - REPLAY_GARBAGE;
+			g->hole = p->data[p->at++];
+		} else if (kind < 0x20) {
+			in = kind;
+			p->stick = kind & IN_STICK;
+		} else {
+			return REPLAY_BAD;
+		}
+
+		if (!getVarint(p, &delta))
+			return REPLAY_BAD;
+		p->next += delta;
+	}
+
+	if (p->next <= g->tick || !g->gameAlive)
+		return REPLAY_BAD;						// records behind the game, or no end after game over
+	return gameTick(g, in);
+}
+
+/***************************************************************************************
+ * REPLAY SEEK
+ * 		Puts g where it was after tick, from the last keyframe at or before it rather
+ * 		than from the start. Returns 0 there, REPLAY_DONE if the game ended first,
+ * 		REPLAY_BAD if the replay is broken.
+ **************************************************************************************/
+int replaySeek(Player *p, Game *g, uint32_t tick) {
+	size_t keyAt = 0;
+	uint32_t keyTick = 0;
+	uint32_t delta;
+	unsigned char kind;
+	int ge = 0;
+
+	if (replayOpen(p, p->data, p->length, g))
+		return REPLAY_BAD;
+
+	// the index gets close, then walk the records for any keyframe after it
+	if (indexFind(p, tick)) {
+		keyAt = p->at;
+		keyTick = p->next;
+		p->at += 1 + REPLAY_KEY_SIZE;
+		if (!getVarint(p, &delta))
+			return REPLAY_BAD;
+		p->next += delta;
+	}
+	while (p->next <= tick + 1 && p->at < p->length) {
+		kind = p->data[p->at];
+		if (kind == REPLAY_END)
+			break;
+		if (kind == REPLAY_KEYFRAME) {
+			keyAt = p->at;
+			keyTick = p->next;
+			p->at += 1 + REPLAY_KEY_SIZE;
+		} else {
+			p->at += kind > REPLAY_GARBAGE ? 2 : 1;
+		}
+		if (!getVarint(p, &delta))
+			return REPLAY_BAD;
+		p->next += delta;
+	}
+
+	// back to the header if there was no keyframe, else start from it
+	if (keyAt == 0) {
+		if (replayOpen(p, p->data, p->length, g))
+			return REPLAY_BAD;
+	} else {
+		p->at = keyAt;
+		p->next = keyTick;
+		if (!keyframeLoad(p, g))
+			return REPLAY_BAD;
+	}
+
+	while (g->tick < tick && (ge = replayStep(p, g)) >= 0);
+	return ge < 0 ? ge : 0;
+}
+
+/***************************************************************************************
+ * KEYFRAME LOAD
+ * 		p is at a keyframe, g takes its snapshot and p moves on past it
+ **************************************************************************************/
+static bool keyframeLoad(Player *p, Game *g) {
+	uint32_t delta;
+
+	if (p->at + 1 + REPLAY_KEY_SIZE > p->length || p->data[p->at] != REPLAY_KEYFRAME)
+		return false;
+	p->stick = p->data[p->at + 1];
+	gameUnpack(g, p->data + p->at + 2);
+	if (g->tick + 1 != p->next)
+		return false;
+	p->at += 1 + REPLAY_KEY_SIZE;
+	if (!getVarint(p, &delta))
+		return false;
+	p->next += delta;
+	return true;
+}
+
+/***************************************************************************************
+ * INDEX FIND
+ * 		Binary search of the index for the last keyframe at or before tick + 1. Leaves
+ * 		p on it and returns true, or false if there is no index or no such keyframe.
+ **************************************************************************************/
+static bool indexFind(Player *p, uint32_t tick) {
+	const unsigned char *end = p->data + p->length;
+	const unsigned char *entries;
+	uint32_t count;
+	uint32_t lo = 0;
+	uint32_t hi;
+	uint32_t mid;
+	uint32_t at;
+
+	if (p->length < REPLAY_HEADER + 8 || end[-4] != 'T' || end[-3] != 'K' || end[-2] != 'I' ||
+			end[-1] != 'X')
+		return false;
+	count = get32(end - 8);
+	if (count == 0 || count > (p->length - REPLAY_HEADER - 8) / 8)
+		return false;
+	entries = end - 8 - 8 * (size_t)count;
+
+	// first entry past tick + 1, the one before it is ours
+	hi = count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (get32(entries + 8 * mid) <= tick + 1)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return false;
+	at = get32(entries + 8 * (lo - 1) + 4);
+	if (at >= p->length || p->data[at] != REPLAY_KEYFRAME)
+		return false;
+	p->at = at;
+	p->next = get32(entries + 8 * (lo - 1));
+	return true;
+}
+
+/***************************************************************************************
+ * PUT 16 / PUT 32 / PUT VARINT / GET VARINT / GET 32
+ **************************************************************************************/
+static void put16(Recorder *r, unsigned int n) {
+	r->put(r->context, n & 0xFF);
+	r->put(r->context, (n >> 8) & 0xFF);
+	r->bytes += 2;
+}
+
+static void put32(Recorder *r, uint32_t n) {
+	put16(r, n & 0xFFFF);
+	put16(r, n >> 16);
+}
+
+static void putVarint(Recorder *r, uint32_t n) {
+	while (n >= 0x80) {
+		r->put(r->context, (n & 0x7F) | 0x80);
+		r->bytes++;
+		n >>= 7;
+	}
+	r->put(r->context, n);
+	r->bytes++;
+}
+
+static bool getVarint(Player *p, uint32_t *n) {
+	unsigned int shift = 0;
+	unsigned char b;
+
+	*n = 0;
+	do {
+		if (p->at >= p->length || shift > 28)
+			return false;
+		b = p->data[p->at++];
+		*n |= (uint32_t)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return true;
+}
+
+static uint32_t get32(const unsigned char *b) {
+	return b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
@@ -0,0 +1,79 @@
+/***************************************************************************************
+ * REPLAY
+ * 		Record a game as its seed and inputs, play it back bit for bit on any build of
+ * 		the same engine.
+ *
+ * 		Header, 14 bytes:
+ * 			'T' 'R' 'P' 'L'  version  grace  rot  right  left  0  build(2)  seed(2)
+ * 		grace and the press weights are the rule settings the game was played with,
+ * 		build is ENGINE_BUILD. Numbers are little endian.
+ *
+ * 		Then one record per event, each starting with the ticks since the last event
+ * 		as a varint (7 bits a byte, low first, top bit set on all but the last):
+ * 			0x00-0x1F	input byte for that tick (IN_ presses and joystick zone)
+ * 			0x40+rows	garbage coming up that tick, then a byte with its hole column
+ * 			0xFE			keyframe, the joystick bits then gamePack of the game before
+ * 								that tick, GAME_PACKED bytes. Garbage that tick comes before it
+ * 								and is in it.
+ * 			0xFF			end of game, then the gameHash of the end, 4 bytes
+ * 		Ticks with no record get no presses and the joystick zone of the last input.
+ * 		Only presses and joystick changes are recorded, a few KB for a long game.
+ *
+ * 		Keyframes go in every so many ticks if the recorder is asked for them, so a
+ * 		seek starts from the nearest one instead of from the first tick. After the end
+ * 		record an index of them can follow, 8 bytes each (tick, offset of the 0xFE),
+ * 		then their count and 'T' 'K' 'I' 'X' as the last 8 bytes of the file. With
+ * 		the index a seek finds its keyframe with a binary search, without one it
+ * 		walks the records.
+ *
+ * 		The recorder hands out one byte at a time, so it needs no buffer and can write
+ * 		straight to a UART or flash.
+ **************************************************************************************/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include "engine.h"
+
+#define REPLAY_VERSION	1
+#define REPLAY_HEADER		14			// bytes
+#define REPLAY_GARBAGE	0x40		// record kinds, see above
+#define REPLAY_KEYFRAME	0xFE
+#define REPLAY_END			0xFF
+#define REPLAY_KEY_SIZE	(1 + GAME_PACKED)	// keyframe bytes after its kind
+
+// replayStep when there is no game left
+#define REPLAY_DONE			-1			// played to the end and the hash matched
+#define REPLAY_BAD			-2			// cut short, garbled, or the game came out different
+
+typedef struct {
+	void (*put)(void *, unsigned char);	// where the bytes go
+	void *context;											// handed back to put
+	uint32_t last;					// tick of the last record
+	uint8_t stick;					// joystick bits of the last input record
+	unsigned long bytes;		// written so far, also where the next record starts
+	uint32_t keyEvery;			// ticks between keyframes, 0 for none
+	uint32_t lastKey;				// tick of the last keyframe
+	uint32_t *index;				// tick, offset pairs for the index, NULL for none
+	unsigned int indexSize;	// pairs index has room for
+	unsigned int keys;			// keyframes written
+} Recorder;
+
+typedef struct {
+	const unsigned char *data;
+	size_t length;
+	size_t at;							// next record
+	uint32_t next;					// tick of the next record
+	uint8_t stick;					// joystick bits held between records
+	bool ended;
+} Player;
+
+void recordStart(Recorder *, void (*)(void *, unsigned char), void *, unsigned int);
+void recordTick(Recorder *, const Game *, unsigned char);
+void recordKeyframes(Recorder *, uint32_t, uint32_t *, unsigned int);
+void recordEnd(Recorder *, const Game *);
+int replayOpen(Player *, const unsigned char *, size_t, Game *);
+int replayStep(Player *, Game *);
+int replaySeek(Player *, Game *, uint32_t);
+
+#endif